@@ -0,0 +1,64 @@
+/*
+
+  The code in this file is released into the Public Domain.
+
+*/
+
+#include <osmium/handler.hpp>
+#include <osmium/io/any_input.hpp>
+#include <osmium/parallel_apply.hpp>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+struct CountHandler : public osmium::handler::Handler {
+
+    uint64_t counter = 0;
+    uint64_t all = 0;
+
+    void node(const osmium::Node& node) {
+        ++all;
+        const char* amenity = node.tags().get_value_by_key("amenity");
+        if (amenity && !strcmp(amenity, "post_box")) {
+            ++counter;
+        }
+    }
+
+    void way(const osmium::Way& /*way*/) {
+        ++all;
+    }
+
+    void relation(const osmium::Relation& /*relation*/) {
+        ++all;
+    }
+
+};
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " OSMFILE\n";
+        std::exit(1);
+    }
+
+    try {
+        const std::string input_filename{argv[1]};
+
+        osmium::io::Reader reader{input_filename};
+
+        CountHandler result;
+        osmium::parallel_apply(reader, CountHandler{}, [&result](CountHandler&& handler) {
+            result.all += handler.all;
+            result.counter += handler.counter;
+        });
+        reader.close();
+
+        std::cout << "r_all=" << result.all << " r_counter=" << result.counter << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::exit(1);
+    }
+}
+
@@ -37,6 +37,8 @@ int main(int argc, char* argv[]) {
 
         osmium::apply(reader, location_handler);
         reader.close();
+
+        std::cout << "Memory used by index: " << (index->used_memory() / (1024 * 1024)) << " MBytes\n";
     } catch (const std::exception& e) {
         std::cerr << e.what() << '\n';
         std::exit(1);
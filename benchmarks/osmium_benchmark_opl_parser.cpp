@@ -0,0 +1,91 @@
+/*
+
+  The code in this file is released into the Public Domain.
+
+  Converts an OSM file into OPL format in memory and parses it again with
+  the scalar code and the SIMD code supported by the CPU. Checks that both
+  produce the same buffers.
+
+*/
+
+#include <osmium/io/any_input.hpp>
+#include <osmium/io/detail/opl_output_format.hpp>
+#include <osmium/io/detail/opl_parser_functions.hpp>
+#include <osmium/io/detail/opl_simd.hpp>
+#include <osmium/memory/buffer.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char* level_name(osmium::io::detail::opl_simd_level level) noexcept {
+    return level == osmium::io::detail::opl_simd_level::sse42 ? "sse42" : "scalar";
+}
+
+static osmium::memory::Buffer parse(const std::vector<const char*>& lines, double& seconds) {
+    osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+
+    const auto start = std::chrono::steady_clock::now();
+    uint64_t line_count = 0;
+    for (const char* line : lines) {
+        osmium::io::detail::opl_parse_line(line_count++, line, buffer);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+    seconds += std::chrono::duration<double>(stop - start).count();
+
+    return buffer;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " OSMFILE\n";
+        std::exit(1);
+    }
+
+    try {
+        const auto simd_level = osmium::io::detail::set_opl_simd_level(osmium::io::detail::opl_simd_level::sse42);
+
+        std::size_t bytes = 0;
+        double seconds_scalar = 0.0;
+        double seconds_simd = 0.0;
+
+        osmium::io::Reader reader{argv[1]};
+        while (osmium::memory::Buffer input_buffer = reader.read()) {
+            std::string opl{osmium::io::detail::OPLOutputBlock{std::move(input_buffer), osmium::io::detail::opl_output_options{}}()};
+            bytes += opl.size();
+
+            std::vector<const char*> lines;
+            std::size_t pos = 0;
+            for (auto end = opl.find('\n'); end != std::string::npos; end = opl.find('\n', pos)) {
+                opl[end] = '\0';
+                lines.push_back(&opl[pos]);
+                pos = end + 1;
+            }
+
+            osmium::io::detail::set_opl_simd_level(osmium::io::detail::opl_simd_level::none);
+            const auto buffer_scalar = parse(lines, seconds_scalar);
+
+            osmium::io::detail::set_opl_simd_level(simd_level);
+            const auto buffer_simd = parse(lines, seconds_simd);
+
+            if (buffer_scalar.committed() != buffer_simd.committed() ||
+                std::memcmp(buffer_scalar.data(), buffer_simd.data(), buffer_scalar.committed()) != 0) {
+                std::cerr << "Buffers parsed with scalar and " << level_name(simd_level) << " code differ\n";
+                std::exit(1);
+            }
+        }
+        reader.close();
+
+        std::cout << "bytes " << bytes << '\n';
+        std::cout << "parse_" << level_name(osmium::io::detail::opl_simd_level::none) << ' ' << seconds_scalar << "s "
+                  << (static_cast<double>(bytes) / seconds_scalar / (1024 * 1024)) << "MB/s\n";
+        std::cout << "parse_" << level_name(simd_level) << ' ' << seconds_simd << "s "
+                  << (static_cast<double>(bytes) / seconds_simd / (1024 * 1024)) << "MB/s\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::exit(1);
+    }
+}
@@ -0,0 +1,163 @@
+/*
+
+  The code in this file is released into the Public Domain.
+
+  Compares the throughput of stock zlib and the zlib backend used by
+  Libosmium (libdeflate if compiled with OSMIUM_WITH_LIBDEFLATE) when
+  uncompressing and compressing the data blobs of a PBF file.
+
+*/
+
+#include <osmium/io/detail/mapped_input.hpp>
+#include <osmium/io/detail/pbf_input_format.hpp>
+#include <osmium/io/detail/zlib.hpp>
+#include <osmium/io/error.hpp>
+
+#include <protozero/pbf_message.hpp>
+
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct blob {
+    protozero::data_view zlib_data;
+    unsigned long raw_size; // NOLINT(google-runtime-int)
+};
+
+static std::vector<blob> get_blobs(const osmium::io::detail::MappedInput& input) {
+    std::vector<blob> blobs;
+
+    const char* expected_type = "OSMHeader";
+    std::size_t offset = 0;
+    while (offset < input.size()) {
+        if (input.size() - offset < sizeof(uint32_t)) {
+            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+        }
+        const auto header_size = osmium::io::detail::decode_blob_header_size(input.data() + offset);
+        offset += sizeof(uint32_t);
+
+        if (input.size() - offset < header_size) {
+            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+        }
+        const auto size = osmium::io::detail::decode_blob_header(protozero::data_view{input.data() + offset, header_size}, expected_type);
+        offset += header_size;
+        osmium::io::detail::check_blob_size(size);
+        expected_type = "OSMData";
+
+        if (input.size() - offset < size) {
+            throw osmium::pbf_error{"truncated data (EOF encountered)"};
+        }
+
+        blob b{protozero::data_view{}, 0};
+        protozero::pbf_message<osmium::io::detail::FileFormat::Blob> pbf_blob{protozero::data_view{input.data() + offset, size}};
+        while (pbf_blob.next()) {
+            switch (pbf_blob.tag_and_type()) {
+                case protozero::tag_and_type(osmium::io::detail::FileFormat::Blob::optional_int32_raw_size, protozero::pbf_wire_type::varint): {
+                        const auto raw_size = pbf_blob.get_int32();
+                        if (raw_size <= 0 || static_cast<uint32_t>(raw_size) > osmium::io::detail::max_uncompressed_blob_size) {
+                            throw osmium::pbf_error{"illegal blob size"};
+                        }
+                        b.raw_size = static_cast<unsigned long>(raw_size); // NOLINT(google-runtime-int)
+                    }
+                    break;
+                case protozero::tag_and_type(osmium::io::detail::FileFormat::Blob::optional_bytes_zlib_data, protozero::pbf_wire_type::length_delimited):
+                    b.zlib_data = pbf_blob.get_view();
+                    break;
+                default:
+                    pbf_blob.skip();
+            }
+        }
+        if (!b.zlib_data.empty()) {
+            blobs.push_back(b);
+        }
+        offset += size;
+    }
+
+    return blobs;
+}
+
+template <typename TFunc>
+static void run(const char* name, std::size_t bytes, TFunc&& func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const auto stop = std::chrono::steady_clock::now();
+    const auto seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << name << ' ' << seconds << "s " << (static_cast<double>(bytes) / seconds / (1024 * 1024)) << "MB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " PBF-FILE\n";
+        std::exit(1);
+    }
+
+    try {
+        const auto input = osmium::io::detail::map_input_file(argv[1]);
+        if (!input) {
+            std::cerr << "Can not map input file\n";
+            std::exit(1);
+        }
+
+        const auto blobs = get_blobs(*input);
+        std::size_t raw_bytes = 0;
+        for (const auto& b : blobs) {
+            raw_bytes += b.raw_size;
+        }
+
+#ifdef OSMIUM_WITH_LIBDEFLATE
+        std::cout << "backend libdeflate\n";
+#else
+        std::cout << "backend zlib\n";
+#endif
+        std::cout << "blobs " << blobs.size() << " raw_bytes " << raw_bytes << '\n';
+
+        std::vector<std::string> uncompressed(blobs.size());
+
+        run("inflate_zlib", raw_bytes, [&]() {
+            for (std::size_t i = 0; i < blobs.size(); ++i) {
+                auto raw_size = blobs[i].raw_size;
+                uncompressed[i].resize(raw_size);
+                if (::uncompress(reinterpret_cast<unsigned char*>(&*uncompressed[i].begin()), &raw_size,
+                                 reinterpret_cast<const unsigned char*>(blobs[i].zlib_data.data()),
+                                 static_cast<unsigned long>(blobs[i].zlib_data.size())) != Z_OK) { // NOLINT(google-runtime-int)
+                    throw std::runtime_error{"zlib error"};
+                }
+            }
+        });
+
+        run("inflate_osmium", raw_bytes, [&]() {
+            std::string output;
+            for (const auto& b : blobs) {
+                osmium::io::detail::zlib_uncompress_string(b.zlib_data.data(), static_cast<unsigned long>(b.zlib_data.size()), b.raw_size, output); // NOLINT(google-runtime-int)
+            }
+        });
+
+        run("deflate_zlib", raw_bytes, [&]() {
+            for (const auto& data : uncompressed) {
+                unsigned long output_size = ::compressBound(static_cast<unsigned long>(data.size())); // NOLINT(google-runtime-int)
+                std::string output(output_size, '\0');
+                if (::compress(reinterpret_cast<unsigned char*>(&*output.begin()), &output_size,
+                               reinterpret_cast<const unsigned char*>(data.data()),
+                               static_cast<unsigned long>(data.size())) != Z_OK) { // NOLINT(google-runtime-int)
+                    throw std::runtime_error{"zlib error"};
+                }
+            }
+        });
+
+        run("deflate_osmium", raw_bytes, [&]() {
+            for (const auto& data : uncompressed) {
+                osmium::io::detail::zlib_compress(data);
+            }
+        });
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        std::exit(1);
+    }
+}
+
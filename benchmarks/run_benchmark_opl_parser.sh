@@ -0,0 +1,21 @@
+#!/bin/sh
+#
+#  run_benchmark_opl_parser.sh
+#
+
+set -e
+
+BENCHMARK_NAME=opl_parser
+
+. @CMAKE_BINARY_DIR@/benchmarks/setup.sh
+
+CMD=$OB_DIR/osmium_benchmark_$BENCHMARK_NAME
+
+echo "# file size num operation seconds throughput"
+for data in $OB_DATA_FILES; do
+    filename=`basename $data`
+    filesize=`stat --format="%s" --dereference $data`
+    for n in $OB_SEQ; do
+        $CMD $data | grep '^parse_' | sed -e "s%^%$filename $filesize $n %"
+    done
+done
@@ -0,0 +1,26 @@
+#!/bin/sh
+#
+#  run_benchmark_pbf_zlib.sh
+#
+
+set -e
+
+BENCHMARK_NAME=pbf_zlib
+
+. @CMAKE_BINARY_DIR@/benchmarks/setup.sh
+
+CMD=$OB_DIR/osmium_benchmark_$BENCHMARK_NAME
+
+echo "# file size num operation seconds throughput"
+for data in $OB_DATA_FILES; do
+    filename=`basename $data`
+    filesize=`stat --format="%s" --dereference $data`
+    case $filename in
+        *.pbf)
+            for n in $OB_SEQ; do
+                $CMD $data | grep '^[di]' | sed -e "s%^%$filename $filesize $n %"
+            done
+            ;;
+    esac
+done
+
@@ -34,6 +34,9 @@
 #      gdal       - include if you want to use any of the OGR functions
 #      proj       - include if you want to use any of the Proj.4 functions
 #      sparsehash - include if you use the sparsehash index
+#      libdeflate - use libdeflate instead of zlib for PBF blobs (faster)
+#      zstd       - include if you want to read/write zstd compressed PBF blobs
+#      lz4        - include if you want to read/write lz4 compressed PBF blobs
 #
 #    You can check for success with something like this:
 #
@@ -131,6 +134,57 @@ if(Osmium_USE_PBF)
     endif()
 endif()
 
+#----------------------------------------------------------------------
+# Component 'libdeflate'
+if(Osmium_USE_LIBDEFLATE)
+    find_path(LIBDEFLATE_INCLUDE_DIR libdeflate.h)
+    find_library(LIBDEFLATE_LIBRARY NAMES deflate libdeflate)
+
+    list(APPEND OSMIUM_EXTRA_FIND_VARS LIBDEFLATE_INCLUDE_DIR LIBDEFLATE_LIBRARY)
+    if(LIBDEFLATE_INCLUDE_DIR AND LIBDEFLATE_LIBRARY)
+        set(LIBDEFLATE_FOUND 1)
+        add_definitions(-DOSMIUM_WITH_LIBDEFLATE)
+        list(APPEND OSMIUM_PBF_LIBRARIES ${LIBDEFLATE_LIBRARY})
+        list(APPEND OSMIUM_INCLUDE_DIRS ${LIBDEFLATE_INCLUDE_DIR})
+    else()
+        message(WARNING "Osmium: libdeflate library is required but not found, please install it or configure the paths.")
+    endif()
+endif()
+
+#----------------------------------------------------------------------
+# Component 'zstd'
+if(Osmium_USE_ZSTD)
+    find_path(ZSTD_INCLUDE_DIR zstd.h)
+    find_library(ZSTD_LIBRARY NAMES zstd)
+
+    list(APPEND OSMIUM_EXTRA_FIND_VARS ZSTD_INCLUDE_DIR ZSTD_LIBRARY)
+    if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+        set(ZSTD_FOUND 1)
+        add_definitions(-DOSMIUM_WITH_ZSTD)
+        list(APPEND OSMIUM_PBF_LIBRARIES ${ZSTD_LIBRARY})
+        list(APPEND OSMIUM_INCLUDE_DIRS ${ZSTD_INCLUDE_DIR})
+    else()
+        message(WARNING "Osmium: zstd library is required but not found, please install it or configure the paths.")
+    endif()
+endif()
+
+#----------------------------------------------------------------------
+# Component 'lz4'
+if(Osmium_USE_LZ4)
+    find_path(LZ4_INCLUDE_DIR lz4hc.h)
+    find_library(LZ4_LIBRARY NAMES lz4)
+
+    list(APPEND OSMIUM_EXTRA_FIND_VARS LZ4_INCLUDE_DIR LZ4_LIBRARY)
+    if(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+        set(LZ4_FOUND 1)
+        add_definitions(-DOSMIUM_WITH_LZ4)
+        list(APPEND OSMIUM_PBF_LIBRARIES ${LZ4_LIBRARY})
+        list(APPEND OSMIUM_INCLUDE_DIRS ${LZ4_INCLUDE_DIR})
+    else()
+        message(WARNING "Osmium: lz4 library is required but not found, please install it or configure the paths.")
+    endif()
+endif()
+
 #----------------------------------------------------------------------
 # Component 'xml'
 if(Osmium_USE_XML)
@@ -36,17 +36,22 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/area/assembler_config.hpp>
 #include <osmium/area/detail/basic_assembler_with_tags.hpp>
 #include <osmium/area/detail/segment_list.hpp>
+#include <osmium/area/detail/vector.hpp>
 #include <osmium/area/problem_reporter.hpp>
 #include <osmium/area/stats.hpp>
 #include <osmium/builder/osm_object_builder.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/item_type.hpp>
+#include <osmium/osm/location.hpp>
 #include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/relation.hpp>
 #include <osmium/osm/tag.hpp>
 #include <osmium/osm/way.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -57,9 +62,103 @@ namespace osmium {
         /**
          * Assembles area objects from closed ways or multipolygon relations
          * and their members.
+         *
+         * An Assembler can be used for any number of areas one after the
+         * other. It keeps the memory it needs internally for re-use, so
+         * that after a while assembling small areas doesn't need any new
+         * memory allocations. The stats() are for the last area only.
          */
         class Assembler : public detail::BasicAssemblerWithTags {
 
+            // Up to this number of segments the intersection check for
+            // simple ways uses the nested loop, above it the sweep line.
+            enum : std::size_t {
+                max_segments_nested_intersection_check = 64
+            };
+
+            std::vector<osmium::Location> m_way_locations;
+
+            /**
+             * Fast path for the common case of a closed way forming a
+             * simple polygon: All locations are valid and distinct and no
+             * segments intersect. The ring is written directly without
+             * the ring building of the full assembly, but it starts at
+             * the same (smallest) location and is oriented counter-
+             * clockwise, so the result is the same.
+             *
+             * @returns false if the way isn't a simple polygon, in which
+             *          case nothing was written and the full assembly
+             *          must be used.
+             */
+            bool create_simple_way_area(osmium::memory::Buffer& out_buffer, const osmium::Way& way) {
+                const osmium::WayNodeList& nodes = way.nodes();
+                if (nodes.size() < 4 || !way.ends_have_same_id() ||
+                    config().problem_reporter || config().debug_level > 0) {
+                    return false;
+                }
+
+                const std::size_t num_segments = nodes.size() - 1;
+                if (nodes[0].location() != nodes[num_segments].location()) {
+                    return false;
+                }
+
+                // All locations must be valid and different from each
+                // other. While checking, find the smallest location
+                // where the ring will start and the winding order.
+                m_way_locations.clear();
+                std::size_t start = 0;
+                int64_t sum = 0;
+                for (std::size_t i = 0; i < num_segments; ++i) {
+                    const osmium::Location location = nodes[i].location();
+                    if (!location.valid()) {
+                        return false;
+                    }
+                    if (location < nodes[start].location()) {
+                        start = i;
+                    }
+                    sum += detail::vec{location} * detail::vec{nodes[i + 1].location()};
+                    m_way_locations.push_back(location);
+                }
+
+                std::sort(m_way_locations.begin(), m_way_locations.end());
+                if (sum == 0 || std::adjacent_find(m_way_locations.cbegin(), m_way_locations.cend()) != m_way_locations.cend()) {
+                    return false;
+                }
+
+                // No segments may intersect each other.
+                uint64_t duplicate_nodes = 0;
+                segment_list().extract_segments_from_way(nullptr, duplicate_nodes, way);
+                segment_list().sort();
+                const uint32_t intersections = num_segments > max_segments_nested_intersection_check ?
+                                               segment_list().find_intersections_sweep_line(nullptr) :
+                                               segment_list().find_intersections(nullptr);
+                segment_list().clear();
+                if (intersections > 0) {
+                    return false;
+                }
+
+                {
+                    osmium::builder::AreaBuilder builder{out_buffer};
+                    builder.initialize_from_object(way);
+                    builder.add_item(way.tags());
+
+                    osmium::builder::OuterRingBuilder ring_builder{builder};
+                    for (std::size_t i = 0; i <= num_segments; ++i) {
+                        const std::size_t n = sum > 0 ? start + i : start + num_segments - i;
+                        ring_builder.add_node_ref(nodes[n % num_segments]);
+                    }
+                }
+                out_buffer.commit();
+
+                ++stats().from_ways;
+                ++stats().area_simple_case;
+                ++stats().area_simple_way_case;
+                ++stats().outer_rings;
+                stats().nodes = num_segments;
+
+                return true;
+            }
+
             bool create_area(osmium::memory::Buffer& out_buffer, const osmium::Way& way) {
                 osmium::builder::AreaBuilder builder{out_buffer};
                 builder.initialize_from_object(way);
@@ -119,6 +218,8 @@ namespace osmium {
              *          area, true otherwise.
              */
             bool operator()(const osmium::Way& way, osmium::memory::Buffer& out_buffer) {
+                reset();
+
                 if (!config().create_way_polygons) {
                     return true;
                 }
@@ -134,6 +235,10 @@ namespace osmium {
                     return false;
                 }
 
+                if (create_simple_way_area(out_buffer, way)) {
+                    return true;
+                }
+
                 if (!way.ends_have_same_id()) {
                     ++stats().duplicate_nodes;
                     if (config().problem_reporter) {
@@ -177,6 +282,8 @@ namespace osmium {
              *          area(s), true otherwise.
              */
             bool operator()(const osmium::Relation& relation, const std::vector<const osmium::Way*>& members, osmium::memory::Buffer& out_buffer) {
+                reset();
+
                 if (!config().create_new_style_polygons) {
                     return true;
                 }
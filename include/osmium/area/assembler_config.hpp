@@ -124,6 +124,16 @@ namespace osmium {
              */
             bool ignore_invalid_locations = false;
 
+            /**
+             * Use a sweep line algorithm to find intersecting segments
+             * instead of the default nested loop. The result is exactly
+             * the same, but the sweep line is much faster for multipolygons
+             * with many segments (like large boundaries or land use
+             * areas). For small multipolygons the nested loop is a bit
+             * faster.
+             */
+            bool sweep_line_intersections = false;
+
             AssemblerConfig() noexcept = default;
 
             /**
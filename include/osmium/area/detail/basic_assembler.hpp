@@ -105,6 +105,13 @@ namespace osmium {
 
                 static constexpr const std::size_t max_split_locations = 100ull;
 
+                // reset() keeps the memory for up to this many rings and
+                // locations.
+                enum : std::size_t {
+                    max_kept_rings = 1000ull,
+                    max_kept_locations = 128ull * 1024ull
+                };
+
                 struct slocation {
 
                     enum {
@@ -152,12 +159,19 @@ namespace osmium {
                 // The rings we are building from the segments
                 std::list<ProtoRing> m_rings;
 
+                // Rings not used any more, kept for re-use
+                std::list<ProtoRing> m_unused_rings;
+
                 // All node locations
                 std::vector<slocation> m_locations;
 
                 // All locations where more than two segments start/end
                 std::vector<Location> m_split_locations;
 
+                // Locations visited while finding candidates in
+                // join_connected_rings()
+                std::unordered_set<osmium::Location> m_loc_done;
+
                 // Statistics
                 area_stats m_stats;
 
@@ -419,8 +433,7 @@ namespace osmium {
                     }
                     segment->mark_direction_done();
 
-                    m_rings.emplace_back(segment);
-                    ProtoRing* ring = &m_rings.back();
+                    ProtoRing* ring = add_ring(segment);
                     if (outer_ring) {
                         if (debug()) {
                             std::cerr << "    This is an inner ring. Outer ring is " << *outer_ring << "\n";
@@ -470,8 +483,7 @@ namespace osmium {
                         segment->reverse();
                     }
 
-                    m_rings.emplace_back(segment);
-                    ProtoRing* ring = &m_rings.back();
+                    ProtoRing* ring = add_ring(segment);
 
                     const osmium::Location& first_location = node.location(m_segment_list);
                     osmium::Location last_location = segment->stop().location();
@@ -642,7 +654,7 @@ namespace osmium {
                     }
 
                     open_ring_its.erase(std::find(open_ring_its.begin(), open_ring_its.end(), r2));
-                    m_rings.erase(r2);
+                    m_unused_rings.splice(m_unused_rings.end(), m_rings, r2);
 
                     if (r1->closed()) {
                         open_ring_its.erase(std::find(open_ring_its.begin(), open_ring_its.end(), r1));
@@ -798,12 +810,11 @@ namespace osmium {
 
                     // Locations we have visited while finding candidates, used
                     // to detect loops.
-                    std::unordered_set<osmium::Location> loc_done;
-
-                    loc_done.insert(cand.stop_location);
+                    m_loc_done.clear();
+                    m_loc_done.insert(cand.stop_location);
 
                     std::vector<candidate> candidates;
-                    find_candidates(candidates, loc_done, xrings, cand);
+                    find_candidates(candidates, m_loc_done, xrings, cand);
 
                     if (candidates.empty()) {
                         if (debug()) {
@@ -939,6 +950,20 @@ namespace osmium {
                     return true;
                 }
 
+                /**
+                 * Add a new ring containing the given segment. Re-uses a
+                 * ring from an earlier run of the assembler if possible.
+                 */
+                ProtoRing* add_ring(NodeRefSegment* segment) {
+                    if (m_unused_rings.empty()) {
+                        m_rings.emplace_back(segment);
+                    } else {
+                        m_rings.splice(m_rings.end(), m_unused_rings, m_unused_rings.begin());
+                        m_rings.back().reinitialize(segment);
+                    }
+                    return &m_rings.back();
+                }
+
 #ifdef OSMIUM_WITH_TIMER
                 static bool print_header() {
                     std::cout << "nodes outer_rings inner_rings sort dupl intersection locations split simple_case complex_case roles_check\n";
@@ -953,6 +978,35 @@ namespace osmium {
 
             protected:
 
+                /**
+                 * Reset the assembler to its initial state so that it can
+                 * be used to assemble the next area. The memory allocated
+                 * for the segments, rings and locations is kept for re-use
+                 * (unless it was very large). This also resets the stats.
+                 * Called at the start of every assembler run.
+                 */
+                void reset() {
+                    m_segment_list.clear();
+                    m_unused_rings.splice(m_unused_rings.end(), m_rings);
+                    if (m_unused_rings.size() > max_kept_rings) {
+                        m_unused_rings.clear();
+                    }
+                    m_locations.clear();
+                    if (m_locations.capacity() > max_kept_locations) {
+                        m_locations.shrink_to_fit();
+                    }
+                    m_split_locations.clear();
+                    if (m_split_locations.capacity() > max_kept_locations) {
+                        m_split_locations.shrink_to_fit();
+                    }
+                    m_loc_done.clear();
+                    if (m_loc_done.bucket_count() > max_kept_locations) {
+                        m_loc_done = std::unordered_set<osmium::Location>{};
+                    }
+                    m_stats = area_stats{};
+                    m_num_members = 0;
+                }
+
                 const std::list<ProtoRing>& rings() const noexcept {
                     return m_rings;
                 }
@@ -1020,7 +1074,11 @@ namespace osmium {
                     // In the future this could be improved by trying to fix those
                     // cases.
                     osmium::Timer timer_intersection;
-                    m_stats.intersections = m_segment_list.find_intersections(m_config.problem_reporter);
+                    if (m_config.sweep_line_intersections) {
+                        m_stats.intersections = m_segment_list.find_intersections_sweep_line(m_config.problem_reporter);
+                    } else {
+                        m_stats.intersections = m_segment_list.find_intersections(m_config.problem_reporter);
+                    }
                     timer_intersection.stop();
 
                     if (m_stats.intersections) {
@@ -46,10 +46,16 @@ DEALINGS IN THE SOFTWARE.
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <limits>
+#include <map>
 #include <numeric>
+#include <queue>
+#include <set>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace osmium {
@@ -84,6 +90,11 @@ namespace osmium {
 
                 using slist_type = std::vector<NodeRefSegment>;
 
+                // clear() keeps the memory of up to this many segments.
+                enum : std::size_t {
+                    max_kept_segments = 64UL * 1024UL
+                };
+
                 slist_type m_segments{};
 
                 bool m_debug;
@@ -210,6 +221,17 @@ namespace osmium {
                     m_debug = debug;
                 }
 
+                /**
+                 * Remove all segments from the list. The memory is kept
+                 * for re-use unless the list was very large.
+                 */
+                void clear() {
+                    m_segments.clear();
+                    if (m_segments.capacity() > max_kept_segments) {
+                        m_segments.shrink_to_fit();
+                    }
+                }
+
                 /// Sort the list of segments.
                 void sort() {
                     std::sort(m_segments.begin(), m_segments.end());
@@ -351,6 +373,152 @@ namespace osmium {
                     return found_intersections;
                 }
 
+                /**
+                 * Find intersections between segments using a sweep line.
+                 * This finds and reports the same intersections in the
+                 * same order as find_intersections(), but it is much
+                 * faster for large numbers of segments.
+                 *
+                 * The segments are visited in order of their first x
+                 * coordinate. Segments that still reach the current x
+                 * coordinate are active. The candidates for intersections
+                 * with the current segment are the active segments that
+                 * overlap it in y direction: Those containing its smallest
+                 * y coordinate, found in an interval tree (a segment tree
+                 * on all y coordinates), and those starting inside its y
+                 * range, found in a map ordered by smallest y coordinate.
+                 * So the time needed only depends on the number of
+                 * candidates, even if some segments are very long.
+                 *
+                 * @param problem_reporter Any intersections found are
+                 *                         reported to this object.
+                 * @returns number of intersections found.
+                 */
+                uint32_t find_intersections_sweep_line(ProblemReporter* problem_reporter) const {
+                    if (m_segments.empty()) {
+                        return 0;
+                    }
+
+                    struct intersection_type {
+                        std::size_t first;
+                        std::size_t second;
+                        osmium::Location location;
+
+                        bool operator<(const intersection_type& other) const noexcept {
+                            return std::make_pair(first, second) < std::make_pair(other.first, other.second);
+                        }
+                    };
+
+                    // All y coordinates of the segments. The leaves of the
+                    // interval tree are the indexes into this vector.
+                    std::vector<int32_t> ys;
+                    ys.reserve(m_segments.size() * 2);
+                    for (const NodeRefSegment& segment : m_segments) {
+                        ys.push_back(segment.first().location().y());
+                        ys.push_back(segment.second().location().y());
+                    }
+                    std::sort(ys.begin(), ys.end());
+                    ys.erase(std::unique(ys.begin(), ys.end()), ys.end());
+
+                    const auto leaf = [&ys](const int32_t y) {
+                        return ys.size() + static_cast<std::size_t>(std::lower_bound(ys.begin(), ys.end(), y) - ys.begin());
+                    };
+
+                    // Bottom-up segment tree: Each segment is added to the
+                    // nodes covering its y range, so all segments containing
+                    // a y coordinate are found on the path from its leaf to
+                    // the root. Segments are removed from the nodes lazily
+                    // when they are not active any more.
+                    std::vector<std::vector<std::size_t>> tree(ys.size() * 2);
+
+                    // Active segments by smallest y coordinate
+                    using active_type = std::multimap<int32_t, std::size_t>;
+                    active_type active;
+                    std::vector<active_type::iterator> active_pos(m_segments.size());
+                    std::vector<bool> is_active(m_segments.size(), false);
+
+                    // Largest x coordinate of active segments
+                    using end_type = std::pair<int32_t, std::size_t>;
+                    std::priority_queue<end_type, std::vector<end_type>, std::greater<end_type>> ends;
+
+                    std::vector<intersection_type> intersections;
+
+                    for (std::size_t i = 0; i < m_segments.size(); ++i) {
+                        const NodeRefSegment& s2 = m_segments[i];
+                        assert(s2.first().location().x() <= s2.second().location().x());
+
+                        // Remove segments ending before this one starts.
+                        while (!ends.empty() && ends.top().first < s2.first().location().x()) {
+                            const auto n = ends.top().second;
+                            is_active[n] = false;
+                            active.erase(active_pos[n]);
+                            ends.pop();
+                        }
+
+                        const auto check = [&](const std::size_t n) {
+                            const NodeRefSegment& s1 = m_segments[n];
+
+                            assert(s1 != s2); // erase_duplicate_segments() should have made sure of that
+
+                            osmium::Location intersection{calculate_intersection(s1, s2)};
+                            if (intersection) {
+                                intersections.push_back(intersection_type{n, i, intersection});
+                            }
+                        };
+
+                        const std::pair<int32_t, int32_t> y2 = std::minmax(s2.first().location().y(), s2.second().location().y());
+
+                        // Active segments containing the smallest y
+                        // coordinate of this segment.
+                        for (std::size_t node = leaf(y2.first); node > 0; node >>= 1u) {
+                            auto& segments = tree[node];
+                            segments.erase(std::remove_if(segments.begin(), segments.end(), [&is_active](const std::size_t n) {
+                                return !is_active[n];
+                            }), segments.end());
+                            for (const auto n : segments) {
+                                check(n);
+                            }
+                        }
+
+                        // Active segments starting inside the y range of
+                        // this segment.
+                        const auto end = active.upper_bound(y2.second);
+                        for (auto it = active.upper_bound(y2.first); it != end; ++it) {
+                            check(it->second);
+                        }
+
+                        for (std::size_t l = leaf(y2.first), r = leaf(y2.second) + 1; l < r; l >>= 1u, r >>= 1u) {
+                            if (l & 1u) {
+                                tree[l++].push_back(i);
+                            }
+                            if (r & 1u) {
+                                tree[--r].push_back(i);
+                            }
+                        }
+                        active_pos[i] = active.emplace(y2.first, i);
+                        is_active[i] = true;
+                        ends.emplace(s2.second().location().x(), i);
+                    }
+
+                    // Report in the same order as the nested loop in
+                    // find_intersections() does.
+                    std::sort(intersections.begin(), intersections.end());
+
+                    for (const auto& intersection : intersections) {
+                        const NodeRefSegment& s1 = m_segments[intersection.first];
+                        const NodeRefSegment& s2 = m_segments[intersection.second];
+                        if (m_debug) {
+                            std::cerr << "  segments " << s1 << " and " << s2 << " intersecting at " << intersection.location << "\n";
+                        }
+                        if (problem_reporter) {
+                            problem_reporter->report_intersection(s1.way()->id(), s1.first().location(), s1.second().location(),
+                                                                  s2.way()->id(), s2.first().location(), s2.second().location(), intersection.location);
+                        }
+                    }
+
+                    return static_cast<uint32_t>(intersections.size());
+                }
+
             }; // class SegmentList
 
         } // namespace detail
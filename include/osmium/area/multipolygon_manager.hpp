@@ -34,6 +34,7 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/area/stats.hpp>
+#include <osmium/memory/buffer.hpp>
 #include <osmium/osm/item_type.hpp>
 #include <osmium/osm/relation.hpp>
 #include <osmium/osm/tag.hpp>
@@ -45,12 +46,18 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/storage/item_stash.hpp>
 #include <osmium/tags/taglist.hpp>
 #include <osmium/tags/tags_filter.hpp>
+#include <osmium/thread/pool.hpp>
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <future>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace osmium {
@@ -60,6 +67,135 @@ namespace osmium {
      */
     namespace area {
 
+        class Assembler;
+
+        /**
+         * Tells the MultipolygonManager whether one object of the
+         * assembler class can be used for many areas. This is only the
+         * case if the assembler resets all its state (including its
+         * stats) at the start of each call. Otherwise a new assembler is
+         * constructed for each area. Specialize this for your own
+         * assembler class deriving from std::true_type if it can be
+         * re-used.
+         */
+        template <typename TAssembler>
+        struct is_reusable_assembler : std::false_type {
+        };
+
+        template <>
+        struct is_reusable_assembler<Assembler> : std::true_type {
+        };
+
+        namespace detail {
+
+            /**
+             * Calls an assembler and returns the stats from that call.
+             * Keeps one assembler for all calls if it is reusable,
+             * otherwise constructs a new one for each call.
+             */
+            template <typename TAssembler, bool reusable = is_reusable_assembler<TAssembler>::value>
+            class assembler_caller {
+
+                TAssembler m_assembler;
+
+            public:
+
+                explicit assembler_caller(const typename TAssembler::config_type& config) :
+                    m_assembler(config) {
+                }
+
+                template <typename... TArgs>
+                area_stats operator()(TArgs&&... args) {
+                    m_assembler(std::forward<TArgs>(args)...);
+                    return m_assembler.stats();
+                }
+
+            }; // class assembler_caller
+
+            template <typename TAssembler>
+            class assembler_caller<TAssembler, false> {
+
+                typename TAssembler::config_type m_config;
+
+            public:
+
+                explicit assembler_caller(const typename TAssembler::config_type& config) :
+                    m_config(config) {
+                }
+
+                template <typename... TArgs>
+                area_stats operator()(TArgs&&... args) {
+                    TAssembler assembler{m_config};
+                    assembler(std::forward<TArgs>(args)...);
+                    return assembler.stats();
+                }
+
+            }; // class assembler_caller
+
+            /**
+             * The areas assembled from one batch of work items and the
+             * statistics from assembling them.
+             */
+            struct assembled_areas {
+                osmium::memory::Buffer buffer;
+                area_stats stats;
+            };
+
+            /**
+             * Assembles the areas from a buffer with work items in the
+             * thread pool. A work item is either a closed way or a relation
+             * followed by its member ways.
+             */
+            template <typename TAssembler>
+            class assemble_areas_task {
+
+                typename TAssembler::config_type m_config;
+                osmium::memory::Buffer m_work;
+
+            public:
+
+                assemble_areas_task(const typename TAssembler::config_type& config, osmium::memory::Buffer&& work) :
+                    m_config(config),
+                    m_work(std::move(work)) {
+                }
+
+                assembled_areas operator()() {
+                    assembled_areas result{osmium::memory::Buffer{m_work.committed(), osmium::memory::Buffer::auto_grow::yes}, area_stats{}};
+                    std::vector<const osmium::Way*> ways;
+                    assembler_caller<TAssembler> assembler{m_config};
+
+                    auto it = m_work.cbegin();
+                    while (it != m_work.cend()) {
+                        try {
+                            if (it->type() == osmium::item_type::way) {
+                                const auto& way = static_cast<const osmium::Way&>(*it);
+                                ++it;
+                                result.stats += assembler(way, result.buffer);
+                            } else {
+                                const auto& relation = static_cast<const osmium::Relation&>(*it);
+                                ++it;
+                                ways.clear();
+                                for (const auto& member : relation.members()) {
+                                    if (member.ref() != 0) {
+                                        assert(it != m_work.cend() && it->type() == osmium::item_type::way);
+                                        ways.push_back(&static_cast<const osmium::Way&>(*it));
+                                        ++it;
+                                    }
+                                }
+                                result.stats += assembler(relation, ways, result.buffer);
+                            }
+                        } catch (const osmium::invalid_location&) {
+                            // XXX ignore
+                        }
+                    }
+
+                    return result;
+                }
+
+            }; // class assemble_areas_task
+
+        } // namespace detail
+
         /**
          * This class collects all data needed for creating areas from
          * relations tagged with type=multipolygon or type=boundary.
@@ -69,7 +205,10 @@ namespace osmium {
          * The actual assembling of the areas is done by the assembler
          * class given as template argument.
          *
-         * @tparam TAssembler Multipolygon Assembler class.
+         * @tparam TAssembler Multipolygon Assembler class. The manager uses
+         *                    one assembler object for many areas if
+         *                    is_reusable_assembler<TAssembler> is true,
+         *                    otherwise it constructs one for each area.
          * @pre The Ids of all objects must be unique in the input data.
          */
         template <typename TAssembler>
@@ -78,10 +217,66 @@ namespace osmium {
             using assembler_config_type = typename TAssembler::config_type;
             const assembler_config_type m_assembler_config;
 
+            // Used for all areas assembled in this thread.
+            detail::assembler_caller<TAssembler> m_assembler;
+
             area_stats m_stats;
 
             osmium::TagsFilter m_filter;
 
+            // Batches of work items are handed to the pool when they
+            // reach this size (in bytes).
+            enum {
+                work_batch_size = 512UL * 1024UL
+            };
+
+            // Only set if the areas are assembled in the thread pool.
+            osmium::thread::Pool* m_pool = nullptr;
+            std::size_t m_max_in_flight = 0;
+
+            osmium::memory::Buffer m_work{};
+            std::deque<std::future<detail::assembled_areas>> m_results{};
+
+            void add_result(detail::assembled_areas&& result) {
+                m_stats += result.stats;
+                if (result.buffer.committed() > 0) {
+                    this->buffer().add_buffer(result.buffer);
+                    this->buffer().commit();
+                    this->possibly_flush();
+                }
+            }
+
+            // Add the results of all finished tasks to the output buffer,
+            // keeping the order in which the work was submitted. Waits for
+            // tasks if there are too many in flight or if wait_for_all is
+            // set.
+            void collect_results(const bool wait_for_all) {
+                while (!m_results.empty()) {
+                    auto& future = m_results.front();
+                    if (!wait_for_all && m_results.size() <= m_max_in_flight &&
+                        future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                        return;
+                    }
+                    detail::assembled_areas result{future.get()};
+                    m_results.pop_front();
+                    add_result(std::move(result));
+                }
+            }
+
+            void submit_work() {
+                if (m_work.committed() > 0) {
+                    m_results.push_back(m_pool->submit(detail::assemble_areas_task<TAssembler>{m_assembler_config, std::move(m_work)}));
+                    m_work = osmium::memory::Buffer{work_batch_size + work_batch_size / 4, osmium::memory::Buffer::auto_grow::yes};
+                }
+            }
+
+            void possibly_submit_work() {
+                if (m_work.committed() >= work_batch_size) {
+                    submit_work();
+                }
+                collect_results(false);
+            }
+
         public:
 
             /**
@@ -95,9 +290,30 @@ namespace osmium {
              */
             explicit MultipolygonManager(assembler_config_type assembler_config, osmium::TagsFilter filter = osmium::TagsFilter{true}) :
                 m_assembler_config(std::move(assembler_config)),
+                m_assembler(m_assembler_config),
                 m_filter(std::move(filter)) {
             }
 
+            MultipolygonManager(const MultipolygonManager&) = delete;
+            MultipolygonManager& operator=(const MultipolygonManager&) = delete;
+
+            MultipolygonManager(MultipolygonManager&&) = delete;
+            MultipolygonManager& operator=(MultipolygonManager&&) = delete;
+
+            /**
+             * Waits for all areas still being assembled in the thread
+             * pool, their results are discarded. The tasks might use the
+             * problem reporter from the assembler config, so they must
+             * not outlive the manager.
+             */
+            ~MultipolygonManager() noexcept {
+                for (auto& result : m_results) {
+                    if (result.valid()) {
+                        result.wait();
+                    }
+                }
+            }
+
             /**
              * Access the aggregated statistics generated by the assemblers
              * called from the manager.
@@ -106,6 +322,44 @@ namespace osmium {
                 return m_stats;
             }
 
+            /**
+             * Assemble the areas in the thread pool instead of the thread
+             * calling the handler. Call this before the second pass.
+             *
+             * Completed relations and closed ways are copied into batches
+             * which are assembled in the pool. The areas are added to the
+             * output in the same order as without this setting. Call
+             * flush_output() or read() (or use osmium::apply() which calls
+             * flush() on the handler) to get all areas at the end.
+             *
+             * The problem reporter from the assembler config, if any, is
+             * called from several threads at the same time. Don't set one
+             * unless it can cope with that.
+             *
+             * @param pool The thread pool to use.
+             * @param max_in_flight The maximum number of batches being
+             *                      assembled at the same time. Default
+             *                      (0) is twice the number of threads in
+             *                      the pool.
+             */
+            void assemble_in_pool(osmium::thread::Pool& pool = osmium::thread::Pool::default_instance(), std::size_t max_in_flight = 0) {
+                m_pool = &pool;
+                m_max_in_flight = max_in_flight == 0 ? 2 * static_cast<std::size_t>(pool.num_threads()) : max_in_flight;
+                m_work = osmium::memory::Buffer{work_batch_size + work_batch_size / 4, osmium::memory::Buffer::auto_grow::yes};
+            }
+
+            /**
+             * Wait for all areas being assembled in the thread pool and
+             * add them to the output buffer. This is called automatically
+             * from flush_output() and read().
+             */
+            void finish_output() {
+                if (m_pool) {
+                    submit_work();
+                    collect_results(true);
+                }
+            }
+
             /**
              * We are interested in all relations tagged with type=multipolygon
              * or type=boundary with at least one way member.
@@ -133,6 +387,20 @@ namespace osmium {
              * assembler.
              */
             void complete_relation(const osmium::Relation& relation) {
+                if (m_pool) {
+                    m_work.add_item(relation);
+                    for (const auto& member : relation.members()) {
+                        if (member.ref() != 0) {
+                            const osmium::Way* way = this->get_member_way(member.ref());
+                            assert(way != nullptr);
+                            m_work.add_item(*way);
+                        }
+                    }
+                    m_work.commit();
+                    possibly_submit_work();
+                    return;
+                }
+
                 std::vector<const osmium::Way*> ways;
                 ways.reserve(relation.members().size());
                 for (const auto& member : relation.members()) {
@@ -143,9 +411,7 @@ namespace osmium {
                 }
 
                 try {
-                    TAssembler assembler{m_assembler_config};
-                    assembler(relation, ways, this->buffer());
-                    m_stats += assembler.stats();
+                    m_stats += m_assembler(relation, ways, this->buffer());
                 } catch (const osmium::invalid_location&) {
                     // XXX ignore
                 }
@@ -170,9 +436,14 @@ namespace osmium {
                             return;
                         }
 
-                        TAssembler assembler{m_assembler_config};
-                        assembler(way, this->buffer());
-                        m_stats += assembler.stats();
+                        if (m_pool) {
+                            m_work.add_item(way);
+                            m_work.commit();
+                            possibly_submit_work();
+                            return;
+                        }
+
+                        m_stats += m_assembler(way, this->buffer());
                         this->possibly_flush();
                     }
                 } catch (const osmium::invalid_location&) {
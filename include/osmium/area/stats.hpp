@@ -49,6 +49,7 @@ namespace osmium {
         struct area_stats {
             uint64_t area_really_complex_case = 0; ///< Most difficult case with rings touching in multiple points
             uint64_t area_simple_case = 0; ///< Simple case, no touching rings
+            uint64_t area_simple_way_case = 0; ///< Simple closed way, built without the full assembly
             uint64_t area_touching_rings_case = 0; ///< More difficult case with touching rings
             uint64_t duplicate_nodes = 0; ///< Consecutive identical nodes or consecutive nodes with same location
             uint64_t duplicate_segments = 0; ///< Segments duplicated (going back and forth)
@@ -75,6 +76,7 @@ namespace osmium {
             area_stats& operator+=(const area_stats& other) noexcept {
                 area_really_complex_case += other.area_really_complex_case;
                 area_simple_case += other.area_simple_case;
+                area_simple_way_case += other.area_simple_way_case;
                 area_touching_rings_case += other.area_touching_rings_case;
                 duplicate_nodes += other.duplicate_nodes;
                 duplicate_segments += other.duplicate_segments;
@@ -105,6 +107,7 @@ namespace osmium {
         inline std::basic_ostream<TChar, TTraits>& operator<<(std::basic_ostream<TChar, TTraits>& out, const area_stats& s) {
             return out << " area_really_complex_case=" << s.area_really_complex_case
                        << " area_simple_case=" << s.area_simple_case
+                       << " area_simple_way_case=" << s.area_simple_way_case
                        << " area_touching_rings_case=" << s.area_touching_rings_case
                        << " duplicate_nodes=" << s.duplicate_nodes
                        << " duplicate_segments=" << s.duplicate_segments
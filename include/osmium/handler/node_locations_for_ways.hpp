@@ -37,14 +37,18 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/index/index.hpp>
 #include <osmium/index/map/dummy.hpp>
 #include <osmium/index/node_locations_map.hpp>
+#include <osmium/memory/buffer.hpp>
 #include <osmium/osm/location.hpp>
 #include <osmium/osm/node.hpp>
 #include <osmium/osm/node_ref.hpp>
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
 
+#include <algorithm>
 #include <limits>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -88,6 +92,15 @@ namespace osmium {
 
             bool m_must_sort = false;
 
+            // The IDs and node refs with positive IDs whose locations are
+            // looked up together and the IDs and locations used for
+            // looking them up. Kept here so their memory is reused.
+            std::vector<std::pair<osmium::unsigned_object_id_type, osmium::NodeRef*>> m_node_refs;
+            std::vector<osmium::unsigned_object_id_type> m_ids;
+            std::vector<osmium::Location> m_locations;
+
+            bool m_error = false;
+
             // It is okay to have this static dummy instance, even when using several threads,
             // because it is read-only.
             static dummy_type& get_dummy() {
@@ -142,29 +155,126 @@ namespace osmium {
                 return m_storage_neg.get_noexcept(static_cast<osmium::unsigned_object_id_type>(-id));
             }
 
-            /**
-             * Retrieve locations of all nodes in the way from storage and add
-             * them to the way object.
-             */
-            void way(osmium::Way& way) {
+        private:
+
+            void sort_if_needed() {
                 if (m_must_sort) {
                     m_storage_pos.sort();
                     m_storage_neg.sort();
                     m_must_sort = false;
                     m_last_id = std::numeric_limits<osmium::unsigned_object_id_type>::max();
                 }
-                bool error = false;
-                for (auto& node_ref : way.nodes()) {
-                    node_ref.set_location(get_node_location(node_ref.ref()));
+            }
+
+            // Remember the node ref for looking up its location later
+            // if it has a positive ID, look up negative IDs directly.
+            void add_node_ref(osmium::NodeRef& node_ref) {
+                if (node_ref.ref() >= 0) {
+                    m_node_refs.emplace_back(static_cast<osmium::unsigned_object_id_type>(node_ref.ref()), &node_ref);
+                } else {
+                    node_ref.set_location(m_storage_neg.get_noexcept(static_cast<osmium::unsigned_object_id_type>(-node_ref.ref())));
                     if (!node_ref.location()) {
-                        error = true;
+                        m_error = true;
                     }
                 }
+            }
+
+            // Look up the locations of all node refs in m_node_refs with
+            // one call to the index, so it can prefetch them.
+            void set_locations() {
+                m_ids.clear();
+                for (const auto& id_ref : m_node_refs) {
+                    m_ids.push_back(id_ref.first);
+                }
+
+                m_locations.resize(m_ids.size());
+                m_storage_pos.get_many_noexcept(m_ids.data(), m_locations.data(), m_ids.size());
+
+                auto location = m_locations.cbegin();
+                for (const auto& id_ref : m_node_refs) {
+                    id_ref.second->set_location(*location);
+                    if (!*location) {
+                        m_error = true;
+                    }
+                    ++location;
+                }
+
+                m_node_refs.clear();
+                const bool error = m_error;
+                m_error = false;
+
                 if (!m_ignore_errors && error) {
                     throw osmium::not_found{"location for one or more nodes not found in node location index"};
                 }
             }
 
+        public:
+
+            /**
+             * Retrieve locations of all nodes in the way from storage and add
+             * them to the way object.
+             */
+            void way(osmium::Way& way) {
+                sort_if_needed();
+
+                for (auto& node_ref : way.nodes()) {
+                    add_node_ref(node_ref);
+                }
+                set_locations();
+            }
+
+            /**
+             * Store the locations of all nodes in the buffer and then add
+             * the node locations to all ways in the buffer.
+             *
+             * This has the same effect as osmium::apply(buffer, handler)
+             * (except that nodes are stored before any way is handled),
+             * but the locations needed for all ways are looked up together
+             * ordered by node ID. For large indexes this touches far fewer
+             * memory pages than looking them up way by way.
+             *
+             * @throws osmium::not_found if a location is not found and
+             *         errors are not ignored. The locations of all ways
+             *         are set anyway.
+             */
+            void apply_to_buffer(osmium::memory::Buffer& buffer) {
+                for (const auto& node : buffer.select<osmium::Node>()) {
+                    this->node(node);
+                }
+
+                add_locations_to_ways(buffer);
+            }
+
+            /**
+             * Add the node locations to all ways in the buffer. Like
+             * apply_to_buffer(), but nodes in the buffer are ignored.
+             *
+             * This only reads from the indexes (unless they need to be
+             * sorted, because nodes were added out of order), so it can be
+             * called from several threads at the same time, each with its
+             * own NodeLocationsForWays object using the same indexes.
+             *
+             * @throws osmium::not_found if a location is not found and
+             *         errors are not ignored. The locations of all ways
+             *         are set anyway.
+             */
+            void add_locations_to_ways(osmium::memory::Buffer& buffer) {
+                sort_if_needed();
+
+                for (auto& way : buffer.select<osmium::Way>()) {
+                    for (auto& node_ref : way.nodes()) {
+                        add_node_ref(node_ref);
+                    }
+                }
+
+                std::sort(m_node_refs.begin(), m_node_refs.end(), [](const std::pair<osmium::unsigned_object_id_type, osmium::NodeRef*>& a,
+                                                                     const std::pair<osmium::unsigned_object_id_type, osmium::NodeRef*>& b) {
+                    return a.first < b.first;
+                });
+
+                set_locations();
+            }
+
             /**
              * Call clear on the location indexes. Makes the
              * NodeLocationsForWays handler unusable. Used to explicitly free
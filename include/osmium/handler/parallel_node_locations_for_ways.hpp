@@ -0,0 +1,268 @@
+#ifndef OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
+#define OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <utility>
+
+namespace osmium {
+
+    namespace handler {
+
+        namespace detail {
+
+            /**
+             * Task for the thread pool adding the node locations to all
+             * ways in a buffer.
+             */
+            template <typename TStoragePosIDs, typename TStorageNegIDs>
+            class add_locations_to_ways_task {
+
+                osmium::memory::Buffer m_buffer;
+                NodeLocationsForWays<TStoragePosIDs, TStorageNegIDs> m_handler;
+
+            public:
+
+                add_locations_to_ways_task(osmium::memory::Buffer&& buffer, TStoragePosIDs& storage_pos, TStorageNegIDs& storage_neg, bool ignore_errors) :
+                    m_buffer(std::move(buffer)),
+                    m_handler(storage_pos, storage_neg) {
+                    if (ignore_errors) {
+                        m_handler.ignore_errors();
+                    }
+                }
+
+                osmium::memory::Buffer operator()() {
+                    m_handler.add_locations_to_ways(m_buffer);
+                    return std::move(m_buffer);
+                }
+
+            }; // class add_locations_to_ways_task
+
+        } // namespace detail
+
+        /**
+         * Reads buffers from a source (usually an osmium::io::Reader) and
+         * adds the node locations to all ways in them using the threads of
+         * a thread pool. The buffers are returned from read() in the order
+         * they were read from the source.
+         *
+         * Buffers containing nodes are handled in the calling thread like
+         * the NodeLocationsForWays handler does: The node locations are
+         * stored in the indexes and then the locations are added to the
+         * ways in the buffer. This is done after all buffers handed to the
+         * pool before are finished. Buffers without nodes are handled in
+         * the pool. The indexes are only read then, so they are used from
+         * several threads at the same time. For a sorted OSM file (with
+         * all nodes before the ways) this means the nodes are stored
+         * serially and the ways are handled in parallel in a single pass.
+         *
+         * Indexes that need a call to sort() before they can be read
+         * (like SparseMemArray) are sorted after every buffer with nodes,
+         * which is slow. Fill them in a first pass, call sort(), and read
+         * only the ways in the second pass instead.
+         *
+         * @code
+         * osmium::io::Reader reader{filename, osmium::osm_entity_bits::node | osmium::osm_entity_bits::way};
+         * ParallelNodeLocationsForWays<osmium::io::Reader, index_type> source{reader, index};
+         * while (osmium::memory::Buffer buffer = source.read()) {
+         *     osmium::apply(buffer, handler);
+         * }
+         * @endcode
+         *
+         * @tparam TSource Class with read() function returning Buffers. An
+         *                 invalid buffer marks the end of data.
+         * @tparam TStoragePosIDs Index class for positive IDs.
+         * @tparam TStorageNegIDs Index class for negative IDs.
+         */
+        template <typename TSource, typename TStoragePosIDs, typename TStorageNegIDs = dummy_type>
+        class ParallelNodeLocationsForWays {
+
+            TSource& m_source;
+            TStoragePosIDs& m_storage_pos;
+            TStorageNegIDs& m_storage_neg;
+            NodeLocationsForWays<TStoragePosIDs, TStorageNegIDs> m_handler;
+            osmium::thread::Pool& m_pool;
+            std::size_t m_max_in_flight;
+            std::deque<std::future<osmium::memory::Buffer>> m_results;
+            std::exception_ptr m_error;
+            bool m_ignore_errors = false;
+            bool m_source_done = false;
+
+            // It is okay to have this static dummy instance, even when using several threads,
+            // because it is read-only.
+            static dummy_type& get_dummy() {
+                static dummy_type instance;
+                return instance;
+            }
+
+            void wait_for_tasks() noexcept {
+                for (auto& result : m_results) {
+                    result.wait();
+                }
+            }
+
+            // Store the node locations and add the locations to the ways
+            // in this thread. The tasks in the pool read the indexes, so
+            // they have to be done before.
+            void handle_buffer_with_nodes(osmium::memory::Buffer&& buffer) {
+                wait_for_tasks();
+
+                std::promise<osmium::memory::Buffer> promise;
+                m_results.push_back(promise.get_future());
+                try {
+                    m_handler.apply_to_buffer(buffer);
+                    promise.set_value(std::move(buffer));
+                } catch (...) {
+                    promise.set_exception(std::current_exception());
+                }
+            }
+
+            void fill_queue() {
+                while (!m_source_done && m_results.size() < m_max_in_flight) {
+                    osmium::memory::Buffer buffer = m_source.read();
+                    if (!buffer) {
+                        m_source_done = true;
+                        return;
+                    }
+                    if (buffer.select<osmium::Node>().begin() != buffer.select<osmium::Node>().end()) {
+                        handle_buffer_with_nodes(std::move(buffer));
+                    } else {
+                        m_results.push_back(m_pool.submit(detail::add_locations_to_ways_task<TStoragePosIDs, TStorageNegIDs>{
+                            std::move(buffer), m_storage_pos, m_storage_neg, m_ignore_errors}));
+                    }
+                }
+            }
+
+        public:
+
+            /**
+             * Create the pipeline stage.
+             *
+             * @param source The data source.
+             * @param storage_pos Index for positive IDs.
+             * @param storage_neg Index for negative IDs.
+             * @param pool The thread pool to use.
+             * @param max_in_flight Maximum number of buffers being handled
+             *                      at the same time. This limits the memory
+             *                      use. If 0, twice the number of threads
+             *                      in the pool is used.
+             */
+            ParallelNodeLocationsForWays(TSource& source,
+                                         TStoragePosIDs& storage_pos,
+                                         TStorageNegIDs& storage_neg,
+                                         osmium::thread::Pool& pool = osmium::thread::Pool::default_instance(),
+                                         std::size_t max_in_flight = 0) :
+                m_source(source),
+                m_storage_pos(storage_pos),
+                m_storage_neg(storage_neg),
+                m_handler(storage_pos, storage_neg),
+                m_pool(pool),
+                m_max_in_flight(max_in_flight == 0 ? 2 * static_cast<std::size_t>(pool.num_threads()) : max_in_flight) {
+            }
+
+            /**
+             * Create the pipeline stage without an index for negative IDs.
+             * See the other constructor for the parameters.
+             */
+            explicit ParallelNodeLocationsForWays(TSource& source,
+                                                  TStoragePosIDs& storage_pos,
+                                                  osmium::thread::Pool& pool = osmium::thread::Pool::default_instance(),
+                                                  std::size_t max_in_flight = 0) :
+                ParallelNodeLocationsForWays(source, storage_pos, get_dummy(), pool, max_in_flight) {
+            }
+
+            ParallelNodeLocationsForWays(const ParallelNodeLocationsForWays&) = delete;
+            ParallelNodeLocationsForWays& operator=(const ParallelNodeLocationsForWays&) = delete;
+
+            ParallelNodeLocationsForWays(ParallelNodeLocationsForWays&&) = delete;
+            ParallelNodeLocationsForWays& operator=(ParallelNodeLocationsForWays&&) = delete;
+
+            ~ParallelNodeLocationsForWays() noexcept {
+                // Wait for all tasks, they use the indexes.
+                wait_for_tasks();
+            }
+
+            /**
+             * Do not throw an exception if a location is not found. Call
+             * this before the first read().
+             */
+            void ignore_errors() {
+                m_ignore_errors = true;
+                m_handler.ignore_errors();
+            }
+
+            /**
+             * Get the next buffer with the node locations added to its
+             * ways.
+             *
+             * @returns Buffer or invalid buffer at the end of data.
+             * @throws Any exception thrown by the source and
+             *         osmium::not_found if a location is not found and
+             *         errors are not ignored. The buffer with the error
+             *         is not returned, so all later calls throw the same
+             *         exception again.
+             */
+            osmium::memory::Buffer read() {
+                if (m_error) {
+                    std::rethrow_exception(m_error);
+                }
+                fill_queue();
+                if (m_results.empty()) {
+                    return osmium::memory::Buffer{};
+                }
+                auto future = std::move(m_results.front());
+                m_results.pop_front();
+                try {
+                    return future.get();
+                } catch (...) {
+                    m_error = std::current_exception();
+                    throw;
+                }
+            }
+
+        }; // class ParallelNodeLocationsForWays
+
+    } // namespace handler
+
+} // namespace osmium
+
+#endif // OSMIUM_HANDLER_PARALLEL_NODE_LOCATIONS_FOR_WAYS_HPP
@@ -0,0 +1,102 @@
+#ifndef OSMIUM_HANDLER_STORE_NODE_LOCATIONS_HPP
+#define OSMIUM_HANDLER_STORE_NODE_LOCATIONS_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/decode_callback.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/types.hpp>
+
+namespace osmium {
+
+    namespace handler {
+
+        /**
+         * Create a Reader option that stores the locations of all nodes in
+         * the given indexes while the input is decoded in the threads of
+         * the thread pool:
+         *
+         * @code
+         * osmium::index::map::ConcurrentDenseMem<osmium::unsigned_object_id_type, osmium::Location> index;
+         * osmium::io::Reader reader{file, osmium::osm_entity_bits::node,
+         *                           osmium::handler::store_node_locations(index)};
+         * while (reader.read()) {
+         * }
+         * reader.close();
+         * @endcode
+         *
+         * The indexes must support calling set() from several threads at
+         * the same time, for instance osmium::index::map::ConcurrentDenseMem.
+         * They must stay valid until the Reader is closed.
+         *
+         * @param storage_pos Index for the nodes with positive IDs.
+         * @param storage_neg Index for the nodes with negative IDs.
+         */
+        template <typename TStoragePosIDs, typename TStorageNegIDs>
+        osmium::io::decode_callback store_node_locations(TStoragePosIDs& storage_pos, TStorageNegIDs& storage_neg) {
+            return osmium::io::decode_callback{[&storage_pos, &storage_neg](osmium::memory::Buffer& buffer) {
+                for (const auto& node : buffer.select<osmium::Node>()) {
+                    const auto id = node.id();
+                    if (id >= 0) {
+                        storage_pos.set(static_cast<osmium::unsigned_object_id_type>(id), node.location());
+                    } else {
+                        storage_neg.set(static_cast<osmium::unsigned_object_id_type>(-id), node.location());
+                    }
+                }
+            }};
+        }
+
+        /**
+         * Create a Reader option that stores the locations of all nodes in
+         * the given index while the input is decoded. Nodes with negative
+         * IDs are ignored. See the other overload for details.
+         *
+         * @param storage_pos Index for the nodes with positive IDs.
+         */
+        template <typename TStoragePosIDs>
+        osmium::io::decode_callback store_node_locations(TStoragePosIDs& storage_pos) {
+            return osmium::io::decode_callback{[&storage_pos](osmium::memory::Buffer& buffer) {
+                for (const auto& node : buffer.select<osmium::Node>()) {
+                    if (node.id() >= 0) {
+                        storage_pos.set(node.positive_id(), node.location());
+                    }
+                }
+            }};
+        }
+
+    } // namespace handler
+
+} // namespace osmium
+
+#endif // OSMIUM_HANDLER_STORE_NODE_LOCATIONS_HPP
@@ -36,6 +36,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/index/index.hpp>
 #include <osmium/index/map.hpp>
 #include <osmium/io/detail/read_write.hpp>
+#include <osmium/util/compatibility.hpp>
 
 #include <algorithm>
 #include <cstddef>
@@ -52,6 +53,11 @@ namespace osmium {
             template <typename TVector, typename TId, typename TValue>
             class VectorBasedDenseMap : public Map<TId, TValue> {
 
+                // How many ids ahead get_many_noexcept() prefetches.
+                enum {
+                    prefetch_distance = 16
+                };
+
                 TVector m_vector;
 
             public:
@@ -98,6 +104,16 @@ namespace osmium {
                     return m_vector[id];
                 }
 
+                void get_many_noexcept(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    const auto size = m_vector.size();
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + prefetch_distance < count && ids[i + prefetch_distance] < size) {
+                            OSMIUM_PREFETCH(&m_vector[ids[i + prefetch_distance]]);
+                        }
+                        values[i] = ids[i] < size ? m_vector[ids[i]] : osmium::index::empty_value<TValue>();
+                    }
+                }
+
                 std::size_t size() const final {
                     return m_vector.size();
                 }
@@ -145,6 +145,26 @@ namespace osmium {
                  */
                 virtual TValue get_noexcept(const TId id) const noexcept = 0;
 
+                /**
+                 * Retrieve values for many ids at once. The value for
+                 * ids[i] is written to values[i]. Ids that are not found
+                 * get the empty value, as in get_noexcept().
+                 *
+                 * Implementations can use this to tell the CPU which memory
+                 * they will need before they need it, which is much faster
+                 * for large indexes than looking up ids one by one. Lookups
+                 * are fastest if the ids are sorted.
+                 *
+                 * @param ids Pointer to the first of count ids.
+                 * @param values Pointer to space for count values.
+                 * @param count Number of ids to look up.
+                 */
+                virtual void get_many_noexcept(const TId* ids, TValue* values, const std::size_t count) const noexcept {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
                 /**
                  * Get the approximate number of items in the storage. The storage
                  * might allocate memory in blocks, so this size might not be
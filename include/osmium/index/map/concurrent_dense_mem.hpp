@@ -0,0 +1,259 @@
+#ifndef OSMIUM_INDEX_MAP_CONCURRENT_DENSE_MEM_HPP
+#define OSMIUM_INDEX_MAP_CONCURRENT_DENSE_MEM_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/index/index.hpp>
+#include <osmium/index/map.hpp>
+#include <osmium/util/compatibility.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#define OSMIUM_HAS_INDEX_MAP_CONCURRENT_DENSE_MEM
+
+namespace osmium {
+
+    namespace index {
+
+        namespace map {
+
+            /**
+             * A dense in-memory index that can be written to from several
+             * threads at the same time. Use it to store node locations in
+             * the threads decoding the input (see
+             * osmium::handler::store_node_locations()).
+             *
+             * The IDs are divided into blocks of 2^16 IDs. Memory for a
+             * block is allocated when the first ID in it is set. The table
+             * of blocks is allocated up front for the largest ID given in
+             * the constructor, so it never has to be resized and setting a
+             * value never has to wait for other threads.
+             *
+             * Calling set() concurrently is safe as long as no two threads
+             * set the same ID. Calling the get functions concurrently with
+             * set() is safe for IDs that are not being set at the same
+             * time. All other functions must not be called concurrently
+             * with any other function on this index.
+             */
+            template <typename TId, typename TValue>
+            class ConcurrentDenseMem : public osmium::index::map::Map<TId, TValue> {
+
+                enum {
+                    bits = 16
+                };
+
+                enum : uint64_t {
+                    block_size = 1ull << bits
+                };
+
+                // How many ids ahead get_many_noexcept() prefetches.
+                enum {
+                    prefetch_distance = 16
+                };
+
+                std::unique_ptr<std::atomic<TValue*>[]> m_blocks;
+
+                std::size_t m_num_blocks;
+
+                // Number of blocks allocated and the highest block number
+                // in use plus one.
+                std::atomic<std::size_t> m_used_blocks{0};
+                std::atomic<std::size_t> m_end_block{0};
+
+                static uint64_t block(const uint64_t id) noexcept {
+                    return id >> bits;
+                }
+
+                static uint64_t offset(const uint64_t id) noexcept {
+                    return id & (block_size - 1);
+                }
+
+                const TValue* get_block(const uint64_t id) const noexcept {
+                    if (block(id) >= m_num_blocks) {
+                        return nullptr;
+                    }
+                    return m_blocks[block(id)].load(std::memory_order_acquire);
+                }
+
+                // Return the block with the given number. If it doesn't
+                // exist yet, create it. If another thread creates the same
+                // block at the same time, one of them wins and the other
+                // block is freed again.
+                TValue* assure_block(const std::size_t num) {
+                    TValue* block = m_blocks[num].load(std::memory_order_acquire);
+                    if (block) {
+                        return block;
+                    }
+
+                    std::unique_ptr<TValue[]> new_block{new TValue[block_size]};
+                    std::fill(new_block.get(), new_block.get() + block_size, osmium::index::empty_value<TValue>());
+
+                    if (!m_blocks[num].compare_exchange_strong(block, new_block.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                        return block;
+                    }
+
+                    ++m_used_blocks;
+                    std::size_t end = m_end_block.load(std::memory_order_relaxed);
+                    while (end <= num && !m_end_block.compare_exchange_weak(end, num + 1, std::memory_order_relaxed)) {
+                    }
+
+                    return new_block.release();
+                }
+
+                void free_blocks() noexcept {
+                    for (std::size_t i = 0; i < m_num_blocks; ++i) {
+                        delete[] m_blocks[i].exchange(nullptr);
+                    }
+                    m_used_blocks = 0;
+                    m_end_block = 0;
+                }
+
+            public:
+
+                // 2^35 is well above the largest node ID in OSM today and
+                // needs a block table of 4 MBytes.
+                enum : uint64_t {
+                    default_max_id = 1ull << 35
+                };
+
+                /**
+                 * Create ConcurrentDenseMem index.
+                 *
+                 * @param max_id The largest ID that can be stored in this
+                 *               index.
+                 */
+                explicit ConcurrentDenseMem(const uint64_t max_id = default_max_id) :
+                    m_blocks(new std::atomic<TValue*>[block(max_id) + 1]),
+                    m_num_blocks(static_cast<std::size_t>(block(max_id) + 1)) {
+                    for (std::size_t i = 0; i < m_num_blocks; ++i) {
+                        m_blocks[i].store(nullptr, std::memory_order_relaxed);
+                    }
+                }
+
+                ConcurrentDenseMem(const ConcurrentDenseMem&) = delete;
+                ConcurrentDenseMem& operator=(const ConcurrentDenseMem&) = delete;
+
+                ConcurrentDenseMem(ConcurrentDenseMem&&) = delete;
+                ConcurrentDenseMem& operator=(ConcurrentDenseMem&&) = delete;
+
+                ~ConcurrentDenseMem() noexcept override {
+                    free_blocks();
+                }
+
+                /**
+                 * The largest ID that can be stored in this index.
+                 */
+                uint64_t max_id() const noexcept {
+                    return m_num_blocks * block_size - 1;
+                }
+
+                std::size_t size() const noexcept final {
+                    return m_end_block.load() * block_size;
+                }
+
+                std::size_t used_memory() const noexcept final {
+                    return sizeof(ConcurrentDenseMem) +
+                           m_num_blocks * sizeof(std::atomic<TValue*>) +
+                           m_used_blocks.load() * block_size * sizeof(TValue);
+                }
+
+                /**
+                 * Set the value for the ID. This can be called from several
+                 * threads at the same time for different IDs.
+                 *
+                 * @throws std::out_of_range if the ID is larger than
+                 *         max_id().
+                 */
+                void set(const TId id, const TValue value) final {
+                    if (block(id) >= m_num_blocks) {
+                        throw std::out_of_range{"ID too large for ConcurrentDenseMem index"};
+                    }
+                    assure_block(block(id))[offset(id)] = value;
+                }
+
+                TValue get_noexcept(const TId id) const noexcept final {
+                    const TValue* block = get_block(id);
+                    if (!block) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+                    return block[offset(id)];
+                }
+
+                void get_many_noexcept(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + prefetch_distance < count) {
+                            const auto id = ids[i + prefetch_distance];
+                            const TValue* block = get_block(id);
+                            if (block) {
+                                OSMIUM_PREFETCH(block + offset(id));
+                            }
+                        }
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
+                TValue get(const TId id) const final {
+                    const auto value = get_noexcept(id);
+                    if (value == osmium::index::empty_value<TValue>()) {
+                        throw osmium::not_found{id};
+                    }
+                    return value;
+                }
+
+                void clear() final {
+                    free_blocks();
+                }
+
+                void sort() final {
+                    // nothing to do here
+                }
+
+            }; // class ConcurrentDenseMem
+
+        } // namespace map
+
+    } // namespace index
+
+} // namespace osmium
+
+#ifdef OSMIUM_WANT_NODE_LOCATION_MAPS
+    REGISTER_MAP(osmium::unsigned_object_id_type, osmium::Location, osmium::index::map::ConcurrentDenseMem, concurrent_dense_mem)
+#endif
+
+#endif // OSMIUM_INDEX_MAP_CONCURRENT_DENSE_MEM_HPP
@@ -0,0 +1,445 @@
+#ifndef OSMIUM_INDEX_MAP_DENSE_COMPRESSED_MEM_HPP
+#define OSMIUM_INDEX_MAP_DENSE_COMPRESSED_MEM_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/index/index.hpp>
+#include <osmium/index/map.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/util/compatibility.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#define OSMIUM_HAS_INDEX_MAP_DENSE_COMPRESSED_MEM
+
+namespace osmium {
+
+    namespace index {
+
+        namespace map {
+
+            namespace detail {
+
+                inline unsigned int popcount(uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+                    return static_cast<unsigned int>(__builtin_popcountll(value));
+#else
+                    value = value - ((value >> 1u) & 0x5555555555555555ull);
+                    value = (value & 0x3333333333333333ull) + ((value >> 2u) & 0x3333333333333333ull);
+                    value = (value + (value >> 4u)) & 0x0f0f0f0f0f0f0f0full;
+                    return static_cast<unsigned int>((value * 0x0101010101010101ull) >> 56u);
+#endif
+                }
+
+                // Number of bits needed to store the value.
+                inline unsigned int bit_width(uint64_t value) noexcept {
+                    unsigned int width = 0;
+                    while (value) {
+                        ++width;
+                        value >>= 1u;
+                    }
+                    return width;
+                }
+
+            } // namespace detail
+
+            /**
+             * A dense index for locations held in memory that needs much
+             * less memory than the DenseMemArray if the locations of nodes
+             * with consecutive IDs are near each other, which is usually
+             * the case in OSM data.
+             *
+             * The IDs are split into blocks of 256 consecutive IDs. Each
+             * block stores a bitmap of the IDs that have a location, the
+             * smallest x and y coordinates of those locations, and the
+             * differences of each location to those coordinates, bit packed
+             * with the number of bits needed for the largest difference in
+             * the block. An ID is found by looking up its block in an array
+             * and counting the bits in the bitmap before it, so lookups take
+             * constant time.
+             *
+             * The block that was written to last is held uncompressed and
+             * compressed when something is written to another block. This
+             * works best if the locations are set ordered by ID, as they
+             * are when reading OSM files. Writing to an already compressed
+             * block again works, but the memory used for the old version of
+             * the block is not reused.
+             *
+             * This index only works with osmium::Location values.
+             */
+            template <typename TId, typename TValue>
+            class DenseCompressedMem : public osmium::index::map::Map<TId, TValue> {
+
+                static_assert(std::is_same<TValue, osmium::Location>::value,
+                              "DenseCompressedMem only works with osmium::Location values");
+
+                enum {
+                    bits = 8
+                };
+
+                enum : uint64_t {
+                    block_size = 1ull << bits
+                };
+
+                enum : uint64_t {
+                    bitmap_words = block_size / 64
+                };
+
+                // Block header: bitmap, base x and y, bit widths for x and y
+                enum : std::size_t {
+                    header_size = bitmap_words * sizeof(uint64_t) + 2 * sizeof(int32_t) + 2
+                };
+
+                enum : uint64_t {
+                    no_block = std::numeric_limits<uint64_t>::max()
+                };
+
+                // How many ids ahead get_many_noexcept() prefetches.
+                enum {
+                    prefetch_distance = 16
+                };
+
+                // The compressed blocks are stored in chunks of at most this
+                // size, so that growing the index never needs to copy more
+                // than one chunk.
+                enum : uint64_t {
+                    chunk_bits = 24
+                };
+
+                enum : uint64_t {
+                    chunk_size = 1ull << chunk_bits
+                };
+
+                // Offsets of the compressed blocks in the chunks.
+                std::vector<uint64_t> m_block_offsets;
+
+                // The compressed blocks.
+                std::vector<std::vector<unsigned char>> m_chunks;
+
+                // Buffer for compressing one block.
+                std::vector<unsigned char> m_record;
+
+                // The block currently written to in uncompressed form.
+                std::vector<TValue> m_current;
+
+                uint64_t m_current_block = no_block;
+
+                bool m_current_dirty = false;
+
+                static uint64_t block(const uint64_t id) noexcept {
+                    return id >> bits;
+                }
+
+                static uint64_t offset(const uint64_t id) noexcept {
+                    return id & (block_size - 1);
+                }
+
+                template <typename T>
+                static T load(const unsigned char* data) noexcept {
+                    T value;
+                    std::memcpy(&value, data, sizeof(T));
+                    return value;
+                }
+
+                template <typename T>
+                void append(T value) {
+                    const auto size = m_record.size();
+                    m_record.resize(size + sizeof(T));
+                    std::memcpy(&m_record[size], &value, sizeof(T));
+                }
+
+                // Copy the record into a chunk and return its offset.
+                uint64_t store_record() {
+                    if (m_chunks.empty() || m_chunks.back().size() + m_record.size() > chunk_size) {
+                        m_chunks.emplace_back();
+                    }
+                    auto& chunk = m_chunks.back();
+                    const uint64_t offset = ((m_chunks.size() - 1) << chunk_bits) + chunk.size();
+                    chunk.insert(chunk.end(), m_record.begin(), m_record.end());
+                    return offset;
+                }
+
+                static uint32_t unpack(const unsigned char* packed, uint64_t pos, unsigned int width) noexcept {
+                    if (width == 0) {
+                        return 0;
+                    }
+                    const auto word = pos / 64;
+                    const auto shift = pos % 64;
+                    uint64_t value = load<uint64_t>(packed + word * sizeof(uint64_t)) >> shift;
+                    if (shift + width > 64) {
+                        value |= load<uint64_t>(packed + (word + 1) * sizeof(uint64_t)) << (64 - shift);
+                    }
+                    return static_cast<uint32_t>(value & ((1ull << width) - 1));
+                }
+
+                static void pack(std::vector<uint64_t>& words, uint64_t pos, unsigned int width, uint64_t value) noexcept {
+                    if (width == 0) {
+                        return;
+                    }
+                    const auto word = pos / 64;
+                    const auto shift = pos % 64;
+                    words[word] |= value << shift;
+                    if (shift + width > 64) {
+                        words[word + 1] |= value >> (64 - shift);
+                    }
+                }
+
+                const unsigned char* block_data(const uint64_t num) const noexcept {
+                    if (num >= m_block_offsets.size() || m_block_offsets[num] == no_block) {
+                        return nullptr;
+                    }
+                    const auto offset = m_block_offsets[num];
+                    return m_chunks[offset >> chunk_bits].data() + (offset & (chunk_size - 1));
+                }
+
+                static TValue decode(const unsigned char* data, uint64_t rank) noexcept {
+                    const unsigned char* ptr = data + bitmap_words * sizeof(uint64_t);
+                    const auto base_x = load<int32_t>(ptr);
+                    const auto base_y = load<int32_t>(ptr + sizeof(int32_t));
+                    const unsigned int width_x = ptr[2 * sizeof(int32_t)];
+                    const unsigned int width_y = ptr[2 * sizeof(int32_t) + 1];
+                    const unsigned char* packed = data + header_size;
+
+                    const uint64_t pos = rank * (width_x + width_y);
+                    const auto x = static_cast<int64_t>(base_x) + unpack(packed, pos, width_x);
+                    const auto y = static_cast<int64_t>(base_y) + unpack(packed, pos + width_x, width_y);
+                    return TValue{static_cast<int32_t>(x), static_cast<int32_t>(y)};
+                }
+
+                static TValue get_from_block(const unsigned char* data, const uint64_t off) noexcept {
+                    const auto word = off / 64;
+                    const auto bit = 1ull << (off % 64);
+                    const auto bitmap = load<uint64_t>(data + word * sizeof(uint64_t));
+                    if (!(bitmap & bit)) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+
+                    uint64_t rank = detail::popcount(bitmap & (bit - 1));
+                    for (uint64_t i = 0; i < word; ++i) {
+                        rank += detail::popcount(load<uint64_t>(data + i * sizeof(uint64_t)));
+                    }
+
+                    return decode(data, rank);
+                }
+
+                // Compress the current block and store it in a chunk.
+                void flush() {
+                    if (m_current_block == no_block || !m_current_dirty) {
+                        return;
+                    }
+
+                    uint64_t bitmap[bitmap_words] = {0};
+                    int32_t min_x = std::numeric_limits<int32_t>::max();
+                    int32_t min_y = std::numeric_limits<int32_t>::max();
+                    int32_t max_x = std::numeric_limits<int32_t>::min();
+                    int32_t max_y = std::numeric_limits<int32_t>::min();
+                    uint64_t count = 0;
+
+                    for (uint64_t i = 0; i < block_size; ++i) {
+                        const auto& location = m_current[i];
+                        if (location != osmium::index::empty_value<TValue>()) {
+                            bitmap[i / 64] |= 1ull << (i % 64);
+                            min_x = std::min(min_x, location.x());
+                            min_y = std::min(min_y, location.y());
+                            max_x = std::max(max_x, location.x());
+                            max_y = std::max(max_y, location.y());
+                            ++count;
+                        }
+                    }
+
+                    if (m_current_block >= m_block_offsets.size()) {
+                        m_block_offsets.resize(m_current_block + 1, no_block);
+                    }
+
+                    if (count == 0) {
+                        m_block_offsets[m_current_block] = no_block;
+                        m_current_dirty = false;
+                        return;
+                    }
+
+                    const auto width_x = detail::bit_width(static_cast<uint64_t>(static_cast<int64_t>(max_x) - min_x));
+                    const auto width_y = detail::bit_width(static_cast<uint64_t>(static_cast<int64_t>(max_y) - min_y));
+
+                    std::vector<uint64_t> words((count * (width_x + width_y) + 63) / 64, 0);
+                    uint64_t pos = 0;
+                    for (const auto& location : m_current) {
+                        if (location != osmium::index::empty_value<TValue>()) {
+                            pack(words, pos, width_x, static_cast<uint64_t>(static_cast<int64_t>(location.x()) - min_x));
+                            pos += width_x;
+                            pack(words, pos, width_y, static_cast<uint64_t>(static_cast<int64_t>(location.y()) - min_y));
+                            pos += width_y;
+                        }
+                    }
+
+                    m_record.clear();
+                    for (const auto word : bitmap) {
+                        append(word);
+                    }
+                    append(min_x);
+                    append(min_y);
+                    append(static_cast<unsigned char>(width_x));
+                    append(static_cast<unsigned char>(width_y));
+                    for (const auto word : words) {
+                        append(word);
+                    }
+                    m_block_offsets[m_current_block] = store_record();
+
+                    m_current_dirty = false;
+                }
+
+                // Make the block with the given number the current block,
+                // uncompressing it if it already exists.
+                void load_block(const uint64_t num) {
+                    flush();
+
+                    m_current.assign(block_size, osmium::index::empty_value<TValue>());
+                    const unsigned char* data = block_data(num);
+                    if (data) {
+                        uint64_t rank = 0;
+                        for (uint64_t i = 0; i < block_size; ++i) {
+                            if (load<uint64_t>(data + (i / 64) * sizeof(uint64_t)) & (1ull << (i % 64))) {
+                                m_current[i] = decode(data, rank++);
+                            }
+                        }
+                    }
+                    m_current_block = num;
+                }
+
+            public:
+
+                DenseCompressedMem() = default;
+
+                std::size_t size() const noexcept final {
+                    return std::max(m_block_offsets.size(), m_current_block == no_block ? 0 : m_current_block + 1) * block_size;
+                }
+
+                std::size_t used_memory() const noexcept final {
+                    std::size_t chunks_size = 0;
+                    for (const auto& chunk : m_chunks) {
+                        chunks_size += chunk.capacity();
+                    }
+                    return sizeof(DenseCompressedMem) +
+                           m_block_offsets.capacity() * sizeof(uint64_t) +
+                           chunks_size +
+                           m_current.capacity() * sizeof(TValue);
+                }
+
+                void set(const TId id, const TValue value) final {
+                    if (block(id) != m_current_block) {
+                        load_block(block(id));
+                    }
+                    m_current[offset(id)] = value;
+                    m_current_dirty = true;
+                }
+
+                TValue get_noexcept(const TId id) const noexcept final {
+                    if (block(id) == m_current_block) {
+                        return m_current[offset(id)];
+                    }
+                    const unsigned char* data = block_data(block(id));
+                    if (!data) {
+                        return osmium::index::empty_value<TValue>();
+                    }
+                    return get_from_block(data, offset(id));
+                }
+
+                void get_many_noexcept(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        // The block offset is needed first to find the
+                        // block, so it is prefetched earlier.
+                        if (i + 2 * prefetch_distance < count) {
+                            const auto num = block(ids[i + 2 * prefetch_distance]);
+                            if (num < m_block_offsets.size()) {
+                                OSMIUM_PREFETCH(&m_block_offsets[num]);
+                            }
+                        }
+                        if (i + prefetch_distance < count) {
+                            const unsigned char* data = block_data(block(ids[i + prefetch_distance]));
+                            if (data) {
+                                OSMIUM_PREFETCH(data);
+                            }
+                        }
+                        values[i] = get_noexcept(ids[i]);
+                    }
+                }
+
+                TValue get(const TId id) const final {
+                    const auto value = get_noexcept(id);
+                    if (value == osmium::index::empty_value<TValue>()) {
+                        throw osmium::not_found{id};
+                    }
+                    return value;
+                }
+
+                void clear() final {
+                    m_block_offsets.clear();
+                    m_block_offsets.shrink_to_fit();
+                    m_chunks.clear();
+                    m_chunks.shrink_to_fit();
+                    m_current.clear();
+                    m_current.shrink_to_fit();
+                    m_current_block = no_block;
+                    m_current_dirty = false;
+                }
+
+                /**
+                 * Compress the block currently written to. Not needed
+                 * before reading, but makes sure all memory not needed any
+                 * more is released.
+                 */
+                void sort() final {
+                    flush();
+                    m_current.clear();
+                    m_current.shrink_to_fit();
+                    m_current_block = no_block;
+                }
+
+            }; // class DenseCompressedMem
+
+        } // namespace map
+
+    } // namespace index
+
+} // namespace osmium
+
+#ifdef OSMIUM_WANT_NODE_LOCATION_MAPS
+    REGISTER_MAP(osmium::unsigned_object_id_type, osmium::Location, osmium::index::map::DenseCompressedMem, dense_compressed_mem)
+#endif
+
+#endif // OSMIUM_INDEX_MAP_DENSE_COMPRESSED_MEM_HPP
@@ -35,6 +35,7 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/index/index.hpp>
 #include <osmium/index/map.hpp>
+#include <osmium/util/compatibility.hpp>
 
 #include <algorithm>
 #include <cstddef>
@@ -70,6 +71,12 @@ namespace osmium {
                     block_size = 1ull << bits
                 };
 
+                // How many ids ahead get_many_noexcept() prefetches in
+                // dense mode.
+                enum {
+                    prefetch_distance = 16
+                };
+
                 // Minimum number of entries in the sparse index before we
                 // are considering switching to a dense index.
                 enum : int64_t {
@@ -211,6 +218,24 @@ namespace osmium {
                     return get_sparse(id);
                 }
 
+                void get_many_noexcept(const TId* ids, TValue* values, const std::size_t count) const noexcept final {
+                    if (!m_dense) {
+                        for (std::size_t i = 0; i < count; ++i) {
+                            values[i] = get_sparse(ids[i]);
+                        }
+                        return;
+                    }
+                    for (std::size_t i = 0; i < count; ++i) {
+                        if (i + prefetch_distance < count) {
+                            const auto id = ids[i + prefetch_distance];
+                            if (block(id) < m_dense_blocks.size() && !m_dense_blocks[block(id)].empty()) {
+                                OSMIUM_PREFETCH(&m_dense_blocks[block(id)][offset(id)]);
+                            }
+                        }
+                        values[i] = get_dense(ids[i]);
+                    }
+                }
+
                 TValue get(const TId id) const final {
                     const auto value = get_noexcept(id);
                     if (value == osmium::index::empty_value<TValue>()) {
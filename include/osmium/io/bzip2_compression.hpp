@@ -39,7 +39,8 @@ DEALINGS IN THE SOFTWARE.
  * Include this file if you want to read or write bzip2-compressed OSM
  * files.
  *
- * @attention If you include this file, you'll need to link with `libbz2`.
+ * @attention If you include this file, you'll need to link with `libbz2`
+ *            and enable multithreading.
  */
 
 #include <osmium/io/compression.hpp>
@@ -47,17 +48,25 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_compression.hpp>
 #include <osmium/io/writer_options.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/util/compatibility.hpp>
+#include <osmium/util/config.hpp>
 #include <osmium/util/file.hpp>
 
 #include <bzlib.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
+#include <deque>
+#include <future>
 #include <limits>
+#include <memory>
 #include <string>
 #include <system_error>
+#include <utility>
 
 #ifndef _MSC_VER
 # include <unistd.h>
@@ -385,14 +394,504 @@ namespace osmium {
 
         }; // class Bzip2BufferDecompressor
 
+        namespace detail {
+
+            enum : uint64_t {
+                bzip2_block_magic = 0x314159265359ULL,
+                bzip2_eos_magic   = 0x177245385090ULL
+            };
+
+            inline uint32_t bzip2_get_bits(const char* data, uint64_t pos, unsigned int count) noexcept {
+                uint32_t value = 0;
+                for (; count > 0; --count, ++pos) {
+                    value = (value << 1u) | ((static_cast<unsigned char>(data[pos >> 3u]) >> (7u - (pos & 7u))) & 1u);
+                }
+                return value;
+            }
+
+            /**
+             * Writes a bit stream, most significant bit first, as used in
+             * bzip2 files.
+             */
+            class bzip2_bit_writer {
+
+                std::string m_data;
+                uint64_t m_buffer = 0;
+                unsigned int m_count = 0;
+
+            public:
+
+                void write(uint32_t value, unsigned int bits) {
+                    assert(bits <= 32);
+                    m_buffer = (m_buffer << bits) | (value & ((uint64_t{1} << bits) - 1));
+                    m_count += bits;
+                    while (m_count >= 8) {
+                        m_count -= 8;
+                        m_data += static_cast<char>((m_buffer >> m_count) & 0xffu);
+                    }
+                }
+
+                /// Copy the bits [first, last) from data.
+                void copy(const char* data, uint64_t first, uint64_t last) {
+                    m_data.reserve(m_data.size() + (last - first) / 8 + 16);
+                    for (; first < last && (first & 7u) != 0; ++first) {
+                        write(bzip2_get_bits(data, first, 1), 1);
+                    }
+                    for (; last - first >= 8; first += 8) {
+                        write(static_cast<unsigned char>(data[first >> 3u]), 8);
+                    }
+                    for (; first < last; ++first) {
+                        write(bzip2_get_bits(data, first, 1), 1);
+                    }
+                }
+
+                std::string finish() {
+                    if (m_count > 0) {
+                        write(0, 8 - m_count);
+                    }
+                    return std::move(m_data);
+                }
+
+            }; // class bzip2_bit_writer
+
+            /**
+             * A compressed block from a bzip2 file. Bzip2 blocks are not
+             * byte-aligned, so all positions are in bits.
+             */
+            struct bzip2_block {
+
+                /// Compressed data containing the block.
+                std::shared_ptr<const std::string> data;
+
+                /// Start of the block (the block magic) in data.
+                uint64_t start = 0;
+
+                /// End of the block in data.
+                uint64_t end = 0;
+
+                /// Start of the next block in data (or end of data).
+                uint64_t next = 0;
+
+            }; // struct bzip2_block
+
+            /**
+             * Merge two consecutive blocks into one block including
+             * everything in between. This is used if a block boundary
+             * turned out to be wrong, because the block magic number was
+             * found inside the compressed data.
+             */
+            inline bzip2_block bzip2_merge_blocks(const bzip2_block& first, const bzip2_block& second) {
+                bzip2_bit_writer writer;
+                writer.copy(first.data->data(), first.start, first.next);
+                writer.copy(second.data->data(), second.start, second.next);
+
+                bzip2_block block;
+                block.data = std::make_shared<const std::string>(writer.finish());
+                block.start = 0;
+                block.end = (first.next - first.start) + (second.end - second.start);
+                block.next = (first.next - first.start) + (second.next - second.start);
+                return block;
+            }
+
+            /**
+             * Decompress one bzip2 block. The block is copied into a new
+             * bzip2 stream which can be decompressed on its own.
+             *
+             * @throws osmium::bzip2_error If the data can't be decompressed.
+             */
+            inline std::string bzip2_decompress_block(const bzip2_block& block) {
+                if (block.end - block.start < 48 + 32) {
+                    throw osmium::bzip2_error{"bzip2 error: decompress failed: block too short", BZ_DATA_ERROR};
+                }
+
+                bzip2_bit_writer writer;
+                writer.write('B', 8);
+                writer.write('Z', 8);
+                writer.write('h', 8);
+                writer.write('9', 8);
+                writer.copy(block.data->data(), block.start, block.end);
+
+                // The stream CRC of a stream with only one block is the
+                // CRC of that block.
+                writer.write(static_cast<uint32_t>(bzip2_eos_magic >> 24u), 24);
+                writer.write(static_cast<uint32_t>(bzip2_eos_magic & 0xffffffu), 24);
+                writer.write(bzip2_get_bits(block.data->data(), block.start + 48, 32), 32);
+                std::string input{writer.finish()};
+
+                bz_stream stream{};
+                int result = BZ2_bzDecompressInit(&stream, 0, 0);
+                if (result != BZ_OK) {
+                    throw osmium::bzip2_error{"bzip2 error: decompression init failed: ", result};
+                }
+
+                stream.next_in = &*input.begin();
+                assert(input.size() < std::numeric_limits<unsigned int>::max());
+                stream.avail_in = static_cast<unsigned int>(input.size());
+
+                std::string output(input.size() * 4, '\0');
+                std::size_t used = 0;
+                do {
+                    if (used == output.size()) {
+                        output.resize(output.size() * 2);
+                    }
+                    stream.next_out = &*output.begin() + used;
+                    stream.avail_out = static_cast<unsigned int>(std::min(output.size() - used, static_cast<std::size_t>(std::numeric_limits<unsigned int>::max())));
+                    result = BZ2_bzDecompress(&stream);
+                    used = static_cast<std::size_t>(stream.next_out - output.data());
+                    if (result == BZ_OK && stream.avail_in == 0 && stream.avail_out != 0) {
+                        result = BZ_UNEXPECTED_EOF;
+                    }
+                } while (result == BZ_OK);
+
+                BZ2_bzDecompressEnd(&stream);
+
+                if (result != BZ_STREAM_END) {
+                    throw osmium::bzip2_error{"bzip2 error: decompress failed: ", result};
+                }
+
+                output.resize(used);
+                return output;
+            }
+
+        } // namespace detail
+
+        /**
+         * Decompressor for bzip2 files using the threads in the thread
+         * pool. The compressed blocks in a bzip2 file can be decompressed
+         * independently. They are found by looking for the (not
+         * byte-aligned) block magic numbers and sent off to the pool.
+         * Results are returned in order.
+         *
+         * This works with any bzip2 file including ones with several
+         * streams (as written by pbzip2 for instance).
+         */
+        class ParallelBzip2Decompressor : public Decompressor {
+
+            struct pending_block {
+                detail::bzip2_block block;
+                std::future<std::string> result;
+                std::size_t offset;
+
+                // Is this the last block in a stream? The end of the
+                // block is the end of stream marker then.
+                bool ends_stream;
+
+                // Stream CRC after the end of stream marker.
+                uint32_t stream_crc;
+            };
+
+            enum : uint64_t {
+                no_position = std::numeric_limits<uint64_t>::max()
+            };
+
+            // Blocks are merged if they can't be decompressed on their
+            // own. Real compressed bzip2 blocks are never this large,
+            // so stop merging then, the data must be corrupt.
+            enum : std::size_t {
+                max_block_size = 4ul * 1024ul * 1024ul
+            };
+
+            osmium::thread::Pool& m_pool;
+            std::deque<pending_block> m_pending;
+            std::size_t m_max_pending;
+
+            int m_fd;
+            std::size_t m_bytes_read = 0;
+            bool m_eof = false;
+
+            // Input data not yet handed off to a block. Contains at least
+            // all data from the beginning of the current block.
+            std::string m_input;
+
+            // Bit position of the beginning of m_input in the file.
+            uint64_t m_input_pos = 0;
+
+            // Number of bytes in m_input already scanned for magic numbers.
+            std::size_t m_scanned = 0;
+
+            // The last bytes read for finding the magic numbers.
+            uint64_t m_bits = 0;
+
+            // Bit position in the file of the current block.
+            uint64_t m_block_start = no_position;
+
+            // Bit position of the end of stream marker ending the current
+            // block (if any) and the stream CRC after it.
+            uint64_t m_block_end = no_position;
+            uint32_t m_block_stream_crc = 0;
+
+            // Bit position of the last end of stream marker found, set
+            // until the stream CRC after it has been read.
+            uint64_t m_eos = no_position;
+
+            // CRC of the current stream calculated from the CRCs of the
+            // blocks returned so far.
+            uint32_t m_stream_crc = 0;
+
+            uint32_t get_bits(const uint64_t pos, const unsigned int count) const noexcept {
+                assert(pos >= m_input_pos);
+                return detail::bzip2_get_bits(m_input.data(), pos - m_input_pos, count);
+            }
+
+            void add_block(const uint64_t next) {
+                assert(m_block_start >= m_input_pos);
+                const auto first_byte = static_cast<std::size_t>((m_block_start - m_input_pos) / 8);
+                const auto last_byte = static_cast<std::size_t>((next - m_input_pos + 7) / 8);
+                const uint64_t base = m_input_pos + first_byte * 8;
+                const bool ends_stream = m_block_end != no_position;
+
+                detail::bzip2_block block;
+                block.data = std::make_shared<const std::string>(m_input, first_byte, last_byte - first_byte);
+                block.start = m_block_start - base;
+                block.end = (ends_stream ? m_block_end : next) - base;
+                block.next = next - base;
+
+                m_pending.push_back(pending_block{block, m_pool.submit([block] {
+                    return detail::bzip2_decompress_block(block);
+                }), m_bytes_read, ends_stream, m_block_stream_crc});
+            }
+
+            // Is the end of stream marker at pos directly after a stream
+            // header, ie. is this a stream without any blocks?
+            bool is_empty_stream(const uint64_t pos) const noexcept {
+                if (pos % 8 != 0 || pos < m_input_pos + 32) {
+                    return false;
+                }
+                const uint32_t header = get_bits(pos - 32, 32);
+                return (header >> 8u) == 0x425a68u /* "BZh" */ &&
+                       (header & 0xffu) >= '1' && (header & 0xffu) <= '9';
+            }
+
+            // Called when the stream CRC after the end of stream marker
+            // has been read. The marker might have been found inside the
+            // compressed data of a block. We can't know that before the
+            // block has been decompressed, so the last marker found wins
+            // and the stream CRC is checked after decompression.
+            void found_stream_end() {
+                const uint32_t crc = get_bits(m_eos + 48, 32);
+                if (m_block_start == no_position || is_empty_stream(m_eos)) {
+                    if (crc != 0) {
+                        detail::throw_bzip2_error(nullptr, "read failed", BZ_DATA_ERROR);
+                    }
+                } else {
+                    m_block_end = m_eos;
+                    m_block_stream_crc = crc;
+                }
+                m_eos = no_position;
+            }
+
+            void found_magic(const uint64_t magic, const uint64_t pos) {
+                if (magic == detail::bzip2_block_magic) {
+                    // A real end of stream marker is always followed by
+                    // the stream CRC and a new stream header before the
+                    // next block, so an end of stream marker found just
+                    // before was inside the compressed data.
+                    m_eos = no_position;
+                    if (m_block_start != no_position) {
+                        add_block(pos);
+                    }
+                    m_block_start = pos;
+                    m_block_end = no_position;
+                } else {
+                    m_eos = pos;
+                }
+            }
+
+            void scan() {
+                if (m_input_pos == 0 && m_scanned == 0) {
+                    if (m_input.size() < 4) {
+                        return;
+                    }
+                    if (m_input[0] != 'B' || m_input[1] != 'Z' || m_input[2] != 'h' || m_input[3] < '1' || m_input[3] > '9') {
+                        detail::throw_bzip2_error(nullptr, "read failed", BZ_DATA_ERROR_MAGIC);
+                    }
+                }
+
+                constexpr const uint64_t mask = (uint64_t{1} << 48u) - 1;
+                for (; m_scanned < m_input.size(); ++m_scanned) {
+                    m_bits = (m_bits << 8u) | static_cast<unsigned char>(m_input[m_scanned]);
+                    const uint64_t end_pos = m_input_pos + (m_scanned + 1) * 8;
+                    if (m_eos != no_position && end_pos >= m_eos + 48 + 32) {
+                        found_stream_end();
+                    }
+                    for (unsigned int shift = 8; shift > 0; --shift) {
+                        const uint64_t value = (m_bits >> (shift - 1)) & mask;
+                        if (value == detail::bzip2_block_magic || value == detail::bzip2_eos_magic) {
+                            found_magic(value, end_pos - (shift - 1) - 48);
+                        }
+                    }
+                }
+
+                // Remove data not needed any more. Keep the stream header
+                // before an end of stream marker, see is_empty_stream().
+                uint64_t keep_from_pos = m_block_start;
+                if (m_eos != no_position) {
+                    keep_from_pos = std::min(keep_from_pos, std::max(m_eos, m_input_pos + 32) - 32);
+                }
+                if (keep_from_pos == no_position) {
+                    keep_from_pos = m_input_pos + m_input.size() * 8;
+                }
+                const auto keep_from = static_cast<std::size_t>((keep_from_pos - m_input_pos) / 8);
+                m_input.erase(0, keep_from);
+                m_input_pos += keep_from * 8;
+                m_scanned -= keep_from;
+            }
+
+            void read_input() {
+                const auto old_size = m_input.size();
+                m_input.resize(old_size + osmium::io::Decompressor::input_buffer_size);
+                const auto nread = detail::reliable_read(m_fd, &*m_input.begin() + old_size, osmium::io::Decompressor::input_buffer_size);
+                m_input.resize(old_size + static_cast<std::size_t>(nread));
+                m_bytes_read += static_cast<std::size_t>(nread);
+
+                if (nread > 0) {
+                    scan();
+                    return;
+                }
+
+                m_eof = true;
+                if (m_bytes_read < 4 || m_eos != no_position ||
+                    (m_block_start != no_position && m_block_end == no_position)) {
+                    detail::throw_bzip2_error(nullptr, "read failed", BZ_UNEXPECTED_EOF);
+                }
+                if (m_block_start != no_position) {
+                    add_block(m_input_pos + m_input.size() * 8);
+                    m_block_start = no_position;
+                }
+            }
+
+            // Called if a block could not be decompressed. Maybe a magic
+            // number was found inside the compressed data. If the block
+            // ended in an end of stream marker, try again with that
+            // marker as part of the block. Otherwise merge the block with
+            // the next one and try again.
+            std::string retry_block(pending_block& pending) {
+                while (true) {
+                    if (pending.ends_stream) {
+                        pending.ends_stream = false;
+                        pending.block.end = pending.block.next;
+                    } else {
+                        while (m_pending.empty() && !m_eof) {
+                            read_input();
+                        }
+                        if (m_pending.empty() || pending.block.next - pending.block.start > max_block_size * 8) {
+                            detail::throw_bzip2_error(nullptr, "read failed", BZ_DATA_ERROR);
+                        }
+
+                        const pending_block next{std::move(m_pending.front())};
+                        m_pending.pop_front();
+                        set_offset(next.offset);
+
+                        pending.block = detail::bzip2_merge_blocks(pending.block, next.block);
+                        pending.ends_stream = next.ends_stream;
+                        pending.stream_crc = next.stream_crc;
+                    }
+
+                    try {
+                        return detail::bzip2_decompress_block(pending.block);
+                    } catch (const osmium::bzip2_error&) {
+                        // try again
+                    }
+                }
+            }
+
+            std::string next_result() {
+                pending_block pending{std::move(m_pending.front())};
+                m_pending.pop_front();
+                set_offset(pending.offset);
+
+                std::string data;
+                try {
+                    data = pending.result.get();
+                } catch (const osmium::bzip2_error&) {
+                    data = retry_block(pending);
+                }
+
+                // Only now we know that the block is real and its CRC
+                // is part of the stream CRC.
+                m_stream_crc = ((m_stream_crc << 1u) | (m_stream_crc >> 31u)) ^
+                               detail::bzip2_get_bits(pending.block.data->data(), pending.block.start + 48, 32);
+
+                if (pending.ends_stream) {
+                    if (m_stream_crc != pending.stream_crc) {
+                        detail::throw_bzip2_error(nullptr, "read failed", BZ_DATA_ERROR);
+                    }
+                    m_stream_crc = 0;
+                }
+
+                return data;
+            }
+
+        public:
+
+            explicit ParallelBzip2Decompressor(const int fd, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) :
+                m_pool(pool),
+                m_max_pending(static_cast<std::size_t>(pool.num_threads()) * 2 + 2),
+                m_fd(fd) {
+                // Check that the file descriptor is valid, throws if not.
+                osmium::file_size(fd);
+            }
+
+            ParallelBzip2Decompressor(const ParallelBzip2Decompressor&) = delete;
+            ParallelBzip2Decompressor& operator=(const ParallelBzip2Decompressor&) = delete;
+
+            ParallelBzip2Decompressor(ParallelBzip2Decompressor&&) = delete;
+            ParallelBzip2Decompressor& operator=(ParallelBzip2Decompressor&&) = delete;
+
+            ~ParallelBzip2Decompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            std::string read() final {
+                while (true) {
+                    if (!m_pending.empty() && (m_eof || m_pending.size() >= m_max_pending)) {
+                        std::string data{next_result()};
+                        if (!data.empty()) {
+                            return data;
+                        }
+                    } else if (m_eof) {
+                        return std::string{};
+                    } else {
+                        read_input();
+                    }
+                }
+            }
+
+            void close() final {
+                m_pending.clear();
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    m_fd = -1;
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class ParallelBzip2Decompressor
+
         namespace detail {
 
             // we want the register_compression() function to run, setting
             // the variable is only a side-effect, it will never be used
             const bool registered_bzip2_compression = osmium::io::CompressionFactory::instance().register_compression(osmium::io::file_compression::bzip2,
                 [](const int fd, const fsync sync) { return new osmium::io::Bzip2Compressor{fd, sync}; },
-                [](const int fd) { return new osmium::io::Bzip2Decompressor{fd}; },
-                [](const char* buffer, const std::size_t size) { return new osmium::io::Bzip2BufferDecompressor{buffer, size}; }
+                [](const int fd) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_pool_threads_for_decompression()) {
+                        return new osmium::io::ParallelBzip2Decompressor{fd};
+                    }
+                    return new osmium::io::Bzip2Decompressor{fd};
+                },
+                [](const char* buffer, const std::size_t size) { return new osmium::io::Bzip2BufferDecompressor{buffer, size}; },
+                nullptr,
+                [](const int fd, osmium::thread::Pool& pool) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_pool_threads_for_decompression()) {
+                        return new osmium::io::ParallelBzip2Decompressor{fd, pool};
+                    }
+                    return new osmium::io::Bzip2Decompressor{fd};
+                }
             );
 
             // dummy function to silence the unused variable warning from above
@@ -37,6 +37,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_compression.hpp>
 #include <osmium/io/writer_options.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/util/file.hpp>
 
 #include <atomic>
@@ -131,8 +132,10 @@ namespace osmium {
          * This singleton factory class is used to register compression
          * algorithms used for reading and writing OSM files.
          *
-         * For each algorithm we store two functions that construct
-         * a compressor and decompressor object, respectively.
+         * For each algorithm we store functions that construct
+         * compressor and decompressor objects. Algorithms working in the
+         * thread pool can register additional functions which get the
+         * pool from the Reader or Writer.
          */
         class CompressionFactory {
 
@@ -142,11 +145,16 @@ namespace osmium {
             using create_decompressor_type_fd     = std::function<osmium::io::Decompressor*(int)>;
             using create_decompressor_type_buffer = std::function<osmium::io::Decompressor*(const char*, std::size_t)>;
 
+            using create_compressor_type_pool      = std::function<osmium::io::Compressor*(int, fsync, osmium::thread::Pool&)>;
+            using create_decompressor_type_fd_pool = std::function<osmium::io::Decompressor*(int, osmium::thread::Pool&)>;
+
         private:
 
             using callbacks_type = std::tuple<create_compressor_type,
                                               create_decompressor_type_fd,
-                                              create_decompressor_type_buffer>;
+                                              create_decompressor_type_buffer,
+                                              create_compressor_type_pool,
+                                              create_decompressor_type_fd_pool>;
 
             using compression_map_type = std::map<const osmium::io::file_compression, callbacks_type>;
 
@@ -191,7 +199,27 @@ namespace osmium {
                 compression_map_type::value_type cc{compression,
                                                     std::make_tuple(create_compressor,
                                                                     create_decompressor_fd,
-                                                                    create_decompressor_buffer)};
+                                                                    create_decompressor_buffer,
+                                                                    create_compressor_type_pool{},
+                                                                    create_decompressor_type_fd_pool{})};
+
+                return m_callbacks.insert(cc).second;
+            }
+
+            bool register_compression(
+                osmium::io::file_compression compression,
+                create_compressor_type create_compressor,
+                create_decompressor_type_fd create_decompressor_fd,
+                create_decompressor_type_buffer create_decompressor_buffer,
+                create_compressor_type_pool create_compressor_pool,
+                create_decompressor_type_fd_pool create_decompressor_fd_pool) {
+
+                compression_map_type::value_type cc{compression,
+                                                    std::make_tuple(create_compressor,
+                                                                    create_decompressor_fd,
+                                                                    create_decompressor_buffer,
+                                                                    create_compressor_pool,
+                                                                    create_decompressor_fd_pool)};
 
                 return m_callbacks.insert(cc).second;
             }
@@ -202,6 +230,19 @@ namespace osmium {
                 return std::unique_ptr<osmium::io::Compressor>(std::get<0>(callbacks)(std::forward<TArgs>(args)...));
             }
 
+            /**
+             * Create a compressor which may use the threads in the given
+             * pool. Falls back to the compressor without pool if the
+             * compression algorithm doesn't use a pool.
+             */
+            std::unique_ptr<osmium::io::Compressor> create_compressor(const osmium::io::file_compression compression, const int fd, const fsync sync, osmium::thread::Pool& pool) const {
+                const auto callbacks = find_callbacks(compression);
+                if (std::get<3>(callbacks)) {
+                    return std::unique_ptr<osmium::io::Compressor>(std::get<3>(callbacks)(fd, sync, pool));
+                }
+                return std::unique_ptr<osmium::io::Compressor>(std::get<0>(callbacks)(fd, sync));
+            }
+
             std::unique_ptr<osmium::io::Decompressor> create_decompressor(const osmium::io::file_compression compression, const int fd) const {
                 const auto callbacks = find_callbacks(compression);
                 auto p = std::unique_ptr<osmium::io::Decompressor>(std::get<1>(callbacks)(fd));
@@ -209,6 +250,20 @@ namespace osmium {
                 return p;
             }
 
+            /**
+             * Create a decompressor which may use the threads in the given
+             * pool. Falls back to the decompressor without pool if the
+             * compression algorithm doesn't use a pool.
+             */
+            std::unique_ptr<osmium::io::Decompressor> create_decompressor(const osmium::io::file_compression compression, const int fd, osmium::thread::Pool& pool) const {
+                const auto callbacks = find_callbacks(compression);
+                auto p = std::get<4>(callbacks) ?
+                    std::unique_ptr<osmium::io::Decompressor>(std::get<4>(callbacks)(fd, pool)) :
+                    std::unique_ptr<osmium::io::Decompressor>(std::get<1>(callbacks)(fd));
+                p->set_file_size(osmium::file_size(fd));
+                return p;
+            }
+
             std::unique_ptr<osmium::io::Decompressor> create_decompressor(const osmium::io::file_compression compression, const char* buffer, const std::size_t size) const {
                 const auto callbacks = find_callbacks(compression);
                 return std::unique_ptr<osmium::io::Decompressor>(std::get<2>(callbacks)(buffer, size));
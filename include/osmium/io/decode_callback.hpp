@@ -0,0 +1,67 @@
+#ifndef OSMIUM_IO_DECODE_CALLBACK_HPP
+#define OSMIUM_IO_DECODE_CALLBACK_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/memory/buffer.hpp>
+
+#include <functional>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * Option for the Reader: A function called for each buffer right
+         * after it was decoded and before it is handed to the user of the
+         * Reader. For most file formats this happens in the threads of the
+         * thread pool, so the function can be called from several threads
+         * at the same time and in any order. It must be thread-safe.
+         *
+         * Use this to do work on the data in parallel that doesn't depend
+         * on the order of the buffers, for instance storing node locations
+         * in an index (see osmium::handler::store_node_locations()).
+         *
+         * The function can change the contents of the buffer.
+         */
+        struct decode_callback {
+
+            std::function<void(osmium::memory::Buffer&)> function;
+
+        }; // struct decode_callback
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DECODE_CALLBACK_HPP
@@ -214,7 +214,7 @@ namespace osmium {
 
                 void write_timestamp(const osmium::Timestamp& timestamp) {
                     if (timestamp.valid()) {
-                        *m_out += timestamp.to_iso();
+                        append_iso_timestamp(*m_out, timestamp.seconds_since_epoch());
                         *m_out += " (";
                         output_int(timestamp.seconds_since_epoch());
                         *m_out += ')';
@@ -292,7 +292,8 @@ namespace osmium {
                 void write_location(const osmium::Location& location) {
                     write_fieldname("lon/lat");
                     *m_out += "  ";
-                    location.as_string_without_check(std::back_inserter(*m_out));
+                    char temp[32];
+                    m_out->append(temp, location.as_string_without_check(temp));
                     if (!location.valid()) {
                         write_error(" INVALID LOCATION!");
                     }
@@ -308,9 +309,10 @@ namespace osmium {
                     }
                     const auto& bl = box.bottom_left();
                     const auto& tr = box.top_right();
-                    bl.as_string_without_check(std::back_inserter(*m_out));
+                    char temp[32];
+                    m_out->append(temp, bl.as_string_without_check(temp));
                     *m_out += ' ';
-                    tr.as_string_without_check(std::back_inserter(*m_out));
+                    m_out->append(temp, tr.as_string_without_check(temp));
                     if (!box.valid()) {
                         write_error(" INVALID BOX!");
                     }
@@ -334,8 +336,8 @@ namespace osmium {
 
             public:
 
-                DebugOutputBlock(osmium::memory::Buffer&& buffer, const debug_output_options& options) :
-                    OutputBlock(std::move(buffer)),
+                DebugOutputBlock(osmium::memory::Buffer&& buffer, const debug_output_options& options, OutputStringPool* string_pool = nullptr) :
+                    OutputBlock(std::move(buffer), 300, string_pool),
                     m_options(options),
                     m_utf8_prefix(options.use_color ? color_red  : ""),
                     m_utf8_suffix(options.use_color ? color_blue : "") {
@@ -399,7 +401,8 @@ namespace osmium {
                         output_formatted("%10lld", static_cast<long long>(node_ref.ref())); // NOLINT(google-runtime-int)
                         if (node_ref.location().valid()) {
                             *m_out += " (";
-                            node_ref.location().as_string(std::back_inserter(*m_out));
+                            char temp[32];
+                            m_out->append(temp, node_ref.location().as_string(temp));
                             *m_out += ')';
                         }
                         *m_out += '\n';
@@ -582,7 +585,7 @@ namespace osmium {
                 }
 
                 void write_buffer(osmium::memory::Buffer&& buffer) final {
-                    m_output_queue.push(m_pool.submit(DebugOutputBlock{std::move(buffer), m_options}));
+                    m_output_queue.push(m_pool.submit(DebugOutputBlock{std::move(buffer), m_options, m_string_pool.get()}));
                 }
 
             }; // class DebugOutputFormat
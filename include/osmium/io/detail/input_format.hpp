@@ -33,11 +33,14 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/io/decode_callback.hpp>
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_block_index.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
@@ -48,6 +51,7 @@ DEALINGS IN THE SOFTWARE.
 #include <future>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <utility>
 
 namespace osmium {
@@ -63,8 +67,49 @@ namespace osmium {
                 std::promise<osmium::io::Header>& header_promise;
                 osmium::osm_entity_bits::type read_which_entities;
                 osmium::io::read_meta read_metadata;
+                MappedInput* mapped_input;
+                const osmium::io::PBFBlockIndex* block_index;
+                osmium::io::read_id_range id_range;
+                osmium::io::decode_callback decode_callback;
             };
 
+            /**
+             * Call the decode callback on the buffer and on all buffers
+             * nested in it. The parsers fill buffers with auto_grow set to
+             * internal, so most of the data can be in nested buffers.
+             */
+            inline void call_decode_callback(const osmium::io::decode_callback& callback, osmium::memory::Buffer& buffer) {
+                buffer.for_each_nested_buffer(callback.function);
+                callback.function(buffer);
+            }
+
+            /**
+             * Wraps a task decoding a buffer and calls the decode callback
+             * on the result when the task is run.
+             */
+            template <typename TFunction>
+            class decode_task_with_callback {
+
+                TFunction m_function;
+                std::shared_ptr<const osmium::io::decode_callback> m_callback;
+
+            public:
+
+                decode_task_with_callback(TFunction function, std::shared_ptr<const osmium::io::decode_callback> callback) :
+                    m_function(std::move(function)),
+                    m_callback(std::move(callback)) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    osmium::memory::Buffer buffer{m_function()};
+                    if (buffer) {
+                        call_decode_callback(*m_callback, buffer);
+                    }
+                    return buffer;
+                }
+
+            }; // class decode_task_with_callback
+
             class Parser {
 
                 osmium::thread::Pool& m_pool;
@@ -73,6 +118,12 @@ namespace osmium {
                 queue_wrapper<std::string> m_input_queue;
                 osmium::osm_entity_bits::type m_read_which_entities;
                 osmium::io::read_meta m_read_metadata;
+                MappedInput* m_mapped_input;
+                const osmium::io::PBFBlockIndex* m_block_index;
+                osmium::io::read_id_range m_id_range;
+                // Shared with the tasks in the pool which can still run
+                // after the parser is gone.
+                std::shared_ptr<const osmium::io::decode_callback> m_decode_callback;
                 bool m_header_is_done;
 
             protected:
@@ -89,6 +140,27 @@ namespace osmium {
                     return m_read_metadata;
                 }
 
+                /**
+                 * The memory mapped input file or nullptr if the input is
+                 * not mapped. If this is set, the parser must use the
+                 * mapped data instead of the input queue.
+                 */
+                MappedInput* mapped_input() const noexcept {
+                    return m_mapped_input;
+                }
+
+                /**
+                 * The index of the blocks in the input file or nullptr if
+                 * there is none. Only used for PBF files.
+                 */
+                const osmium::io::PBFBlockIndex* block_index() const noexcept {
+                    return m_block_index;
+                }
+
+                const osmium::io::read_id_range& id_range() const noexcept {
+                    return m_id_range;
+                }
+
                 bool header_is_done() const noexcept {
                     return m_header_is_done;
                 }
@@ -109,8 +181,13 @@ namespace osmium {
 
                 /**
                  * Wrap the buffer into a future and add it to the output queue.
+                 * Calls the decode callback on the buffer first, if there
+                 * is one.
                  */
                 void send_to_output_queue(osmium::memory::Buffer&& buffer) {
+                    if (m_decode_callback && buffer) {
+                        call_decode_callback(*m_decode_callback, buffer);
+                    }
                     add_to_queue(m_output_queue, std::move(buffer));
                 }
 
@@ -118,6 +195,21 @@ namespace osmium {
                     m_output_queue.push(std::move(future));
                 }
 
+                /**
+                 * Run the function decoding a buffer in the thread pool and
+                 * add the future result to the output queue. The decode
+                 * callback, if there is one, is called on the buffer in the
+                 * pool thread.
+                 */
+                template <typename TFunction>
+                void submit_to_pool(TFunction&& function) {
+                    if (m_decode_callback) {
+                        send_to_output_queue(m_pool.submit(decode_task_with_callback<typename std::decay<TFunction>::type>{std::forward<TFunction>(function), m_decode_callback}));
+                    } else {
+                        send_to_output_queue(m_pool.submit(std::forward<TFunction>(function)));
+                    }
+                }
+
             public:
 
                 explicit Parser(parser_arguments& args) :
@@ -127,6 +219,10 @@ namespace osmium {
                     m_input_queue(args.input_queue),
                     m_read_which_entities(args.read_which_entities),
                     m_read_metadata(args.read_metadata),
+                    m_mapped_input(args.mapped_input),
+                    m_block_index(args.block_index),
+                    m_id_range(args.id_range),
+                    m_decode_callback(args.decode_callback.function ? std::make_shared<const osmium::io::decode_callback>(std::move(args.decode_callback)) : nullptr),
                     m_header_is_done(false) {
                 }
 
@@ -0,0 +1,126 @@
+#ifndef OSMIUM_IO_DETAIL_LZ4_HPP
+#define OSMIUM_IO_DETAIL_LZ4_HPP
+
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/error.hpp>
+
+#include <protozero/version.hpp>
+
+#if PROTOZERO_VERSION_CODE >= 10600
+# include <protozero/data_view.hpp>
+#else
+# include <protozero/types.hpp>
+#endif
+
+#include <lz4.h>
+#include <lz4hc.h>
+
+#include <cstddef>
+#include <string>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * Compress data using lz4.
+             *
+             * Note that this function can not compress data larger than
+             * LZ4_MAX_INPUT_SIZE (about 2GB).
+             *
+             * @param input Data to compress.
+             * @param level Compression level. Levels smaller than
+             *              LZ4HC_CLEVEL_MIN use the fast lz4 compressor,
+             *              higher levels the slower lz4hc compressor.
+             * @returns Compressed data.
+             */
+            inline std::string lz4_compress(const std::string& input, int level = 0) {
+                if (input.size() > LZ4_MAX_INPUT_SIZE) {
+                    throw io_error{"failed to compress data: input too large for lz4"};
+                }
+
+                const auto input_size = static_cast<int>(input.size());
+                std::string output(static_cast<std::size_t>(LZ4_compressBound(input_size)), '\0');
+
+                const int output_size = level < LZ4HC_CLEVEL_MIN
+                    ? LZ4_compress_default(input.data(), &*output.begin(), input_size, static_cast<int>(output.size()))
+                    : LZ4_compress_HC(input.data(), &*output.begin(), input_size, static_cast<int>(output.size()), level);
+
+                if (output_size <= 0) {
+                    throw io_error{"failed to compress data"};
+                }
+
+                output.resize(static_cast<std::size_t>(output_size));
+
+                return output;
+            }
+
+            /**
+             * Uncompress data using lz4.
+             *
+             * @param input Compressed input data.
+             * @param input_size Size of compressed input data.
+             * @param raw_size Size of uncompressed data.
+             * @param output Uncompressed result data.
+             * @returns Pointer and size to uncompressed data.
+             */
+            inline protozero::data_view lz4_uncompress_string(const char* input, std::size_t input_size, std::size_t raw_size, std::string& output) {
+                if (input_size > LZ4_MAX_INPUT_SIZE || raw_size > LZ4_MAX_INPUT_SIZE) {
+                    throw io_error{"failed to uncompress data: input too large for lz4"};
+                }
+
+                output.resize(raw_size);
+
+                const int result = LZ4_decompress_safe(input,
+                                                       &*output.begin(),
+                                                       static_cast<int>(input_size),
+                                                       static_cast<int>(raw_size));
+
+                if (result < 0 || static_cast<std::size_t>(result) != raw_size) {
+                    throw io_error{"failed to uncompress data"};
+                }
+
+                return protozero::data_view{output.data(), output.size()};
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_LZ4_HPP
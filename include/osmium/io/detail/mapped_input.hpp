@@ -0,0 +1,165 @@
+#ifndef OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
+#define OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/util/file.hpp>
+#include <osmium/util/memory_mapping.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * An input file mapped into memory as a whole. Parsers that
+             * support this can work directly on the file contents instead
+             * of getting copies of the data through the input queue. This
+             * is only possible for uncompressed, seekable files.
+             *
+             * The mapping is read-only and shared between the parser thread
+             * and the pool threads doing the actual decoding. It must
+             * outlive all tasks referencing data in it.
+             */
+            class MappedInput {
+
+                osmium::MemoryMapping m_mapping;
+
+                // updated by the parser thread, read by the main thread
+                std::atomic<std::size_t> m_offset{0};
+
+                // set by the main thread, read by the parser thread
+                std::atomic<bool> m_done{false};
+
+            public:
+
+                /**
+                 * Map the file with the given file descriptor. The file
+                 * descriptor is not needed after this and can be closed
+                 * by the caller.
+                 *
+                 * @pre @code osmium::file_size(fd) > 0 @endcode
+                 * @throws std::system_error if the mapping fails
+                 */
+                MappedInput(const int fd, const std::size_t size) :
+                    m_mapping(size, osmium::MemoryMapping::mapping_mode::readonly, fd) {
+#ifndef _WIN32
+                    // We are going to read the file from start to end,
+                    // so tell the kernel it can read ahead aggressively.
+                    ::posix_madvise(m_mapping.get_addr(), size, POSIX_MADV_SEQUENTIAL);
+#endif
+                }
+
+                MappedInput(const MappedInput&) = delete;
+                MappedInput& operator=(const MappedInput&) = delete;
+
+                MappedInput(MappedInput&&) = delete;
+                MappedInput& operator=(MappedInput&&) = delete;
+
+                ~MappedInput() noexcept = default;
+
+                const char* data() const noexcept {
+                    return m_mapping.get_addr<const char>();
+                }
+
+                std::size_t size() const noexcept {
+                    return m_mapping.size();
+                }
+
+                std::size_t offset() const noexcept {
+                    return m_offset;
+                }
+
+                void set_offset(const std::size_t offset) noexcept {
+                    m_offset = offset;
+                }
+
+                bool done() const noexcept {
+                    return m_done;
+                }
+
+                void stop() noexcept {
+                    m_done = true;
+                }
+
+            }; // class MappedInput
+
+            /**
+             * Try to memory map the file with the given name. Returns
+             * nullptr if the file can not be mapped, because it is not a
+             * regular file (for instance a pipe or STDIN) or because it
+             * is empty. In that case the caller should fall back to
+             * reading the file normally.
+             *
+             * @throws std::system_error if the file can not be opened or
+             *         the mapping fails.
+             */
+            inline std::unique_ptr<MappedInput> map_input_file(const std::string& filename) {
+                if (filename.empty() || filename == "-") {
+                    return nullptr;
+                }
+
+                const int fd = open_for_reading(filename);
+                std::unique_ptr<MappedInput> input;
+                try {
+                    const auto size = osmium::file_size(fd);
+                    if (size > 0) {
+                        input.reset(new MappedInput{fd, size});
+                    }
+                } catch (...) {
+                    reliable_close(fd);
+                    throw;
+                }
+                reliable_close(fd);
+
+                return input;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_MAPPED_INPUT_HPP
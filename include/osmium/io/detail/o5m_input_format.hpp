@@ -50,7 +50,9 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/timestamp.hpp>
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
+#include <osmium/util/config.hpp>
 #include <osmium/util/delta.hpp>
 
 #include <protozero/exception.hpp>
@@ -61,6 +63,7 @@ DEALINGS IN THE SOFTWARE.
 #include <cstdint>
 #include <cstring>
 #include <future>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
@@ -149,97 +152,22 @@ namespace osmium {
 
             }; // class ReferenceTable
 
-            class O5mParser : public Parser {
+            /**
+             * Decodes the node, way, and relation datasets of an o5m file
+             * into a buffer. Keeps the state needed for this (the string
+             * reference table and the delta decoders) until the next reset.
+             */
+            class O5mDecoder {
 
                 enum {
                     initial_buffer_size = 1024ul * 1024ul
                 };
 
-                osmium::io::Header m_header{};
-
                 osmium::memory::Buffer m_buffer{initial_buffer_size,
                                                 osmium::memory::Buffer::auto_grow::internal};
 
-                std::string m_input{};
-
-                const char* m_data;
-                const char* m_end;
-
                 ReferenceTable m_reference_table;
 
-                static int64_t zvarint(const char** data, const char* end) {
-                    return protozero::decode_zigzag64(protozero::decode_varint(data, end));
-                }
-
-                bool ensure_bytes_available(std::size_t need_bytes) {
-                    if ((m_end - m_data) >= static_cast<int64_t>(need_bytes)) {
-                        return true;
-                    }
-
-                    if (input_done() && (m_input.size() < need_bytes)) {
-                        return false;
-                    }
-
-                    m_input.erase(0, m_data - m_input.data());
-
-                    while (m_input.size() < need_bytes) {
-                        const std::string data{get_input()};
-                        if (input_done()) {
-                            return false;
-                        }
-                        m_input.append(data);
-                    }
-
-                    m_data = m_input.data();
-                    m_end = m_input.data() + m_input.size();
-
-                    return true;
-                }
-
-                void check_header_magic() {
-                    static const unsigned char header_magic[] = { 0xff, 0xe0, 0x04, 'o', '5' };
-
-                    if (std::strncmp(reinterpret_cast<const char*>(header_magic), m_data, sizeof(header_magic)) != 0) {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data += sizeof(header_magic);
-                }
-
-                void check_file_type() {
-                    if (*m_data == 'm') {         // o5m data file
-                        m_header.set_has_multiple_object_versions(false);
-                    } else if (*m_data == 'c') {  // o5c change file
-                        m_header.set_has_multiple_object_versions(true);
-                    } else {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data++;
-                }
-
-                void check_file_format_version() {
-                    if (*m_data != '2') {
-                        throw o5m_error{"wrong header magic"};
-                    }
-
-                    m_data++;
-                }
-
-                void decode_header() {
-                    if (! ensure_bytes_available(7)) { // overall length of header
-                        throw o5m_error{"file too short (incomplete header info)"};
-                    }
-
-                    check_header_magic();
-                    check_file_type();
-                    check_file_format_version();
-                }
-
-                void mark_header_as_done() {
-                    set_header_value(m_header);
-                }
-
                 osmium::DeltaDecode<osmium::object_id_type> m_delta_id;
 
                 osmium::DeltaDecode<int64_t> m_delta_timestamp;
@@ -250,21 +178,6 @@ namespace osmium {
                 osmium::DeltaDecode<osmium::object_id_type> m_delta_way_node_id;
                 osmium::DeltaDecode<osmium::object_id_type> m_delta_member_ids[3];
 
-                void reset() {
-                    m_reference_table.clear();
-
-                    m_delta_id.clear();
-                    m_delta_timestamp.clear();
-                    m_delta_changeset.clear();
-                    m_delta_lon.clear();
-                    m_delta_lat.clear();
-
-                    m_delta_way_node_id.clear();
-                    m_delta_member_ids[0].clear();
-                    m_delta_member_ids[1].clear();
-                    m_delta_member_ids[2].clear();
-                }
-
                 const char* decode_string(const char** dataptr, const char* const end) {
                     if (**dataptr == 0x00) { // get inline string
                         (*dataptr)++;
@@ -500,21 +413,7 @@ namespace osmium {
                     }
                 }
 
-                void decode_bbox(const char* data, const char* const end) {
-                    const auto sw_lon = zvarint(&data, end);
-                    const auto sw_lat = zvarint(&data, end);
-                    const auto ne_lon = zvarint(&data, end);
-                    const auto ne_lat = zvarint(&data, end);
-
-                    m_header.add_box(osmium::Box{osmium::Location{sw_lon, sw_lat},
-                                                 osmium::Location{ne_lon, ne_lat}});
-                }
-
-                void decode_timestamp(const char* data, const char* const end) {
-                    const auto timestamp = osmium::Timestamp{zvarint(&data, end)}.to_iso();
-                    m_header.set("o5m_timestamp", timestamp);
-                    m_header.set("timestamp", timestamp);
-                }
+            public:
 
                 enum class dataset_type : unsigned char {
                     node         = 0x10,
@@ -528,6 +427,303 @@ namespace osmium {
                     reset        = 0xff
                 };
 
+                static int64_t zvarint(const char** data, const char* end) {
+                    return protozero::decode_zigzag64(protozero::decode_varint(data, end));
+                }
+
+                void reset() {
+                    m_reference_table.clear();
+
+                    m_delta_id.clear();
+                    m_delta_timestamp.clear();
+                    m_delta_changeset.clear();
+                    m_delta_lon.clear();
+                    m_delta_lat.clear();
+
+                    m_delta_way_node_id.clear();
+                    m_delta_member_ids[0].clear();
+                    m_delta_member_ids[1].clear();
+                    m_delta_member_ids[2].clear();
+                }
+
+                osmium::memory::Buffer& buffer() noexcept {
+                    return m_buffer;
+                }
+
+                /**
+                 * Move the buffer with the decoded objects out of this
+                 * decoder and replace it by an empty buffer.
+                 */
+                osmium::memory::Buffer release_buffer() {
+                    osmium::memory::Buffer buffer{initial_buffer_size,
+                                                  osmium::memory::Buffer::auto_grow::internal};
+                    using std::swap;
+                    swap(buffer, m_buffer);
+                    return buffer;
+                }
+
+                /**
+                 * Decode one node, way, or relation dataset and commit
+                 * the object to the buffer.
+                 */
+                void decode_object(dataset_type ds_type, const char* data, const char* const end) {
+                    switch (ds_type) {
+                        case dataset_type::node:
+                            decode_node(data, end);
+                            break;
+                        case dataset_type::way:
+                            decode_way(data, end);
+                            break;
+                        case dataset_type::relation:
+                            decode_relation(data, end);
+                            break;
+                        default:
+                            return;
+                    }
+                    m_buffer.commit();
+                }
+
+                /**
+                 * Decode a sequence of complete node, way, relation, and
+                 * reset datasets. All other datasets are ignored.
+                 */
+                void decode(const char* data, const char* const end) {
+                    while (data != end) {
+                        const auto ds_type = static_cast<dataset_type>(*data++);
+                        if (ds_type > dataset_type::jump) {
+                            if (ds_type == dataset_type::reset) {
+                                reset();
+                            }
+                            continue;
+                        }
+
+                        uint64_t length = 0;
+                        try {
+                            length = protozero::decode_varint(&data, end);
+                        } catch (const protozero::end_of_buffer_exception&) {
+                            throw o5m_error{"premature end of file"};
+                        }
+                        if (length > static_cast<uint64_t>(end - data)) {
+                            throw o5m_error{"premature end of file"};
+                        }
+
+                        decode_object(ds_type, data, data + length);
+                        data += length;
+                    }
+                }
+
+            }; // class O5mDecoder
+
+            /**
+             * Decodes a chunk of o5m data in the thread pool. The chunk must
+             * start right after a reset dataset (or at the beginning of the
+             * data) so that no state from earlier datasets is needed.
+             */
+            class O5mChunkParser {
+
+                std::string m_data;
+
+            public:
+
+                explicit O5mChunkParser(std::string&& data) :
+                    m_data(std::move(data)) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    O5mDecoder decoder;
+                    decoder.decode(m_data.data(), m_data.data() + m_data.size());
+                    return decoder.release_buffer();
+                }
+
+            }; // class O5mChunkParser
+
+            /**
+             * Parser for o5m files. Decoding an o5m dataset depends on the
+             * datasets before it (string reference table and delta coding)
+             * up to the last reset dataset. So the datasets are collected
+             * into chunks which start after a reset and the chunks are
+             * decoded in the thread pool.
+             *
+             * This only helps if the file has resets often enough. Files
+             * written by osmconvert only have resets between the sections
+             * with nodes, ways, and relations. If more than max_chunk_size
+             * bytes come without a reset, the rest of the data up to the
+             * next reset is decoded serially in the parser thread. For
+             * those files most of the data is decoded serially. Files
+             * written by libosmium have a reset at the start of every
+             * block and are decoded fully in parallel.
+             */
+            class O5mParser : public Parser {
+
+                enum {
+                    min_chunk_size = 1024ul * 1024ul,
+                    max_chunk_size = 8ul * 1024ul * 1024ul
+                };
+
+                using dataset_type = O5mDecoder::dataset_type;
+
+                osmium::io::Header m_header{};
+
+                std::string m_input{};
+
+                const char* m_data;
+                const char* m_end;
+
+                // Used for decoding in the parser thread
+                O5mDecoder m_decoder;
+
+                // Datasets collected since the last reset to be decoded
+                // in the thread pool
+                std::string m_chunk;
+
+                bool m_use_pool;
+
+                // Set if the objects are currently decoded in the parser
+                // thread, either because the pool should not be used or
+                // because there was no reset for too long.
+                bool m_decode_in_parser_thread;
+
+                bool ensure_bytes_available(std::size_t need_bytes) {
+                    if ((m_end - m_data) >= static_cast<int64_t>(need_bytes)) {
+                        return true;
+                    }
+
+                    if (input_done() && (m_input.size() < need_bytes)) {
+                        return false;
+                    }
+
+                    m_input.erase(0, m_data - m_input.data());
+
+                    while (m_input.size() < need_bytes) {
+                        const std::string data{get_input()};
+                        if (input_done()) {
+                            return false;
+                        }
+                        m_input.append(data);
+                    }
+
+                    m_data = m_input.data();
+                    m_end = m_input.data() + m_input.size();
+
+                    return true;
+                }
+
+                void check_header_magic() {
+                    static const unsigned char header_magic[] = { 0xff, 0xe0, 0x04, 'o', '5' };
+
+                    if (std::strncmp(reinterpret_cast<const char*>(header_magic), m_data, sizeof(header_magic)) != 0) {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data += sizeof(header_magic);
+                }
+
+                void check_file_type() {
+                    if (*m_data == 'm') {         // o5m data file
+                        m_header.set_has_multiple_object_versions(false);
+                    } else if (*m_data == 'c') {  // o5c change file
+                        m_header.set_has_multiple_object_versions(true);
+                    } else {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data++;
+                }
+
+                void check_file_format_version() {
+                    if (*m_data != '2') {
+                        throw o5m_error{"wrong header magic"};
+                    }
+
+                    m_data++;
+                }
+
+                void decode_header() {
+                    if (! ensure_bytes_available(7)) { // overall length of header
+                        throw o5m_error{"file too short (incomplete header info)"};
+                    }
+
+                    check_header_magic();
+                    check_file_type();
+                    check_file_format_version();
+                }
+
+                void mark_header_as_done() {
+                    set_header_value(m_header);
+                }
+
+                void decode_bbox(const char* data, const char* const end) {
+                    const auto sw_lon = O5mDecoder::zvarint(&data, end);
+                    const auto sw_lat = O5mDecoder::zvarint(&data, end);
+                    const auto ne_lon = O5mDecoder::zvarint(&data, end);
+                    const auto ne_lat = O5mDecoder::zvarint(&data, end);
+
+                    m_header.add_box(osmium::Box{osmium::Location{sw_lon, sw_lat},
+                                                 osmium::Location{ne_lon, ne_lat}});
+                }
+
+                void decode_timestamp(const char* data, const char* const end) {
+                    const auto timestamp = osmium::Timestamp{O5mDecoder::zvarint(&data, end)}.to_iso();
+                    m_header.set("o5m_timestamp", timestamp);
+                    m_header.set("timestamp", timestamp);
+                }
+
+                void send_decoded_buffers() {
+                    auto& buffer = m_decoder.buffer();
+                    while (buffer.has_nested_buffers()) {
+                        std::unique_ptr<osmium::memory::Buffer> buffer_ptr{buffer.get_last_nested()};
+                        send_to_output_queue(std::move(*buffer_ptr));
+                    }
+                }
+
+                void send_chunk() {
+                    if (!m_chunk.empty()) {
+                        submit_to_pool(O5mChunkParser{std::move(m_chunk)});
+                        m_chunk.clear();
+                    }
+                }
+
+                // At a reset the collected datasets are handed to the
+                // thread pool if there are enough of them.
+                void reset() {
+                    if (m_decode_in_parser_thread) {
+                        m_decoder.reset();
+                        if (m_use_pool) {
+                            send_decoded_buffers();
+                            if (m_decoder.buffer().committed() > 0) {
+                                send_to_output_queue(m_decoder.release_buffer());
+                            }
+                            m_decode_in_parser_thread = false;
+                        }
+                    } else if (m_chunk.size() >= min_chunk_size) {
+                        send_chunk();
+                    } else if (!m_chunk.empty()) {
+                        m_chunk += static_cast<char>(dataset_type::reset);
+                    }
+                }
+
+                void decode_object(dataset_type ds_type, uint64_t length) {
+                    if (m_decode_in_parser_thread) {
+                        m_decoder.decode_object(ds_type, m_data, m_data + length);
+                        send_decoded_buffers();
+                        return;
+                    }
+
+                    m_chunk += static_cast<char>(ds_type);
+                    protozero::write_varint(std::back_inserter(m_chunk), length);
+                    m_chunk.append(m_data, length);
+
+                    // If there is no reset for a long time, decode the
+                    // datasets here instead of collecting more and more
+                    // of them.
+                    if (m_chunk.size() > max_chunk_size) {
+                        m_decoder.decode(m_chunk.data(), m_chunk.data() + m_chunk.size());
+                        m_chunk.clear();
+                        m_decode_in_parser_thread = true;
+                        send_decoded_buffers();
+                    }
+                }
+
                 void decode_data() {
                     while (ensure_bytes_available(1)) {
                         const auto ds_type = static_cast<dataset_type>(*m_data++);
@@ -553,22 +749,19 @@ namespace osmium {
                                 case dataset_type::node:
                                     mark_header_as_done();
                                     if (read_types() & osmium::osm_entity_bits::node) {
-                                        decode_node(m_data, m_data + length);
-                                        m_buffer.commit();
+                                        decode_object(ds_type, length);
                                     }
                                     break;
                                 case dataset_type::way:
                                     mark_header_as_done();
                                     if (read_types() & osmium::osm_entity_bits::way) {
-                                        decode_way(m_data, m_data + length);
-                                        m_buffer.commit();
+                                        decode_object(ds_type, length);
                                     }
                                     break;
                                 case dataset_type::relation:
                                     mark_header_as_done();
                                     if (read_types() & osmium::osm_entity_bits::relation) {
-                                        decode_relation(m_data, m_data + length);
-                                        m_buffer.commit();
+                                        decode_object(ds_type, length);
                                     }
                                     break;
                                 case dataset_type::bounding_box:
@@ -587,16 +780,13 @@ namespace osmium {
                             }
 
                             m_data += length;
-
-                            if (m_buffer.has_nested_buffers()) {
-                                std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
-                                send_to_output_queue(std::move(*buffer_ptr));
-                            }
                         }
                     }
 
-                    if (m_buffer.committed() > 0) {
-                        send_to_output_queue(std::move(m_buffer));
+                    send_chunk();
+                    send_decoded_buffers();
+                    if (m_decoder.buffer().committed() > 0) {
+                        send_to_output_queue(m_decoder.release_buffer());
                     }
 
                     mark_header_as_done();
@@ -607,7 +797,9 @@ namespace osmium {
                 explicit O5mParser(parser_arguments& args) :
                     Parser(args),
                     m_data(m_input.data()),
-                    m_end(m_data) {
+                    m_end(m_data),
+                    m_use_pool(osmium::config::use_pool_threads_for_o5m_parsing()),
+                    m_decode_in_parser_thread(!m_use_pool) {
                 }
 
                 O5mParser(const O5mParser&) = delete;
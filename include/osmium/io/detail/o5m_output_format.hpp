@@ -0,0 +1,431 @@
+#ifndef OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
+#define OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/detail/output_format.hpp>
+#include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/file.hpp>
+#include <osmium/io/file_format.hpp>
+#include <osmium/io/header.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/box.hpp>
+#include <osmium/osm/item_type.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/metadata_options.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/object.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/tag.hpp>
+#include <osmium/osm/timestamp.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/util/delta.hpp>
+#include <osmium/visitor.hpp>
+
+#include <protozero/varint.hpp>
+
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            // Implementation of the o5m/o5c file formats according to the
+            // description at https://wiki.openstreetmap.org/wiki/O5m .
+
+            enum class o5m_dataset_type : unsigned char {
+                node         = 0x10,
+                way          = 0x11,
+                relation     = 0x12,
+                bounding_box = 0xdb,
+                timestamp    = 0xdc,
+                header       = 0xe0,
+                end_of_file  = 0xfe,
+                reset        = 0xff
+            };
+
+            /**
+             * The writing side of the o5m string reference table. It keeps
+             * the same entries as the ReferenceTable used when reading and
+             * can find the index of a string that is already in the table.
+             */
+            class O5mStringTable {
+
+                // The maximum number of entries in this table.
+                enum {
+                    number_of_entries = 15000u
+                };
+
+                // The maximum length of a string in the table including
+                // two \0 bytes.
+                enum {
+                    max_length = 250u + 2u
+                };
+
+                std::vector<std::string> m_entries;
+
+                std::unordered_map<std::string, unsigned int> m_index;
+
+                unsigned int m_current_entry = 0;
+
+                void add_entry(const std::string& str, bool can_be_referenced) {
+                    if (m_entries.size() < number_of_entries) {
+                        m_entries.emplace_back();
+                    } else {
+                        const auto it = m_index.find(m_entries[m_current_entry]);
+                        if (it != m_index.end() && it->second == m_current_entry) {
+                            m_index.erase(it);
+                        }
+                    }
+
+                    m_entries[m_current_entry] = str;
+                    if (can_be_referenced) {
+                        m_index[str] = m_current_entry;
+                    }
+
+                    if (++m_current_entry == number_of_entries) {
+                        m_current_entry = 0;
+                    }
+                }
+
+            public:
+
+                /**
+                 * Get the index under which the string can be referenced or
+                 * 0 if it is not in the table.
+                 */
+                uint64_t lookup(const std::string& str) const {
+                    const auto it = m_index.find(str);
+                    if (it == m_index.end()) {
+                        return 0;
+                    }
+                    return (m_current_entry + number_of_entries - it->second) % number_of_entries;
+                }
+
+                /**
+                 * Add a string written inline to the table. Strings that
+                 * are too long are not added, just like the reader does it.
+                 */
+                void add(const std::string& str) {
+                    if (str.size() <= max_length) {
+                        add_entry(str, true);
+                    }
+                }
+
+                /**
+                 * The reader adds an entry for the anonymous user, but it
+                 * can not be referenced later because it doesn't contain the
+                 * (empty) user name.
+                 */
+                void add_anonymous_user() {
+                    add_entry(std::string{}, false);
+                }
+
+            }; // class O5mStringTable
+
+            struct o5m_output_options {
+
+                /// Which metadata of objects should be added?
+                osmium::metadata_options add_metadata;
+
+            }; // struct o5m_output_options
+
+            /**
+             * Writes out one buffer with OSM data in o5m format. Each block
+             * starts with a reset, so the delta encoding and the string
+             * table only depend on the data in this block and blocks can
+             * be encoded in parallel.
+             */
+            class O5mOutputBlock : public OutputBlock {
+
+                o5m_output_options m_options;
+
+                O5mStringTable m_string_table;
+
+                osmium::DeltaEncode<osmium::object_id_type> m_delta_id;
+
+                osmium::DeltaEncode<int64_t> m_delta_timestamp;
+                osmium::DeltaEncode<osmium::changeset_id_type> m_delta_changeset;
+                osmium::DeltaEncode<int64_t> m_delta_lon;
+                osmium::DeltaEncode<int64_t> m_delta_lat;
+
+                osmium::DeltaEncode<osmium::object_id_type> m_delta_way_node_id;
+                osmium::DeltaEncode<osmium::object_id_type> m_delta_member_ids[3];
+
+                // The contents of the current dataset and its reference
+                // section. Reused for all objects in this block.
+                std::string m_data;
+                std::string m_refs;
+                std::string m_string;
+
+                static void write_varint(std::string& out, uint64_t value) {
+                    protozero::write_varint(std::back_inserter(out), value);
+                }
+
+                static void write_zvarint(std::string& out, int64_t value) {
+                    write_varint(out, protozero::encode_zigzag64(value));
+                }
+
+                // Write the string in m_string, either as reference into
+                // the string table or inline.
+                void write_string(std::string& out) {
+                    const auto index = m_string_table.lookup(m_string);
+                    if (index != 0) {
+                        write_varint(out, index);
+                        return;
+                    }
+                    out += '\0';
+                    out += m_string;
+                    m_string_table.add(m_string);
+                }
+
+                void write_user(osmium::user_id_type uid, const char* user) {
+                    if (uid == 0) {
+                        m_data.append(3, '\0');
+                        m_string_table.add_anonymous_user();
+                        return;
+                    }
+                    m_string.clear();
+                    write_varint(m_string, uid);
+                    m_string += '\0';
+                    m_string += user;
+                    m_string += '\0';
+                    write_string(m_data);
+                }
+
+                // The o5m format has a fixed order of the metadata fields
+                // and the version and timestamp also mark whether the
+                // following fields are there. So there is no info section
+                // without the version, the changeset and user are only
+                // written together with a timestamp, and all fields not
+                // asked for are written as zero or empty.
+                void write_info(const osmium::OSMObject& object) {
+                    const auto& add = m_options.add_metadata;
+                    if (!add.version() || object.version() == 0) {
+                        m_data += '\0';
+                        return;
+                    }
+
+                    write_varint(m_data, object.version());
+
+                    const auto timestamp = add.timestamp() ? object.timestamp().seconds_since_epoch() : 0;
+                    write_zvarint(m_data, m_delta_timestamp.update(timestamp));
+                    if (timestamp != 0) {
+                        write_zvarint(m_data, m_delta_changeset.update(add.changeset() ? object.changeset() : 0));
+                        write_user(add.uid() ? object.uid() : 0, add.user() ? object.user() : "");
+                    }
+                }
+
+                void write_tags(const osmium::TagList& tags) {
+                    for (const auto& tag : tags) {
+                        m_string.assign(tag.key());
+                        m_string += '\0';
+                        m_string += tag.value();
+                        m_string += '\0';
+                        write_string(m_data);
+                    }
+                }
+
+                void write_refs() {
+                    write_varint(m_data, m_refs.size());
+                    m_data += m_refs;
+                }
+
+                void start_dataset(const osmium::OSMObject& object) {
+                    m_data.clear();
+                    write_zvarint(m_data, m_delta_id.update(object.id()));
+                    write_info(object);
+                }
+
+                void write_dataset(o5m_dataset_type type) {
+                    *m_out += static_cast<char>(type);
+                    write_varint(*m_out, m_data.size());
+                    *m_out += m_data;
+                }
+
+            public:
+
+                O5mOutputBlock(osmium::memory::Buffer&& buffer, const o5m_output_options& options, OutputStringPool* string_pool = nullptr) :
+                    OutputBlock(std::move(buffer), 60, string_pool),
+                    m_options(options) {
+                }
+
+                std::string operator()() {
+                    *m_out += static_cast<char>(o5m_dataset_type::reset);
+
+                    osmium::apply(m_input_buffer->cbegin(), m_input_buffer->cend(), *this);
+
+                    std::string out;
+                    using std::swap;
+                    swap(out, *m_out);
+                    return out;
+                }
+
+                // Deleted objects have no data after the info section.
+
+                void node(const osmium::Node& node) {
+                    start_dataset(node);
+                    if (node.visible()) {
+                        write_zvarint(m_data, m_delta_lon.update(node.location().x()));
+                        write_zvarint(m_data, m_delta_lat.update(node.location().y()));
+                        write_tags(node.tags());
+                    }
+                    write_dataset(o5m_dataset_type::node);
+                }
+
+                void way(const osmium::Way& way) {
+                    start_dataset(way);
+                    if (way.visible()) {
+                        m_refs.clear();
+                        for (const auto& node_ref : way.nodes()) {
+                            write_zvarint(m_refs, m_delta_way_node_id.update(node_ref.ref()));
+                        }
+                        write_refs();
+                        write_tags(way.tags());
+                    }
+                    write_dataset(o5m_dataset_type::way);
+                }
+
+                void relation(const osmium::Relation& relation) {
+                    start_dataset(relation);
+                    if (relation.visible()) {
+                        m_refs.clear();
+                        for (const auto& member : relation.members()) {
+                            const auto index = osmium::item_type_to_nwr_index(member.type());
+                            write_zvarint(m_refs, m_delta_member_ids[index].update(member.ref()));
+                            m_string.assign(1, static_cast<char>('0' + index));
+                            m_string += member.role();
+                            m_string += '\0';
+                            write_string(m_refs);
+                        }
+                        write_refs();
+                        write_tags(relation.tags());
+                    }
+                    write_dataset(o5m_dataset_type::relation);
+                }
+
+            }; // class O5mOutputBlock
+
+            class O5mOutputFormat : public osmium::io::detail::OutputFormat {
+
+                o5m_output_options m_options;
+
+                bool m_change_format;
+
+                static void write_dataset(std::string& out, o5m_dataset_type type, const std::string& data) {
+                    out += static_cast<char>(type);
+                    protozero::write_varint(std::back_inserter(out), data.size());
+                    out += data;
+                }
+
+                static void add_zvarint(std::string& out, int64_t value) {
+                    protozero::write_varint(std::back_inserter(out), protozero::encode_zigzag64(value));
+                }
+
+            public:
+
+                O5mOutputFormat(osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) :
+                    OutputFormat(pool, output_queue),
+                    m_change_format(file.is_true("o5c_change_format")) {
+                    m_options.add_metadata = osmium::metadata_options{file.get("add_metadata")};
+                }
+
+                void write_header(const osmium::io::Header& header) final {
+                    std::string out{static_cast<char>(o5m_dataset_type::reset)};
+                    write_dataset(out, o5m_dataset_type::header, m_change_format ? "o5c2" : "o5m2");
+
+                    const std::string timestamp{header.get("timestamp")};
+                    if (!timestamp.empty()) {
+                        try {
+                            std::string data;
+                            add_zvarint(data, osmium::Timestamp{timestamp.c_str()}.seconds_since_epoch());
+                            write_dataset(out, o5m_dataset_type::timestamp, data);
+                        } catch (const std::invalid_argument&) {
+                            // ignore timestamp we can not parse
+                        }
+                    }
+
+                    const osmium::Box box{header.box()};
+                    if (box) {
+                        std::string data;
+                        add_zvarint(data, box.bottom_left().x());
+                        add_zvarint(data, box.bottom_left().y());
+                        add_zvarint(data, box.top_right().x());
+                        add_zvarint(data, box.top_right().y());
+                        write_dataset(out, o5m_dataset_type::bounding_box, data);
+                    }
+
+                    send_to_output_queue(std::move(out));
+                }
+
+                void write_buffer(osmium::memory::Buffer&& buffer) final {
+                    if (buffer.committed() > 0) {
+                        m_output_queue.push(m_pool.submit(O5mOutputBlock{std::move(buffer), m_options, m_string_pool.get()}));
+                    }
+                }
+
+                void write_end() final {
+                    send_to_output_queue(std::string(1, static_cast<char>(o5m_dataset_type::end_of_file)));
+                }
+
+            }; // class O5mOutputFormat
+
+            // we want the register_output_format() function to run, setting
+            // the variable is only a side-effect, it will never be used
+            const bool registered_o5m_output = osmium::io::detail::OutputFormatFactory::instance().register_output_format(osmium::io::file_format::o5m,
+                [](osmium::thread::Pool& pool, const osmium::io::File& file, future_string_queue_type& output_queue) {
+                    return new osmium::io::detail::O5mOutputFormat(pool, file, output_queue);
+            });
+
+            // dummy function to silence the unused variable warning from above
+            inline bool get_registered_o5m_output() noexcept {
+                return registered_o5m_output;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_O5M_OUTPUT_FORMAT_HPP
@@ -38,8 +38,13 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
 #include <osmium/memory/buffer.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
+#include <osmium/util/config.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -98,14 +103,100 @@ namespace osmium {
                 }
             }
 
-            class OPLParser : public Parser {
+            // Collect data coming in blocks into chunks of at least
+            // min_chunk_size bytes which end at a line boundary and hand
+            // them to the worker. Only the last chunk can be smaller or
+            // end without a newline. Like line_by_line() this is a
+            // standalone template function to be better testable.
+            template <typename T>
+            void chunk_by_lines(T& worker, const std::size_t min_chunk_size) {
+                std::string chunk;
+
+                while (!worker.input_done()) {
+                    std::string input{worker.get_input()};
+                    if (chunk.empty()) {
+                        chunk = std::move(input);
+                    } else {
+                        chunk.append(input);
+                    }
+
+                    if (chunk.size() < min_chunk_size) {
+                        continue;
+                    }
+
+                    const auto pos = chunk.find_last_of("\n\r");
+                    if (pos == std::string::npos) {
+                        continue;
+                    }
+
+                    std::string rest{chunk, pos + 1};
+                    chunk.resize(pos + 1);
+                    worker.parse_chunk(std::move(chunk));
+                    chunk = std::move(rest);
+                }
+
+                if (!chunk.empty()) {
+                    worker.parse_chunk(std::move(chunk));
+                }
+            }
+
+            /**
+             * Parses a chunk of OPL data consisting of complete lines into
+             * a buffer. Instances of this class are run in the thread pool.
+             * Line numbers in error messages are counted from first_line,
+             * which is the number of newline characters in the input before
+             * this chunk.
+             */
+            class OPLChunkParser {
 
                 enum {
                     initial_buffer_size = 1024ul * 1024ul
                 };
 
-                osmium::memory::Buffer m_buffer{initial_buffer_size,
-                                                osmium::memory::Buffer::auto_grow::internal};
+                std::string m_data;
+                uint64_t m_first_line;
+                osmium::osm_entity_bits::type m_read_types;
+
+            public:
+
+                OPLChunkParser(std::string&& data, uint64_t first_line, osmium::osm_entity_bits::type read_types) :
+                    m_data(std::move(data)),
+                    m_first_line(first_line),
+                    m_read_types(read_types) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    osmium::memory::Buffer buffer{initial_buffer_size,
+                                                  osmium::memory::Buffer::auto_grow::internal};
+
+                    uint64_t line_count = m_first_line;
+                    std::string::size_type ppos = 0;
+                    while (ppos < m_data.size()) {
+                        auto pos = m_data.find_first_of("\n\r", ppos);
+                        if (pos == std::string::npos) {
+                            pos = m_data.size();
+                        }
+                        const bool newline = pos < m_data.size() && m_data[pos] == '\n';
+                        m_data[pos] = '\0'; // writes the terminating null if pos == size()
+                        if (pos > ppos) {
+                            opl_parse_line(line_count, &m_data[ppos], buffer, m_read_types);
+                        }
+                        if (newline) {
+                            ++line_count;
+                        }
+                        ppos = pos + 1;
+                    }
+
+                    return buffer;
+                }
+
+            }; // class OPLChunkParser
+
+            class OPLParser : public Parser {
+
+                enum {
+                    min_chunk_size = 1024ul * 1024ul
+                };
 
                 uint64_t m_line_count = 0;
 
@@ -124,24 +215,22 @@ namespace osmium {
 
                 ~OPLParser() noexcept final = default;
 
-                void parse_line(const char* data) {
-                    if (opl_parse_line(m_line_count, data, m_buffer, read_types())) {
-                        if (m_buffer.has_nested_buffers()) {
-                            std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
-                            send_to_output_queue(std::move(*buffer_ptr));
-                        }
+                void parse_chunk(std::string&& chunk) {
+                    const auto first_line = m_line_count;
+                    m_line_count += std::count(chunk.cbegin(), chunk.cend(), '\n');
+                    OPLChunkParser chunk_parser{std::move(chunk), first_line, read_types()};
+
+                    if (osmium::config::use_pool_threads_for_opl_parsing()) {
+                        submit_to_pool(std::move(chunk_parser));
+                    } else {
+                        send_to_output_queue(chunk_parser());
                     }
-                    ++m_line_count;
                 }
 
                 void run() final {
                     osmium::thread::set_thread_name("_osmium_opl_in");
 
-                    line_by_line(*this);
-
-                    if (m_buffer.committed() > 0) {
-                        send_to_output_queue(std::move(m_buffer));
-                    }
+                    chunk_by_lines(*this, min_chunk_size);
                 }
 
             }; // class OPLParser
@@ -57,7 +57,6 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/visitor.hpp>
 
 #include <cstdint>
-#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -99,7 +98,9 @@ namespace osmium {
 
                 void write_field_timestamp(char c, const osmium::Timestamp& timestamp) {
                     *m_out += c;
-                    *m_out += timestamp.to_iso();
+                    if (timestamp.valid()) {
+                        append_iso_timestamp(*m_out, timestamp.seconds_since_epoch());
+                    }
                 }
 
                 void write_tags(const osmium::TagList& tags) {
@@ -156,12 +157,12 @@ namespace osmium {
                     *m_out += ' ';
                     *m_out += x;
                     if (not_undefined) {
-                        osmium::detail::append_location_coordinate_to_string(std::back_inserter(*m_out), location.x());
+                        append_location_coordinate(*m_out, location.x());
                     }
                     *m_out += ' ';
                     *m_out += y;
                     if (not_undefined) {
-                        osmium::detail::append_location_coordinate_to_string(std::back_inserter(*m_out), location.y());
+                        append_location_coordinate(*m_out, location.y());
                     }
                 }
 
@@ -173,8 +174,8 @@ namespace osmium {
 
             public:
 
-                OPLOutputBlock(osmium::memory::Buffer&& buffer, const opl_output_options& options) :
-                    OutputBlock(std::move(buffer)),
+                OPLOutputBlock(osmium::memory::Buffer&& buffer, const opl_output_options& options, OutputStringPool* string_pool = nullptr) :
+                    OutputBlock(std::move(buffer), 150, string_pool),
                     m_options(options) {
                 }
 
@@ -200,7 +201,8 @@ namespace osmium {
                     write_field_int('n', node_ref.ref());
                     *m_out += 'x';
                     if (node_ref.location()) {
-                        node_ref.location().as_string(std::back_inserter(*m_out), 'y');
+                        char temp[32];
+                        m_out->append(temp, node_ref.location().as_string(temp, 'y'));
                     } else {
                         *m_out += 'y';
                     }
@@ -295,7 +297,7 @@ namespace osmium {
                 }
 
                 void write_buffer(osmium::memory::Buffer&& buffer) final {
-                    m_output_queue.push(m_pool.submit(OPLOutputBlock{std::move(buffer), m_options}));
+                    m_output_queue.push(m_pool.submit(OPLOutputBlock{std::move(buffer), m_options, m_string_pool.get()}));
                 }
 
             }; // class OPLOutputFormat
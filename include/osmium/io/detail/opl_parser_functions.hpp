@@ -34,6 +34,7 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/builder/osm_object_builder.hpp>
+#include <osmium/io/detail/opl_simd.hpp>
 #include <osmium/io/detail/string_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/memory/buffer.hpp>
@@ -131,9 +132,7 @@ namespace osmium {
              * string.
              */
             inline const char* opl_skip_section(const char** s) noexcept {
-                while (opl_non_empty(*s)) {
-                    ++*s;
-                }
+                *s = opl_simd()->find_section_end(*s);
                 return *s;
             }
 
@@ -184,18 +183,15 @@ namespace osmium {
             inline void opl_parse_string(const char** data, std::string& result) {
                 const char* s = *data;
                 while (true) {
-                    if (*s == '\0' || *s == ' ' || *s == '\t' || *s == ',' || *s == '=') {
-                        break;
-                    }
-                    if (*s == '%') {
-                        ++s;
-                        opl_parse_escaped(&s, result);
-                    } else {
-                        result += *s;
-                        ++s;
+                    const char* end = opl_simd()->find_string_end(s);
+                    result.append(s, end);
+                    if (*end != '%') {
+                        *data = end;
+                        return;
                     }
+                    s = end + 1;
+                    opl_parse_escaped(&s, result);
                 }
-                *data = s;
             }
 
             // Arbitrary limit how long integers can get
@@ -213,22 +209,22 @@ namespace osmium {
                     ++*s;
                 }
 
-                int64_t value = 0;
+                uint64_t digits = 0;
+                const int n = opl_simd()->parse_digits(*s, &digits);
 
-                int n = max_int_len;
-                while (**s >= '0' && **s <= '9') {
-                    if (--n == 0) {
-                        throw opl_error{"integer too long", *s};
-                    }
-                    value *= 10;
-                    value += **s - '0';
-                    ++*s;
+                if (n == 0) {
+                    throw opl_error{"expected integer", *s};
                 }
 
-                if (n == max_int_len) {
-                    throw opl_error{"expected integer", *s};
+                if (n >= max_int_len) {
+                    // Point to the first digit that is too many.
+                    *s += n - 1;
+                    throw opl_error{"integer too long", *s};
                 }
 
+                *s += n;
+                auto value = static_cast<int64_t>(digits);
+
                 if (negative) {
                     value = -value;
                     if (value < std::numeric_limits<T>::min()) {
@@ -243,6 +239,54 @@ namespace osmium {
                 return T(value);
             }
 
+            /**
+             * Parse a coordinate. The common case of up to three digits
+             * before and up to seven digits after the decimal point is
+             * handled here, anything else (including errors) by the
+             * more general osmium::detail::string_to_location_coordinate().
+             */
+            inline int32_t opl_parse_coordinate(const char** data) {
+                static const int64_t powers_of_ten[] = {
+                    10000000, 1000000, 100000, 10000, 1000, 100, 10, 1
+                };
+
+                const char* s = *data;
+                const bool negative = (*s == '-');
+                if (negative) {
+                    ++s;
+                }
+
+                uint64_t integer_part = 0;
+                const int integer_digits = opl_simd()->parse_digits(s, &integer_part);
+                if (integer_digits == 0 || integer_digits > 3) {
+                    return osmium::detail::string_to_location_coordinate(data);
+                }
+                s += integer_digits;
+
+                uint64_t fraction = 0;
+                int fraction_digits = 0;
+                if (*s == '.') {
+                    fraction_digits = opl_simd()->parse_digits(s + 1, &fraction);
+                    if (fraction_digits > 7) {
+                        return osmium::detail::string_to_location_coordinate(data);
+                    }
+                    s += 1 + fraction_digits;
+                }
+
+                if (*s == 'e' || *s == 'E') {
+                    return osmium::detail::string_to_location_coordinate(data);
+                }
+
+                const int64_t value = static_cast<int64_t>(integer_part) * osmium::detail::coordinate_precision +
+                                      static_cast<int64_t>(fraction) * powers_of_ten[fraction_digits];
+                if (value > std::numeric_limits<int32_t>::max()) {
+                    return osmium::detail::string_to_location_coordinate(data);
+                }
+
+                *data = s;
+                return static_cast<int32_t>(negative ? -value : value);
+            }
+
             inline osmium::object_id_type opl_parse_id(const char** s) {
                 return opl_parse_int<osmium::object_id_type>(s);
             }
@@ -348,10 +392,10 @@ namespace osmium {
                     osmium::Location location;
                     if (*s == 'x') {
                         ++s;
-                        location.set_lon_partial(&s);
+                        location.set_x(opl_parse_coordinate(&s));
                         if (*s == 'y') {
                             ++s;
-                            location.set_lat_partial(&s);
+                            location.set_y(opl_parse_coordinate(&s));
                         }
                     }
 
@@ -408,12 +452,12 @@ namespace osmium {
                             break;
                         case 'x':
                             if (opl_non_empty(*data)) {
-                                location.set_lon_partial(data);
+                                location.set_x(opl_parse_coordinate(data));
                             }
                             break;
                         case 'y':
                             if (opl_non_empty(*data)) {
-                                location.set_lat_partial(data);
+                                location.set_y(opl_parse_coordinate(data));
                             }
                             break;
                         default:
@@ -631,22 +675,22 @@ namespace osmium {
                             break;
                         case 'x':
                             if (opl_non_empty(*data)) {
-                                box.bottom_left().set_lon_partial(data);
+                                box.bottom_left().set_x(opl_parse_coordinate(data));
                             }
                             break;
                         case 'y':
                             if (opl_non_empty(*data)) {
-                                box.bottom_left().set_lat_partial(data);
+                                box.bottom_left().set_y(opl_parse_coordinate(data));
                             }
                             break;
                         case 'X':
                             if (opl_non_empty(*data)) {
-                                box.top_right().set_lon_partial(data);
+                                box.top_right().set_x(opl_parse_coordinate(data));
                             }
                             break;
                         case 'Y':
                             if (opl_non_empty(*data)) {
-                                box.top_right().set_lat_partial(data);
+                                box.top_right().set_y(opl_parse_coordinate(data));
                             }
                             break;
                         case 'T':
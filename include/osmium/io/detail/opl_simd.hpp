@@ -0,0 +1,249 @@
+#ifndef OSMIUM_IO_DETAIL_OPL_SIMD_HPP
+#define OSMIUM_IO_DETAIL_OPL_SIMD_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <cstdint>
+
+#if !defined(OSMIUM_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define OSMIUM_OPL_SIMD
+# include <immintrin.h>
+#endif
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * The instruction set extensions used to speed up the OPL
+             * parser. Support is detected at runtime, the SIMD versions
+             * are only compiled in when using GCC or clang on x86. Define
+             * OSMIUM_NO_SIMD to always use the scalar code.
+             *
+             * There is no AVX2 version. It was only about 5% faster than
+             * the scalar code, most of the time goes into building the
+             * objects, and the wider loads read even further beyond the
+             * end of the strings.
+             */
+            enum class opl_simd_level {
+                none  = 0,
+                sse42 = 1
+            };
+
+            // Scalar versions of the functions below. They are used if the
+            // CPU doesn't support any of the SIMD instruction sets and to
+            // check the SIMD versions.
+
+            template <bool StringEnd>
+            inline const char* opl_find_special_scalar(const char* s) noexcept {
+                while (*s != '\0' && *s != ' ' && *s != '\t' &&
+                       (!StringEnd || (*s != ',' && *s != '=' && *s != '%'))) {
+                    ++s;
+                }
+                return s;
+            }
+
+            inline int opl_parse_digits_scalar(const char* s, uint64_t* value) noexcept {
+                uint64_t result = 0;
+                int n = 0;
+                while (n < 16 && s[n] >= '0' && s[n] <= '9') {
+                    result = result * 10 + static_cast<uint64_t>(s[n] - '0');
+                    ++n;
+                }
+                *value = result;
+                return n;
+            }
+
+#ifdef OSMIUM_OPL_SIMD
+
+            // The scanning functions use aligned loads which can never
+            // cross a page boundary, so they can't fault even though they
+            // read some bytes before the start and after the end of the
+            // string. That's the same technique the strlen() in the C
+            // library uses. The address sanitizer doesn't know that, so it
+            // has to be switched off for these functions.
+
+            template <bool StringEnd>
+            __attribute__((target("sse4.2")))
+            inline uint32_t opl_special_mask_sse42(__m128i v) noexcept {
+                __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+                            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+                if (StringEnd) {
+                    m = _mm_or_si128(m,
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('=')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('%')))));
+                }
+                return static_cast<uint32_t>(_mm_movemask_epi8(m));
+            }
+
+            template <bool StringEnd>
+            __attribute__((target("sse4.2"), no_sanitize_address))
+            inline const char* opl_find_special_sse42(const char* s) noexcept {
+                const auto offset = reinterpret_cast<std::uintptr_t>(s) & 15u;
+                const char* p = s - offset;
+                uint32_t mask = opl_special_mask_sse42<StringEnd>(_mm_load_si128(reinterpret_cast<const __m128i*>(p))) >> offset;
+                if (mask != 0) {
+                    return s + __builtin_ctz(mask);
+                }
+                while (true) {
+                    p += 16;
+                    mask = opl_special_mask_sse42<StringEnd>(_mm_load_si128(reinterpret_cast<const __m128i*>(p)));
+                    if (mask != 0) {
+                        return p + __builtin_ctz(mask);
+                    }
+                }
+            }
+
+            // Parse up to 15 decimal digits without branching on each digit:
+            // The digits are moved to the end of a 16 byte register and
+            // then combined pairwise with multiply-add instructions until
+            // there are two 8-digit numbers left. The unaligned load is only
+            // done if it doesn't cross a page boundary, the (rare) other
+            // case is handled by the scalar code.
+            __attribute__((target("sse4.2"), no_sanitize_address))
+            inline int opl_parse_digits_sse42(const char* s, uint64_t* value) noexcept {
+                if ((reinterpret_cast<std::uintptr_t>(s) & 4095u) > 4096u - 16u) {
+                    return opl_parse_digits_scalar(s, value);
+                }
+
+                const __m128i digits = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s)), _mm_set1_epi8('0'));
+                const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+                const auto non_digits = ~static_cast<uint32_t>(_mm_movemask_epi8(is_digit)) & 0xffffu;
+                if (non_digits == 0) {
+                    *value = 0;
+                    return 16;
+                }
+
+                const int n = __builtin_ctz(non_digits);
+                const __m128i index = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                                   _mm_set1_epi8(static_cast<char>(n - 16)));
+                const __m128i aligned = _mm_shuffle_epi8(digits, index);
+
+                const __m128i pairs = _mm_maddubs_epi16(aligned, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+                const __m128i quads = _mm_madd_epi16(pairs, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+                const __m128i packed = _mm_packus_epi32(quads, quads);
+                const __m128i octets = _mm_madd_epi16(packed, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+                *value = static_cast<uint64_t>(_mm_cvtsi128_si32(octets)) * 100000000u +
+                         static_cast<uint64_t>(_mm_extract_epi32(octets, 1));
+                return n;
+            }
+
+#endif
+
+            struct opl_simd_functions {
+                opl_simd_level level;
+
+                // Find the end of a string: '\0', space, tab, comma, equal
+                // sign or the '%' starting an escape sequence.
+                const char* (*find_string_end)(const char*);
+
+                // Find the end of a section: '\0', space or tab.
+                const char* (*find_section_end)(const char*);
+
+                // Parse decimal digits. Returns the number of digits and
+                // sets value. If there are 16 or more digits, 16 is
+                // returned and value is undefined.
+                int (*parse_digits)(const char*, uint64_t*);
+            };
+
+            inline opl_simd_level opl_simd_level_supported() noexcept {
+#ifdef OSMIUM_OPL_SIMD
+                __builtin_cpu_init();
+                if (__builtin_cpu_supports("sse4.2")) {
+                    return opl_simd_level::sse42;
+                }
+#endif
+                return opl_simd_level::none;
+            }
+
+            inline const opl_simd_functions* opl_simd_functions_for(opl_simd_level level) noexcept {
+                static const opl_simd_functions scalar{opl_simd_level::none,
+                                                       opl_find_special_scalar<true>,
+                                                       opl_find_special_scalar<false>,
+                                                       opl_parse_digits_scalar};
+#ifdef OSMIUM_OPL_SIMD
+                static const opl_simd_functions sse42{opl_simd_level::sse42,
+                                                      opl_find_special_sse42<true>,
+                                                      opl_find_special_sse42<false>,
+                                                      opl_parse_digits_sse42};
+                if (level == opl_simd_level::sse42) {
+                    return &sse42;
+                }
+#endif
+                return &scalar;
+            }
+
+            inline std::atomic<const opl_simd_functions*>& opl_simd_functions_used() noexcept {
+                static std::atomic<const opl_simd_functions*> functions{opl_simd_functions_for(opl_simd_level_supported())};
+                return functions;
+            }
+
+            // The functions are all equivalent, so it doesn't matter which
+            // version a thread sees while the level is changed.
+            inline const opl_simd_functions* opl_simd() noexcept {
+                return opl_simd_functions_used().load(std::memory_order_relaxed);
+            }
+
+            /**
+             * Set the SIMD level used by the OPL parser. The level is
+             * capped at what the CPU supports. This is mostly useful for
+             * testing and benchmarking.
+             *
+             * @returns The level that is actually used.
+             */
+            inline opl_simd_level set_opl_simd_level(opl_simd_level level) noexcept {
+                const auto supported = opl_simd_level_supported();
+                if (static_cast<int>(level) > static_cast<int>(supported)) {
+                    level = supported;
+                }
+                opl_simd_functions_used().store(opl_simd_functions_for(level), std::memory_order_relaxed);
+                return level;
+            }
+
+            inline opl_simd_level get_opl_simd_level() noexcept {
+                return opl_simd()->level;
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_OPL_SIMD_HPP
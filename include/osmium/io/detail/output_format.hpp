@@ -34,7 +34,9 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/handler.hpp>
+#include <osmium/io/detail/output_string_pool.hpp>
 #include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/detail/string_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
 #include <osmium/io/file_format.hpp>
@@ -66,33 +68,34 @@ namespace osmium {
 
                 std::shared_ptr<std::string> m_out;
 
-                explicit OutputBlock(osmium::memory::Buffer&& buffer) :
+                static std::string get_output_string(OutputStringPool* string_pool, std::size_t capacity) {
+                    if (capacity > OutputStringPool::max_string_capacity) {
+                        capacity = OutputStringPool::max_string_capacity;
+                    }
+                    if (string_pool) {
+                        return string_pool->get(capacity);
+                    }
+                    std::string str;
+                    str.reserve(capacity);
+                    return str;
+                }
+
+                /**
+                 * Construct an OutputBlock. The output string is taken from
+                 * the string_pool (if there is one) with a capacity of
+                 * size_percent percent of the size of the data in the
+                 * buffer. This should be a (generous) estimate of the size
+                 * of the output, so that the string doesn't have to grow
+                 * while writing to it. The capacity is capped so that the
+                 * string can be given back to the pool.
+                 */
+                explicit OutputBlock(osmium::memory::Buffer&& buffer, std::size_t size_percent = 100, OutputStringPool* string_pool = nullptr) :
                     m_input_buffer(std::make_shared<osmium::memory::Buffer>(std::move(buffer))),
-                    m_out(std::make_shared<std::string>()) {
+                    m_out(std::make_shared<std::string>(get_output_string(string_pool, m_input_buffer->committed() / 100 * size_percent))) {
                 }
 
-                // Simple function to convert integer to string. This is much
-                // faster than using sprintf, but could be further optimized.
-                // See https://github.com/miloyip/itoa-benchmark .
                 void output_int(int64_t value) {
-                    if (value < 0) {
-                        *m_out += '-';
-                        value = -value;
-                    }
-
-                    char temp[20];
-                    char *t = temp;
-                    do {
-                        *t++ = char(value % 10) + '0';
-                        value /= 10;
-                    } while (value > 0);
-
-                    const auto old_size = m_out->size();
-                    m_out->resize(old_size + (t - temp));
-                    char* data = &(*m_out)[old_size];
-                    do {
-                        *data++ += *--t;
-                    } while (t != temp);
+                    append_int(*m_out, value);
                 }
 
             }; // class OutputBlock;
@@ -111,6 +114,10 @@ namespace osmium {
                 osmium::thread::Pool& m_pool;
                 future_string_queue_type& m_output_queue;
 
+                // Output strings of this Writer are taken from and given
+                // back to this pool.
+                std::shared_ptr<OutputStringPool> m_string_pool{std::make_shared<OutputStringPool>()};
+
                 /**
                  * Wrap the string into a future and add it to the output
                  * queue.
@@ -134,6 +141,10 @@ namespace osmium {
 
                 virtual ~OutputFormat() noexcept = default;
 
+                const std::shared_ptr<OutputStringPool>& string_pool() const noexcept {
+                    return m_string_pool;
+                }
+
                 virtual void write_header(const osmium::io::Header& /*header*/) {
                 }
 
@@ -0,0 +1,166 @@
+#ifndef OSMIUM_IO_DETAIL_OUTPUT_STRING_POOL_HPP
+#define OSMIUM_IO_DETAIL_OUTPUT_STRING_POOL_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            /**
+             * A pool of strings used for the output of the XML, OPL, o5m,
+             * and debug formats. The strings are filled in the thread pool
+             * and given back to this pool by the WriteThread after they
+             * have been written out, so their memory can be used again and
+             * doesn't have to be allocated and grown for every block.
+             *
+             * Every Writer has its own pool which goes away with the Writer.
+             * The pool is limited by the total capacity of the strings in
+             * it, so it never keeps more than a few output blocks alive.
+             *
+             * All functions are thread-safe.
+             */
+            class OutputStringPool {
+
+            public:
+
+                enum : std::size_t {
+                    // Maximum number of strings kept in the pool.
+                    max_strings = 64,
+
+                    // Strings with a smaller capacity are not worth keeping.
+                    min_capacity = 4096,
+
+                    // Strings with a larger capacity are not kept. Large
+                    // enough for the output of the 10MB buffers the Writer
+                    // creates in the most verbose formats.
+                    max_string_capacity = 32ul * 1024ul * 1024ul,
+
+                    // Maximum total capacity of all strings in the pool.
+                    max_capacity = 2ul * max_string_capacity
+                };
+
+            private:
+
+                std::mutex m_mutex;
+                std::vector<std::string> m_strings;
+                std::size_t m_capacity = 0;
+
+            public:
+
+                OutputStringPool() = default;
+
+                OutputStringPool(const OutputStringPool&) = delete;
+                OutputStringPool& operator=(const OutputStringPool&) = delete;
+
+                OutputStringPool(OutputStringPool&&) = delete;
+                OutputStringPool& operator=(OutputStringPool&&) = delete;
+
+                ~OutputStringPool() noexcept = default;
+
+                /**
+                 * Get an empty string from the pool (or a new one if the
+                 * pool is empty) with at least the given capacity.
+                 */
+                std::string get(std::size_t capacity = 0) {
+                    std::string str;
+                    {
+                        std::lock_guard<std::mutex> lock{m_mutex};
+                        if (!m_strings.empty()) {
+                            using std::swap;
+                            swap(str, m_strings.back());
+                            m_strings.pop_back();
+                            m_capacity -= str.capacity();
+                        }
+                    }
+                    str.reserve(capacity);
+                    return str;
+                }
+
+                /**
+                 * Give a string back to the pool. Its content is discarded.
+                 */
+                void put(std::string&& str) {
+                    if (str.capacity() < min_capacity || str.capacity() > max_string_capacity) {
+                        return;
+                    }
+                    str.clear();
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    if (m_strings.size() < max_strings && m_capacity + str.capacity() <= max_capacity) {
+                        m_capacity += str.capacity();
+                        m_strings.push_back(std::move(str));
+                    }
+                }
+
+                /**
+                 * Remove all strings from the pool and free their memory.
+                 */
+                void clear() {
+                    std::vector<std::string> strings;
+                    {
+                        std::lock_guard<std::mutex> lock{m_mutex};
+                        using std::swap;
+                        swap(strings, m_strings);
+                        m_capacity = 0;
+                    }
+                }
+
+                /// The number of strings currently in the pool.
+                std::size_t size() {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    return m_strings.size();
+                }
+
+                /// The total capacity of the strings currently in the pool.
+                std::size_t capacity() {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    return m_capacity;
+                }
+
+            }; // class OutputStringPool
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_OUTPUT_STRING_POOL_HPP
@@ -39,6 +39,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/detail/zlib.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_block_index.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/box.hpp>
 #include <osmium/osm/entity_bits.hpp>
@@ -56,15 +57,26 @@ DEALINGS IN THE SOFTWARE.
 #include <protozero/pbf_message.hpp>
 #include <protozero/types.hpp>
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
+
+#ifdef OSMIUM_WITH_LZ4
+# include <osmium/io/detail/lz4.hpp>
+#endif
+
 namespace osmium {
 
     namespace builder {
@@ -738,9 +750,26 @@ namespace osmium {
 
             }; // class PBFPrimitiveBlockDecoder
 
-            inline data_view decode_blob(const std::string& blob_data, std::string& output) {
+            /**
+             * Decode a Blob message and return its uncompressed contents.
+             *
+             * Blobs compressed with zstd or lz4 can only be decoded if
+             * OSMIUM_WITH_ZSTD or OSMIUM_WITH_LZ4 is defined, respectively.
+             *
+             * @param blob_data Input data (the Blob message)
+             * @param output String used as buffer for the uncompressed data
+             * @returns Uncompressed data
+             * @throws osmium::pbf_error If the blob can't be decoded.
+             */
+            inline data_view decode_blob(const data_view& blob_data, std::string& output) {
                 int32_t raw_size = 0;
                 protozero::data_view zlib_data;
+#ifdef OSMIUM_WITH_ZSTD
+                protozero::data_view zstd_data;
+#endif
+#ifdef OSMIUM_WITH_LZ4
+                protozero::data_view lz4_data;
+#endif
 
                 protozero::pbf_message<FileFormat::Blob> pbf_blob{blob_data};
                 while (pbf_blob.next()) {
@@ -764,23 +793,270 @@ namespace osmium {
                             break;
                         case protozero::tag_and_type(FileFormat::Blob::optional_bytes_lzma_data, protozero::pbf_wire_type::length_delimited):
                             throw osmium::pbf_error{"lzma blobs not implemented"};
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_zstd_data, protozero::pbf_wire_type::length_delimited):
+#ifdef OSMIUM_WITH_ZSTD
+                            zstd_data = pbf_blob.get_view();
+                            break;
+#else
+                            throw osmium::pbf_error{"zstd blobs not supported (compile with OSMIUM_WITH_ZSTD)"};
+#endif
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_lz4_data, protozero::pbf_wire_type::length_delimited):
+#ifdef OSMIUM_WITH_LZ4
+                            lz4_data = pbf_blob.get_view();
+                            break;
+#else
+                            throw osmium::pbf_error{"lz4 blobs not supported (compile with OSMIUM_WITH_LZ4)"};
+#endif
                         default:
                             throw osmium::pbf_error{"unknown compression"};
                     }
                 }
 
-                if (!zlib_data.empty() && raw_size != 0) {
-                    return osmium::io::detail::zlib_uncompress_string(
-                        zlib_data.data(),
-                        static_cast<unsigned long>(zlib_data.size()), // NOLINT(google-runtime-int)
-                        static_cast<unsigned long>(raw_size), // NOLINT(google-runtime-int)
-                        output
-                    );
+                if (raw_size != 0) {
+                    if (!zlib_data.empty()) {
+                        return osmium::io::detail::zlib_uncompress_string(
+                            zlib_data.data(),
+                            static_cast<unsigned long>(zlib_data.size()), // NOLINT(google-runtime-int)
+                            static_cast<unsigned long>(raw_size), // NOLINT(google-runtime-int)
+                            output
+                        );
+                    }
+#ifdef OSMIUM_WITH_ZSTD
+                    if (!zstd_data.empty()) {
+                        return osmium::io::detail::zstd_uncompress_string(zstd_data.data(), zstd_data.size(), static_cast<std::size_t>(raw_size), output);
+                    }
+#endif
+#ifdef OSMIUM_WITH_LZ4
+                    if (!lz4_data.empty()) {
+                        return osmium::io::detail::lz4_uncompress_string(lz4_data.data(), lz4_data.size(), static_cast<std::size_t>(raw_size), output);
+                    }
+#endif
                 }
 
                 throw osmium::pbf_error{"blob contains no data"};
             }
 
+            /**
+             * Gives access to the beginning of the uncompressed contents
+             * of a blob byte by byte, decompressing only as much as needed.
+             */
+            class blob_peek_stream {
+
+                static constexpr const std::size_t chunk_size = 4096;
+
+                std::unique_ptr<zlib_inflate_stream> m_zlib_stream;
+                std::unique_ptr<char[]> m_chunk;
+                const char* m_data = nullptr;
+                const char* m_end = nullptr;
+
+                bool fill() {
+                    if (!m_zlib_stream) {
+                        return false;
+                    }
+                    const auto size = m_zlib_stream->read(m_chunk.get(), chunk_size);
+                    m_data = m_chunk.get();
+                    m_end = m_data + size;
+                    return size != 0;
+                }
+
+            public:
+
+                /**
+                 * @param data The raw or zlib-compressed data from the blob
+                 * @param compressed Is the data zlib-compressed?
+                 */
+                blob_peek_stream(const data_view& data, const bool compressed) {
+                    if (compressed) {
+                        m_zlib_stream.reset(new zlib_inflate_stream{data.data(), static_cast<unsigned long>(data.size())}); // NOLINT(google-runtime-int)
+                        m_chunk.reset(new char[chunk_size]);
+                    } else {
+                        m_data = data.data();
+                        m_end = data.data() + data.size();
+                    }
+                }
+
+                bool get_byte(char& c) {
+                    if (m_data == m_end && !fill()) {
+                        return false;
+                    }
+                    c = *m_data++;
+                    return true;
+                }
+
+                bool get_varint(uint64_t& value) {
+                    value = 0;
+                    char c = 0;
+                    for (unsigned int shift = 0; shift < 64; shift += 7) {
+                        if (!get_byte(c)) {
+                            return false;
+                        }
+                        value |= static_cast<uint64_t>(static_cast<unsigned char>(c) & 0x7fu) << shift;
+                        if ((static_cast<unsigned char>(c) & 0x80u) == 0) {
+                            return true;
+                        }
+                    }
+                    return false;
+                }
+
+                bool skip(uint64_t size) {
+                    while (size > 0) {
+                        if (m_data == m_end && !fill()) {
+                            return false;
+                        }
+                        const auto n = std::min(size, static_cast<uint64_t>(m_end - m_data));
+                        m_data += n;
+                        size -= n;
+                    }
+                    return true;
+                }
+
+            }; // class blob_peek_stream
+
+            /**
+             * Find out the type of objects in the first PrimitiveGroup of a
+             * blob containing a PrimitiveBlock. Only the data up to the
+             * first PrimitiveGroup is decompressed, usually that is the
+             * string table only. Together with the "Sort.Type_then_ID"
+             * header flag this can be used to find blocks that can't
+             * contain any objects of the requested types.
+             *
+             * @param blob_data Input data (the Blob message)
+             * @returns Object type or osm_entity_bits::nothing if the
+             *          blob contains no PrimitiveGroup or if the type can't
+             *          be found out (for instance because of an unknown
+             *          compression).
+             */
+            inline osmium::osm_entity_bits::type peek_first_group_type(const data_view& blob_data) {
+                std::unique_ptr<blob_peek_stream> stream;
+
+                protozero::pbf_message<FileFormat::Blob> pbf_blob{blob_data};
+                while (!stream && pbf_blob.next()) {
+                    switch (pbf_blob.tag_and_type()) {
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_raw, protozero::pbf_wire_type::length_delimited):
+                            stream.reset(new blob_peek_stream{pbf_blob.get_view(), false});
+                            break;
+                        case protozero::tag_and_type(FileFormat::Blob::optional_bytes_zlib_data, protozero::pbf_wire_type::length_delimited):
+                            stream.reset(new blob_peek_stream{pbf_blob.get_view(), true});
+                            break;
+                        default:
+                            pbf_blob.skip();
+                    }
+                }
+
+                if (!stream) {
+                    return osmium::osm_entity_bits::nothing;
+                }
+
+                uint64_t key = 0;
+                while (stream->get_varint(key)) {
+                    const auto wire_type = static_cast<protozero::pbf_wire_type>(key & 0x07u);
+                    const auto tag = static_cast<protozero::pbf_tag_type>(key >> 3u);
+
+                    if (tag == static_cast<protozero::pbf_tag_type>(OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup) &&
+                        wire_type == protozero::pbf_wire_type::length_delimited) {
+                        uint64_t length = 0;
+                        if (!stream->get_varint(length) || !stream->get_varint(key)) {
+                            return osmium::osm_entity_bits::nothing;
+                        }
+                        switch (static_cast<OSMFormat::PrimitiveGroup>(key >> 3u)) {
+                            case OSMFormat::PrimitiveGroup::repeated_Node_nodes:
+                            case OSMFormat::PrimitiveGroup::optional_DenseNodes_dense:
+                                return osmium::osm_entity_bits::node;
+                            case OSMFormat::PrimitiveGroup::repeated_Way_ways:
+                                return osmium::osm_entity_bits::way;
+                            case OSMFormat::PrimitiveGroup::repeated_Relation_relations:
+                                return osmium::osm_entity_bits::relation;
+                            case OSMFormat::PrimitiveGroup::repeated_ChangeSet_changesets:
+                                return osmium::osm_entity_bits::changeset;
+                            default:
+                                return osmium::osm_entity_bits::nothing;
+                        }
+                    }
+
+                    uint64_t length = 0;
+                    switch (wire_type) {
+                        case protozero::pbf_wire_type::varint:
+                            if (!stream->get_varint(length)) {
+                                return osmium::osm_entity_bits::nothing;
+                            }
+                            break;
+                        case protozero::pbf_wire_type::fixed64:
+                            length = 8;
+                            break;
+                        case protozero::pbf_wire_type::length_delimited:
+                            if (!stream->get_varint(length)) {
+                                return osmium::osm_entity_bits::nothing;
+                            }
+                            break;
+                        case protozero::pbf_wire_type::fixed32:
+                            length = 4;
+                            break;
+                        default:
+                            return osmium::osm_entity_bits::nothing;
+                    }
+                    if (wire_type != protozero::pbf_wire_type::varint && !stream->skip(length)) {
+                        return osmium::osm_entity_bits::nothing;
+                    }
+                }
+
+                return osmium::osm_entity_bits::nothing;
+            }
+
+            template <typename TMessage, typename TTag>
+            inline void add_id_to_block_info(PBFBlockIndex::block_info& info, const data_view& data, const osmium::osm_entity_bits::type type, const TTag id_tag) {
+                protozero::pbf_message<TMessage> pbf_object{data};
+                if (pbf_object.next(id_tag, protozero::pbf_wire_type::varint)) {
+                    info.add(type, std::is_same<TMessage, OSMFormat::Node>::value ? pbf_object.get_sint64() : pbf_object.get_int64());
+                }
+            }
+
+            /**
+             * Get the types and the smallest and largest IDs of the objects
+             * in a PrimitiveBlock. Only the IDs are looked at, the objects
+             * themselves are not decoded. The offset in the result is not
+             * set.
+             *
+             * @param data Uncompressed PrimitiveBlock
+             * @returns Block info
+             * @throws osmium::pbf_error If there was a parsing error
+             */
+            inline PBFBlockIndex::block_info decode_block_info(const data_view& data) {
+                PBFBlockIndex::block_info info;
+
+                protozero::pbf_message<OSMFormat::PrimitiveBlock> pbf_primitive_block{data};
+                while (pbf_primitive_block.next(OSMFormat::PrimitiveBlock::repeated_PrimitiveGroup_primitivegroup, protozero::pbf_wire_type::length_delimited)) {
+                    protozero::pbf_message<OSMFormat::PrimitiveGroup> pbf_primitive_group = pbf_primitive_block.get_message();
+                    while (pbf_primitive_group.next()) {
+                        switch (pbf_primitive_group.tag_and_type()) {
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Node_nodes, protozero::pbf_wire_type::length_delimited):
+                                add_id_to_block_info<OSMFormat::Node>(info, pbf_primitive_group.get_view(), osmium::osm_entity_bits::node, OSMFormat::Node::required_sint64_id);
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::optional_DenseNodes_dense, protozero::pbf_wire_type::length_delimited):
+                                {
+                                    protozero::pbf_message<OSMFormat::DenseNodes> pbf_dense_nodes{pbf_primitive_group.get_view()};
+                                    if (pbf_dense_nodes.next(OSMFormat::DenseNodes::packed_sint64_id, protozero::pbf_wire_type::length_delimited)) {
+                                        osmium::DeltaDecode<int64_t> dense_id;
+                                        for (const auto id : pbf_dense_nodes.get_packed_sint64()) {
+                                            info.add(osmium::osm_entity_bits::node, dense_id.update(id));
+                                        }
+                                    }
+                                }
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Way_ways, protozero::pbf_wire_type::length_delimited):
+                                add_id_to_block_info<OSMFormat::Way>(info, pbf_primitive_group.get_view(), osmium::osm_entity_bits::way, OSMFormat::Way::required_int64_id);
+                                break;
+                            case protozero::tag_and_type(OSMFormat::PrimitiveGroup::repeated_Relation_relations, protozero::pbf_wire_type::length_delimited):
+                                add_id_to_block_info<OSMFormat::Relation>(info, pbf_primitive_group.get_view(), osmium::osm_entity_bits::relation, OSMFormat::Relation::required_int64_id);
+                                break;
+                            default:
+                                pbf_primitive_group.skip();
+                        }
+                    }
+                }
+
+                return info;
+            }
+
             inline osmium::Box decode_header_bbox(const data_view& data) {
                     int64_t left   = std::numeric_limits<int64_t>::max();
                     int64_t right  = std::numeric_limits<int64_t>::max();
@@ -848,7 +1124,13 @@ namespace osmium {
                             }
                             break;
                         case protozero::tag_and_type(OSMFormat::HeaderBlock::repeated_string_optional_features, protozero::pbf_wire_type::length_delimited):
-                            header.set("pbf_optional_feature_" + std::to_string(i++), pbf_header_block.get_string());
+                            {
+                                const auto feature = pbf_header_block.get_string();
+                                if (feature == "Sort.Type_then_ID") {
+                                    header.set("sorting", "Type_then_ID");
+                                }
+                                header.set("pbf_optional_feature_" + std::to_string(i++), feature);
+                            }
                             break;
                         case protozero::tag_and_type(OSMFormat::HeaderBlock::optional_string_writingprogram, protozero::pbf_wire_type::length_delimited):
                             header.set("generator", pbf_header_block.get_string());
@@ -881,7 +1163,7 @@ namespace osmium {
              * @returns Header object
              * @throws osmium::pbf_error If there was a parsing error
              */
-            inline osmium::io::Header decode_header(const std::string& header_block_data) {
+            inline osmium::io::Header decode_header(const data_view& header_block_data) {
                 std::string output;
 
                 return decode_header_block(decode_blob(header_block_data, output));
@@ -889,7 +1171,9 @@ namespace osmium {
 
             class PBFDataBlobDecoder {
 
+                // Owns the input data unless it is memory mapped
                 std::shared_ptr<std::string> m_input_buffer;
+                data_view m_input_data;
                 osmium::osm_entity_bits::type m_read_types;
                 osmium::io::read_meta m_read_metadata;
 
@@ -897,13 +1181,30 @@ namespace osmium {
 
                 PBFDataBlobDecoder(std::string&& input_buffer, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
                     m_input_buffer(std::make_shared<std::string>(std::move(input_buffer))),
+                    m_input_data(m_input_buffer->data(), m_input_buffer->size()),
                     m_read_types(read_types),
                     m_read_metadata(read_metadata) {
                 }
 
+                /**
+                 * Construct decoder for data that is owned by somebody else
+                 * (usually the memory mapped input file). The data must
+                 * stay valid until the decoder has run.
+                 */
+                PBFDataBlobDecoder(const data_view& input_data, const osmium::osm_entity_bits::type read_types, const osmium::io::read_meta read_metadata) :
+                    m_input_buffer(),
+                    m_input_data(input_data),
+                    m_read_types(read_types),
+                    m_read_metadata(read_metadata) {
+                }
+
+                const data_view& data() const noexcept {
+                    return m_input_data;
+                }
+
                 osmium::memory::Buffer operator()() {
                     std::string output;
-                    PBFPrimitiveBlockDecoder decoder{decode_blob(*m_input_buffer, output), m_read_types, m_read_metadata};
+                    PBFPrimitiveBlockDecoder decoder{decode_blob(m_input_data, output), m_read_types, m_read_metadata};
                     return decoder();
                 }
 
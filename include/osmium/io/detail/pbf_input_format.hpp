@@ -34,11 +34,13 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/io/detail/input_format.hpp>
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/pbf.hpp> // IWYU pragma: export
 #include <osmium/io/detail/pbf_decoder.hpp>
 #include <osmium/io/detail/protobuf_tags.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_block_index.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
@@ -51,10 +53,13 @@ DEALINGS IN THE SOFTWARE.
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <future>
 #include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -62,10 +67,75 @@ namespace osmium {
 
         namespace detail {
 
+            /**
+             * Decode the 4 bytes in network byte order in front of each
+             * BlobHeader. They contain the length of the BlobHeader.
+             *
+             * @throws osmium::pbf_error If the size is too large
+             */
+            inline uint32_t decode_blob_header_size(const char* d) {
+                const uint32_t size = (static_cast<uint32_t>(d[3])) |
+                                      (static_cast<uint32_t>(d[2]) << 8u) |
+                                      (static_cast<uint32_t>(d[1]) << 16u) |
+                                      (static_cast<uint32_t>(d[0]) << 24u);
+
+                if (size > static_cast<uint32_t>(max_blob_header_size)) {
+                    throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
+                }
+
+                return size;
+            }
+
+            /**
+             * Decode the BlobHeader. Make sure it contains the expected
+             * type. Return the size of the following Blob.
+             */
+            inline size_t decode_blob_header(const protozero::data_view& data, const char* expected_type) {
+                protozero::pbf_message<FileFormat::BlobHeader> pbf_blob_header{data};
+                protozero::data_view blob_header_type;
+                size_t blob_header_datasize = 0;
+
+                while (pbf_blob_header.next()) {
+                    switch (pbf_blob_header.tag_and_type()) {
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
+                            blob_header_type = pbf_blob_header.get_view();
+                            break;
+                        case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
+                            blob_header_datasize = pbf_blob_header.get_int32();
+                            break;
+                        default:
+                            pbf_blob_header.skip();
+                    }
+                }
+
+                if (blob_header_datasize == 0) {
+                    throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
+                }
+
+                if (std::strncmp(expected_type, blob_header_type.data(), blob_header_type.size()) != 0) {
+                    throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+                }
+
+                return blob_header_datasize;
+            }
+
+            inline void check_blob_size(size_t size) {
+                if (size > max_uncompressed_blob_size) {
+                    throw osmium::pbf_error{std::string{"invalid blob size: "} +
+                                            std::to_string(size)};
+                }
+            }
+
             class PBFParser : public Parser {
 
                 std::string m_input_buffer{};
 
+                // Number of bytes read from the input so far
+                std::size_t m_offset = 0;
+
+                // Objects in the file are sorted by type (and ID)
+                bool m_sorted_by_type = false;
+
                 /**
                  * Read the given number of bytes from the input queue.
                  *
@@ -88,65 +158,66 @@ namespace osmium {
                     using std::swap;
                     swap(output, m_input_buffer);
 
+                    m_offset += size;
+
                     return output;
                 }
 
                 /**
-                 * Read 4 bytes in network byte order from file. They contain
-                 * the length of the following BlobHeader.
+                 * Get the given number of bytes from the memory mapped input.
+                 * No data is copied, the result points into the mapping.
+                 *
+                 * @param size Number of bytes to read
+                 * @returns View on the data
+                 * @throws osmium::pbf_error If size bytes can't be read
                  */
-                uint32_t read_blob_header_size_from_file() {
-                    uint32_t size;
-
-                    try {
-                        // size is encoded in network byte order
-                        const std::string input_data{read_from_input_queue(sizeof(size))};
-                        const char* d = input_data.data();
-                        size = (static_cast<uint32_t>(d[3])) |
-                               (static_cast<uint32_t>(d[2]) << 8u) |
-                               (static_cast<uint32_t>(d[1]) << 16u) |
-                               (static_cast<uint32_t>(d[0]) << 24u);
-                    } catch (const osmium::pbf_error&) {
-                        return 0; // EOF
+                protozero::data_view read_from_mapped_input(size_t size) {
+                    assert(mapped_input());
+                    if (mapped_input()->size() - m_offset < size) {
+                        throw osmium::pbf_error{"truncated data (EOF encountered)"};
                     }
 
-                    if (size > static_cast<uint32_t>(max_blob_header_size)) {
-                        throw osmium::pbf_error{"invalid BlobHeader size (> max_blob_header_size)"};
-                    }
+                    const protozero::data_view data{mapped_input()->data() + m_offset, size};
+                    m_offset += size;
+                    mapped_input()->set_offset(m_offset);
 
-                    return size;
+                    return data;
                 }
 
                 /**
-                 * Decode the BlobHeader. Make sure it contains the expected
-                 * type. Return the size of the following Blob.
+                 * Read the given number of bytes from the input. If the input
+                 * is memory mapped, the result points into the mapping,
+                 * otherwise the data is read from the input queue into the
+                 * storage string and the result points there.
+                 *
+                 * @param size Number of bytes to read
+                 * @param storage String used as storage for the data
+                 * @returns View on the data
+                 * @throws osmium::pbf_error If size bytes can't be read
                  */
-                size_t decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>&& pbf_blob_header, const char* expected_type) {
-                    protozero::data_view blob_header_type;
-                    size_t blob_header_datasize = 0;
-
-                    while (pbf_blob_header.next()) {
-                        switch (pbf_blob_header.tag_and_type()) {
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_string_type, protozero::pbf_wire_type::length_delimited):
-                                blob_header_type = pbf_blob_header.get_view();
-                                break;
-                            case protozero::tag_and_type(FileFormat::BlobHeader::required_int32_datasize, protozero::pbf_wire_type::varint):
-                                blob_header_datasize = pbf_blob_header.get_int32();
-                                break;
-                            default:
-                                pbf_blob_header.skip();
-                        }
+                protozero::data_view read_from_input(size_t size, std::string& storage) {
+                    if (mapped_input()) {
+                        return read_from_mapped_input(size);
                     }
+                    storage = read_from_input_queue(size);
+                    return protozero::data_view{storage.data(), storage.size()};
+                }
 
-                    if (blob_header_datasize == 0) {
-                        throw osmium::pbf_error{"PBF format error: BlobHeader.datasize missing or zero."};
-                    }
+                /**
+                 * Read 4 bytes in network byte order from file. They contain
+                 * the length of the following BlobHeader.
+                 */
+                uint32_t read_blob_header_size_from_file() {
+                    std::string storage;
+                    protozero::data_view input_data;
 
-                    if (std::strncmp(expected_type, blob_header_type.data(), blob_header_type.size()) != 0) {
-                        throw osmium::pbf_error{"blob does not have expected type (OSMHeader in first blob, OSMData in following blobs)"};
+                    try {
+                        input_data = read_from_input(sizeof(uint32_t), storage);
+                    } catch (const osmium::pbf_error&) {
+                        return 0; // EOF
                     }
 
-                    return blob_header_datasize;
+                    return decode_blob_header_size(input_data.data());
                 }
 
                 size_t check_type_and_get_blob_size(const char* expected_type) {
@@ -157,37 +228,252 @@ namespace osmium {
                         return 0;
                     }
 
-                    const std::string blob_header{read_from_input_queue(size)};
-
-                    return decode_blob_header(protozero::pbf_message<FileFormat::BlobHeader>(blob_header), expected_type);
-                }
+                    std::string storage;
+                    const auto blob_header = read_from_input(size, storage);
 
-                std::string read_from_input_queue_with_check(size_t size) {
-                    if (size > max_uncompressed_blob_size) {
-                        throw osmium::pbf_error{std::string{"invalid blob size: "} +
-                                                std::to_string(size)};
-                    }
-                    return read_from_input_queue(size);
+                    return decode_blob_header(blob_header, expected_type);
                 }
 
                 // Parse the header in the PBF OSMHeader blob.
                 void parse_header_blob() {
                     const auto size = check_type_and_get_blob_size("OSMHeader");
-                    osmium::io::Header header{decode_header(read_from_input_queue_with_check(size))};
+                    check_blob_size(size);
+                    std::string storage;
+                    osmium::io::Header header{decode_header(read_from_input(size, storage))};
+                    m_sorted_by_type = header.get("sorting") == "Type_then_ID";
                     set_header_value(header);
                 }
 
+                /**
+                 * Use the block index (if there is one) to find out whether
+                 * the data blob with the given number, which starts at the
+                 * given offset, can contain anything we are interested in.
+                 *
+                 * @throws osmium::pbf_error If the index doesn't fit the file
+                 */
+                bool data_blob_wanted(std::size_t blob_num, std::size_t offset) const {
+                    if (!block_index()) {
+                        return true;
+                    }
+
+                    if (blob_num >= block_index()->size() || (*block_index())[blob_num].offset != offset) {
+                        throw osmium::pbf_error{"block index does not match input file"};
+                    }
+
+                    return (*block_index())[blob_num].may_contain(read_types(), id_range());
+                }
+
+                void decode_data_blob(PBFDataBlobDecoder&& data_blob_parser) {
+                    if (osmium::config::use_pool_threads_for_pbf_parsing()) {
+                        submit_to_pool(std::move(data_blob_parser));
+                    } else {
+                        send_to_output_queue(data_blob_parser());
+                    }
+                }
+
+                /**
+                 * Is the type based skipping of blobs possible and useful?
+                 * It is if the file is sorted by type and we don't want all
+                 * types.
+                 */
+                bool skip_by_type() const noexcept {
+                    constexpr const auto all = osmium::osm_entity_bits::nwr | osmium::osm_entity_bits::changeset;
+                    return m_sorted_by_type && (read_types() & all) != all;
+                }
+
+                /**
+                 * In a file sorted by type a blob can only contain objects
+                 * of types between the type of its first PrimitiveGroup and
+                 * the type of the first PrimitiveGroup in the next blob.
+                 * Returns the bitmask of all those types. The types in
+                 * osm_entity_bits are ordered the same way as in the file.
+                 */
+                static osmium::osm_entity_bits::type types_between(osmium::osm_entity_bits::type first, osmium::osm_entity_bits::type last) noexcept {
+                    return static_cast<osmium::osm_entity_bits::type>((static_cast<unsigned int>(last) << 1u) - static_cast<unsigned int>(first));
+                }
+
+                /**
+                 * Finds out the type of the first PrimitiveGroup in a blob.
+                 * The decoder copy shares the input data with the original.
+                 */
+                class peek_type_task {
+
+                    PBFDataBlobDecoder m_blob;
+
+                public:
+
+                    explicit peek_type_task(const PBFDataBlobDecoder& blob) :
+                        m_blob(blob) {
+                    }
+
+                    osmium::osm_entity_bits::type operator()() const {
+                        return peek_first_group_type(m_blob.data());
+                    }
+
+                }; // class peek_type_task
+
+                /**
+                 * Blobs waiting for the result of peeking at their type.
+                 * The peeking tasks might still use the data in the memory
+                 * mapped input, so the destructor waits for all of them.
+                 */
+                class peeked_blobs {
+
+                    struct peeked_blob {
+                        std::unique_ptr<PBFDataBlobDecoder> blob;
+                        std::future<osmium::osm_entity_bits::type> type;
+                    };
+
+                    std::deque<peeked_blob> m_blobs;
+
+                public:
+
+                    peeked_blobs() = default;
+
+                    peeked_blobs(const peeked_blobs&) = delete;
+                    peeked_blobs& operator=(const peeked_blobs&) = delete;
+
+                    peeked_blobs(peeked_blobs&&) = delete;
+                    peeked_blobs& operator=(peeked_blobs&&) = delete;
+
+                    ~peeked_blobs() noexcept {
+                        for (auto& peeked : m_blobs) {
+                            if (peeked.type.valid()) {
+                                peeked.type.wait();
+                            }
+                        }
+                    }
+
+                    std::size_t size() const noexcept {
+                        return m_blobs.size();
+                    }
+
+                    bool empty() const noexcept {
+                        return m_blobs.empty();
+                    }
+
+                    void push(std::unique_ptr<PBFDataBlobDecoder>&& blob, osmium::thread::Pool& pool) {
+                        auto type = pool.submit(peek_type_task{*blob});
+                        m_blobs.push_back(peeked_blob{std::move(blob), std::move(type)});
+                    }
+
+                    osmium::osm_entity_bits::type front_type() {
+                        return m_blobs.front().type.get();
+                    }
+
+                    std::unique_ptr<PBFDataBlobDecoder> pop() {
+                        auto blob = std::move(m_blobs.front().blob);
+                        m_blobs.pop_front();
+                        return blob;
+                    }
+
+                }; // class peeked_blobs
+
                 void parse_data_blobs() {
-                    while (const auto size = check_type_and_get_blob_size("OSMData")) {
-                        std::string input_buffer{read_from_input_queue_with_check(size)};
+                    // In files sorted by type, blobs whose first type isn't
+                    // wanted are held back until the first type of the next
+                    // blob is known. If all types in between are unwanted,
+                    // the blob is dropped without decompressing it.
+                    std::unique_ptr<PBFDataBlobDecoder> pending_blob;
+                    auto pending_type = osmium::osm_entity_bits::nothing;
+
+                    // Types after the last wanted type are never needed.
+                    auto last_wanted_type = osmium::osm_entity_bits::changeset;
+                    while (last_wanted_type != osmium::osm_entity_bits::nothing && (read_types() & last_wanted_type) == 0) {
+                        last_wanted_type = static_cast<osmium::osm_entity_bits::type>(static_cast<unsigned int>(last_wanted_type) >> 1u);
+                    }
 
-                        PBFDataBlobDecoder data_blob_parser{std::move(input_buffer), read_types(), read_metadata()};
+                    // Decides what to do with a blob once its type is
+                    // known. Returns false if no more blobs are needed.
+                    const auto handle_blob = [&](std::unique_ptr<PBFDataBlobDecoder>&& blob, const osmium::osm_entity_bits::type type) {
+                        if (pending_blob) {
+                            if (type == osmium::osm_entity_bits::nothing || (types_between(pending_type, type) & read_types())) {
+                                decode_data_blob(std::move(*pending_blob));
+                            }
+                            pending_blob.reset();
+                        }
 
-                        if (osmium::config::use_pool_threads_for_pbf_parsing()) {
-                            send_to_output_queue(get_pool().submit(std::move(data_blob_parser)));
+                        if (type == osmium::osm_entity_bits::nothing || (type & read_types())) {
+                            decode_data_blob(std::move(*blob));
+                        } else if (type > last_wanted_type) {
+                            return false;
                         } else {
-                            send_to_output_queue(data_blob_parser());
+                            pending_blob = std::move(blob);
+                            pending_type = type;
+                        }
+                        return true;
+                    };
+
+                    // Peeking at the type decompresses the beginning of
+                    // the blob, so it is done in the pool when the blobs
+                    // are decoded there. Enough blobs are kept in flight
+                    // to keep the pool busy.
+                    const bool peek_in_pool = osmium::config::use_pool_threads_for_pbf_parsing();
+                    const auto max_peeking = 2 * static_cast<std::size_t>(get_pool().num_threads());
+                    peeked_blobs peeking;
+                    bool done = false;
+
+                    std::size_t blob_num = 0;
+                    while (!mapped_input() || !mapped_input()->done()) {
+                        const auto offset = m_offset;
+                        const auto size = check_type_and_get_blob_size("OSMData");
+                        if (size == 0) { // EOF
+                            break;
                         }
+                        check_blob_size(size);
+
+                        const bool wanted = data_blob_wanted(blob_num++, offset);
+
+                        // Data blobs in the memory mapped input are not
+                        // copied, the decoders get views into the mapping.
+                        std::unique_ptr<PBFDataBlobDecoder> blob;
+                        if (mapped_input()) {
+                            const auto input_data = read_from_mapped_input(size);
+                            if (wanted) {
+                                blob.reset(new PBFDataBlobDecoder{input_data, read_types(), read_metadata()});
+                            }
+                        } else {
+                            std::string input_buffer{read_from_input_queue(size)};
+                            if (wanted) {
+                                blob.reset(new PBFDataBlobDecoder{std::move(input_buffer), read_types(), read_metadata()});
+                            }
+                        }
+
+                        if (!blob) {
+                            continue;
+                        }
+
+                        if (!skip_by_type()) {
+                            decode_data_blob(std::move(*blob));
+                            continue;
+                        }
+
+                        if (!peek_in_pool) {
+                            const auto type = peek_first_group_type(blob->data());
+                            if (!handle_blob(std::move(blob), type)) {
+                                done = true;
+                                break;
+                            }
+                            continue;
+                        }
+
+                        peeking.push(std::move(blob), get_pool());
+                        if (peeking.size() > max_peeking) {
+                            const auto type = peeking.front_type();
+                            if (!handle_blob(peeking.pop(), type)) {
+                                done = true;
+                                break;
+                            }
+                        }
+                    }
+
+                    while (!done && !peeking.empty()) {
+                        const auto type = peeking.front_type();
+                        done = !handle_blob(peeking.pop(), type);
+                    }
+
+                    if (pending_blob) {
+                        decode_data_blob(std::move(*pending_blob));
                     }
                 }
 
@@ -232,6 +518,70 @@ namespace osmium {
 
         } // namespace detail
 
+        /**
+         * Create an index of the data blocks in the given PBF file. The
+         * file is memory mapped and the blocks are decompressed and
+         * scanned for object types and IDs in the thread pool.
+         *
+         * @param filename Name of the PBF file. Must be an uncompressed,
+         *                 non-empty file, not stdin.
+         * @returns The index.
+         * @throws osmium::pbf_error If the file is not a valid PBF file.
+         * @throws std::system_error If the file can't be opened or mapped.
+         */
+        inline PBFBlockIndex build_pbf_block_index(const std::string& filename) {
+            const auto input = detail::map_input_file(filename);
+            if (!input) {
+                throw osmium::pbf_error{"can not create block index for empty file or stdin"};
+            }
+
+            auto& pool = osmium::thread::Pool::default_instance();
+            std::vector<std::future<PBFBlockIndex::block_info>> results;
+
+            const char* expected_type = "OSMHeader";
+            std::size_t offset = 0;
+            while (offset < input->size()) {
+                const auto blob_offset = offset;
+                if (input->size() - offset < sizeof(uint32_t)) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+                const auto header_size = detail::decode_blob_header_size(input->data() + offset);
+                offset += sizeof(uint32_t);
+
+                if (input->size() - offset < header_size) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+                const auto size = detail::decode_blob_header(protozero::data_view{input->data() + offset, header_size}, expected_type);
+                offset += header_size;
+                detail::check_blob_size(size);
+
+                if (input->size() - offset < size) {
+                    throw osmium::pbf_error{"truncated data (EOF encountered)"};
+                }
+                const protozero::data_view blob{input->data() + offset, size};
+                offset += size;
+
+                if (blob_offset == 0) { // skip OSMHeader blob
+                    expected_type = "OSMData";
+                    continue;
+                }
+
+                results.push_back(pool.submit([blob, blob_offset]() {
+                    std::string output;
+                    auto info = detail::decode_block_info(detail::decode_blob(blob, output));
+                    info.offset = blob_offset;
+                    return info;
+                }));
+            }
+
+            PBFBlockIndex index;
+            for (auto& result : results) {
+                index.add(result.get());
+            }
+
+            return index;
+        }
+
     } // namespace io
 
 } // namespace osmium
@@ -71,16 +71,118 @@ DEALINGS IN THE SOFTWARE.
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#ifdef OSMIUM_WITH_ZSTD
+# include <osmium/io/detail/zstd.hpp>
+#endif
+
+#ifdef OSMIUM_WITH_LZ4
+# include <osmium/io/detail/lz4.hpp>
+#endif
+
 namespace osmium {
 
     namespace io {
 
         namespace detail {
 
+            /**
+             * Compression used for the PBF blobs. Blobs compressed with zstd
+             * or lz4 can only be written if Osmium is compiled with
+             * OSMIUM_WITH_ZSTD or OSMIUM_WITH_LZ4, respectively.
+             */
+            enum class pbf_compression {
+                none = 0,
+                zlib = 1,
+                zstd = 2,
+                lz4  = 3
+            };
+
+            /**
+             * Get the PBF compression from the value of the
+             * "pbf_compression" file option. For compatibility with older
+             * versions "true", "yes", and "on" also mean zlib compression
+             * and "false" and "no" mean no compression.
+             *
+             * @throws std::invalid_argument if the value is unknown or the
+             *         compression is not available.
+             */
+            inline pbf_compression get_pbf_compression(const std::string& value) {
+                if (value.empty() || value == "zlib" || value == "true" || value == "yes" || value == "on") {
+                    return pbf_compression::zlib;
+                }
+                if (value == "none" || value == "false" || value == "no") {
+                    return pbf_compression::none;
+                }
+                if (value == "zstd") {
+#ifdef OSMIUM_WITH_ZSTD
+                    return pbf_compression::zstd;
+#else
+                    throw std::invalid_argument{"PBF zstd compression not available (compile with OSMIUM_WITH_ZSTD)"};
+#endif
+                }
+                if (value == "lz4") {
+#ifdef OSMIUM_WITH_LZ4
+                    return pbf_compression::lz4;
+#else
+                    throw std::invalid_argument{"PBF lz4 compression not available (compile with OSMIUM_WITH_LZ4)"};
+#endif
+                }
+                throw std::invalid_argument{std::string{"Unknown value for pbf_compression option: '"} + value + "'"};
+            }
+
+            /**
+             * Get the compression level from the value of the
+             * "pbf_compression_level" file option. If the value is empty,
+             * the default level of the compression is used.
+             *
+             * @throws std::invalid_argument if the value is not a valid
+             *         level for the compression.
+             */
+            inline int get_pbf_compression_level(pbf_compression compression, const std::string& value) {
+                int min_level = 0;
+                int max_level = 0;
+                int default_level = 0;
+
+                switch (compression) {
+                    case pbf_compression::none:
+                        break;
+                    case pbf_compression::zlib:
+                        max_level = 9;
+                        default_level = Z_DEFAULT_COMPRESSION;
+                        break;
+                    case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                        min_level = 1;
+                        max_level = ZSTD_maxCLevel();
+                        default_level = ZSTD_CLEVEL_DEFAULT;
+#endif
+                        break;
+                    case pbf_compression::lz4:
+#ifdef OSMIUM_WITH_LZ4
+                        max_level = LZ4HC_CLEVEL_MAX;
+#endif
+                        break;
+                }
+
+                if (value.empty()) {
+                    return default_level;
+                }
+
+                char* end = nullptr;
+                const auto level = std::strtol(value.c_str(), &end, 10);
+                if (*end != '\0' || level < min_level || level > max_level) {
+                    throw std::invalid_argument{std::string{"Invalid value for pbf_compression_level option: '"} + value +
+                                                "' (must be between " + std::to_string(min_level) + " and " + std::to_string(max_level) + ")"};
+                }
+
+                return static_cast<int>(level);
+            }
+
             struct pbf_output_options {
 
                 /// Which metadata of objects should be added?
@@ -90,14 +192,18 @@ namespace osmium {
                 bool use_dense_nodes = true;
 
                 /**
-                 * Should the PBF blobs contain zlib compressed data?
+                 * How should the PBF blobs be compressed?
                  *
-                 * The zlib compression is optional, it's possible to store the
+                 * The compression is optional, it's possible to store the
                  * blobs in raw format. Disabling the compression can improve
                  * the writing speed a little but the output will be 2x to 3x
-                 * bigger.
+                 * bigger. Zstd and lz4 are much faster than zlib, especially
+                 * when reading, but not all PBF readers support them.
                  */
-                bool use_compression = true;
+                pbf_compression compression = pbf_compression::zlib;
+
+                /// Compression level, meaning depends on the compression.
+                int compression_level = Z_DEFAULT_COMPRESSION;
 
                 /// Add the "HistoricalInformation" header flag.
                 bool add_historical_information_flag = false;
@@ -148,7 +254,9 @@ namespace osmium {
 
                 pbf_blob_type m_blob_type;
 
-                bool m_use_compression;
+                pbf_compression m_compression;
+
+                int m_compression_level;
 
             public:
 
@@ -157,13 +265,14 @@ namespace osmium {
                  *
                  * @param msg Protobuf-message containing the blob data
                  * @param type Type of blob.
-                 * @param use_compression Should the output be compressed using
-                 *        zlib?
+                 * @param compression How should the output be compressed?
+                 * @param compression_level Compression level.
                  */
-                SerializeBlob(std::string&& msg, pbf_blob_type type, bool use_compression) :
+                SerializeBlob(std::string&& msg, pbf_blob_type type, pbf_compression compression, int compression_level) :
                     m_msg(std::move(msg)),
                     m_blob_type(type),
-                    m_use_compression(use_compression) {
+                    m_compression(compression),
+                    m_compression_level(compression_level) {
                 }
 
                 /**
@@ -177,11 +286,30 @@ namespace osmium {
                     std::string blob_data;
                     protozero::pbf_builder<FileFormat::Blob> pbf_blob{blob_data};
 
-                    if (m_use_compression) {
-                        pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
-                        pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, osmium::io::detail::zlib_compress(m_msg));
-                    } else {
-                        pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_raw, m_msg);
+                    switch (m_compression) {
+                        case pbf_compression::none:
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_raw, m_msg);
+                            break;
+                        case pbf_compression::zlib:
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zlib_data, osmium::io::detail::zlib_compress(m_msg, m_compression_level));
+                            break;
+                        case pbf_compression::zstd:
+#ifdef OSMIUM_WITH_ZSTD
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_zstd_data, osmium::io::detail::zstd_compress(m_msg, m_compression_level));
+                            break;
+#else
+                            throw std::invalid_argument{"PBF zstd compression not available"};
+#endif
+                        case pbf_compression::lz4:
+#ifdef OSMIUM_WITH_LZ4
+                            pbf_blob.add_int32(FileFormat::Blob::optional_int32_raw_size, int32_t(m_msg.size()));
+                            pbf_blob.add_bytes(FileFormat::Blob::optional_bytes_lz4_data, osmium::io::detail::lz4_compress(m_msg, m_compression_level));
+                            break;
+#else
+                            throw std::invalid_argument{"PBF lz4 compression not available"};
+#endif
                     }
 
                     std::string blob_header_data;
@@ -191,9 +319,10 @@ namespace osmium {
 
                     // The static_cast is okay, because the size can never
                     // be much larger than max_uncompressed_blob_size. This
-                    // is due to the assert above and the fact that the zlib
-                    // library will not grow deflated data beyond the original
-                    // data plus a few header bytes (https://zlib.net/zlib_tech.html).
+                    // is due to the assert above and the fact that the zlib,
+                    // zstd, and lz4 libraries will not grow compressed data
+                    // beyond the original data plus a few header bytes
+                    // (https://zlib.net/zlib_tech.html).
                     pbf_blob_header.add_int32(FileFormat::BlobHeader::required_int32_datasize, static_cast<int32_t>(blob_data.size()));
 
                     const auto size = static_cast<uint32_t>(blob_header_data.size());
@@ -478,7 +607,8 @@ namespace osmium {
                     m_output_queue.push(m_pool.submit(
                         SerializeBlob{std::move(primitive_block_data),
                                       pbf_blob_type::data,
-                                      m_options.use_compression}
+                                      m_options.compression,
+                                      m_options.compression_level}
                     ));
                 }
 
@@ -542,7 +672,8 @@ namespace osmium {
                     }
 
                     m_options.use_dense_nodes = file.is_not_false("pbf_dense_nodes");
-                    m_options.use_compression = file.get("pbf_compression") != "none" && file.is_not_false("pbf_compression");
+                    m_options.compression = get_pbf_compression(file.get("pbf_compression"));
+                    m_options.compression_level = get_pbf_compression_level(m_options.compression, file.get("pbf_compression_level"));
                     m_options.add_metadata = osmium::metadata_options{file.get("add_metadata")};
                     m_options.add_historical_information_flag = file.has_multiple_object_versions();
                     m_options.add_visible_flag = file.has_multiple_object_versions();
@@ -577,6 +708,10 @@ namespace osmium {
                         pbf_header_block.add_string(OSMFormat::HeaderBlock::repeated_string_optional_features, "LocationsOnWays");
                     }
 
+                    if (header.get("sorting") == "Type_then_ID") {
+                        pbf_header_block.add_string(OSMFormat::HeaderBlock::repeated_string_optional_features, "Sort.Type_then_ID");
+                    }
+
                     pbf_header_block.add_string(OSMFormat::HeaderBlock::optional_string_writingprogram, header.get("generator"));
 
                     const std::string osmosis_replication_timestamp{header.get("osmosis_replication_timestamp")};
@@ -598,7 +733,8 @@ namespace osmium {
                     m_output_queue.push(m_pool.submit(
                         SerializeBlob{std::move(data),
                                       pbf_blob_type::header,
-                                      m_options.use_compression}
+                                      m_options.compression,
+                                      m_options.compression_level}
                         ));
                 }
 
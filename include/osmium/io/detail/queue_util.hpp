@@ -34,7 +34,12 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/memory/buffer.hpp>
-#include <osmium/thread/queue.hpp>
+
+#ifdef OSMIUM_USE_LOCKFREE_QUEUES
+# include <osmium/thread/lockfree_queue.hpp>
+#else
+# include <osmium/thread/queue.hpp>
+#endif
 
 #include <cassert>
 #include <exception>
@@ -48,8 +53,20 @@ namespace osmium {
 
         namespace detail {
 
+            /**
+             * The queues between the threads of the Reader and Writer
+             * pipelines. Each of them has exactly one producer and one
+             * consumer thread, so if OSMIUM_USE_LOCKFREE_QUEUES is defined,
+             * the single-producer lock-free queue is used instead of the
+             * default mutex-based queue.
+             */
+#ifdef OSMIUM_USE_LOCKFREE_QUEUES
+            template <typename T>
+            using future_queue_type = osmium::thread::LockFreeQueue<std::future<T>>;
+#else
             template <typename T>
             using future_queue_type = osmium::thread::Queue<std::future<T>>;
+#endif
 
             /**
              * This type of queue contains buffers with OSM data in them.
@@ -33,6 +33,8 @@ DEALINGS IN THE SOFTWARE.
 
 */
 
+#include <osmium/osm/location.hpp>
+
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -203,9 +205,109 @@ namespace osmium {
                 out += hex_digits[ value         & 0xfu];
             }
 
+            // Lookup table for two decimal digits at a time. This halves
+            // the number of (slow) divisions when converting integers.
+            inline const char* decimal_digit_pairs() noexcept {
+                static const char digits[] =
+                    "00010203040506070809"
+                    "10111213141516171819"
+                    "20212223242526272829"
+                    "30313233343536373839"
+                    "40414243444546474849"
+                    "50515253545556575859"
+                    "60616263646566676869"
+                    "70717273747576777879"
+                    "80818283848586878889"
+                    "90919293949596979899";
+                return digits;
+            }
+
+            // Write the decimal representation of value into the buffer
+            // ending at end. Returns the start of the representation.
+            inline char* format_uint_backwards(char* end, uint64_t value) noexcept {
+                const char* pairs = decimal_digit_pairs();
+                while (value >= 100) {
+                    const auto i = static_cast<std::size_t>(value % 100) * 2;
+                    value /= 100;
+                    *--end = pairs[i + 1];
+                    *--end = pairs[i];
+                }
+                if (value >= 10) {
+                    const auto i = static_cast<std::size_t>(value) * 2;
+                    *--end = pairs[i + 1];
+                    *--end = pairs[i];
+                } else {
+                    *--end = static_cast<char>('0' + value);
+                }
+                return end;
+            }
+
+            // Append integer as decimal number to the string.
+            inline void append_int(std::string& out, int64_t value) {
+                char temp[20];
+                char* end = temp + sizeof(temp);
+                char* start;
+                if (value < 0) {
+                    start = format_uint_backwards(end, static_cast<uint64_t>(0) - static_cast<uint64_t>(value));
+                    *--start = '-';
+                } else {
+                    start = format_uint_backwards(end, static_cast<uint64_t>(value));
+                }
+                out.append(start, end);
+            }
+
+            // Append a location coordinate (as used internally in the
+            // Location class) as decimal number to the string.
+            inline void append_location_coordinate(std::string& out, int32_t value) {
+                char temp[16];
+                out.append(temp, osmium::detail::append_location_coordinate_to_string(temp, value));
+            }
+
+            // Append the given number of seconds since the epoch in ISO
+            // format ("yyyy-mm-ddThh:mm:ssZ") to the string. This gives the
+            // same result as Timestamp::to_iso_all(), but doesn't need
+            // gmtime() and doesn't allocate any memory. See
+            // https://howardhinnant.github.io/date_algorithms.html#civil_from_days
+            // for the algorithm used.
+            inline void append_iso_timestamp(std::string& out, uint32_t seconds_since_epoch) {
+                const char* pairs = decimal_digit_pairs();
+                const uint32_t seconds_of_day = seconds_since_epoch % 86400u;
+
+                const uint32_t z = seconds_since_epoch / 86400u + 719468u;
+                const uint32_t era = z / 146097u;
+                const uint32_t doe = z - era * 146097u;
+                const uint32_t yoe = (doe - doe / 1460u + doe / 36524u - doe / 146096u) / 365u;
+                const uint32_t doy = doe - (365u * yoe + yoe / 4u - yoe / 100u);
+                const uint32_t mp = (5u * doy + 2u) / 153u;
+                const uint32_t day = doy - (153u * mp + 2u) / 5u + 1u;
+                const uint32_t month = mp < 10u ? mp + 3u : mp - 9u;
+                const uint32_t year = yoe + era * 400u + (month <= 2u ? 1u : 0u);
+
+                char temp[20];
+                const auto put2 = [pairs](char* p, uint32_t v) noexcept {
+                    p[0] = pairs[v * 2];
+                    p[1] = pairs[v * 2 + 1];
+                };
+                put2(temp, year / 100u);
+                put2(temp + 2, year % 100u);
+                temp[4] = '-';
+                put2(temp + 5, month);
+                temp[7] = '-';
+                put2(temp + 8, day);
+                temp[10] = 'T';
+                put2(temp + 11, seconds_of_day / 3600u);
+                temp[13] = ':';
+                put2(temp + 14, seconds_of_day / 60u % 60u);
+                temp[16] = ':';
+                put2(temp + 17, seconds_of_day % 60u);
+                temp[19] = 'Z';
+                out.append(temp, sizeof(temp));
+            }
+
             inline void append_utf8_encoded_string(std::string& out, const char* data) {
                 static const char* lookup_hex = "0123456789abcdef";
                 const char* end = data + std::strlen(data);
+                const char* run = data;
 
                 while (data != end) {
                     const char* last = data;
@@ -224,22 +326,30 @@ namespace osmium {
                         (0x0041 <= c && c <= 0x007e) ||
                         (0x00a1 <= c && c <= 0x00ac) ||
                         (0x00ae <= c && c <= 0x05ff)) {
-                        out.append(last, data);
+                        continue;
+                    }
+                    out.append(run, last);
+                    run = data;
+                    out += '%';
+                    if (c <= 0xff) {
+                        append_2_hex_digits(out, c, lookup_hex);
                     } else {
-                        out += '%';
-                        if (c <= 0xff) {
-                            append_2_hex_digits(out, c, lookup_hex);
-                        } else {
-                            append_min_4_hex_digits(out, c, lookup_hex);
-                        }
-                        out += '%';
+                        append_min_4_hex_digits(out, c, lookup_hex);
                     }
+                    out += '%';
                 }
+                out.append(run, end);
             }
 
             inline void append_xml_encoded_string(std::string& out, const char* data) {
-                for (; *data != '\0'; ++data) {
+                while (true) {
+                    // Copy runs of characters that don't need encoding in
+                    // one go.
+                    const char* end = data + std::strcspn(data, "&\"'<>\n\r\t");
+                    out.append(data, end);
+                    data = end;
                     switch (*data) {
+                        case '\0': return;
                         case '&':  out += "&amp;";  break;
                         case '\"': out += "&quot;"; break;
                         case '\'': out += "&apos;"; break;
@@ -248,8 +358,8 @@ namespace osmium {
                         case '\n': out += "&#xA;";  break;
                         case '\r': out += "&#xD;";  break;
                         case '\t': out += "&#x9;";  break;
-                        default:   out += *data;    break;
                     }
+                    ++data;
                 }
             }
 
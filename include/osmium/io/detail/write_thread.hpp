@@ -34,6 +34,7 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/io/compression.hpp>
+#include <osmium/io/detail/output_string_pool.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/thread/util.hpp>
 
@@ -59,15 +60,18 @@ namespace osmium {
                 queue_wrapper<std::string> m_queue;
                 std::unique_ptr<osmium::io::Compressor> m_compressor;
                 std::promise<bool> m_promise;
+                std::shared_ptr<OutputStringPool> m_string_pool;
 
             public:
 
                 WriteThread(future_string_queue_type& input_queue,
                             std::unique_ptr<osmium::io::Compressor>&& compressor,
-                            std::promise<bool>&& promise) :
+                            std::promise<bool>&& promise,
+                            std::shared_ptr<OutputStringPool> string_pool = nullptr) :
                     m_queue(input_queue),
                     m_compressor(std::move(compressor)),
-                    m_promise(std::move(promise)) {
+                    m_promise(std::move(promise)),
+                    m_string_pool(std::move(string_pool)) {
                 }
 
                 WriteThread(const WriteThread&) = delete;
@@ -83,11 +87,14 @@ namespace osmium {
 
                     try {
                         while (true) {
-                            const std::string data{m_queue.pop()};
+                            std::string data{m_queue.pop()};
                             if (at_end_of_data(data)) {
                                 break;
                             }
                             m_compressor->write(data);
+                            if (m_string_pool) {
+                                m_string_pool->put(std::move(data));
+                            }
                         }
                         m_compressor->close();
                         m_promise.set_value(true);
@@ -95,6 +102,12 @@ namespace osmium {
                         m_promise.set_exception(std::current_exception());
                         m_queue.drain();
                     }
+
+                    // Don't keep the memory of the output strings alive
+                    // after the Writer is done.
+                    if (m_string_pool) {
+                        m_string_pool->clear();
+                    }
                 }
 
             }; // class WriteThread
@@ -37,6 +37,7 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/builder/osm_object_builder.hpp>
 #include <osmium/io/detail/input_format.hpp>
 #include <osmium/io/detail/queue_util.hpp>
+#include <osmium/io/detail/string_util.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
@@ -54,17 +55,24 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/osm/types.hpp>
 #include <osmium/osm/types_from_string.hpp>
 #include <osmium/osm/way.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/thread/util.hpp>
+#include <osmium/util/config.hpp>
 
 #include <expat.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <future>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace osmium {
 
@@ -80,17 +88,23 @@ namespace osmium {
         XML_Error error_code;
         std::string error_string;
 
-        explicit xml_error(const XML_Parser& parser) :
+        xml_error(uint64_t error_line, uint64_t error_column, XML_Error code) :
             io_error(std::string{"XML parsing error at line "}
-                    + std::to_string(XML_GetCurrentLineNumber(parser))
+                    + std::to_string(error_line)
                     + ", column "
-                    + std::to_string(XML_GetCurrentColumnNumber(parser))
+                    + std::to_string(error_column)
                     + ": "
-                    + XML_ErrorString(XML_GetErrorCode(parser))),
-            line(XML_GetCurrentLineNumber(parser)),
-            column(XML_GetCurrentColumnNumber(parser)),
-            error_code(XML_GetErrorCode(parser)),
-            error_string(XML_ErrorString(error_code)) {
+                    + XML_ErrorString(code)),
+            line(error_line),
+            column(error_column),
+            error_code(code),
+            error_string(XML_ErrorString(code)) {
+        }
+
+        explicit xml_error(const XML_Parser& parser) :
+            xml_error(XML_GetCurrentLineNumber(parser),
+                      XML_GetCurrentColumnNumber(parser),
+                      XML_GetErrorCode(parser)) {
         }
 
         explicit xml_error(const std::string& message) :
@@ -124,12 +138,19 @@ namespace osmium {
 
         namespace detail {
 
-            class XMLParser : public Parser {
+            /**
+             * Builds OSM objects in a buffer from the start and end element
+             * and character data events of an XML parser. This is used with
+             * the expat parser and with the simpler XMLSubsetParser.
+             */
+            class XMLElementParser {
 
                 enum {
                     initial_buffer_size = 1024ul * 1024ul
                 };
 
+            protected:
+
                 enum class context {
                     osm,
                     osmChange,
@@ -170,6 +191,12 @@ namespace osmium {
 
                 std::string m_comment_text;
 
+                osmium::osm_entity_bits::type m_read_types;
+
+                bool m_encoding_is_utf8 = true;
+
+            public:
+
                 /**
                  * A C++ wrapper for the Expat parser that makes sure no memory
                  * is leaked.
@@ -179,15 +206,19 @@ namespace osmium {
                     XML_Parser m_parser;
 
                     static void XMLCALL start_element_wrapper(void* data, const XML_Char* element, const XML_Char** attrs) {
-                        static_cast<XMLParser*>(data)->start_element(element, attrs);
+                        static_cast<XMLElementParser*>(data)->start_element(element, attrs);
                     }
 
                     static void XMLCALL end_element_wrapper(void* data, const XML_Char* element) {
-                        static_cast<XMLParser*>(data)->end_element(element);
+                        static_cast<XMLElementParser*>(data)->end_element(element);
                     }
 
                     static void XMLCALL character_data_wrapper(void* data, const XML_Char* text, int len) {
-                        static_cast<XMLParser*>(data)->characters(text, len);
+                        static_cast<XMLElementParser*>(data)->characters(text, len);
+                    }
+
+                    static void XMLCALL xml_declaration_wrapper(void* data, const XML_Char* /*version*/, const XML_Char* encoding, int /*standalone*/) {
+                        static_cast<XMLElementParser*>(data)->xml_declaration(encoding);
                     }
 
                     // This handler is called when there are any XML entities
@@ -209,7 +240,7 @@ namespace osmium {
 
                 public:
 
-                    explicit ExpatXMLParser(void* callback_object) :
+                    explicit ExpatXMLParser(XMLElementParser* callback_object) :
                         m_parser(XML_ParserCreate(nullptr)) {
                         if (!m_parser) {
                             throw osmium::io_error{"Internal error: Can not create parser"};
@@ -217,6 +248,7 @@ namespace osmium {
                         XML_SetUserData(m_parser, callback_object);
                         XML_SetElementHandler(m_parser, start_element_wrapper, end_element_wrapper);
                         XML_SetCharacterDataHandler(m_parser, character_data_wrapper);
+                        XML_SetXmlDeclHandler(m_parser, xml_declaration_wrapper);
                         XML_SetEntityDeclHandler(m_parser, entity_declaration_handler);
                     }
 
@@ -230,15 +262,21 @@ namespace osmium {
                         XML_ParserFree(m_parser);
                     }
 
-                    void operator()(const std::string& data, bool last) {
-                        assert(data.size() < std::numeric_limits<int>::max());
-                        if (XML_Parse(m_parser, data.data(), static_cast<int>(data.size()), last) == XML_STATUS_ERROR) {
+                    void operator()(const char* data, std::size_t size, bool last) {
+                        assert(size < std::numeric_limits<int>::max());
+                        if (XML_Parse(m_parser, data, static_cast<int>(size), last) == XML_STATUS_ERROR) {
                             throw osmium::xml_error{m_parser};
                         }
                     }
 
+                    void operator()(const std::string& data, bool last) {
+                        operator()(data.data(), data.size(), last);
+                    }
+
                 }; // class ExpatXMLParser
 
+            protected:
+
                 template <typename T>
                 static void check_attributes(const XML_Char** attrs, T&& check) {
                     while (*attrs) {
@@ -315,8 +353,16 @@ namespace osmium {
                     m_tl_builder->add_tag(k, v);
                 }
 
-                void mark_header_as_done() {
-                    set_header_value(m_header);
+                // Called when the header is complete.
+                virtual void mark_header_as_done() {
+                }
+
+                // Called after each object has been committed to the buffer.
+                virtual void flush_buffer() {
+                }
+
+                void xml_declaration(const XML_Char* encoding) {
+                    m_encoding_is_utf8 = !encoding || !strcasecmp(encoding, "UTF-8");
                 }
 
                 void top_level_element(const XML_Char* element, const XML_Char** attrs) {
@@ -361,7 +407,7 @@ namespace osmium {
                     if (!std::strcmp(element, "node")) {
                         m_context_stack.push_back(context::node);
                         mark_header_as_done();
-                        if (read_types() & osmium::osm_entity_bits::node) {
+                        if (m_read_types & osmium::osm_entity_bits::node) {
                             m_node_builder.reset(new osmium::builder::NodeBuilder{m_buffer});
                             m_node_builder->set_user(init_object(m_node_builder->object(), attrs));
                         }
@@ -371,7 +417,7 @@ namespace osmium {
                     if (!std::strcmp(element, "way")) {
                         m_context_stack.push_back(context::way);
                         mark_header_as_done();
-                        if (read_types() & osmium::osm_entity_bits::way) {
+                        if (m_read_types & osmium::osm_entity_bits::way) {
                             m_way_builder.reset(new osmium::builder::WayBuilder{m_buffer});
                             m_way_builder->set_user(init_object(m_way_builder->object(), attrs));
                         }
@@ -381,7 +427,7 @@ namespace osmium {
                     if (!std::strcmp(element, "relation")) {
                         m_context_stack.push_back(context::relation);
                         mark_header_as_done();
-                        if (read_types() & osmium::osm_entity_bits::relation) {
+                        if (m_read_types & osmium::osm_entity_bits::relation) {
                             m_relation_builder.reset(new osmium::builder::RelationBuilder{m_buffer});
                             m_relation_builder->set_user(init_object(m_relation_builder->object(), attrs));
                         }
@@ -395,7 +441,7 @@ namespace osmium {
                     if (!std::strcmp(element, "changeset")) {
                         m_context_stack.push_back(context::changeset);
                         mark_header_as_done();
-                        if (read_types() & osmium::osm_entity_bits::changeset) {
+                        if (m_read_types & osmium::osm_entity_bits::changeset) {
                             m_changeset_builder.reset(new osmium::builder::ChangesetBuilder{m_buffer});
                             init_changeset(*m_changeset_builder, attrs);
                         }
@@ -440,6 +486,28 @@ namespace osmium {
                     }
                 }
 
+            public:
+
+                explicit XMLElementParser(osmium::osm_entity_bits::type read_types) :
+                    m_read_types(read_types) {
+                }
+
+                XMLElementParser(const XMLElementParser&) = delete;
+                XMLElementParser& operator=(const XMLElementParser&) = delete;
+
+                XMLElementParser(XMLElementParser&&) = delete;
+                XMLElementParser& operator=(XMLElementParser&&) = delete;
+
+                virtual ~XMLElementParser() noexcept = default;
+
+                /**
+                 * Move the buffer with the parsed objects out of this parser.
+                 * Only call this after parsing was successful.
+                 */
+                osmium::memory::Buffer release_buffer() {
+                    return std::move(m_buffer);
+                }
+
                 void start_element(const XML_Char* element, const XML_Char** attrs) {
                     if (m_context_stack.empty()) {
                         top_level_element(element, attrs);
@@ -462,7 +530,7 @@ namespace osmium {
                         case context::node:
                             if (!std::strcmp(element, "tag")) {
                                 m_context_stack.push_back(context::tag);
-                                if (read_types() & osmium::osm_entity_bits::node) {
+                                if (m_read_types & osmium::osm_entity_bits::node) {
                                     get_tag(*m_node_builder, attrs);
                                 }
                             } else {
@@ -472,7 +540,7 @@ namespace osmium {
                         case context::way:
                             if (!std::strcmp(element, "nd")) {
                                 m_context_stack.push_back(context::nd);
-                                if (read_types() & osmium::osm_entity_bits::way) {
+                                if (m_read_types & osmium::osm_entity_bits::way) {
                                     m_tl_builder.reset();
 
                                     if (!m_wnl_builder) {
@@ -493,7 +561,7 @@ namespace osmium {
                                 }
                             } else if (!std::strcmp(element, "tag")) {
                                 m_context_stack.push_back(context::tag);
-                                if (read_types() & osmium::osm_entity_bits::way) {
+                                if (m_read_types & osmium::osm_entity_bits::way) {
                                     m_wnl_builder.reset();
                                     get_tag(*m_way_builder, attrs);
                                 }
@@ -506,7 +574,7 @@ namespace osmium {
                         case context::relation:
                             if (!std::strcmp(element, "member")) {
                                 m_context_stack.push_back(context::member);
-                                if (read_types() & osmium::osm_entity_bits::relation) {
+                                if (m_read_types & osmium::osm_entity_bits::relation) {
                                     m_tl_builder.reset();
 
                                     if (!m_rml_builder) {
@@ -537,7 +605,7 @@ namespace osmium {
                                 }
                             } else if (!std::strcmp(element, "tag")) {
                                 m_context_stack.push_back(context::tag);
-                                if (read_types() & osmium::osm_entity_bits::relation) {
+                                if (m_read_types & osmium::osm_entity_bits::relation) {
                                     m_rml_builder.reset();
                                     get_tag(*m_relation_builder, attrs);
                                 }
@@ -556,7 +624,7 @@ namespace osmium {
                         case context::changeset:
                             if (!std::strcmp(element, "discussion")) {
                                 m_context_stack.push_back(context::discussion);
-                                if (read_types() & osmium::osm_entity_bits::changeset) {
+                                if (m_read_types & osmium::osm_entity_bits::changeset) {
                                     m_tl_builder.reset();
                                     if (!m_changeset_discussion_builder) {
                                         m_changeset_discussion_builder.reset(new osmium::builder::ChangesetDiscussionBuilder{*m_changeset_builder});
@@ -564,7 +632,7 @@ namespace osmium {
                                 }
                             } else if (!std::strcmp(element, "tag")) {
                                 m_context_stack.push_back(context::tag);
-                                if (read_types() & osmium::osm_entity_bits::changeset) {
+                                if (m_read_types & osmium::osm_entity_bits::changeset) {
                                     m_changeset_discussion_builder.reset();
                                     get_tag(*m_changeset_builder, attrs);
                                 }
@@ -575,7 +643,7 @@ namespace osmium {
                         case context::discussion:
                             if (!std::strcmp(element, "comment")) {
                                 m_context_stack.push_back(context::comment);
-                                if (read_types() & osmium::osm_entity_bits::changeset) {
+                                if (m_read_types & osmium::osm_entity_bits::changeset) {
                                     osmium::Timestamp date;
                                     osmium::user_id_type uid = 0;
                                     const char* user = "";
@@ -638,7 +706,7 @@ namespace osmium {
                             break;
                         case context::node:
                             assert(!std::strcmp(element, "node"));
-                            if (read_types() & osmium::osm_entity_bits::node) {
+                            if (m_read_types & osmium::osm_entity_bits::node) {
                                 m_tl_builder.reset();
                                 m_node_builder.reset();
                                 m_buffer.commit();
@@ -647,7 +715,7 @@ namespace osmium {
                             break;
                         case context::way:
                             assert(!std::strcmp(element, "way"));
-                            if (read_types() & osmium::osm_entity_bits::way) {
+                            if (m_read_types & osmium::osm_entity_bits::way) {
                                 m_tl_builder.reset();
                                 m_wnl_builder.reset();
                                 m_way_builder.reset();
@@ -657,7 +725,7 @@ namespace osmium {
                             break;
                         case context::relation:
                             assert(!std::strcmp(element, "relation"));
-                            if (read_types() & osmium::osm_entity_bits::relation) {
+                            if (m_read_types & osmium::osm_entity_bits::relation) {
                                 m_tl_builder.reset();
                                 m_rml_builder.reset();
                                 m_relation_builder.reset();
@@ -673,7 +741,7 @@ namespace osmium {
                             break;
                         case context::changeset:
                             assert(!std::strcmp(element, "changeset"));
-                            if (read_types() & osmium::osm_entity_bits::changeset) {
+                            if (m_read_types & osmium::osm_entity_bits::changeset) {
                                 m_tl_builder.reset();
                                 m_changeset_discussion_builder.reset();
                                 m_changeset_builder.reset();
@@ -689,7 +757,7 @@ namespace osmium {
                             break;
                         case context::text:
                             assert(!std::strcmp(element, "text"));
-                            if (read_types() & osmium::osm_entity_bits::changeset) {
+                            if (m_read_types & osmium::osm_entity_bits::changeset) {
                                 m_changeset_discussion_builder->add_comment_text(m_comment_text);
                                 m_comment_text.clear();
                             }
@@ -707,24 +775,679 @@ namespace osmium {
                 }
 
                 void characters(const XML_Char* text, int len) {
-                    if ((read_types() & osmium::osm_entity_bits::changeset) &&
+                    if ((m_read_types & osmium::osm_entity_bits::changeset) &&
                         !m_context_stack.empty() &&
                         m_context_stack.back() == context::text) {
                         m_comment_text.append(text, len);
                     }
                 }
 
-                void flush_buffer() {
+            }; // class XMLElementParser
+
+            /**
+             * Check that the data contains only characters allowed in XML
+             * documents encoded as valid UTF-8.
+             */
+            inline bool xml_is_valid_utf8(const char* data, const char* end) noexcept {
+                while (data != end) {
+                    // fast path for runs of printable ASCII characters
+                    if (end - data >= 8) {
+                        uint64_t word;
+                        std::memcpy(&word, data, 8);
+                        if (((word | (word - 0x2020202020202020ull)) & 0x8080808080808080ull) == 0) {
+                            data += 8;
+                            continue;
+                        }
+                    }
+
+                    const auto c = static_cast<unsigned char>(*data++);
+                    if (c < 0x80) {
+                        if (c < 0x20 && c != '\t' && c != '\n' && c != '\r') {
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    int length;
+                    unsigned char min = 0x80;
+                    unsigned char max = 0xbf;
+                    if (c < 0xc2) {
+                        return false;
+                    }
+                    if (c < 0xe0) {
+                        length = 1;
+                    } else if (c < 0xf0) {
+                        length = 2;
+                        if (c == 0xe0) {
+                            min = 0xa0; // overlong encoding
+                        } else if (c == 0xed) {
+                            max = 0x9f; // surrogates
+                        }
+                    } else if (c < 0xf5) {
+                        length = 3;
+                        if (c == 0xf0) {
+                            min = 0x90; // overlong encoding
+                        } else if (c == 0xf4) {
+                            max = 0x8f; // larger than U+10FFFF
+                        }
+                    } else {
+                        return false;
+                    }
+
+                    if (end - data < length) {
+                        return false;
+                    }
+                    const auto c1 = static_cast<unsigned char>(data[0]);
+                    if (c1 < min || c1 > max) {
+                        return false;
+                    }
+                    for (int i = 1; i < length; ++i) {
+                        if ((static_cast<unsigned char>(data[i]) & 0xc0u) != 0x80u) {
+                            return false;
+                        }
+                    }
+                    // U+FFFE and U+FFFF are not allowed in XML
+                    if (c == 0xef && c1 == 0xbf && static_cast<unsigned char>(data[1]) >= 0xbe) {
+                        return false;
+                    }
+                    data += length;
+                }
+
+                return true;
+            }
+
+            enum class xml_tag {
+                none,
+                object,
+                root_end,
+                declaration
+            }; // enum class xml_tag
+
+            /**
+             * Find the next tag in an OSM XML file that is of interest when
+             * splitting the file into chunks: The start tag of a top-level
+             * object (node, way, relation, or changeset), the end tag of the
+             * osm element, or a declaration like DOCTYPE. Comments, CDATA
+             * sections and processing instructions are skipped.
+             *
+             * The search starts at pos. Pos is set to the beginning of the
+             * tag found. If no tag is found, xml_tag::none is returned and pos
+             * is set to the place where the search has to be resumed after
+             * more data was added. Set at_end if no more data will follow.
+             *
+             * This only looks at the names of the tags, so it will only work
+             * on well-formed OSM XML files.
+             */
+            inline xml_tag xml_find_tag(const std::string& data, std::string::size_type& pos, bool at_end) {
+                // longest lookahead needed: "<changeset" plus one character
+                constexpr const std::size_t lookahead = 11;
+
+                const auto match = [&](const char* s, std::size_t available, const char* name) {
+                    const auto len = std::strlen(name);
+                    if (available < len || std::strncmp(s, name, len) != 0) {
+                        return false;
+                    }
+                    if (available == len) {
+                        return true;
+                    }
+                    const char c = s[len];
+                    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '/' || c == '>';
+                };
+
+                while (true) {
+                    const auto lt = data.find('<', pos);
+                    if (lt == std::string::npos) {
+                        pos = data.size();
+                        return xml_tag::none;
+                    }
+                    pos = lt;
+
+                    const auto available = data.size() - lt - 1;
+                    if (available < lookahead && !at_end) {
+                        return xml_tag::none;
+                    }
+
+                    const char* s = data.data() + lt + 1;
+                    switch (s[0]) {
+                        case '!':
+                            if (available >= 3 && s[1] == '-' && s[2] == '-') {
+                                const auto end = data.find("-->", lt + 4);
+                                if (end == std::string::npos) {
+                                    return xml_tag::none;
+                                }
+                                pos = end + 3;
+                            } else if (available >= 8 && !std::strncmp(s, "![CDATA[", 8)) {
+                                const auto end = data.find("]]>", lt + 9);
+                                if (end == std::string::npos) {
+                                    return xml_tag::none;
+                                }
+                                pos = end + 3;
+                            } else {
+                                return xml_tag::declaration;
+                            }
+                            break;
+                        case '?': {
+                                const auto end = data.find("?>", lt + 2);
+                                if (end == std::string::npos) {
+                                    return xml_tag::none;
+                                }
+                                pos = end + 2;
+                            }
+                            break;
+                        case '/':
+                            if (match(s + 1, available - 1, "osm")) {
+                                return xml_tag::root_end;
+                            }
+                            pos = lt + 1;
+                            break;
+                        default:
+                            if (match(s, available, "node") ||
+                                match(s, available, "way") ||
+                                match(s, available, "relation") ||
+                                match(s, available, "changeset")) {
+                                return xml_tag::object;
+                            }
+                            pos = lt + 1;
+                    }
+                }
+            }
+
+            /**
+             * A simple non-validating tokenizer for the subset of XML used
+             * in OSM XML files. It parses a chunk of data consisting of
+             * complete top-level objects and feeds the elements found into
+             * the XMLElementParser.
+             *
+             * Anything outside this subset, like comments, CDATA sections,
+             * processing instructions, character data, unknown entities,
+             * or anything not well-formed, makes the parse() function return
+             * false. The chunk must then be parsed with expat instead.
+             */
+            class XMLSubsetParser : public XMLElementParser {
+
+                // element names and decoded attribute names and values,
+                // each followed by a null character
+                std::string m_scratch;
+
+                std::vector<std::size_t> m_offsets;
+
+                std::vector<const XML_Char*> m_attrs;
+
+                std::vector<std::pair<const char*, std::size_t>> m_open_elements;
+
+                static bool is_space(char c) noexcept {
+                    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+                }
+
+                static bool is_name_start_char(char c) noexcept {
+                    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+                }
+
+                static bool is_name_char(char c) noexcept {
+                    return is_name_start_char(c) || (c >= '0' && c <= '9') || c == '-' || c == '.';
+                }
+
+                static const char* skip_space(const char* s, const char* end) noexcept {
+                    while (s != end && is_space(*s)) {
+                        ++s;
+                    }
+                    return s;
+                }
+
+                // Returns the end of the name starting at s or s itself if
+                // there is no name (or a name we do not understand).
+                static const char* parse_name(const char* s, const char* end) noexcept {
+                    if (s == end || !is_name_start_char(*s)) {
+                        return s;
+                    }
+                    const char* name_end = s + 1;
+                    while (name_end != end && is_name_char(*name_end)) {
+                        ++name_end;
+                    }
+                    if (name_end != end && static_cast<unsigned char>(*name_end) >= 0x80) {
+                        return s;
+                    }
+                    return name_end;
+                }
+
+                // Decode an entity or character reference starting after
+                // the '&' and append it to the scratch string.
+                bool parse_reference(const char** s, const char* end) {
+                    const char* semicolon = static_cast<const char*>(std::memchr(*s, ';', std::min<std::ptrdiff_t>(end - *s, 12)));
+                    if (!semicolon) {
+                        return false;
+                    }
+                    const std::string::size_type len = semicolon - *s;
+                    const char* ref = *s;
+                    *s = semicolon + 1;
+
+                    if (len == 3 && !std::strncmp(ref, "amp", 3)) {
+                        m_scratch += '&';
+                    } else if (len == 2 && !std::strncmp(ref, "lt", 2)) {
+                        m_scratch += '<';
+                    } else if (len == 2 && !std::strncmp(ref, "gt", 2)) {
+                        m_scratch += '>';
+                    } else if (len == 4 && !std::strncmp(ref, "quot", 4)) {
+                        m_scratch += '"';
+                    } else if (len == 4 && !std::strncmp(ref, "apos", 4)) {
+                        m_scratch += '\'';
+                    } else if (len >= 2 && ref[0] == '#') {
+                        uint32_t value = 0;
+                        if (ref[1] == 'x') {
+                            if (len < 3 || len > 8) {
+                                return false;
+                            }
+                            for (const char* p = ref + 2; p != semicolon; ++p) {
+                                value <<= 4u;
+                                if (*p >= '0' && *p <= '9') {
+                                    value += *p - '0';
+                                } else if (*p >= 'a' && *p <= 'f') {
+                                    value += *p - 'a' + 10;
+                                } else if (*p >= 'A' && *p <= 'F') {
+                                    value += *p - 'A' + 10;
+                                } else {
+                                    return false;
+                                }
+                            }
+                        } else {
+                            if (len > 8) {
+                                return false;
+                            }
+                            for (const char* p = ref + 1; p != semicolon; ++p) {
+                                if (*p < '0' || *p > '9') {
+                                    return false;
+                                }
+                                value = value * 10 + (*p - '0');
+                            }
+                        }
+                        // only characters allowed in XML
+                        if (!(value == 0x9 || value == 0xa || value == 0xd ||
+                              (value >= 0x20 && value <= 0xd7ff) ||
+                              (value >= 0xe000 && value <= 0xfffd) ||
+                              (value >= 0x10000 && value <= 0x10ffff))) {
+                            return false;
+                        }
+                        append_codepoint_as_utf8(value, std::back_inserter(m_scratch));
+                    } else {
+                        return false;
+                    }
+
+                    return true;
+                }
+
+                // Parse a quoted attribute value starting at the quote
+                // character and append the decoded value to the scratch
+                // string.
+                bool parse_attribute_value(const char** s, const char* end) {
+                    if (*s == end || (**s != '"' && **s != '\'')) {
+                        return false;
+                    }
+                    const char quote = **s;
+                    const char* p = *s + 1;
+                    while (true) {
+                        const char* run = p;
+                        while (p != end && *p != quote && *p != '&' && *p != '<' &&
+                               *p != '\t' && *p != '\n' && *p != '\r') {
+                            ++p;
+                        }
+                        m_scratch.append(run, p);
+                        if (p == end) {
+                            return false;
+                        }
+                        if (*p == quote) {
+                            *s = p + 1;
+                            return true;
+                        }
+                        if (*p != '&') {
+                            // '<' is not allowed here, whitespace characters
+                            // would have to be normalized
+                            return false;
+                        }
+                        ++p;
+                        if (!parse_reference(&p, end)) {
+                            return false;
+                        }
+                    }
+                }
+
+                // Parse a start tag from after the '<'.
+                bool parse_start_tag(const char** s, const char* end) {
+                    const char* name = *s;
+                    const char* p = parse_name(name, end);
+                    if (p == name) {
+                        return false;
+                    }
+
+                    const auto name_len = static_cast<std::size_t>(p - name);
+                    m_scratch.assign(name, name_len);
+                    m_scratch += '\0';
+                    m_offsets.clear();
+
+                    bool self_closing = false;
+                    while (true) {
+                        const char* after_space = skip_space(p, end);
+                        if (after_space == end) {
+                            return false;
+                        }
+                        if (*after_space == '>') {
+                            p = after_space + 1;
+                            break;
+                        }
+                        if (*after_space == '/') {
+                            if (after_space + 1 == end || after_space[1] != '>') {
+                                return false;
+                            }
+                            p = after_space + 2;
+                            self_closing = true;
+                            break;
+                        }
+                        if (after_space == p) { // attributes must be separated by whitespace
+                            return false;
+                        }
+
+                        const char* attr_name_end = parse_name(after_space, end);
+                        if (attr_name_end == after_space) {
+                            return false;
+                        }
+                        const auto attr_name_len = static_cast<std::size_t>(attr_name_end - after_space);
+                        for (std::size_t i = 0; i < m_offsets.size(); i += 2) {
+                            const char* other = &m_scratch[m_offsets[i]];
+                            if (!std::strncmp(other, after_space, attr_name_len) && other[attr_name_len] == '\0') {
+                                return false; // duplicate attribute
+                            }
+                        }
+                        m_offsets.push_back(m_scratch.size());
+                        m_scratch.append(after_space, attr_name_end);
+                        m_scratch += '\0';
+
+                        p = skip_space(attr_name_end, end);
+                        if (p == end || *p != '=') {
+                            return false;
+                        }
+                        p = skip_space(p + 1, end);
+                        m_offsets.push_back(m_scratch.size());
+                        if (!parse_attribute_value(&p, end)) {
+                            return false;
+                        }
+                        m_scratch += '\0';
+                    }
+
+                    m_attrs.clear();
+                    for (const auto offset : m_offsets) {
+                        m_attrs.push_back(&m_scratch[offset]);
+                    }
+                    m_attrs.push_back(nullptr);
+
+                    start_element(m_scratch.data(), m_attrs.data());
+                    if (self_closing) {
+                        end_element(m_scratch.data());
+                    } else {
+                        m_open_elements.emplace_back(name, name_len);
+                    }
+
+                    *s = p;
+                    return true;
+                }
+
+                // Parse an end tag from after the "</".
+                bool parse_end_tag(const char** s, const char* end) {
+                    const char* name = *s;
+                    const char* p = parse_name(name, end);
+                    if (p == name || m_open_elements.empty()) {
+                        return false;
+                    }
+                    const auto len = static_cast<std::size_t>(p - name);
+                    const auto& open = m_open_elements.back();
+                    if (len != open.second || std::strncmp(name, open.first, len) != 0) {
+                        return false;
+                    }
+                    p = skip_space(p, end);
+                    if (p == end || *p != '>') {
+                        return false;
+                    }
+
+                    m_scratch.assign(name, len);
+                    end_element(m_scratch.c_str());
+                    m_open_elements.pop_back();
+
+                    *s = p + 1;
+                    return true;
+                }
+
+            public:
+
+                explicit XMLSubsetParser(osmium::osm_entity_bits::type read_types) :
+                    XMLElementParser(read_types) {
+                    m_context_stack.push_back(context::osm);
+                }
+
+                /**
+                 * Parse the data. Returns false if the data contains
+                 * anything this parser can not handle.
+                 */
+                bool parse(const std::string& data) {
+                    const char* s = data.data();
+                    const char* const end = s + data.size();
+
+                    if (!xml_is_valid_utf8(s, end)) {
+                        return false;
+                    }
+
+                    while (true) {
+                        const char* text = s;
+                        s = skip_space(s, end);
+                        if (s != text && m_context_stack.back() == context::text) {
+                            return false;
+                        }
+                        if (s == end) {
+                            break;
+                        }
+                        if (*s != '<' || ++s == end) {
+                            return false;
+                        }
+                        if (*s == '/') {
+                            ++s;
+                            if (!parse_end_tag(&s, end)) {
+                                return false;
+                            }
+                        } else if (!parse_start_tag(&s, end)) {
+                            return false;
+                        }
+                    }
+
+                    return m_open_elements.empty();
+                }
+
+            }; // class XMLSubsetParser
+
+            /**
+             * Parses a chunk of OSM XML data consisting of complete top-level
+             * objects into a buffer. Instances of this class are run in the
+             * thread pool.
+             *
+             * The chunk is parsed with the XMLSubsetParser. If it contains
+             * anything that parser can not handle, it is parsed again with
+             * expat. First_line and first_column give the position of the
+             * chunk in the input, they are used to correct the position in
+             * error messages from expat.
+             */
+            class XMLChunkParser {
+
+                std::string m_data;
+                uint64_t m_first_line;
+                uint64_t m_first_column;
+                osmium::osm_entity_bits::type m_read_types;
+
+                osmium::memory::Buffer parse_with_expat() const {
+                    static const char root[] = "<osm version=\"0.6\">";
+
+                    XMLElementParser element_parser{m_read_types};
+                    XMLElementParser::ExpatXMLParser parser{&element_parser};
+
+                    try {
+                        parser(root, sizeof(root) - 1, false);
+                        parser(m_data, false);
+                        parser("</osm>", 6, true);
+                    } catch (const osmium::xml_error& e) {
+                        if (e.line == 0) {
+                            throw;
+                        }
+                        const uint64_t column = e.line == 1 ? e.column - (sizeof(root) - 1) + m_first_column : e.column;
+                        throw osmium::xml_error{m_first_line + e.line, column, e.error_code};
+                    }
+
+                    return element_parser.release_buffer();
+                }
+
+            public:
+
+                XMLChunkParser(std::string&& data, uint64_t first_line, uint64_t first_column, osmium::osm_entity_bits::type read_types) :
+                    m_data(std::move(data)),
+                    m_first_line(first_line),
+                    m_first_column(first_column),
+                    m_read_types(read_types) {
+                }
+
+                osmium::memory::Buffer operator()() {
+                    {
+                        XMLSubsetParser subset_parser{m_read_types};
+                        if (subset_parser.parse(m_data)) {
+                            return subset_parser.release_buffer();
+                        }
+                    }
+
+                    return parse_with_expat();
+                }
+
+            }; // class XMLChunkParser
+
+            class XMLParser : public Parser, public XMLElementParser {
+
+                enum {
+                    min_chunk_size = 1024ul * 1024ul,
+                    max_header_size = 16ul * 1024ul * 1024ul
+                };
+
+                uint64_t m_line_count = 0;
+                uint64_t m_column = 0;
+
+                void mark_header_as_done() final {
+                    set_header_value(m_header);
+                }
+
+                void flush_buffer() final {
                     if (m_buffer.has_nested_buffers()) {
                         std::unique_ptr<osmium::memory::Buffer> buffer_ptr{m_buffer.get_last_nested()};
                         send_to_output_queue(std::move(*buffer_ptr));
                     }
                 }
 
+                // Advance the line count and the column in the last line
+                // (both zero-based) over the data, so that the position of
+                // the next chunk in the file is known.
+                void count_lines(const char* data, std::size_t size) {
+                    const char* end = data + size;
+                    const auto newlines = std::count(data, end, '\n');
+                    if (newlines == 0) {
+                        m_column += size;
+                        return;
+                    }
+                    m_line_count += newlines;
+                    const char* last_newline = end - 1;
+                    while (*last_newline != '\n') {
+                        --last_newline;
+                    }
+                    m_column = end - last_newline - 1;
+                }
+
+                // Hand a chunk of data to an XMLChunkParser in the thread
+                // pool. Expat gets the newlines from the chunk and spaces
+                // instead of everything else on the last line, so that the
+                // positions in its error messages stay correct.
+                void parse_chunk(std::string&& chunk, ExpatXMLParser& parser) {
+                    const auto first_line = m_line_count;
+                    const auto first_column = m_column;
+                    count_lines(chunk.data(), chunk.size());
+
+                    std::string placeholder(m_line_count - first_line, '\n');
+                    placeholder.append(m_line_count == first_line ? chunk.size() : m_column, ' ');
+                    parser(placeholder, false);
+
+                    XMLChunkParser chunk_parser{std::move(chunk), first_line, first_column, read_types()};
+                    submit_to_pool(std::move(chunk_parser));
+                }
+
+                // Split the input into chunks at the top-level objects and
+                // parse them in the thread pool. The header and everything
+                // after the end of the osm element is parsed by expat. If
+                // the file is not suitable for this (for instance because
+                // it is an OSM change file), all data read so far is given
+                // to expat and the function returns.
+                void parse_in_chunks(ExpatXMLParser& parser) {
+                    std::string data;
+                    std::string::size_type pos = 0;
+
+                    xml_tag tag;
+                    while ((tag = xml_find_tag(data, pos, input_done())) == xml_tag::none) {
+                        if (input_done() || data.size() > max_header_size) {
+                            parser(data, input_done());
+                            return;
+                        }
+                        data.append(get_input());
+                    }
+
+                    parser(data.data(), pos, false);
+                    if (tag != xml_tag::object ||
+                        !m_encoding_is_utf8 ||
+                        m_context_stack.size() != 1 ||
+                        m_context_stack.back() != context::osm) {
+                        parser(data.data() + pos, data.size() - pos, input_done());
+                        return;
+                    }
+
+                    mark_header_as_done();
+                    count_lines(data.data(), pos);
+                    data.erase(0, pos);
+                    pos = 1;
+
+                    while (true) {
+                        tag = xml_find_tag(data, pos, input_done());
+                        if (tag == xml_tag::none) {
+                            if (input_done()) {
+                                // The end of the osm element is missing,
+                                // let expat parse the rest and report the
+                                // error.
+                                parser(data, true);
+                                return;
+                            }
+                            data.append(get_input());
+                        } else if (tag == xml_tag::root_end) {
+                            if (pos > 0) {
+                                std::string rest{data, pos};
+                                data.resize(pos);
+                                parse_chunk(std::move(data), parser);
+                                data = std::move(rest);
+                            }
+                            parser(data, input_done());
+                            return;
+                        } else {
+                            if (tag == xml_tag::object && pos >= min_chunk_size) {
+                                std::string rest{data, pos};
+                                data.resize(pos);
+                                parse_chunk(std::move(data), parser);
+                                data = std::move(rest);
+                                pos = 0;
+                            }
+                            ++pos;
+                        }
+                    }
+                }
+
             public:
 
                 explicit XMLParser(parser_arguments& args) :
-                    Parser(args) {
+                    Parser(args),
+                    XMLElementParser(args.read_which_entities) {
                 }
 
                 XMLParser(const XMLParser&) = delete;
@@ -740,6 +1463,11 @@ namespace osmium {
 
                     ExpatXMLParser parser{this};
 
+                    if (read_types() != osmium::osm_entity_bits::nothing &&
+                        osmium::config::use_pool_threads_for_xml_parsing()) {
+                        parse_in_chunks(parser);
+                    }
+
                     while (!input_done()) {
                         const std::string data{get_input()};
                         parser(data, input_done());
@@ -58,7 +58,6 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/thread/pool.hpp>
 #include <osmium/visitor.hpp>
 
-#include <iterator>
 #include <memory>
 #include <string>
 #include <utility>
@@ -96,11 +95,11 @@ namespace osmium {
                     out += ' ';
                     out += lat;
                     out += "=\"";
-                    osmium::detail::append_location_coordinate_to_string(std::back_inserter(out), location.y());
+                    append_location_coordinate(out, location.y());
                     out += "\" ";
                     out += lon;
                     out += "=\"";
-                    osmium::detail::append_location_coordinate_to_string(std::back_inserter(out), location.x());
+                    append_location_coordinate(out, location.x());
                     out += "\"";
                 }
 
@@ -152,7 +151,7 @@ namespace osmium {
 
                     if (m_options.add_metadata.timestamp() && object.timestamp()) {
                         *m_out += " timestamp=\"";
-                        *m_out += object.timestamp().to_iso_all();
+                        append_iso_timestamp(*m_out, object.timestamp().seconds_since_epoch());
                         *m_out += "\"";
                     }
 
@@ -198,7 +197,7 @@ namespace osmium {
                         *m_out += " user=\"";
                         append_xml_encoded_string(*m_out, comment.user());
                         *m_out += "\" date=\"";
-                        *m_out += comment.date().to_iso_all();
+                        append_iso_timestamp(*m_out, comment.date().seconds_since_epoch());
                         *m_out += "\">\n";
                         *m_out += "    <text>";
                         append_xml_encoded_string(*m_out, comment.text());
@@ -245,8 +244,8 @@ namespace osmium {
 
             public:
 
-                XMLOutputBlock(osmium::memory::Buffer&& buffer, const xml_output_options& options) :
-                    OutputBlock(std::move(buffer)),
+                XMLOutputBlock(osmium::memory::Buffer&& buffer, const xml_output_options& options, OutputStringPool* string_pool = nullptr) :
+                    OutputBlock(std::move(buffer), 300, string_pool),
                     m_options(options) {
                 }
 
@@ -372,13 +371,13 @@ namespace osmium {
 
                     if (changeset.created_at()) {
                         *m_out += " created_at=\"";
-                        *m_out += changeset.created_at().to_iso();
+                        append_iso_timestamp(*m_out, changeset.created_at().seconds_since_epoch());
                         *m_out += "\"";
                     }
 
                     if (changeset.closed_at()) {
                         *m_out += " closed_at=\"";
-                        *m_out += changeset.closed_at().to_iso();
+                        append_iso_timestamp(*m_out, changeset.closed_at().seconds_since_epoch());
                         *m_out += "\" open=\"false\"";
                     } else {
                         *m_out += " open=\"true\"";
@@ -464,7 +463,7 @@ namespace osmium {
                 }
 
                 void write_buffer(osmium::memory::Buffer&& buffer) final {
-                    m_output_queue.push(m_pool.submit(XMLOutputBlock{std::move(buffer), m_options}));
+                    m_output_queue.push(m_pool.submit(XMLOutputBlock{std::move(buffer), m_options, m_string_pool.get()}));
                 }
 
                 void write_end() final {
@@ -45,8 +45,15 @@ DEALINGS IN THE SOFTWARE.
 
 #include <zlib.h>
 
+#ifdef OSMIUM_WITH_LIBDEFLATE
+# include <libdeflate.h>
+#endif
+
 #include <cassert>
+#include <cstddef>
+#include <cstring>
 #include <limits>
+#include <memory>
 #include <string>
 
 namespace osmium {
@@ -55,26 +62,95 @@ namespace osmium {
 
         namespace detail {
 
+#ifdef OSMIUM_WITH_LIBDEFLATE
+            struct libdeflate_compressor_deleter {
+                void operator()(libdeflate_compressor* compressor) const noexcept {
+                    libdeflate_free_compressor(compressor);
+                }
+            };
+
+            struct libdeflate_decompressor_deleter {
+                void operator()(libdeflate_decompressor* decompressor) const noexcept {
+                    libdeflate_free_decompressor(decompressor);
+                }
+            };
+
+            /**
+             * Get the libdeflate compressor for this thread and compression
+             * level. Allocating a compressor is expensive, so it is kept
+             * around until a different level is asked for.
+             */
+            inline libdeflate_compressor* get_libdeflate_compressor(int level) {
+                // Z_DEFAULT_COMPRESSION is 6 in zlib
+                if (level == Z_DEFAULT_COMPRESSION) {
+                    level = 6;
+                }
+                static thread_local std::unique_ptr<libdeflate_compressor, libdeflate_compressor_deleter> compressor;
+                static thread_local int compressor_level = -1;
+                if (!compressor || compressor_level != level) {
+                    compressor.reset(libdeflate_alloc_compressor(level));
+                    compressor_level = level;
+                }
+                if (!compressor) {
+                    throw io_error{"failed to allocate libdeflate compressor"};
+                }
+                return compressor.get();
+            }
+
+            /// Get the libdeflate decompressor for this thread.
+            inline libdeflate_decompressor* get_libdeflate_decompressor() {
+                static thread_local std::unique_ptr<libdeflate_decompressor, libdeflate_decompressor_deleter> decompressor{libdeflate_alloc_decompressor()};
+                if (!decompressor) {
+                    throw io_error{"failed to allocate libdeflate decompressor"};
+                }
+                return decompressor.get();
+            }
+#endif
+
             /**
              * Compress data using zlib.
              *
              * Note that this function can not compress data larger than
              * what fits in an unsigned long, on Windows this is usually 32bit.
              *
+             * If OSMIUM_WITH_LIBDEFLATE is defined, the faster libdeflate
+             * library is used instead of zlib. The result is still in zlib
+             * format, but not necessarily the same bytes.
+             *
              * @param input Data to compress.
+             * @param level Compression level (0 to 9 or
+             *              Z_DEFAULT_COMPRESSION).
              * @returns Compressed data.
              */
-            inline std::string zlib_compress(const std::string& input) {
+            inline std::string zlib_compress(const std::string& input, int level = Z_DEFAULT_COMPRESSION) {
+#ifdef OSMIUM_WITH_LIBDEFLATE
+                auto* compressor = get_libdeflate_compressor(level);
+                std::string output(libdeflate_zlib_compress_bound(compressor, input.size()), '\0');
+
+                const auto output_size = libdeflate_zlib_compress(compressor,
+                                                                  input.data(),
+                                                                  input.size(),
+                                                                  &*output.begin(),
+                                                                  output.size());
+                if (output_size == 0) {
+                    throw io_error{"failed to compress data"};
+                }
+
+                output.resize(output_size);
+
+                return output;
+#else
                 assert(input.size() < std::numeric_limits<unsigned long>::max());
                 unsigned long output_size = ::compressBound(static_cast<unsigned long>(input.size())); // NOLINT(google-runtime-int)
 
                 std::string output(output_size, '\0');
 
-                const auto result = ::compress(
+                const auto result = ::compress2(
                     reinterpret_cast<unsigned char*>(&*output.begin()),
                     &output_size,
                     reinterpret_cast<const unsigned char*>(input.data()),
-                    static_cast<unsigned long>(input.size()) // NOLINT(google-runtime-int)
+                    static_cast<unsigned long>(input.size()), // NOLINT(google-runtime-int)
+                    level
                 );
 
                 if (result != Z_OK) {
@@ -84,6 +160,7 @@ namespace osmium {
                 output.resize(output_size);
 
                 return output;
+#endif
             }
 
             /**
@@ -92,6 +169,10 @@ namespace osmium {
              * Note that this function can not uncompress data larger than
              * what fits in an unsigned long, on Windows this is usually 32bit.
              *
+             * If OSMIUM_WITH_LIBDEFLATE is defined, the faster libdeflate
+             * library is used instead of zlib. It needs to know the size of
+             * the uncompressed data, which is always the case here.
+             *
              * @param input Compressed input data.
              * @param raw_size Size of uncompressed data.
              * @param output Uncompressed result data.
@@ -100,6 +181,18 @@ namespace osmium {
             inline protozero::data_view zlib_uncompress_string(const char* input, unsigned long input_size, unsigned long raw_size, std::string& output) { // NOLINT(google-runtime-int)
                 output.resize(raw_size);
 
+#ifdef OSMIUM_WITH_LIBDEFLATE
+                const auto result = libdeflate_zlib_decompress(get_libdeflate_decompressor(),
+                                                               input,
+                                                               input_size,
+                                                               &*output.begin(),
+                                                               raw_size,
+                                                               nullptr);
+
+                if (result != LIBDEFLATE_SUCCESS) {
+                    throw io_error{"failed to uncompress data"};
+                }
+#else
                 const auto result = ::uncompress(
                     reinterpret_cast<unsigned char*>(&*output.begin()),
                     &raw_size,
@@ -110,10 +203,66 @@ namespace osmium {
                 if (result != Z_OK) {
                     throw io_error{std::string{"failed to uncompress data: "} + zError(result)};
                 }
+#endif
 
                 return protozero::data_view{output.data(), output.size()};
             }
 
+            /**
+             * Decompress zlib data piece by piece. This is used when only
+             * the beginning of the uncompressed data is needed, so there
+             * is no point in decompressing all of it.
+             */
+            class zlib_inflate_stream {
+
+                z_stream m_stream;
+
+            public:
+
+                zlib_inflate_stream(const char* input, unsigned long input_size) { // NOLINT(google-runtime-int)
+                    std::memset(&m_stream, 0, sizeof(m_stream));
+                    m_stream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(input));
+                    m_stream.avail_in = static_cast<unsigned int>(input_size);
+
+                    const auto result = ::inflateInit(&m_stream);
+                    if (result != Z_OK) {
+                        throw io_error{std::string{"failed to initialize zlib stream: "} + zError(result)};
+                    }
+                }
+
+                zlib_inflate_stream(const zlib_inflate_stream&) = delete;
+                zlib_inflate_stream& operator=(const zlib_inflate_stream&) = delete;
+
+                zlib_inflate_stream(zlib_inflate_stream&&) = delete;
+                zlib_inflate_stream& operator=(zlib_inflate_stream&&) = delete;
+
+                ~zlib_inflate_stream() noexcept {
+                    ::inflateEnd(&m_stream);
+                }
+
+                /**
+                 * Decompress the next part of the data into the buffer.
+                 *
+                 * @param buffer Output buffer
+                 * @param size Size of the output buffer
+                 * @returns Number of bytes written to the buffer. Zero
+                 *          at the end of the data.
+                 * @throws osmium::io_error If the data is invalid.
+                 */
+                std::size_t read(char* buffer, std::size_t size) {
+                    m_stream.next_out = reinterpret_cast<unsigned char*>(buffer);
+                    m_stream.avail_out = static_cast<unsigned int>(size);
+
+                    const auto result = ::inflate(&m_stream, Z_NO_FLUSH);
+                    if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+                        throw io_error{std::string{"failed to uncompress data: "} + zError(result)};
+                    }
+
+                    return size - m_stream.avail_out;
+                }
+
+            }; // class zlib_inflate_stream
+
         } // namespace detail
 
     } // namespace io
@@ -0,0 +1,153 @@
+#ifndef OSMIUM_IO_DETAIL_ZSTD_HPP
+#define OSMIUM_IO_DETAIL_ZSTD_HPP
+
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/error.hpp>
+
+#include <protozero/version.hpp>
+
+#if PROTOZERO_VERSION_CODE >= 10600
+# include <protozero/data_view.hpp>
+#else
+# include <protozero/types.hpp>
+#endif
+
+#include <zstd.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace osmium {
+
+    namespace io {
+
+        namespace detail {
+
+            struct zstd_cctx_deleter {
+                void operator()(ZSTD_CCtx* cctx) const noexcept {
+                    ZSTD_freeCCtx(cctx);
+                }
+            };
+
+            struct zstd_dctx_deleter {
+                void operator()(ZSTD_DCtx* dctx) const noexcept {
+                    ZSTD_freeDCtx(dctx);
+                }
+            };
+
+            /**
+             * Get the zstd compression context for this thread. Creating
+             * a context is expensive, so it is kept around.
+             */
+            inline ZSTD_CCtx* get_zstd_cctx() {
+                static thread_local std::unique_ptr<ZSTD_CCtx, zstd_cctx_deleter> cctx{ZSTD_createCCtx()};
+                if (!cctx) {
+                    throw io_error{"failed to create zstd compression context"};
+                }
+                return cctx.get();
+            }
+
+            /// Get the zstd decompression context for this thread.
+            inline ZSTD_DCtx* get_zstd_dctx() {
+                static thread_local std::unique_ptr<ZSTD_DCtx, zstd_dctx_deleter> dctx{ZSTD_createDCtx()};
+                if (!dctx) {
+                    throw io_error{"failed to create zstd decompression context"};
+                }
+                return dctx.get();
+            }
+
+            /**
+             * Compress data using zstd.
+             *
+             * @param input Data to compress.
+             * @param level Compression level.
+             * @returns Compressed data.
+             */
+            inline std::string zstd_compress(const std::string& input, int level = ZSTD_CLEVEL_DEFAULT) {
+                std::string output(ZSTD_compressBound(input.size()), '\0');
+
+                const auto output_size = ZSTD_compressCCtx(get_zstd_cctx(),
+                                                           &*output.begin(),
+                                                           output.size(),
+                                                           input.data(),
+                                                           input.size(),
+                                                           level);
+
+                if (ZSTD_isError(output_size)) {
+                    throw io_error{std::string{"failed to compress data: "} + ZSTD_getErrorName(output_size)};
+                }
+
+                output.resize(output_size);
+
+                return output;
+            }
+
+            /**
+             * Uncompress data using zstd.
+             *
+             * @param input Compressed input data.
+             * @param input_size Size of compressed input data.
+             * @param raw_size Size of uncompressed data.
+             * @param output Uncompressed result data.
+             * @returns Pointer and size to uncompressed data.
+             */
+            inline protozero::data_view zstd_uncompress_string(const char* input, std::size_t input_size, std::size_t raw_size, std::string& output) {
+                output.resize(raw_size);
+
+                const auto result = ZSTD_decompressDCtx(get_zstd_dctx(),
+                                                        &*output.begin(),
+                                                        raw_size,
+                                                        input,
+                                                        input_size);
+
+                if (ZSTD_isError(result)) {
+                    throw io_error{std::string{"failed to uncompress data: "} + ZSTD_getErrorName(result)};
+                }
+
+                if (result != raw_size) {
+                    throw io_error{"failed to uncompress data: wrong size"};
+                }
+
+                return protozero::data_view{output.data(), output.size()};
+            }
+
+        } // namespace detail
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_DETAIL_ZSTD_HPP
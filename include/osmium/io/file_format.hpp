@@ -56,6 +56,11 @@ namespace osmium {
             yes = 1
         };
 
+        enum class read_mmap {
+            no  = 0,
+            yes = 1
+        };
+
         inline const char* as_string(const file_format format) noexcept {
             switch (format) {
                 case file_format::xml:
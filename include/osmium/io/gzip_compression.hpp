@@ -39,7 +39,8 @@ DEALINGS IN THE SOFTWARE.
  * Include this file if you want to read or write gzip-compressed OSM
  * files.
  *
- * @attention If you include this file, you'll need to link with `libz`.
+ * @attention If you include this file, you'll need to link with `libz`
+ *            and enable multithreading.
  */
 
 #include <osmium/io/compression.hpp>
@@ -47,15 +48,24 @@ DEALINGS IN THE SOFTWARE.
 #include <osmium/io/error.hpp>
 #include <osmium/io/file_compression.hpp>
 #include <osmium/io/writer_options.hpp>
+#include <osmium/thread/pool.hpp>
 #include <osmium/util/compatibility.hpp>
+#include <osmium/util/config.hpp>
+#include <osmium/util/file.hpp>
 
 #include <zlib.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <iterator>
 #include <limits>
 #include <string>
+#include <utility>
 
 #ifndef _MSC_VER
 # include <unistd.h>
@@ -310,14 +320,451 @@ namespace osmium {
 
         }; // class GzipBufferDecompressor
 
+        namespace detail {
+
+            enum {
+                bgzf_header_size = 18
+            };
+
+            enum {
+                bgzf_max_input_size = 0xff00u
+            };
+
+            // The uncompressed data in a BGZF block is never larger than
+            // this according to the spec.
+            enum {
+                bgzf_max_uncompressed_size = 0x10000u
+            };
+
+            /**
+             * Get the size of the BGZF block (a gzip member with the size
+             * of the member in an extra field) at the beginning of data.
+             *
+             * @returns The size or 0 if there is no BGZF block header.
+             */
+            inline std::size_t bgzf_block_size(const char* data, const std::size_t size) noexcept {
+                const auto* d = reinterpret_cast<const unsigned char*>(data);
+                if (size < bgzf_header_size || d[0] != 0x1fu || d[1] != 0x8bu || d[2] != Z_DEFLATED || (d[3] & 0x04u) == 0) {
+                    return 0;
+                }
+
+                // Look for the "BC" subfield in the extra field.
+                const std::size_t xlen = d[10] | (static_cast<std::size_t>(d[11]) << 8u);
+                const std::size_t end = std::min(size, 12 + xlen);
+                for (std::size_t pos = 12; pos + 6 <= end;) {
+                    const std::size_t slen = d[pos + 2] | (static_cast<std::size_t>(d[pos + 3]) << 8u);
+                    if (d[pos] == 'B' && d[pos + 1] == 'C' && slen == 2) {
+                        return (d[pos + 4] | (static_cast<std::size_t>(d[pos + 5]) << 8u)) + 1;
+                    }
+                    pos += 4 + slen;
+                }
+
+                return 0;
+            }
+
+            /**
+             * Check whether the file with the given file descriptor starts
+             * with a BGZF block. Only works for files that can be read at
+             * an offset, always returns false for pipes etc.
+             */
+            inline bool is_bgzf_file(const int fd) noexcept {
+#ifndef _WIN32
+                char header[bgzf_header_size];
+                return ::pread(fd, header, bgzf_header_size, 0) == bgzf_header_size &&
+                       bgzf_block_size(header, bgzf_header_size) != 0;
+#else
+                return false;
+#endif
+            }
+
+            /**
+             * Compress data into a BGZF block. The size of the data must be
+             * small enough that the compressed block is smaller than 64k
+             * (bgzf_max_input_size).
+             *
+             * @throws osmium::gzip_error If the data can't be compressed.
+             */
+            inline std::string bgzf_compress_block(const char* data, const std::size_t size, const int level = Z_DEFAULT_COMPRESSION) {
+                assert(size <= bgzf_max_input_size);
+
+                z_stream zstream{};
+                int result = deflateInit2(&zstream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY); // NOLINT(hicpp-signed-bitwise)
+                if (result != Z_OK) {
+                    throw osmium::gzip_error{"gzip error: compression init failed", result};
+                }
+
+                std::string output(bgzf_header_size + deflateBound(&zstream, static_cast<uLong>(size)) + 8, '\0');
+                zstream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(data));
+                zstream.avail_in = static_cast<unsigned int>(size);
+                zstream.next_out = reinterpret_cast<unsigned char*>(&*output.begin()) + bgzf_header_size;
+                zstream.avail_out = static_cast<unsigned int>(output.size() - bgzf_header_size - 8);
+                result = deflate(&zstream, Z_FINISH);
+                const auto compressed_size = zstream.total_out;
+                deflateEnd(&zstream);
+
+                if (result != Z_STREAM_END) {
+                    throw osmium::gzip_error{"gzip error: deflate failed", result};
+                }
+
+                const std::size_t block_size = bgzf_header_size + compressed_size + 8;
+                if (block_size > 0x10000u) {
+                    throw osmium::gzip_error{"gzip error: deflate failed: BGZF block too large", Z_BUF_ERROR};
+                }
+                output.resize(block_size);
+
+                static const unsigned char header[bgzf_header_size - 2] = {
+                    0x1f, 0x8b, Z_DEFLATED, 0x04, // magic, method, flags (FEXTRA)
+                    0, 0, 0, 0, 0, 0xff,          // mtime, extra flags, OS
+                    6, 0, 'B', 'C', 2, 0          // XLEN, subfield "BC" with size 2
+                };
+                std::copy(std::begin(header), std::end(header), output.begin());
+
+                const auto add_uint = [&output](std::size_t pos, uint32_t value, int bytes) {
+                    for (int i = 0; i < bytes; ++i, ++pos) {
+                        output[pos] = static_cast<char>((value >> (8 * i)) & 0xffu);
+                    }
+                };
+                add_uint(bgzf_header_size - 2, static_cast<uint32_t>(block_size - 1), 2);
+
+                const auto crc = crc32(crc32(0, nullptr, 0), reinterpret_cast<const unsigned char*>(data), static_cast<unsigned int>(size));
+                add_uint(block_size - 8, static_cast<uint32_t>(crc), 4);
+                add_uint(block_size - 4, static_cast<uint32_t>(size), 4);
+
+                return output;
+            }
+
+            /**
+             * Decompress a complete BGZF block.
+             *
+             * @throws osmium::gzip_error If the data can't be decompressed.
+             */
+            inline std::string bgzf_decompress_block(const std::string& block) {
+                assert(block.size() >= bgzf_header_size + 8);
+
+                // The uncompressed size is in the last four bytes.
+                const auto* end = reinterpret_cast<const unsigned char*>(block.data() + block.size());
+                const uint32_t size = end[-4] |
+                                      (static_cast<uint32_t>(end[-3]) <<  8u) |
+                                      (static_cast<uint32_t>(end[-2]) << 16u) |
+                                      (static_cast<uint32_t>(end[-1]) << 24u);
+
+                // Check before allocating, the size comes from the input.
+                if (size > bgzf_max_uncompressed_size) {
+                    throw osmium::gzip_error{"gzip error: inflate failed: BGZF block too large", Z_DATA_ERROR};
+                }
+
+                std::string output(size, '\0');
+
+                z_stream zstream{};
+                int result = inflateInit2(&zstream, MAX_WBITS | 16); // NOLINT(hicpp-signed-bitwise)
+                if (result != Z_OK) {
+                    throw osmium::gzip_error{"gzip error: decompression init failed", result};
+                }
+
+                zstream.next_in = reinterpret_cast<unsigned char*>(const_cast<char*>(block.data()));
+                zstream.avail_in = static_cast<unsigned int>(block.size());
+                zstream.next_out = reinterpret_cast<unsigned char*>(&*output.begin());
+                zstream.avail_out = size;
+                result = inflate(&zstream, Z_FINISH);
+
+                std::string message{"gzip error: inflate failed: "};
+                if (zstream.msg) {
+                    message.append(zstream.msg);
+                }
+                const auto total_out = zstream.total_out;
+                inflateEnd(&zstream);
+
+                if (result != Z_STREAM_END) {
+                    throw osmium::gzip_error{message, result == Z_OK || result == Z_BUF_ERROR ? Z_DATA_ERROR : result};
+                }
+                if (total_out != size) {
+                    throw osmium::gzip_error{"gzip error: inflate failed: wrong size", Z_DATA_ERROR};
+                }
+
+                return output;
+            }
+
+            struct bgzf_decompress_task {
+
+                std::string block;
+
+                std::string operator()() const {
+                    return bgzf_decompress_block(block);
+                }
+
+            }; // struct bgzf_decompress_task
+
+            struct bgzf_compress_task {
+
+                std::string data;
+                int level;
+
+                std::string operator()() const {
+                    std::string output;
+                    for (std::size_t pos = 0; pos < data.size(); pos += bgzf_max_input_size) {
+                        const auto size = std::min(data.size() - pos, static_cast<std::size_t>(bgzf_max_input_size));
+                        output += bgzf_compress_block(data.data() + pos, size, level);
+                    }
+                    return output;
+                }
+
+            }; // struct bgzf_compress_task
+
+        } // namespace detail
+
+        /**
+         * Decompressor for BGZF files using the threads in the thread pool.
+         * BGZF files (as written by bgzip for instance) are gzip files
+         * consisting of many small gzip members which have their size in
+         * an extra header field. They can be found without decompressing
+         * the data, so they are sent off to the pool to be decompressed.
+         * Results are returned in order.
+         *
+         * This only works if all members in the file are BGZF blocks.
+         * Use detail::is_bgzf_file() to check the beginning of the file.
+         */
+        class ParallelGzipDecompressor : public Decompressor {
+
+            osmium::thread::Pool& m_pool;
+            std::deque<std::pair<std::future<std::string>, std::size_t>> m_pending;
+            std::size_t m_max_pending;
+
+            int m_fd;
+            std::size_t m_bytes_read = 0;
+            bool m_eof = false;
+
+            // Input data not yet handed off to a block.
+            std::string m_input;
+
+            void read_input() {
+                const auto old_size = m_input.size();
+                m_input.resize(old_size + osmium::io::Decompressor::input_buffer_size);
+                const auto nread = detail::reliable_read(m_fd, &*m_input.begin() + old_size, osmium::io::Decompressor::input_buffer_size);
+                m_input.resize(old_size + static_cast<std::size_t>(nread));
+                m_bytes_read += static_cast<std::size_t>(nread);
+
+                if (nread == 0) {
+                    m_eof = true;
+                    if (!m_input.empty()) {
+                        throw gzip_error{"gzip error: read failed: unexpected end of file", Z_BUF_ERROR};
+                    }
+                    return;
+                }
+
+                std::size_t pos = 0;
+                while (m_input.size() - pos >= detail::bgzf_header_size) {
+                    const auto size = detail::bgzf_block_size(m_input.data() + pos, m_input.size() - pos);
+                    if (size == 0) {
+                        throw gzip_error{"gzip error: read failed: not a BGZF block", Z_DATA_ERROR};
+                    }
+                    if (size > m_input.size() - pos) {
+                        break;
+                    }
+                    m_pending.emplace_back(m_pool.submit(detail::bgzf_decompress_task{std::string{m_input, pos, size}}), m_bytes_read);
+                    pos += size;
+                }
+                m_input.erase(0, pos);
+            }
+
+        public:
+
+            explicit ParallelGzipDecompressor(const int fd, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) :
+                m_pool(pool),
+                m_max_pending(static_cast<std::size_t>(pool.num_threads()) * 2 + 2),
+                m_fd(fd) {
+                // Check that the file descriptor is valid, throws if not.
+                osmium::file_size(fd);
+            }
+
+            ParallelGzipDecompressor(const ParallelGzipDecompressor&) = delete;
+            ParallelGzipDecompressor& operator=(const ParallelGzipDecompressor&) = delete;
+
+            ParallelGzipDecompressor(ParallelGzipDecompressor&&) = delete;
+            ParallelGzipDecompressor& operator=(ParallelGzipDecompressor&&) = delete;
+
+            ~ParallelGzipDecompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            std::string read() final {
+                while (true) {
+                    if (!m_pending.empty() && (m_eof || m_pending.size() >= m_max_pending)) {
+                        auto pending = std::move(m_pending.front());
+                        m_pending.pop_front();
+                        set_offset(pending.second);
+                        std::string data{pending.first.get()};
+                        // The last block in a BGZF file is usually empty.
+                        if (!data.empty()) {
+                            return data;
+                        }
+                    } else if (m_eof) {
+                        return std::string{};
+                    } else {
+                        read_input();
+                    }
+                }
+            }
+
+            void close() final {
+                m_pending.clear();
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    m_fd = -1;
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class ParallelGzipDecompressor
+
+        /**
+         * Compressor for gzip files using the threads in the thread pool.
+         * The data is split into chunks which are compressed independently
+         * into BGZF blocks (gzip members with their size in an extra
+         * header field). The result is a normal gzip file which can be
+         * read by any gzip decompressor and can be decompressed in
+         * parallel by the ParallelGzipDecompressor.
+         *
+         * The compression ratio is slightly worse than with the
+         * GzipCompressor, because each block is compressed on its own.
+         */
+        class ParallelGzipCompressor : public Compressor {
+
+            enum {
+                // Number of BGZF blocks compressed in one task.
+                blocks_per_task = 16
+            };
+
+            osmium::thread::Pool& m_pool;
+            std::deque<std::future<std::string>> m_pending;
+            std::size_t m_max_pending;
+
+            int m_fd;
+            int m_level;
+            std::string m_buffer;
+
+            void write_result() {
+                const std::string data{m_pending.front().get()};
+                m_pending.pop_front();
+                osmium::io::detail::reliable_write(m_fd, data.data(), data.size());
+            }
+
+            void submit_buffer() {
+                m_pending.push_back(m_pool.submit(detail::bgzf_compress_task{std::move(m_buffer), m_level}));
+                m_buffer.clear();
+                m_buffer.reserve(chunk_size);
+                while (m_pending.size() > m_max_pending) {
+                    write_result();
+                }
+            }
+
+        public:
+
+            enum {
+                chunk_size = blocks_per_task * detail::bgzf_max_input_size
+            };
+
+            explicit ParallelGzipCompressor(const int fd, const fsync sync, const int level = Z_DEFAULT_COMPRESSION, osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) :
+                Compressor(sync),
+                m_pool(pool),
+                m_max_pending(static_cast<std::size_t>(pool.num_threads()) * 2 + 2),
+                m_fd(fd),
+                m_level(level) {
+                // Check that the file descriptor is valid, throws if not.
+                osmium::file_size(fd);
+                m_buffer.reserve(chunk_size);
+            }
+
+            ParallelGzipCompressor(const ParallelGzipCompressor&) = delete;
+            ParallelGzipCompressor& operator=(const ParallelGzipCompressor&) = delete;
+
+            ParallelGzipCompressor(ParallelGzipCompressor&&) = delete;
+            ParallelGzipCompressor& operator=(ParallelGzipCompressor&&) = delete;
+
+            ~ParallelGzipCompressor() noexcept final {
+                try {
+                    close();
+                } catch (...) {
+                    // Ignore any exceptions because destructor must not throw.
+                }
+            }
+
+            void write(const std::string& data) final {
+                assert(m_fd >= 0);
+                std::size_t pos = 0;
+                while (pos < data.size()) {
+                    const auto size = std::min(data.size() - pos, static_cast<std::size_t>(chunk_size) - m_buffer.size());
+                    m_buffer.append(data, pos, size);
+                    pos += size;
+                    if (m_buffer.size() == chunk_size) {
+                        submit_buffer();
+                    }
+                }
+            }
+
+            void close() final {
+                if (m_fd >= 0) {
+                    const int fd = m_fd;
+                    try {
+                        if (!m_buffer.empty()) {
+                            submit_buffer();
+                        }
+                        while (!m_pending.empty()) {
+                            write_result();
+                        }
+
+                        // BGZF files end with an empty block
+                        const std::string eof_block{detail::bgzf_compress_block(nullptr, 0)};
+                        osmium::io::detail::reliable_write(fd, eof_block.data(), eof_block.size());
+                    } catch (...) {
+                        m_fd = -1;
+                        m_pending.clear();
+                        osmium::io::detail::reliable_close(fd);
+                        throw;
+                    }
+                    m_fd = -1;
+                    if (do_fsync()) {
+                        osmium::io::detail::reliable_fsync(fd);
+                    }
+                    osmium::io::detail::reliable_close(fd);
+                }
+            }
+
+        }; // class ParallelGzipCompressor
+
         namespace detail {
 
             // we want the register_compression() function to run, setting
             // the variable is only a side-effect, it will never be used
             const bool registered_gzip_compression = osmium::io::CompressionFactory::instance().register_compression(osmium::io::file_compression::gzip,
-                [](const int fd, const fsync sync) { return new osmium::io::GzipCompressor{fd, sync}; },
-                [](const int fd) { return new osmium::io::GzipDecompressor{fd}; },
-                [](const char* buffer, const std::size_t size) { return new osmium::io::GzipBufferDecompressor{buffer, size}; }
+                [](const int fd, const fsync sync) -> osmium::io::Compressor* {
+                    if (osmium::config::use_pool_threads_for_compression()) {
+                        return new osmium::io::ParallelGzipCompressor{fd, sync};
+                    }
+                    return new osmium::io::GzipCompressor{fd, sync};
+                },
+                [](const int fd) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_pool_threads_for_decompression() && is_bgzf_file(fd)) {
+                        return new osmium::io::ParallelGzipDecompressor{fd};
+                    }
+                    return new osmium::io::GzipDecompressor{fd};
+                },
+                [](const char* buffer, const std::size_t size) { return new osmium::io::GzipBufferDecompressor{buffer, size}; },
+                [](const int fd, const fsync sync, osmium::thread::Pool& pool) -> osmium::io::Compressor* {
+                    if (osmium::config::use_pool_threads_for_compression()) {
+                        return new osmium::io::ParallelGzipCompressor{fd, sync, Z_DEFAULT_COMPRESSION, pool};
+                    }
+                    return new osmium::io::GzipCompressor{fd, sync};
+                },
+                [](const int fd, osmium::thread::Pool& pool) -> osmium::io::Decompressor* {
+                    if (osmium::config::use_pool_threads_for_decompression() && is_bgzf_file(fd)) {
+                        return new osmium::io::ParallelGzipDecompressor{fd, pool};
+                    }
+                    return new osmium::io::GzipDecompressor{fd};
+                }
             );
 
             // dummy function to silence the unused variable warning from above
@@ -0,0 +1,208 @@
+#ifndef OSMIUM_IO_PBF_BLOCK_INDEX_HPP
+#define OSMIUM_IO_PBF_BLOCK_INDEX_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/io/error.hpp>
+#include <osmium/osm/entity_bits.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/util/file.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace osmium {
+
+    namespace io {
+
+        /**
+         * Reader option: Only read objects with IDs in the given range
+         * (inclusive). This is only used together with a PBFBlockIndex,
+         * blocks that can not contain any objects in this range will be
+         * skipped. Note that the Reader still returns all objects from
+         * the blocks that are not skipped, so you will see objects
+         * outside this range.
+         */
+        struct read_id_range {
+
+            osmium::object_id_type first = std::numeric_limits<osmium::object_id_type>::min();
+            osmium::object_id_type last  = std::numeric_limits<osmium::object_id_type>::max();
+
+            read_id_range() noexcept = default;
+
+            read_id_range(osmium::object_id_type first_id, osmium::object_id_type last_id) noexcept :
+                first(first_id),
+                last(last_id) {
+            }
+
+        }; // struct read_id_range
+
+        /**
+         * Index of the data blocks in a PBF file. For each OSMData blob
+         * it records the offset in the file, the types of the objects in
+         * the blob and the smallest and largest ID of those objects.
+         *
+         * Create the index using the osmium::io::build_pbf_block_index()
+         * function (in osmium/io/pbf_input.hpp) and give it to the Reader
+         * as an option. The Reader will then skip all blocks that can not
+         * contain any objects of the requested entity types (and in the
+         * requested read_id_range) without decompressing them.
+         *
+         * The index can be dumped into a file and loaded again later, so
+         * it can be stored next to the PBF file and doesn't have to be
+         * re-created for every read. The dump uses the native byte order
+         * and can only be read on machines of the same type.
+         *
+         * The index must not be destroyed while a Reader is using it.
+         */
+        class PBFBlockIndex {
+
+        public:
+
+            struct block_info {
+
+                /// Offset of the blob (including its BlobHeader) in the file
+                uint64_t offset = 0;
+
+                /// Smallest ID of any object in this block
+                osmium::object_id_type min_id = std::numeric_limits<osmium::object_id_type>::max();
+
+                /// Largest ID of any object in this block
+                osmium::object_id_type max_id = std::numeric_limits<osmium::object_id_type>::min();
+
+                /// Types of the objects in this block (osm_entity_bits::type)
+                uint32_t types = osmium::osm_entity_bits::nothing;
+
+                uint32_t reserved = 0;
+
+                void add(const osmium::osm_entity_bits::type type, const osmium::object_id_type id) noexcept {
+                    types |= type;
+                    if (id < min_id) {
+                        min_id = id;
+                    }
+                    if (id > max_id) {
+                        max_id = id;
+                    }
+                }
+
+                /**
+                 * Can this block contain objects of any of the given types
+                 * with IDs in the given range?
+                 */
+                bool may_contain(const osmium::osm_entity_bits::type entities, const read_id_range& range) const noexcept {
+                    return (types & entities) != 0 &&
+                           min_id <= range.last &&
+                           max_id >= range.first;
+                }
+
+            }; // struct block_info
+
+        private:
+
+            std::vector<block_info> m_blocks;
+
+        public:
+
+            using const_iterator = std::vector<block_info>::const_iterator;
+
+            PBFBlockIndex() = default;
+
+            /**
+             * Load an index from a file previously written with dump().
+             *
+             * @param fd File descriptor to read the index from.
+             * @throws osmium::io_error if the file has the wrong size.
+             * @throws std::system_error if reading fails.
+             */
+            explicit PBFBlockIndex(const int fd) {
+                const auto size = osmium::file_size(fd);
+                if (size % sizeof(block_info) != 0) {
+                    throw osmium::io_error{"PBF block index file has wrong size"};
+                }
+
+                m_blocks.resize(size / sizeof(block_info));
+                auto* data = reinterpret_cast<char*>(m_blocks.data());
+                std::size_t offset = 0;
+                while (offset < size) {
+                    const auto nread = osmium::io::detail::reliable_read(fd, data + offset, static_cast<unsigned int>(size - offset));
+                    if (nread == 0) {
+                        throw osmium::io_error{"PBF block index file truncated"};
+                    }
+                    offset += static_cast<std::size_t>(nread);
+                }
+            }
+
+            /**
+             * Write the index to the given file descriptor.
+             *
+             * @throws std::system_error if writing fails.
+             */
+            void dump(const int fd) const {
+                osmium::io::detail::reliable_write(fd, reinterpret_cast<const char*>(m_blocks.data()), m_blocks.size() * sizeof(block_info));
+            }
+
+            void add(const block_info& block) {
+                m_blocks.push_back(block);
+            }
+
+            std::size_t size() const noexcept {
+                return m_blocks.size();
+            }
+
+            bool empty() const noexcept {
+                return m_blocks.empty();
+            }
+
+            const block_info& operator[](const std::size_t n) const noexcept {
+                return m_blocks[n];
+            }
+
+            const_iterator begin() const noexcept {
+                return m_blocks.cbegin();
+            }
+
+            const_iterator end() const noexcept {
+                return m_blocks.cend();
+            }
+
+        }; // class PBFBlockIndex
+
+    } // namespace io
+
+} // namespace osmium
+
+#endif // OSMIUM_IO_PBF_BLOCK_INDEX_HPP
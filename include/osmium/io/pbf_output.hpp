@@ -40,6 +40,11 @@ DEALINGS IN THE SOFTWARE.
  *
  * @attention If you include this file, you'll need to link with
  *            `libz`, and enable multithreading.
+ *
+ * @attention If OSMIUM_WITH_ZSTD or OSMIUM_WITH_LZ4 is defined before
+ *            including this file, blobs compressed with zstd or lz4
+ *            are supported and you'll also need to link with `libzstd`
+ *            or `liblz4`, respectively.
  */
 
 #include <osmium/io/detail/pbf_output_format.hpp> // IWYU pragma: export
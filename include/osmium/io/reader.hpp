@@ -34,13 +34,18 @@ DEALINGS IN THE SOFTWARE.
 */
 
 #include <osmium/io/compression.hpp>
+#include <osmium/io/decode_callback.hpp>
 #include <osmium/io/detail/input_format.hpp>
+#include <osmium/io/detail/mapped_input.hpp>
 #include <osmium/io/detail/queue_util.hpp>
 #include <osmium/io/detail/read_thread.hpp>
 #include <osmium/io/detail/read_write.hpp>
 #include <osmium/io/error.hpp>
 #include <osmium/io/file.hpp>
+#include <osmium/io/file_compression.hpp>
+#include <osmium/io/file_format.hpp>
 #include <osmium/io/header.hpp>
+#include <osmium/io/pbf_block_index.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/entity_bits.hpp>
 #include <osmium/thread/pool.hpp>
@@ -111,9 +116,14 @@ namespace osmium {
 
             detail::future_string_queue_type m_input_queue;
 
+            // Either the input file is memory mapped (m_mapped_input is set)
+            // or it is read through the decompressor in the read thread
+            // (m_decompressor and m_read_thread_manager are set).
+            std::unique_ptr<detail::MappedInput> m_mapped_input;
+
             std::unique_ptr<osmium::io::Decompressor> m_decompressor;
 
-            osmium::io::detail::ReadThreadManager m_read_thread_manager;
+            std::unique_ptr<detail::ReadThreadManager> m_read_thread_manager;
 
             detail::future_buffer_queue_type m_osmdata_queue;
             detail::queue_wrapper<osmium::memory::Buffer> m_osmdata_queue_wrapper;
@@ -128,6 +138,13 @@ namespace osmium {
             osmium::osm_entity_bits::type m_read_which_entities = osmium::osm_entity_bits::all;
             osmium::io::read_meta m_read_metadata = osmium::io::read_meta::yes;
 
+            osmium::io::read_mmap m_read_mmap = osmium::io::read_mmap::no;
+
+            const osmium::io::PBFBlockIndex* m_block_index = nullptr;
+            osmium::io::read_id_range m_id_range{};
+
+            osmium::io::decode_callback m_decode_callback{};
+
             void set_option(osmium::thread::Pool& pool) noexcept {
                 m_pool = &pool;
             }
@@ -140,6 +157,22 @@ namespace osmium {
                 m_read_metadata = value;
             }
 
+            void set_option(osmium::io::read_mmap value) noexcept {
+                m_read_mmap = value;
+            }
+
+            void set_option(const osmium::io::PBFBlockIndex& index) noexcept {
+                m_block_index = &index;
+            }
+
+            void set_option(const osmium::io::read_id_range& range) noexcept {
+                m_id_range = range;
+            }
+
+            void set_option(const osmium::io::decode_callback& callback) {
+                m_decode_callback = callback;
+            }
+
             // This function will run in a separate thread.
             static void parser_thread(osmium::thread::Pool& pool,
                                       const detail::ParserFactory::create_parser_type& creator,
@@ -147,7 +180,11 @@ namespace osmium {
                                       detail::future_buffer_queue_type& osmdata_queue,
                                       std::promise<osmium::io::Header>&& header_promise,
                                       osmium::osm_entity_bits::type read_which_entities,
-                                      osmium::io::read_meta read_metadata) {
+                                      osmium::io::read_meta read_metadata,
+                                      detail::MappedInput* mapped_input,
+                                      const osmium::io::PBFBlockIndex* block_index,
+                                      osmium::io::read_id_range id_range,
+                                      osmium::io::decode_callback decode_callback) {
                 std::promise<osmium::io::Header> promise{std::move(header_promise)};
                 osmium::io::detail::parser_arguments args = {
                     pool,
@@ -155,7 +192,11 @@ namespace osmium {
                     osmdata_queue,
                     promise,
                     read_which_entities,
-                    read_metadata
+                    read_metadata,
+                    mapped_input,
+                    block_index,
+                    id_range,
+                    std::move(decode_callback)
                 };
                 creator(args)->parse();
             }
@@ -229,6 +270,41 @@ namespace osmium {
                 return osmium::io::detail::open_for_reading(filename);
             }
 
+            /**
+             * Can the file be memory mapped for reading? This is only the
+             * case for uncompressed PBF files on disk. Other formats can
+             * not make use of the mapping and we can not map compressed
+             * files, pipes, or data from the network.
+             */
+            static bool can_be_mapped(const osmium::io::File& file) {
+                if (file.buffer() ||
+                    file.format() != osmium::io::file_format::pbf ||
+                    file.compression() != osmium::io::file_compression::none) {
+                    return false;
+                }
+                const std::string protocol{file.filename().substr(0, file.filename().find_first_of(':'))};
+                return protocol != "http" && protocol != "https" && protocol != "ftp" && protocol != "file";
+            }
+
+            void open_input() {
+                if (m_read_mmap == osmium::io::read_mmap::yes && can_be_mapped(m_file)) {
+                    m_mapped_input = detail::map_input_file(m_file.filename());
+                }
+
+                if (m_mapped_input) {
+                    // Nothing will ever be read through the input queue.
+                    detail::add_end_of_data_to_queue(m_input_queue);
+                    m_file_size = m_mapped_input->size();
+                    return;
+                }
+
+                m_decompressor = m_file.buffer() ?
+                    osmium::io::CompressionFactory::instance().create_decompressor(m_file.compression(), m_file.buffer(), m_file.buffer_size()) :
+                    osmium::io::CompressionFactory::instance().create_decompressor(m_file.compression(), open_input_file_or_url(m_file.filename(), &m_childpid), *m_pool);
+                m_read_thread_manager.reset(new detail::ReadThreadManager{*m_decompressor, m_input_queue});
+                m_file_size = m_decompressor->file_size();
+            }
+
         public:
 
             /**
@@ -250,6 +326,32 @@ namespace osmium {
              *      etc.) is not read possibly speeding up the read. Not all
              *      file formats use this setting.
              *
+             * * osmium::io::read_mmap: Memory map the input file instead of
+             *      reading it through a pipeline of threads. The default is
+             *      osmium::io::read_mmap::no. If you set this to
+             *      osmium::io::read_mmap::yes and the input is an
+             *      uncompressed PBF file on disk, the file is mapped into
+             *      memory and the data blobs are handed to the decoding
+             *      threads without copying. For all other inputs this
+             *      setting is ignored.
+             *
+             * * osmium::io::PBFBlockIndex: Index of the blocks in a PBF file
+             *      created with osmium::io::build_pbf_block_index(). If this
+             *      is set, blocks that don't contain any of the requested
+             *      entities are skipped without decompressing them. The
+             *      index must stay valid until the Reader is closed. Ignored
+             *      for other file formats.
+             *
+             * * osmium::io::read_id_range: Together with a PBFBlockIndex
+             *      this will skip all blocks that don't contain objects with
+             *      IDs in the given range. Objects outside the range will
+             *      still be returned from blocks that are not skipped.
+             *
+             * * osmium::io::decode_callback: A function called on each
+             *      buffer right after it was decoded, usually in the threads
+             *      of the thread pool. See the documentation of the
+             *      decode_callback struct for details.
+             *
              * @throws osmium::io_error If there was an error.
              * @throws std::system_error If the file could not be opened.
              */
@@ -258,13 +360,8 @@ namespace osmium {
                 m_file(file.check()),
                 m_creator(detail::ParserFactory::instance().get_creator_function(m_file)),
                 m_input_queue(detail::get_input_queue_size(), "raw_input"),
-                m_decompressor(m_file.buffer() ?
-                    osmium::io::CompressionFactory::instance().create_decompressor(file.compression(), m_file.buffer(), m_file.buffer_size()) :
-                    osmium::io::CompressionFactory::instance().create_decompressor(file.compression(), open_input_file_or_url(m_file.filename(), &m_childpid))),
-                m_read_thread_manager(*m_decompressor, m_input_queue),
                 m_osmdata_queue(detail::get_osmdata_queue_size(), "parser_results"),
-                m_osmdata_queue_wrapper(m_osmdata_queue),
-                m_file_size(m_decompressor->file_size()) {
+                m_osmdata_queue_wrapper(m_osmdata_queue) {
 
                 (void)std::initializer_list<int>{
                     (set_option(args), 0)...
@@ -274,9 +371,18 @@ namespace osmium {
                     m_pool = &thread::Pool::default_instance();
                 }
 
+                try {
+                    open_input();
+                } catch (...) {
+                    // The parser thread will never be started, so make sure
+                    // nobody waits for data from it.
+                    detail::add_end_of_data_to_queue(m_osmdata_queue);
+                    throw;
+                }
+
                 std::promise<osmium::io::Header> header_promise;
                 m_header_future = header_promise.get_future();
-                m_thread = osmium::thread::thread_handler{parser_thread, std::ref(*m_pool), std::ref(m_creator), std::ref(m_input_queue), std::ref(m_osmdata_queue), std::move(header_promise), m_read_which_entities, m_read_metadata};
+                m_thread = osmium::thread::thread_handler{parser_thread, std::ref(*m_pool), std::ref(m_creator), std::ref(m_input_queue), std::ref(m_osmdata_queue), std::move(header_promise), m_read_which_entities, m_read_metadata, m_mapped_input.get(), m_block_index, m_id_range, m_decode_callback};
             }
 
             template <typename... TArgs>
@@ -314,14 +420,22 @@ namespace osmium {
             void close() {
                 m_status = status::closed;
 
-                m_read_thread_manager.stop();
+                if (m_mapped_input) {
+                    m_mapped_input->stop();
+                }
+
+                if (m_read_thread_manager) {
+                    m_read_thread_manager->stop();
+                }
 
                 m_osmdata_queue_wrapper.drain();
 
-                try {
-                    m_read_thread_manager.close();
-                } catch (...) {
-                    // Ignore any exceptions.
+                if (m_read_thread_manager) {
+                    try {
+                        m_read_thread_manager->close();
+                    } catch (...) {
+                        // Ignore any exceptions.
+                    }
                 }
 
 #ifndef _WIN32
@@ -403,7 +517,9 @@ namespace osmium {
                         buffer = m_osmdata_queue_wrapper.pop();
                         if (detail::at_end_of_data(buffer)) {
                             m_status = status::eof;
-                            m_read_thread_manager.close();
+                            if (m_read_thread_manager) {
+                                m_read_thread_manager->close();
+                            }
                             return buffer;
                         }
                         if (buffer.has_nested_buffers()) {
@@ -452,6 +568,9 @@ namespace osmium {
              * do an expensive system call.
              */
             std::size_t offset() const noexcept {
+                if (m_mapped_input) {
+                    return m_mapped_input->offset();
+                }
                 return m_decompressor->offset();
             }
 
@@ -453,6 +453,21 @@ namespace osmium {
                 return std::move(buffer->m_next_buffer);
             }
 
+            /**
+             * Call a function on each buffer nested in this one, the most
+             * deeply nested (ie. the oldest) buffer first. The buffers are
+             * not moved out, this buffer itself is not included.
+             *
+             * @param func Function taking a Buffer&.
+             */
+            template <typename TFunction>
+            void for_each_nested_buffer(TFunction&& func) {
+                if (m_next_buffer) {
+                    m_next_buffer->for_each_nested_buffer(func);
+                    func(*m_next_buffer);
+                }
+            }
+
             /**
              * Mark currently written bytes in the buffer as committed.
              *
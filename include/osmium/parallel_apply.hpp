@@ -0,0 +1,165 @@
+#ifndef OSMIUM_PARALLEL_APPLY_HPP
+#define OSMIUM_PARALLEL_APPLY_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <osmium/memory/buffer.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <utility>
+
+namespace osmium {
+
+    namespace detail {
+
+        /**
+         * Task for the thread pool applying a copy of a handler to a
+         * buffer. Returns the handler so its results can be collected.
+         */
+        template <typename THandler>
+        class apply_buffer_task {
+
+            osmium::memory::Buffer m_buffer;
+            THandler m_handler;
+
+        public:
+
+            apply_buffer_task(osmium::memory::Buffer&& buffer, const THandler& handler) :
+                m_buffer(std::move(buffer)),
+                m_handler(handler) {
+            }
+
+            THandler operator()() {
+                osmium::apply(m_buffer, m_handler);
+                return std::move(m_handler);
+            }
+
+        }; // class apply_buffer_task
+
+        struct no_reduce {
+
+            template <typename THandler>
+            void operator()(THandler&& /*handler*/) const noexcept {
+            }
+
+        }; // struct no_reduce
+
+    } // namespace detail
+
+    /**
+     * Apply a handler to all buffers read from a source (usually an
+     * osmium::io::Reader) using the threads of a thread pool.
+     *
+     * Each buffer is handled by its own copy of the prototype handler,
+     * so the handler must be copyable and it can't rely on seeing all
+     * objects or seeing them in order. (This rules out handlers like the
+     * NodeLocationsForWays handler.) The handler's flush() function is
+     * called at the end of each buffer.
+     *
+     * After a handler copy is done with its buffer, it is given to the
+     * reduce function, which can merge its results into the overall
+     * result. The reduce function is always called from the thread
+     * calling parallel_apply() and in the order in which the buffers were
+     * read from the source, so it doesn't need any synchronization and
+     * can rely on the order of the data.
+     *
+     * @tparam TSource Class with read() function returning Buffers. An
+     *                 invalid buffer marks the end of data.
+     * @param source The data source.
+     * @param prototype The handler that will be copied for each buffer.
+     * @param reduce Function called with each handler copy (as rvalue)
+     *               after it has handled its buffer.
+     * @param pool The thread pool to use.
+     * @param max_in_flight Maximum number of buffers being handled at the
+     *                      same time. This limits the memory use. If 0,
+     *                      twice the number of threads in the pool is
+     *                      used.
+     * @throws Any exception thrown by the source, the handler or the
+     *         reduce function.
+     */
+    template <typename TSource, typename THandler, typename TReduce>
+    inline void parallel_apply(TSource& source, const THandler& prototype, TReduce&& reduce,
+                               osmium::thread::Pool& pool = osmium::thread::Pool::default_instance(),
+                               std::size_t max_in_flight = 0) {
+        if (max_in_flight == 0) {
+            max_in_flight = 2 * static_cast<std::size_t>(pool.num_threads());
+        }
+
+        std::deque<std::future<THandler>> results;
+        try {
+            while (osmium::memory::Buffer buffer = source.read()) {
+                if (results.size() >= max_in_flight) {
+                    reduce(results.front().get());
+                    results.pop_front();
+                }
+                results.push_back(pool.submit(detail::apply_buffer_task<THandler>{std::move(buffer), prototype}));
+            }
+
+            while (!results.empty()) {
+                reduce(results.front().get());
+                results.pop_front();
+            }
+        } catch (...) {
+            // Tasks still in the pool use copies of the handler and maybe
+            // data owned by the caller, so wait for them before leaving.
+            for (auto& result : results) {
+                if (result.valid()) {
+                    result.wait();
+                }
+            }
+            throw;
+        }
+    }
+
+    /**
+     * Apply a handler to all buffers read from a source (usually an
+     * osmium::io::Reader) using the threads of a thread pool. Each buffer
+     * is handled by its own copy of the handler and the copies are thrown
+     * away afterwards. This is useful for handlers that write their
+     * results somewhere else in a thread-safe way.
+     *
+     * See the other parallel_apply() function for details.
+     */
+    template <typename TSource, typename THandler>
+    inline void parallel_apply(TSource& source, const THandler& prototype,
+                               osmium::thread::Pool& pool = osmium::thread::Pool::default_instance()) {
+        parallel_apply(source, prototype, detail::no_reduce{}, pool);
+    }
+
+} // namespace osmium
+
+#endif // OSMIUM_PARALLEL_APPLY_HPP
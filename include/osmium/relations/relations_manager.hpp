@@ -227,6 +227,25 @@ namespace osmium {
                 return member_relations_database().get(id);
             }
 
+            /**
+             * Keep the relations and member objects in the given file
+             * instead of in memory. This allows working with more or
+             * larger relations than would fit into memory, because the
+             * operating system only keeps the parts of the file used
+             * recently in memory. The relations and members databases
+             * (a few bytes for each relation and member) are still kept
+             * in memory. Call this before reading any data.
+             *
+             * @param fd File descriptor of a file opened for reading and
+             *           writing. Usually this is a temporary file created
+             *           with osmium::detail::create_tmp_file(). The file is
+             *           not closed by the manager.
+             * @throws std::system_error if the mapping fails.
+             */
+            void store_objects_in_file(int fd) {
+                m_stash.store_in_file(fd);
+            }
+
             /**
              * Sort the members databases to prepare them for reading. Usually
              * this is called between the first and second pass reading through
@@ -438,6 +457,17 @@ namespace osmium {
             void after_relation(const osmium::Relation& /*relation*/) const noexcept {
             }
 
+            /**
+             * This method is called before the output buffer is flushed
+             * with flush_output() or read with read().
+             *
+             * Overwrite this method in a derived class if it creates
+             * output asynchronously, for instance in other threads. It
+             * must add all outstanding output to the output buffer.
+             */
+            void finish_output() const noexcept {
+            }
+
             TManager& derived() noexcept {
                 return *static_cast<TManager*>(this);
             }
@@ -471,6 +501,23 @@ namespace osmium {
                 return m_handler_pass2;
             }
 
+            /**
+             * Add all outstanding output to the output buffer and flush it.
+             */
+            void flush_output() {
+                derived().finish_output();
+                RelationsManagerBase::flush_output();
+            }
+
+            /**
+             * Add all outstanding output to the output buffer and return
+             * its contents.
+             */
+            osmium::memory::Buffer read() {
+                derived().finish_output();
+                return RelationsManagerBase::read();
+            }
+
             /**
              * Add the specified relation to the list of relations we want to
              * build. This calls the new_relation() and new_member()
@@ -35,10 +35,13 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/memory/buffer.hpp>
 #include <osmium/memory/item.hpp>
+#include <osmium/util/memory_mapping.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <limits>
+#include <memory>
 #include <ostream>
 #include <vector>
 
@@ -53,6 +56,9 @@ namespace osmium {
      * Class for storing OSM data in memory. Any osmium::memory::Item can be
      * added to the stash and it will be copied into its internal Buffer. To
      * access the item again, an opaque handle is used.
+     *
+     * The items can also be kept in a file instead of in memory, see
+     * store_in_file().
      */
     class ItemStash {
 
@@ -124,6 +130,7 @@ namespace osmium {
         };
 
         osmium::memory::Buffer m_buffer;
+        std::unique_ptr<osmium::MemoryMapping> m_mapping;
         std::vector<std::size_t> m_index;
         std::size_t m_count_items = 0;
         std::size_t m_count_removed = 0;
@@ -193,21 +200,75 @@ namespace osmium {
             return m_buffer.capacity() - m_buffer.committed() < 10 * 1024; // *4
         }
 
+        // Round up to a multiple of the initial buffer size. This is also
+        // a multiple of the alignment needed for the buffer.
+        static std::size_t file_buffer_size(std::size_t size) noexcept {
+            return (size + initial_buffer_size - 1) / initial_buffer_size * initial_buffer_size;
+        }
+
+        // Make sure there is enough space for an item of the specified
+        // size in the buffer if it is backed by a file. The file mapping
+        // is grown as needed.
+        void reserve_in_file(std::size_t size) {
+            const std::size_t committed = m_buffer.committed();
+            if (m_buffer.capacity() - committed >= size) {
+                return;
+            }
+            const std::size_t new_capacity = file_buffer_size(std::max(m_buffer.capacity() * 2, committed + size));
+            m_mapping->resize(new_capacity);
+            m_buffer = osmium::memory::Buffer{m_mapping->get_addr<unsigned char>(), new_capacity, committed};
+        }
+
     public:
 
         ItemStash() :
             m_buffer(initial_buffer_size, osmium::memory::Buffer::auto_grow::yes) {
         }
 
+        /**
+         * Keep the items in the given file instead of in memory. The file
+         * is memory mapped and grown as needed. The operating system
+         * keeps the parts of the file used recently in memory and writes
+         * the rest out to disk when the memory gets tight. This allows
+         * stashing more items than would fit into memory. The index from
+         * handles to items (one std::size_t per item) is still kept in
+         * memory.
+         *
+         * Items already in the stash are copied into the file, all
+         * handles stay valid.
+         *
+         * Complexity: Linear in the size of the items in the stash.
+         *
+         * @param fd File descriptor of a file opened for reading and
+         *           writing. Usually this is a temporary file created
+         *           with osmium::detail::create_tmp_file(). The file is
+         *           not closed by the ItemStash.
+         * @throws std::system_error if the mapping fails.
+         */
+        void store_in_file(int fd) {
+            const std::size_t committed = m_buffer.committed();
+            const std::size_t capacity = file_buffer_size(std::max(committed * 2, static_cast<std::size_t>(initial_buffer_size)));
+            std::unique_ptr<osmium::MemoryMapping> mapping{new osmium::MemoryMapping{capacity, osmium::MemoryMapping::mapping_mode::write_shared, fd}};
+            std::copy_n(m_buffer.data(), committed, mapping->get_addr<unsigned char>());
+            m_buffer = osmium::memory::Buffer{mapping->get_addr<unsigned char>(), capacity, committed};
+            m_mapping = std::move(mapping);
+        }
+
+        /// Are the items kept in a file? See store_in_file().
+        bool stored_in_file() const noexcept {
+            return m_mapping != nullptr;
+        }
+
         /**
          * Return an estimate of the number of bytes currently used by this
-         * ItemStash instance.
+         * ItemStash instance. If the items are kept in a file, the memory
+         * for the file mapping is not included.
          *
          * Complexity: Constant.
          */
         std::size_t used_memory() const noexcept {
             return sizeof(ItemStash) +
-                   m_buffer.capacity() +
+                   (m_mapping ? 0 : m_buffer.capacity()) +
                    m_index.capacity() * sizeof(std::size_t);
         }
 
@@ -252,6 +313,9 @@ namespace osmium {
             if (should_gc()) {
                 garbage_collect();
             }
+            if (m_mapping) {
+                reserve_in_file(item.padded_size());
+            }
             ++m_count_items;
             const auto offset = m_buffer.committed();
             m_buffer.add_item(item);
@@ -0,0 +1,296 @@
+#ifndef OSMIUM_THREAD_LOCKFREE_QUEUE_HPP
+#define OSMIUM_THREAD_LOCKFREE_QUEUE_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace osmium {
+
+    namespace thread {
+
+        /**
+         * A bounded, lock-free, thread-safe queue for a single consumer.
+         * It is implemented as a ring buffer where each slot has a sequence
+         * number telling producers and the consumer whether it is free.
+         *
+         * If multi_producer is false, only one thread at a time may push
+         * to the queue (single producer, single consumer), otherwise any
+         * number of threads may push concurrently. Only one thread at a
+         * time may pop from the queue.
+         *
+         * Pushing and popping doesn't take a lock as long as the queue is
+         * neither full nor empty. Threads that have to wait spin for a
+         * short while and then block on a condition variable until they
+         * are woken up by the other side, there is no polling.
+         *
+         * This has the same interface as osmium::thread::Queue. The
+         * type T must be default constructible.
+         */
+        template <typename T, bool multi_producer = false>
+        class LockFreeQueue {
+
+            enum {
+                spin_count = 16,
+                cache_line_size = 64
+            };
+
+            struct slot {
+                std::atomic<std::size_t> sequence{0};
+                T value{};
+            };
+
+            // Keeps head and tail positions on different cache lines so
+            // producers and consumer don't slow each other down.
+            struct padded_position {
+                std::atomic<std::size_t> pos{0};
+                char padding[cache_line_size - sizeof(std::atomic<std::size_t>)];
+            };
+
+            const std::size_t m_mask;
+
+            /// Name of this queue (for debugging only).
+            const std::string m_name;
+
+            std::unique_ptr<slot[]> m_slots;
+
+            /// Position where the next element will be pushed.
+            padded_position m_head;
+
+            /// Position where the next element will be popped from.
+            padded_position m_tail;
+
+            /// Only used for blocking if the queue is full or empty.
+            std::mutex m_mutex;
+
+            /// Used to signal the consumer when data is available.
+            std::condition_variable m_data_available;
+
+            /// Used to signal producers when the queue is not full.
+            std::condition_variable m_space_available;
+
+            std::atomic<bool> m_consumer_waiting{false};
+
+            std::atomic<int> m_producers_waiting{0};
+
+            static std::size_t capacity_for(std::size_t max_size) noexcept {
+                std::size_t capacity = 2;
+                while (capacity < max_size) {
+                    capacity <<= 1u;
+                }
+                return capacity;
+            }
+
+            bool try_push_impl(T& value) {
+                auto pos = m_head.pos.load(std::memory_order_relaxed);
+                slot* s = nullptr;
+                while (true) {
+                    s = &m_slots[pos & m_mask];
+                    const auto seq = s->sequence.load(std::memory_order_acquire);
+                    const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if (diff == 0) {
+                        if (!multi_producer) {
+                            m_head.pos.store(pos + 1, std::memory_order_relaxed);
+                            break;
+                        }
+                        if (m_head.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if (diff < 0) {
+                        return false; // full
+                    } else {
+                        pos = m_head.pos.load(std::memory_order_relaxed);
+                    }
+                }
+
+                s->value = std::move(value);
+                s->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool try_pop_impl(T& value) {
+                const auto pos = m_tail.pos.load(std::memory_order_relaxed);
+                slot& s = m_slots[pos & m_mask];
+                if (s.sequence.load(std::memory_order_acquire) != pos + 1) {
+                    return false; // empty
+                }
+
+                value = std::move(s.value);
+                s.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                m_tail.pos.store(pos + 1, std::memory_order_relaxed);
+                return true;
+            }
+
+            void wake_consumer() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_consumer_waiting.load(std::memory_order_relaxed)) {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_data_available.notify_one();
+                }
+            }
+
+            void wake_producers() {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (m_producers_waiting.load(std::memory_order_relaxed) > 0) {
+                    std::lock_guard<std::mutex> lock{m_mutex};
+                    m_space_available.notify_all();
+                }
+            }
+
+        public:
+
+            /**
+             * Construct a lock-free queue.
+             *
+             * @param max_size Maximum number of elements in the queue. This
+             *                 is rounded up to the next power of two (at
+             *                 least 2). Unlike with the Queue class 0 is not
+             *                 allowed, this queue always has a maximum size.
+             * @param name Optional name for this queue. (Used for debugging.)
+             * @throws std::invalid_argument if max_size is 0.
+             */
+            explicit LockFreeQueue(std::size_t max_size, std::string name = "") :
+                m_mask(capacity_for(max_size) - 1),
+                m_name(std::move(name)),
+                m_slots(new slot[m_mask + 1]) {
+                if (max_size == 0) {
+                    throw std::invalid_argument{"LockFreeQueue needs a maximum size"};
+                }
+                for (std::size_t i = 0; i <= m_mask; ++i) {
+                    m_slots[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            LockFreeQueue(const LockFreeQueue&) = delete;
+            LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+            LockFreeQueue(LockFreeQueue&&) = delete;
+            LockFreeQueue& operator=(LockFreeQueue&&) = delete;
+
+            ~LockFreeQueue() = default;
+
+            /**
+             * Push an element onto the queue. If the queue is full, this
+             * call will block.
+             */
+            void push(T value) {
+                for (int i = 0; i < spin_count; ++i) {
+                    if (try_push_impl(value)) {
+                        wake_consumer();
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+
+                {
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    ++m_producers_waiting;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    while (!try_push_impl(value)) {
+                        m_space_available.wait(lock);
+                    }
+                    --m_producers_waiting;
+                }
+
+                wake_consumer();
+            }
+
+            void wait_and_pop(T& value) {
+                for (int i = 0; i < spin_count; ++i) {
+                    if (try_pop_impl(value)) {
+                        wake_producers();
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+
+                {
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_consumer_waiting = true;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    while (!try_pop_impl(value)) {
+                        m_data_available.wait(lock);
+                    }
+                    m_consumer_waiting = false;
+                }
+
+                wake_producers();
+            }
+
+            bool try_pop(T& value) {
+                if (try_pop_impl(value)) {
+                    wake_producers();
+                    return true;
+                }
+                return false;
+            }
+
+            bool empty() const noexcept {
+                return size() == 0;
+            }
+
+            /**
+             * The number of elements in the queue. This is only a snapshot,
+             * it can change any time if other threads are using the queue.
+             */
+            std::size_t size() const noexcept {
+                const auto tail = m_tail.pos.load(std::memory_order_acquire);
+                const auto head = m_head.pos.load(std::memory_order_acquire);
+                return head > tail ? head - tail : 0;
+            }
+
+            const std::string& name() const noexcept {
+                return m_name;
+            }
+
+            /// The maximum number of elements in this queue.
+            std::size_t capacity() const noexcept {
+                return m_mask + 1;
+            }
+
+        }; // class LockFreeQueue
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_LOCKFREE_QUEUE_HPP
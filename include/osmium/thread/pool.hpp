@@ -35,11 +35,17 @@ DEALINGS IN THE SOFTWARE.
 
 #include <osmium/thread/function_wrapper.hpp>
 #include <osmium/thread/queue.hpp>
+#include <osmium/thread/task_handle.hpp>
 #include <osmium/thread/util.hpp>
 #include <osmium/util/config.hpp>
 
+#include <atomic>
+#include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <type_traits>
 #include <utility>
@@ -84,6 +90,24 @@ namespace osmium {
 
         } // namespace detail
 
+        /**
+         * How tasks are distributed to the threads of a Pool.
+         */
+        enum class pool_scheduling {
+
+            /// Use work stealing if the environment variable
+            /// OSMIUM_POOL_WORK_STEALING is set, a shared queue otherwise.
+            from_config = 0,
+
+            /// All threads take their tasks from one shared queue.
+            shared_queue = 1,
+
+            /// Each thread has its own queue, idle threads steal tasks
+            /// from the queues of the others.
+            work_stealing = 2
+
+        }; // enum class pool_scheduling
+
         /**
          *  Thread pool.
          */
@@ -119,11 +143,50 @@ namespace osmium {
 
             }; // class thread_joiner
 
+            /// Task queue of one thread in a work stealing pool.
+            struct worker_queue {
+                std::mutex mutex;
+                std::deque<function_wrapper> tasks;
+                std::atomic<std::size_t> size{0};
+            };
+
+            /// The worker thread we are running in (if any).
+            struct current_worker {
+                const Pool* pool = nullptr;
+                std::size_t index = 0;
+            };
+
+            static current_worker& this_thread_worker() noexcept {
+                static thread_local current_worker worker;
+                return worker;
+            }
+
+            // Used with shared queue scheduling only.
             osmium::thread::Queue<function_wrapper> m_work_queue;
+
+            // Used with work stealing scheduling only.
+            std::vector<std::unique_ptr<worker_queue>> m_worker_queues;
+            const std::size_t m_max_queue_size;
+            std::atomic<std::size_t> m_next_queue{0};
+            std::atomic<std::size_t> m_pending{0};
+            std::atomic<int> m_sleeping_workers{0};
+            std::atomic<int> m_waiting_submitters{0};
+            std::atomic<bool> m_shutdown{false};
+            std::mutex m_sleep_mutex;
+            std::condition_variable m_work_available;
+            std::condition_variable m_space_available;
+
             std::vector<std::thread> m_threads{};
             thread_joiner m_joiner;
             int m_num_threads;
 
+            static bool use_work_stealing(const pool_scheduling scheduling) noexcept {
+                if (scheduling == pool_scheduling::from_config) {
+                    return osmium::config::use_work_stealing_pool();
+                }
+                return scheduling == pool_scheduling::work_stealing;
+            }
+
             void worker_thread() {
                 osmium::thread::set_thread_name("_osmium_worker");
                 while (true) {
@@ -137,6 +200,122 @@ namespace osmium {
                 }
             }
 
+            /**
+             * Take a task from the queue of the given worker or, if that is
+             * empty, steal one from the queue of another worker. Tasks are
+             * always taken from the front of the queues, so older tasks run
+             * first. That's important because results are usually consumed
+             * in the order the tasks were submitted.
+             */
+            bool take_task(const std::size_t index, function_wrapper& task) {
+                const auto num_queues = m_worker_queues.size();
+                for (std::size_t i = 0; i < num_queues; ++i) {
+                    auto& queue = *m_worker_queues[(index + i) % num_queues];
+                    if (queue.size.load(std::memory_order_relaxed) == 0) {
+                        continue;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock{queue.mutex};
+                        if (queue.tasks.empty()) {
+                            continue;
+                        }
+                        task = std::move(queue.tasks.front());
+                        queue.tasks.pop_front();
+                        --queue.size;
+                    }
+                    --m_pending;
+                    if (m_waiting_submitters.load() > 0) {
+                        std::lock_guard<std::mutex> lock{m_sleep_mutex};
+                        m_space_available.notify_all();
+                    }
+                    return true;
+                }
+                return false;
+            }
+
+            void work_stealing_worker_thread(const std::size_t index) {
+                osmium::thread::set_thread_name("_osmium_worker");
+                this_thread_worker().pool = this;
+                this_thread_worker().index = index;
+
+                while (true) {
+                    function_wrapper task;
+                    if (take_task(index, task)) {
+                        task();
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock{m_sleep_mutex};
+                    ++m_sleeping_workers;
+                    m_work_available.wait(lock, [this] {
+                        return m_pending.load() > 0 || m_shutdown.load();
+                    });
+                    --m_sleeping_workers;
+
+                    // Only shut down after all tasks are done.
+                    if (m_shutdown.load() && m_pending.load() == 0) {
+                        return;
+                    }
+                }
+            }
+
+            // Count a new pending task, waiting until there is space in
+            // the pool. Checking and incrementing the count is one atomic
+            // operation, so several submitting threads can't overfill it.
+            void reserve_pending_slot() {
+                auto pending = m_pending.load();
+                while (true) {
+                    if (pending < m_max_queue_size) {
+                        if (m_pending.compare_exchange_weak(pending, pending + 1)) {
+                            return;
+                        }
+                        continue;
+                    }
+                    std::unique_lock<std::mutex> lock{m_sleep_mutex};
+                    ++m_waiting_submitters;
+                    m_space_available.wait(lock, [this] {
+                        return m_pending.load() < m_max_queue_size;
+                    });
+                    --m_waiting_submitters;
+                    pending = m_pending.load();
+                }
+            }
+
+            void push_task(function_wrapper&& task) {
+                if (m_worker_queues.empty()) {
+                    m_work_queue.push(std::move(task));
+                    return;
+                }
+
+                const auto& worker = this_thread_worker();
+                const bool in_worker = worker.pool == this;
+
+                // Block if the pool is full. Tasks submitted from worker
+                // threads are always accepted to prevent a deadlock.
+                if (in_worker) {
+                    ++m_pending;
+                } else {
+                    reserve_pending_slot();
+                }
+
+                // Tasks submitted from a worker thread go into its own
+                // queue, others are distributed round-robin.
+                const auto index = in_worker ? worker.index
+                                             : m_next_queue++ % m_worker_queues.size();
+                auto& queue = *m_worker_queues[index];
+
+                {
+                    std::lock_guard<std::mutex> lock{queue.mutex};
+                    queue.tasks.push_back(std::move(task));
+                    ++queue.size;
+                }
+
+                if (m_sleeping_workers.load() > 0) {
+                    std::lock_guard<std::mutex> lock{m_sleep_mutex};
+                    m_work_available.notify_one();
+                }
+            }
+
         public:
 
             enum {
@@ -161,15 +340,30 @@ namespace osmium {
              *
              * If max_queue_size is 0, the queue size is read from
              * the environment variable OSMIUM_MAX_WORK_QUEUE_SIZE.
+             *
+             * The scheduling decides whether all threads share one task
+             * queue or whether each thread has its own queue and steals
+             * tasks from the others when idle. With many threads work
+             * stealing avoids contention on the shared queue.
              */
-            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size) :
+            explicit Pool(int num_threads = default_num_threads, std::size_t max_queue_size = default_queue_size, pool_scheduling scheduling = pool_scheduling::from_config) :
                 m_work_queue(max_queue_size > 0 ? max_queue_size : detail::get_work_queue_size(), "work"),
+                m_max_queue_size(max_queue_size > 0 ? max_queue_size : detail::get_work_queue_size()),
                 m_joiner(m_threads),
                 m_num_threads(detail::get_pool_size(num_threads, osmium::config::get_pool_threads(), std::thread::hardware_concurrency())) {
 
                 try {
-                    for (int i = 0; i < m_num_threads; ++i) {
-                        m_threads.emplace_back(&Pool::worker_thread, this);
+                    if (use_work_stealing(scheduling)) {
+                        for (int i = 0; i < m_num_threads; ++i) {
+                            m_worker_queues.emplace_back(new worker_queue{});
+                        }
+                        for (int i = 0; i < m_num_threads; ++i) {
+                            m_threads.emplace_back(&Pool::work_stealing_worker_thread, this, static_cast<std::size_t>(i));
+                        }
+                    } else {
+                        for (int i = 0; i < m_num_threads; ++i) {
+                            m_threads.emplace_back(&Pool::worker_thread, this);
+                        }
                     }
                 } catch (...) {
                     shutdown_all_workers();
@@ -183,6 +377,12 @@ namespace osmium {
             }
 
             void shutdown_all_workers() {
+                if (!m_worker_queues.empty()) {
+                    std::lock_guard<std::mutex> lock{m_sleep_mutex};
+                    m_shutdown = true;
+                    m_work_available.notify_all();
+                    return;
+                }
                 for (int i = 0; i < m_num_threads; ++i) {
                     // The special function wrapper makes a worker shut down.
                     m_work_queue.push(function_wrapper{0});
@@ -203,12 +403,20 @@ namespace osmium {
                 return m_num_threads;
             }
 
+            /// Does this pool use work stealing?
+            bool work_stealing() const noexcept {
+                return !m_worker_queues.empty();
+            }
+
             std::size_t queue_size() const {
+                if (work_stealing()) {
+                    return m_pending.load();
+                }
                 return m_work_queue.size();
             }
 
             bool queue_empty() const {
-                return m_work_queue.empty();
+                return queue_size() == 0;
             }
 
             template <typename TFunction>
@@ -217,11 +425,26 @@ namespace osmium {
 
                 std::packaged_task<result_type()> task{std::forward<TFunction>(func)};
                 std::future<result_type> future_result{task.get_future()};
-                m_work_queue.push(std::move(task));
+                push_task(std::move(task));
 
                 return future_result;
             }
 
+            /**
+             * Submit a task to the pool. Like submit(), but returns the
+             * lighter-weight task_handle instead of a std::future.
+             */
+            template <typename TFunction>
+            task_handle<typename std::result_of<TFunction()>::type> submit_task(TFunction&& func) {
+                using result_type = typename std::result_of<TFunction()>::type;
+                using function_type = typename std::decay<TFunction>::type;
+
+                auto state = std::make_shared<detail::task_state<result_type>>();
+                push_task(detail::task_runner<function_type, result_type>{function_type(std::forward<TFunction>(func)), state});
+
+                return task_handle<result_type>{std::move(state)};
+            }
+
         }; // class Pool
 
     } // namespace thread
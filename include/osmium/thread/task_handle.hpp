@@ -0,0 +1,233 @@
+#ifndef OSMIUM_THREAD_TASK_HANDLE_HPP
+#define OSMIUM_THREAD_TASK_HANDLE_HPP
+
+/*
+
+This file is part of Osmium (https://osmcode.org/libosmium).
+
+Copyright 2013-2019 Jochen Topf <jochen@topf.org> and others (see README).
+
+Boost Software License - Version 1.0 - August 17th, 2003
+
+Permission is hereby granted, free of charge, to any person or organization
+obtaining a copy of the software and accompanying documentation covered by
+this license (the "Software") to use, reproduce, display, distribute,
+execute, and transmit the Software, and to prepare derivative works of the
+Software, and to permit third-parties to whom the Software is furnished to
+do so, all subject to the following:
+
+The copyright notices in the Software and this entire statement, including
+the above license grant, this restriction and the following disclaimer,
+must be included in all copies of the Software, in whole or in part, and
+all derivative works of the Software, unless such copies or derivative
+works are solely in the form of machine-executable object code generated by
+a source language processor.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace osmium {
+
+    namespace thread {
+
+        namespace detail {
+
+            /**
+             * The state shared between a task running in a thread pool and
+             * the task_handle for its result.
+             */
+            template <typename T>
+            class task_state {
+
+                static_assert(!std::is_void<T>::value, "Tasks must return a value");
+
+                enum {
+                    spin_count = 16
+                };
+
+                std::atomic<bool> m_ready{false};
+                std::atomic<bool> m_waiting{false};
+
+                // Only used if somebody has to wait for the result.
+                std::mutex m_mutex;
+                std::condition_variable m_result_available;
+
+                T m_value{};
+                std::exception_ptr m_exception{};
+
+                void set_ready() noexcept {
+                    m_ready.store(true, std::memory_order_release);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (m_waiting.load(std::memory_order_relaxed)) {
+                        std::lock_guard<std::mutex> lock{m_mutex};
+                        m_result_available.notify_all();
+                    }
+                }
+
+            public:
+
+                template <typename TFunction>
+                void run(TFunction& func) noexcept {
+                    try {
+                        m_value = func();
+                    } catch (...) {
+                        m_exception = std::current_exception();
+                    }
+                    set_ready();
+                }
+
+                /**
+                 * Called if the task is destroyed without having run. Like
+                 * with std::packaged_task the result is then a
+                 * std::future_error with the broken_promise error code.
+                 */
+                void abandon() noexcept {
+                    m_exception = std::make_exception_ptr(std::future_error{std::future_errc::broken_promise});
+                    set_ready();
+                }
+
+                bool ready() const noexcept {
+                    return m_ready.load(std::memory_order_acquire);
+                }
+
+                void wait() {
+                    for (int i = 0; i < spin_count; ++i) {
+                        if (ready()) {
+                            return;
+                        }
+                        std::this_thread::yield();
+                    }
+
+                    std::unique_lock<std::mutex> lock{m_mutex};
+                    m_waiting = true;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_result_available.wait(lock, [this] {
+                        return ready();
+                    });
+                }
+
+                T get() {
+                    wait();
+                    if (m_exception) {
+                        std::rethrow_exception(m_exception);
+                    }
+                    return std::move(m_value);
+                }
+
+            }; // class task_state
+
+            /**
+             * The function object actually put into the work queue of the
+             * pool. Runs the task and stores its result in the shared state.
+             * If it is destroyed without having run (for instance because
+             * the queue it is in is destroyed), the task is abandoned, so
+             * the handle doesn't wait forever.
+             */
+            template <typename TFunction, typename TResult>
+            class task_runner {
+
+                TFunction m_func;
+                std::shared_ptr<task_state<TResult>> m_state;
+
+            public:
+
+                task_runner(TFunction&& func, std::shared_ptr<task_state<TResult>> state) :
+                    m_func(std::forward<TFunction>(func)),
+                    m_state(std::move(state)) {
+                }
+
+                task_runner(const task_runner&) = delete;
+                task_runner& operator=(const task_runner&) = delete;
+
+                task_runner(task_runner&&) = default;
+                task_runner& operator=(task_runner&&) = delete;
+
+                ~task_runner() noexcept {
+                    if (m_state && !m_state->ready()) {
+                        m_state->abandon();
+                    }
+                }
+
+                void operator()() {
+                    m_state->run(m_func);
+                }
+
+            }; // class task_runner
+
+        } // namespace detail
+
+        /**
+         * Handle for the result of a task submitted to a Pool using
+         * Pool::submit_task(). This is a lighter-weight alternative to the
+         * std::future returned by Pool::submit(): The task and its result
+         * share one allocation and checking for or getting a result that
+         * is already there doesn't need a lock.
+         *
+         * Like std::future, the result can only be retrieved once with
+         * get(). Exceptions thrown by the task are re-thrown by get().
+         */
+        template <typename T>
+        class task_handle {
+
+            std::shared_ptr<detail::task_state<T>> m_state;
+
+        public:
+
+            task_handle() = default;
+
+            explicit task_handle(std::shared_ptr<detail::task_state<T>> state) noexcept :
+                m_state(std::move(state)) {
+            }
+
+            /// Does this handle refer to a task?
+            bool valid() const noexcept {
+                return static_cast<bool>(m_state);
+            }
+
+            /// Has the task finished? The handle must be valid.
+            bool ready() const noexcept {
+                return m_state->ready();
+            }
+
+            /// Wait for the task to finish. The handle must be valid.
+            void wait() const {
+                m_state->wait();
+            }
+
+            /**
+             * Wait for the task to finish and return its result. After
+             * this the handle is not valid any more.
+             *
+             * @throws Any exception thrown by the task.
+             * @throws std::future_error with the broken_promise error code
+             *         if the task was destroyed without having run.
+             */
+            T get() {
+                const auto state = std::move(m_state);
+                return state->get();
+            }
+
+        }; // class task_handle
+
+    } // namespace thread
+
+} // namespace osmium
+
+#endif // OSMIUM_THREAD_TASK_HANDLE_HPP
@@ -50,4 +50,11 @@ DEALINGS IN THE SOFTWARE.
 # define OSMIUM_DEPRECATED
 #endif
 
+// Hint to the CPU that the memory at the address will be read soon
+#if defined(__GNUC__) || defined(__clang__)
+# define OSMIUM_PREFETCH(address) __builtin_prefetch(address)
+#else
+# define OSMIUM_PREFETCH(address)
+#endif
+
 #endif // OSMIUM_UTIL_COMPATIBILITY_HPP
@@ -55,6 +55,32 @@ namespace osmium {
         }
 #endif
 
+        /**
+         * Get a boolean setting from the environment variable with the
+         * given name. The values "on", "true", "yes", and "1" mean true,
+         * "off", "false", "no", and "0" mean false (all case-insensitive).
+         * If the variable isn't set or has any other value, the default
+         * value is returned.
+         */
+        inline bool get_bool_env(const char* name, const bool default_value) noexcept {
+            const auto env = getenv_wrapper(name);
+            if (env) {
+                if (!strcasecmp(env, "on") ||
+                    !strcasecmp(env, "true") ||
+                    !strcasecmp(env, "yes") ||
+                    !strcasecmp(env, "1")) {
+                    return true;
+                }
+                if (!strcasecmp(env, "off") ||
+                    !strcasecmp(env, "false") ||
+                    !strcasecmp(env, "no") ||
+                    !strcasecmp(env, "0")) {
+                    return false;
+                }
+            }
+            return default_value;
+        }
+
     } // namespace detail
 
     namespace config {
@@ -80,6 +106,30 @@ namespace osmium {
             return true;
         }
 
+        inline bool use_pool_threads_for_opl_parsing() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_USE_POOL_THREADS_FOR_OPL_PARSING", true);
+        }
+
+        inline bool use_pool_threads_for_xml_parsing() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_USE_POOL_THREADS_FOR_XML_PARSING", true);
+        }
+
+        inline bool use_pool_threads_for_o5m_parsing() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_USE_POOL_THREADS_FOR_O5M_PARSING", true);
+        }
+
+        inline bool use_pool_threads_for_compression() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_USE_POOL_THREADS_FOR_COMPRESSION", false);
+        }
+
+        inline bool use_pool_threads_for_decompression() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_USE_POOL_THREADS_FOR_DECOMPRESSION", false);
+        }
+
+        inline bool use_work_stealing_pool() noexcept {
+            return osmium::detail::get_bool_env("OSMIUM_POOL_WORK_STEALING", false);
+        }
+
         inline std::size_t get_max_queue_size(const char* queue_name, const std::size_t default_value) noexcept {
             assert(queue_name);
             std::string name{"OSMIUM_MAX_"};
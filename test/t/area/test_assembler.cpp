@@ -1,10 +1,18 @@
 #include "catch.hpp"
 
 #include <osmium/area/assembler.hpp>
+#include <osmium/area/problem_reporter_stream.hpp>
 #include <osmium/builder/attr.hpp>
+#include <osmium/builder/osm_object_builder.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/osm/area.hpp>
 
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
 
 TEST_CASE("Build area from way") {
@@ -141,3 +149,224 @@ TEST_CASE("Build area from way with ignored invalid location") {
     REQUIRE(s.invalid_locations == 1);
 }
 
+
+TEST_CASE("Build area from self-intersecting way") {
+    osmium::memory::Buffer buffer{10240};
+
+    const auto wpos = osmium::builder::add_way(buffer,
+        _id(1),
+        _nodes({
+            {1, {1.0, 1.0}},
+            {2, {2.0, 2.0}},
+            {3, {2.0, 1.0}},
+            {4, {1.0, 2.0}},
+            {1, {1.0, 1.0}}
+        })
+    );
+
+    osmium::area::AssemblerConfig config;
+    config.create_empty_areas = false;
+
+    SECTION("nested loop") {
+        config.sweep_line_intersections = false;
+    }
+
+    SECTION("sweep line") {
+        config.sweep_line_intersections = true;
+    }
+
+    osmium::area::Assembler assembler{config};
+
+    osmium::memory::Buffer area_buffer{10240};
+    REQUIRE_FALSE(assembler(buffer.get<osmium::Way>(wpos), area_buffer));
+    REQUIRE(area_buffer.committed() == 0);
+
+    const auto& s = assembler.stats();
+    REQUIRE(s.from_ways == 1);
+    REQUIRE(s.intersections == 1);
+}
+
+TEST_CASE("Build several areas with the same assembler") {
+    osmium::memory::Buffer buffer{10240};
+
+    const auto wpos1 = osmium::builder::add_way(buffer,
+        _id(1),
+        _nodes({
+            {1, {1.0, 1.0}},
+            {2, {1.0, 2.0}},
+            {3, {2.0, 2.0}},
+            {4, {2.0, 1.0}},
+            {1, {1.0, 1.0}}
+        })
+    );
+
+    const auto wpos2 = osmium::builder::add_way(buffer,
+        _id(2),
+        _nodes({
+            {11, {1.0, 1.0}},
+            {12, {2.0, 2.0}},
+            {13, {2.0, 1.0}},
+            {14, {1.0, 2.0}},
+            {11, {1.0, 1.0}}
+        })
+    );
+
+    const auto wpos3 = osmium::builder::add_way(buffer,
+        _id(3),
+        _nodes({
+            {21, {5.0, 5.0}},
+            {22, {5.0, 6.0}},
+            {23, {6.0, 6.0}},
+            {21, {5.0, 5.0}}
+        })
+    );
+
+    osmium::area::AssemblerConfig config;
+    config.create_empty_areas = false;
+    osmium::area::Assembler assembler{config};
+
+    osmium::memory::Buffer area_buffer{10240};
+
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(assembler(buffer.get<osmium::Way>(wpos1), area_buffer));
+        REQUIRE(assembler.stats().from_ways == 1);
+        REQUIRE(assembler.stats().nodes == 4);
+        REQUIRE(assembler.stats().intersections == 0);
+
+        REQUIRE_FALSE(assembler(buffer.get<osmium::Way>(wpos2), area_buffer));
+        REQUIRE(assembler.stats().from_ways == 1);
+        REQUIRE(assembler.stats().intersections == 1);
+
+        REQUIRE(assembler(buffer.get<osmium::Way>(wpos3), area_buffer));
+        REQUIRE(assembler.stats().from_ways == 1);
+        REQUIRE(assembler.stats().nodes == 3);
+        REQUIRE(assembler.stats().intersections == 0);
+    }
+
+    int count = 0;
+    for (const auto& area : area_buffer.select<osmium::Area>()) {
+        REQUIRE(area.id() == (count % 2 == 0 ? 2 : 6));
+        const auto it = area.outer_rings().begin();
+        REQUIRE(it != area.outer_rings().end());
+        REQUIRE(it->size() == (count % 2 == 0 ? 5 : 4));
+        REQUIRE(area.inner_rings(*it).size() == 0);
+        ++count;
+    }
+    REQUIRE(count == 6);
+}
+
+static void check_same_area(const osmium::Area& a, const osmium::Area& b) {
+    REQUIRE(a.id() == b.id());
+    REQUIRE(a.version() == b.version());
+    REQUIRE(a.tags().size() == b.tags().size());
+    REQUIRE(std::string{a.tags()["building"]} == std::string{b.tags()["building"]});
+
+    const auto rings = a.num_rings();
+    REQUIRE(rings == b.num_rings());
+    REQUIRE(rings.first == 1);
+    REQUIRE(rings.second == 0);
+
+    const auto& ring_a = *a.outer_rings().begin();
+    const auto& ring_b = *b.outer_rings().begin();
+    REQUIRE(ring_a.size() == ring_b.size());
+    for (std::size_t i = 0; i < ring_a.size(); ++i) {
+        REQUIRE(ring_a[i].ref() == ring_b[i].ref());
+        REQUIRE(ring_a[i].location() == ring_b[i].location());
+    }
+}
+
+TEST_CASE("Build area from simple way with and without the fast path") {
+    const std::vector<std::vector<std::pair<double, double>>> polygons = {
+        {{1.0, 1.0}, {1.0, 2.0}, {2.0, 2.0}, {2.0, 1.0}},
+        {{2.0, 2.0}, {2.0, 1.0}, {1.0, 1.0}, {1.0, 2.0}},
+        {{3.0, 1.0}, {3.0, 3.0}, {2.0, 3.0}, {2.0, 2.0}, {1.0, 2.0}, {1.0, 1.0}},
+        {{1.0, 1.0}, {3.0, 1.0}, {3.0, 3.0}, {2.0, 1.5}, {1.0, 3.0}},
+        {{1.0, 2.0}, {2.0, 1.0}, {3.0, 2.0}}
+    };
+
+    osmium::memory::Buffer buffer{10240};
+    osmium::object_id_type way_id = 0;
+    for (const auto& polygon : polygons) {
+        // Each polygon in both directions and starting at each node
+        for (int direction = 0; direction < 2; ++direction) {
+            for (std::size_t start = 0; start < polygon.size(); ++start) {
+                {
+                    osmium::builder::WayBuilder builder{buffer};
+                    builder.set_id(++way_id);
+                    builder.set_version(3);
+                    builder.add_tags({{"building", "yes"}});
+                    osmium::builder::WayNodeListBuilder wnl_builder{builder};
+                    for (std::size_t i = 0; i <= polygon.size(); ++i) {
+                        std::size_t n = (start + i) % polygon.size();
+                        if (direction == 1) {
+                            n = polygon.size() - 1 - n;
+                        }
+                        wnl_builder.add_node_ref(static_cast<osmium::object_id_type>(n + 1),
+                                                 osmium::Location{polygon[n].first, polygon[n].second});
+                    }
+                }
+                buffer.commit();
+            }
+        }
+    }
+
+    osmium::area::AssemblerConfig config;
+    osmium::area::Assembler assembler{config};
+
+    // The fast path is not used if there is a problem reporter.
+    std::stringstream ss;
+    osmium::area::ProblemReporterStream problem_reporter{ss};
+    osmium::area::AssemblerConfig config_full{&problem_reporter};
+    osmium::area::Assembler assembler_full{config_full};
+
+    for (const auto& way : buffer.select<osmium::Way>()) {
+        osmium::memory::Buffer area_buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+        REQUIRE(assembler(way, area_buffer));
+        const auto& s = assembler.stats();
+        REQUIRE(s.area_simple_way_case == 1);
+
+        osmium::memory::Buffer area_buffer_full{1024, osmium::memory::Buffer::auto_grow::yes};
+        REQUIRE(assembler_full(way, area_buffer_full));
+        const auto& s_full = assembler_full.stats();
+        REQUIRE(s_full.area_simple_way_case == 0);
+
+        check_same_area(area_buffer.get<osmium::Area>(0), area_buffer_full.get<osmium::Area>(0));
+
+        REQUIRE(s.area_simple_case == s_full.area_simple_case);
+        REQUIRE(s.from_ways == s_full.from_ways);
+        REQUIRE(s.nodes == s_full.nodes);
+        REQUIRE(s.outer_rings == s_full.outer_rings);
+        REQUIRE(s.inner_rings == s_full.inner_rings);
+    }
+    REQUIRE(ss.str().empty());
+}
+
+TEST_CASE("Build area from way touching itself") {
+    osmium::memory::Buffer buffer{10240};
+
+    const auto wpos = osmium::builder::add_way(buffer,
+        _id(1),
+        _nodes({
+            {1, {1.0, 1.0}},
+            {2, {2.0, 1.0}},
+            {3, {2.0, 2.0}},
+            {4, {3.0, 2.0}},
+            {5, {3.0, 3.0}},
+            {3, {2.0, 2.0}},
+            {6, {1.0, 2.0}},
+            {1, {1.0, 1.0}}
+        })
+    );
+
+    osmium::area::AssemblerConfig config;
+    osmium::area::Assembler assembler{config};
+
+    osmium::memory::Buffer area_buffer{10240};
+    REQUIRE(assembler(buffer.get<osmium::Way>(wpos), area_buffer));
+
+    const auto& s = assembler.stats();
+    REQUIRE(s.area_simple_way_case == 0);
+    REQUIRE(s.from_ways == 1);
+    REQUIRE(s.nodes == 7);
+    REQUIRE(s.outer_rings == 2);
+}
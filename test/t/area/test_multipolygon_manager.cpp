@@ -0,0 +1,207 @@
+#include "catch.hpp"
+
+#include <osmium/area/assembler.hpp>
+#include <osmium/area/multipolygon_manager.hpp>
+#include <osmium/builder/attr.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/area.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/visitor.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+namespace {
+
+    // Square with lower left corner at (x, y) and size 1 made up of one
+    // closed way.
+    void add_closed_way(osmium::memory::Buffer& buffer, osmium::object_id_type id, double x, double y) {
+        const osmium::object_id_type n = id * 10;
+        osmium::builder::add_way(buffer,
+            _id(id),
+            _tag("building", "yes"),
+            _nodes({
+                {n + 1, {x,       y      }},
+                {n + 2, {x,       y + 1.0}},
+                {n + 3, {x + 1.0, y + 1.0}},
+                {n + 4, {x + 1.0, y      }},
+                {n + 1, {x,       y      }}
+            })
+        );
+    }
+
+    // Square made up of two ways for a multipolygon relation.
+    void add_two_ways(osmium::memory::Buffer& buffer, osmium::object_id_type id, double x, double y) {
+        const osmium::object_id_type n = id * 10;
+        osmium::builder::add_way(buffer,
+            _id(id),
+            _nodes({
+                {n + 1, {x,       y      }},
+                {n + 2, {x,       y + 1.0}},
+                {n + 3, {x + 1.0, y + 1.0}}
+            })
+        );
+        osmium::builder::add_way(buffer,
+            _id(id + 1),
+            _nodes({
+                {n + 3, {x + 1.0, y + 1.0}},
+                {n + 4, {x + 1.0, y      }},
+                {n + 1, {x,       y      }}
+            })
+        );
+    }
+
+    osmium::memory::Buffer create_input() {
+        osmium::memory::Buffer buffer{10240, osmium::memory::Buffer::auto_grow::yes};
+
+        for (osmium::object_id_type id = 1; id < 2000; id += 2) {
+            add_two_ways(buffer, id, static_cast<double>(id % 100), static_cast<double>((id / 100) % 80));
+        }
+        for (osmium::object_id_type id = 2001; id < 12000; ++id) {
+            add_closed_way(buffer, id, static_cast<double>(id % 100), static_cast<double>((id / 100) % 80));
+        }
+        // not closed, no area
+        osmium::builder::add_way(buffer, _id(12000), _tag("building", "yes"), _nodes({{1, {1.0, 1.0}}, {2, {2.0, 1.0}}, {3, {2.0, 2.0}}, {4, {1.0, 2.0}}}));
+
+        for (osmium::object_id_type id = 1; id < 2000; id += 2) {
+            osmium::builder::add_relation(buffer,
+                _id(id),
+                _tag("type", "multipolygon"),
+                _tag("landuse", "forest"),
+                _member(osmium::item_type::way, id, "outer"),
+                _member(osmium::item_type::way, id + 1, "outer")
+            );
+        }
+
+        return buffer;
+    }
+
+    // Assembler which adds up the stats from all its runs. It must not
+    // be re-used for several areas.
+    class SummingAssembler {
+
+        osmium::area::Assembler m_assembler;
+        osmium::area::area_stats m_stats;
+
+    public:
+
+        using config_type = osmium::area::Assembler::config_type;
+
+        explicit SummingAssembler(const config_type& config) :
+            m_assembler(config) {
+        }
+
+        bool operator()(const osmium::Way& way, osmium::memory::Buffer& out_buffer) {
+            const bool result = m_assembler(way, out_buffer);
+            m_stats += m_assembler.stats();
+            return result;
+        }
+
+        bool operator()(const osmium::Relation& relation, const std::vector<const osmium::Way*>& members, osmium::memory::Buffer& out_buffer) {
+            const bool result = m_assembler(relation, members, out_buffer);
+            m_stats += m_assembler.stats();
+            return result;
+        }
+
+        const osmium::area::area_stats& stats() const noexcept {
+            return m_stats;
+        }
+
+    }; // class SummingAssembler
+
+    template <typename TAssembler = osmium::area::Assembler>
+    std::vector<std::string> build_areas(const osmium::memory::Buffer& input, osmium::thread::Pool* pool, osmium::area::area_stats& stats) {
+        typename TAssembler::config_type config;
+        osmium::area::MultipolygonManager<TAssembler> manager{config};
+
+        for (const auto& relation : input.select<osmium::Relation>()) {
+            manager.relation(relation);
+        }
+        manager.prepare_for_lookup();
+
+        if (pool) {
+            manager.assemble_in_pool(*pool, 2);
+        }
+
+        std::vector<std::string> areas;
+        std::size_t callback_calls = 0;
+        osmium::apply(input, manager.handler([&](osmium::memory::Buffer&& buffer) {
+            ++callback_calls;
+            for (const auto& area : buffer.select<osmium::Area>()) {
+                const auto& ring = *area.outer_rings().begin();
+                areas.push_back(std::to_string(area.id()) + " " + area.tags().begin()->key() + " " + std::to_string(ring.size()));
+            }
+        }));
+        REQUIRE(callback_calls > 0);
+
+        stats = manager.stats();
+        return areas;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("MultipolygonManager assembling in thread pool gives same result") {
+    const auto input = create_input();
+
+    osmium::area::area_stats stats_serial;
+    const auto areas_serial = build_areas(input, nullptr, stats_serial);
+
+    REQUIRE(areas_serial.size() == 1000 + 9999);
+    REQUIRE(areas_serial.front() == "3 landuse 5");
+    REQUIRE(areas_serial.back() == "23998 building 5");
+    REQUIRE(stats_serial.from_relations == 1000);
+    REQUIRE(stats_serial.from_ways == 9999);
+
+    osmium::thread::Pool pool{2};
+    osmium::area::area_stats stats_parallel;
+    const auto areas_parallel = build_areas(input, &pool, stats_parallel);
+
+    REQUIRE(areas_parallel == areas_serial);
+    REQUIRE(stats_parallel.from_relations == stats_serial.from_relations);
+    REQUIRE(stats_parallel.from_ways == stats_serial.from_ways);
+    REQUIRE(stats_parallel.nodes == stats_serial.nodes);
+    REQUIRE(stats_parallel.area_simple_case == stats_serial.area_simple_case);
+}
+
+TEST_CASE("MultipolygonManager uses new assembler for each area if it is not reusable") {
+    static_assert(osmium::area::is_reusable_assembler<osmium::area::Assembler>::value, "Assembler is reusable");
+    static_assert(!osmium::area::is_reusable_assembler<SummingAssembler>::value, "SummingAssembler is not reusable");
+
+    const auto input = create_input();
+
+    osmium::area::area_stats stats;
+    const auto areas = build_areas<SummingAssembler>(input, nullptr, stats);
+    REQUIRE(areas.size() == 1000 + 9999);
+    REQUIRE(stats.from_relations == 1000);
+    REQUIRE(stats.from_ways == 9999);
+
+    osmium::thread::Pool pool{2};
+    osmium::area::area_stats stats_parallel;
+    const auto areas_parallel = build_areas<SummingAssembler>(input, &pool, stats_parallel);
+    REQUIRE(areas_parallel == areas);
+    REQUIRE(stats_parallel.from_relations == 1000);
+    REQUIRE(stats_parallel.from_ways == 9999);
+}
+
+TEST_CASE("MultipolygonManager destroyed while areas are assembled in thread pool") {
+    const auto input = create_input();
+
+    osmium::thread::Pool pool{2};
+    osmium::area::Assembler::config_type config;
+    {
+        osmium::area::MultipolygonManager<osmium::area::Assembler> manager{config};
+        for (const auto& relation : input.select<osmium::Relation>()) {
+            manager.relation(relation);
+        }
+        manager.prepare_for_lookup();
+        manager.assemble_in_pool(pool, 100);
+
+        auto& handler = manager.handler();
+        for (const auto& way : input.select<osmium::Way>()) {
+            handler.way(way);
+        }
+        REQUIRE(manager.stats().from_ways < 9999);
+    }
+}
@@ -0,0 +1,145 @@
+#include "catch.hpp"
+
+#include <osmium/area/detail/segment_list.hpp>
+#include <osmium/area/problem_reporter.hpp>
+#include <osmium/builder/attr.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/way.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+using namespace osmium::builder::attr; // NOLINT(google-build-using-namespace)
+
+namespace {
+
+    using intersection_type = std::tuple<osmium::object_id_type, osmium::Location, osmium::Location,
+                                         osmium::object_id_type, osmium::Location, osmium::Location,
+                                         osmium::Location>;
+
+    class RecordingProblemReporter : public osmium::area::ProblemReporter {
+
+    public:
+
+        std::vector<intersection_type> intersections;
+
+        void report_intersection(osmium::object_id_type way1_id, osmium::Location way1_seg_start, osmium::Location way1_seg_end,
+                                 osmium::object_id_type way2_id, osmium::Location way2_seg_start, osmium::Location way2_seg_end, osmium::Location intersection) override {
+            intersections.emplace_back(way1_id, way1_seg_start, way1_seg_end, way2_id, way2_seg_start, way2_seg_end, intersection);
+        }
+
+    }; // class RecordingProblemReporter
+
+    // Simple deterministic pseudo random numbers
+    class Random {
+
+        uint32_t m_state;
+
+    public:
+
+        explicit Random(uint32_t seed) :
+            m_state(seed) {
+        }
+
+        int32_t operator()(int32_t max) {
+            m_state = m_state * 1103515245U + 12345U;
+            return static_cast<int32_t>((m_state >> 8U) % static_cast<uint32_t>(max));
+        }
+
+    }; // class Random
+
+    // Add ways with random segments. Most segments are short, some long.
+    void add_random_ways(osmium::memory::Buffer& buffer, int num_ways, int num_nodes, uint32_t seed) {
+        Random random{seed};
+        osmium::object_id_type node_id = 1;
+        for (int w = 1; w <= num_ways; ++w) {
+            std::vector<osmium::NodeRef> nodes;
+            int32_t x = random(100000);
+            int32_t y = random(100000);
+            for (int n = 0; n < num_nodes; ++n) {
+                const int32_t step = random(10) == 0 ? 20000 : 2000;
+                x += random(2 * step) - step;
+                y += random(2 * step) - step;
+                nodes.emplace_back(node_id++, osmium::Location{x, y});
+            }
+            osmium::builder::add_way(buffer, _id(w), _nodes(nodes));
+        }
+    }
+
+    uint32_t find_intersections(const osmium::memory::Buffer& buffer, RecordingProblemReporter& reporter, bool sweep_line) {
+        osmium::area::detail::SegmentList segment_list{false};
+        uint64_t duplicate_nodes = 0;
+        for (const auto& way : buffer.select<osmium::Way>()) {
+            segment_list.extract_segments_from_way(nullptr, duplicate_nodes, way);
+        }
+        segment_list.sort();
+        uint64_t duplicate_segments = 0;
+        uint64_t overlapping_segments = 0;
+        segment_list.erase_duplicate_segments(nullptr, duplicate_segments, overlapping_segments);
+
+        if (sweep_line) {
+            return segment_list.find_intersections_sweep_line(&reporter);
+        }
+        return segment_list.find_intersections(&reporter);
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Sweep line finds the same intersections as nested loop") {
+    osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+
+    SECTION("few segments") {
+        add_random_ways(buffer, 3, 10, 17);
+    }
+
+    SECTION("many segments") {
+        add_random_ways(buffer, 20, 500, 42);
+    }
+
+    SECTION("long segments spanning all others") {
+        add_random_ways(buffer, 20, 500, 7);
+        osmium::builder::add_way(buffer, _id(1000), _nodes({
+            {1000000, osmium::Location{-1000000, -1000000}},
+            {1000001, osmium::Location{ 1000000,  1000000}}
+        }));
+        osmium::builder::add_way(buffer, _id(1001), _nodes({
+            {1000002, osmium::Location{-1000000,  1000000}},
+            {1000003, osmium::Location{ 1000000, -1000000}}
+        }));
+    }
+
+    RecordingProblemReporter nested;
+    RecordingProblemReporter sweep;
+
+    const auto count_nested = find_intersections(buffer, nested, false);
+    const auto count_sweep = find_intersections(buffer, sweep, true);
+
+    REQUIRE(count_nested > 0);
+    REQUIRE(count_nested == nested.intersections.size());
+    REQUIRE(count_sweep == count_nested);
+    REQUIRE(sweep.intersections == nested.intersections);
+}
+
+TEST_CASE("Sweep line with no segments or no intersections") {
+    osmium::memory::Buffer buffer{10240};
+
+    RecordingProblemReporter reporter;
+    REQUIRE(find_intersections(buffer, reporter, true) == 0);
+
+    osmium::builder::add_way(buffer,
+        _id(1),
+        _nodes({
+            {1, {1.0, 1.0}},
+            {2, {1.0, 2.0}},
+            {3, {2.0, 2.0}},
+            {4, {2.0, 1.0}},
+            {1, {1.0, 1.0}}
+        })
+    );
+
+    REQUIRE(find_intersections(buffer, reporter, true) == 0);
+    REQUIRE(reporter.intersections.empty());
+}
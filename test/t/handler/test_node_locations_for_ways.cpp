@@ -0,0 +1,237 @@
+#include "catch.hpp"
+
+#include <osmium/handler/node_locations_for_ways.hpp>
+#include <osmium/handler/parallel_node_locations_for_ways.hpp>
+#include <osmium/index/map/dense_compressed_mem.hpp>
+#include <osmium/index/map/dense_mem_array.hpp>
+#include <osmium/index/map/flex_mem.hpp>
+#include <osmium/index/map/sparse_mem_array.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/opl.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/visitor.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using index_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
+
+static osmium::memory::Buffer create_buffer() {
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+
+    REQUIRE(osmium::opl_parse("n-3 x-1 y-1", buffer));
+    for (int i = 1; i <= 1000; ++i) {
+        const std::string node = "n" + std::to_string(i * 7) + " x" + std::to_string(i % 180) + " y" + std::to_string(i % 90);
+        REQUIRE(osmium::opl_parse(node.c_str(), buffer));
+    }
+
+    REQUIRE(osmium::opl_parse("w1 Nn7,n14,n21,n7", buffer));
+    REQUIRE(osmium::opl_parse("w2 Nn7000,n-3,n700", buffer));
+    std::string long_way = "w3 N";
+    for (int i = 1000; i > 0; i -= 3) {
+        long_way += "n" + std::to_string(i * 7) + ",";
+    }
+    long_way.pop_back();
+    REQUIRE(osmium::opl_parse(long_way.c_str(), buffer));
+
+    return buffer;
+}
+
+static void check_ways(const osmium::memory::Buffer& buffer) {
+    int count = 0;
+    for (const auto& way : buffer.select<osmium::Way>()) {
+        for (const auto& node_ref : way.nodes()) {
+            if (node_ref.ref() < 0) {
+                REQUIRE(node_ref.location() == osmium::Location(-1.0, -1.0));
+            } else {
+                const auto i = node_ref.ref() / 7;
+                REQUIRE(node_ref.location() == osmium::Location(static_cast<double>(i % 180), static_cast<double>(i % 90)));
+            }
+            ++count;
+        }
+    }
+    REQUIRE(count == 4 + 3 + 334);
+}
+
+template <typename TIndex>
+static void test_index() {
+    TIndex index_pos;
+    TIndex index_neg;
+    osmium::handler::NodeLocationsForWays<TIndex, TIndex> handler{index_pos, index_neg};
+
+    SECTION("Using apply") {
+        auto buffer = create_buffer();
+        osmium::apply(buffer, handler);
+        check_ways(buffer);
+    }
+
+    SECTION("Using apply_to_buffer") {
+        auto buffer = create_buffer();
+        handler.apply_to_buffer(buffer);
+        check_ways(buffer);
+    }
+}
+
+TEST_CASE("NodeLocationsForWays with DenseMemArray") {
+    test_index<osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with FlexMem") {
+    test_index<osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with SparseMemArray") {
+    test_index<osmium::index::map::SparseMemArray<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with DenseCompressedMem") {
+    test_index<osmium::index::map::DenseCompressedMem<osmium::unsigned_object_id_type, osmium::Location>>();
+}
+
+TEST_CASE("NodeLocationsForWays with missing locations") {
+    osmium::index::map::FlexMem<osmium::unsigned_object_id_type, osmium::Location> index{true};
+    osmium::handler::NodeLocationsForWays<index_type> handler{index};
+
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    REQUIRE(osmium::opl_parse("n1 x1 y1", buffer));
+    REQUIRE(osmium::opl_parse("w1 Nn1,n2", buffer));
+    REQUIRE(osmium::opl_parse("w2 Nn1", buffer));
+
+    SECTION("Throw") {
+        REQUIRE_THROWS_AS(handler.apply_to_buffer(buffer), const osmium::not_found&);
+    }
+
+    SECTION("Ignore errors") {
+        handler.ignore_errors();
+        handler.apply_to_buffer(buffer);
+        auto it = buffer.select<osmium::Way>().begin();
+        REQUIRE(it->nodes()[0].location() == osmium::Location(1.0, 1.0));
+        REQUIRE_FALSE(it->nodes()[1].location());
+        ++it;
+        REQUIRE(it->nodes()[0].location() == osmium::Location(1.0, 1.0));
+    }
+}
+
+namespace {
+
+    class BufferSource {
+
+        std::vector<osmium::memory::Buffer> m_buffers;
+        std::size_t m_next = 0;
+
+    public:
+
+        void add(osmium::memory::Buffer&& buffer) {
+            m_buffers.push_back(std::move(buffer));
+        }
+
+        osmium::memory::Buffer read() {
+            if (m_next == m_buffers.size()) {
+                return osmium::memory::Buffer{};
+            }
+            return std::move(m_buffers[m_next++]);
+        }
+
+    }; // class BufferSource
+
+} // anonymous namespace
+
+TEST_CASE("ParallelNodeLocationsForWays") {
+    using pos_index_type = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+    pos_index_type index_pos;
+    pos_index_type index_neg;
+
+    {
+        osmium::handler::NodeLocationsForWays<pos_index_type, pos_index_type> handler{index_pos, index_neg};
+        auto buffer = create_buffer();
+        handler.apply_to_buffer(buffer);
+    }
+
+    BufferSource source;
+    for (int i = 0; i < 20; ++i) {
+        osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+        const std::string way = "w" + std::to_string(i + 1) + " Nn" + std::to_string((i + 1) * 7) + ",n-3,n7000";
+        REQUIRE(osmium::opl_parse(way.c_str(), buffer));
+        source.add(std::move(buffer));
+    }
+
+    osmium::thread::Pool pool{2};
+    osmium::handler::ParallelNodeLocationsForWays<BufferSource, pos_index_type, pos_index_type> stage{source, index_pos, index_neg, pool, 3};
+
+    osmium::object_id_type id = 0;
+    while (const osmium::memory::Buffer buffer = stage.read()) {
+        for (const auto& way : buffer.select<osmium::Way>()) {
+            REQUIRE(way.id() == ++id);
+            REQUIRE(way.nodes()[0].location() == osmium::Location(static_cast<double>(id), static_cast<double>(id)));
+            REQUIRE(way.nodes()[1].location() == osmium::Location(-1.0, -1.0));
+            REQUIRE(way.nodes()[2].location() == osmium::Location(100.0, 10.0));
+        }
+    }
+    REQUIRE(id == 20);
+}
+
+TEST_CASE("ParallelNodeLocationsForWays with missing location") {
+    using index_type_concrete = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+    index_type_concrete index;
+    index.set(1, osmium::Location{1.0, 2.0});
+
+    BufferSource source;
+    for (int i = 0; i < 3; ++i) {
+        osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+        REQUIRE(osmium::opl_parse(i == 1 ? "w2 Nn1,n2" : "w1 Nn1", buffer));
+        source.add(std::move(buffer));
+    }
+
+    osmium::thread::Pool pool{2};
+    osmium::handler::ParallelNodeLocationsForWays<BufferSource, index_type_concrete> stage{source, index, pool};
+
+    SECTION("Throw") {
+        REQUIRE(stage.read());
+        REQUIRE_THROWS_AS(stage.read(), const osmium::not_found&);
+        REQUIRE_THROWS_AS(stage.read(), const osmium::not_found&);
+    }
+
+    SECTION("Ignore errors") {
+        stage.ignore_errors();
+        int count = 0;
+        while (const osmium::memory::Buffer buffer = stage.read()) {
+            ++count;
+        }
+        REQUIRE(count == 3);
+    }
+}
+
+TEST_CASE("ParallelNodeLocationsForWays storing nodes in a single pass") {
+    using pos_index_type = osmium::index::map::DenseMemArray<osmium::unsigned_object_id_type, osmium::Location>;
+    pos_index_type index_pos;
+    pos_index_type index_neg;
+
+    BufferSource source;
+    source.add(create_buffer()); // nodes followed by three ways
+    for (int i = 0; i < 20; ++i) {
+        osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+        const std::string way = "w" + std::to_string(i + 4) + " Nn" + std::to_string((i + 1) * 7) + ",n-3,n7000";
+        REQUIRE(osmium::opl_parse(way.c_str(), buffer));
+        source.add(std::move(buffer));
+    }
+
+    osmium::thread::Pool pool{2};
+    osmium::handler::ParallelNodeLocationsForWays<BufferSource, pos_index_type, pos_index_type> stage{source, index_pos, index_neg, pool, 3};
+
+    const osmium::memory::Buffer first = stage.read();
+    REQUIRE(first.select<osmium::Node>().size() == 1001);
+    REQUIRE(first.select<osmium::Way>().size() == 3);
+    REQUIRE(first.select<osmium::Way>().begin()->nodes()[0].location() == osmium::Location(1.0, 1.0));
+
+    osmium::object_id_type id = 3;
+    while (const osmium::memory::Buffer buffer = stage.read()) {
+        for (const auto& way : buffer.select<osmium::Way>()) {
+            REQUIRE(way.id() == ++id);
+            REQUIRE(way.nodes()[0].location() == osmium::Location(static_cast<double>(id - 3), static_cast<double>(id - 3)));
+            REQUIRE(way.nodes()[1].location() == osmium::Location(-1.0, -1.0));
+            REQUIRE(way.nodes()[2].location() == osmium::Location(100.0, 10.0));
+        }
+    }
+    REQUIRE(id == 23);
+}
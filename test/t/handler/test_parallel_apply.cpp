@@ -0,0 +1,197 @@
+#include "catch.hpp"
+
+#include <osmium/handler.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/opl.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/parallel_apply.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    // Source returning buffers with one node or way each.
+    class BufferSource {
+
+        std::vector<osmium::memory::Buffer> m_buffers;
+        std::size_t m_next = 0;
+
+    public:
+
+        explicit BufferSource(int num) {
+            for (int i = 1; i <= num; ++i) {
+                m_buffers.emplace_back(1024);
+                const std::string opl = (i % 3 == 0 ? "w" : "n") + std::to_string(i) + " v1 Tamenity=post_box";
+                osmium::opl_parse(opl.c_str(), m_buffers.back());
+            }
+        }
+
+        osmium::memory::Buffer read() {
+            if (m_next == m_buffers.size()) {
+                return osmium::memory::Buffer{};
+            }
+            return std::move(m_buffers[m_next++]);
+        }
+
+    }; // class BufferSource
+
+    struct CountHandler : public osmium::handler::Handler {
+
+        int nodes = 0;
+        int ways = 0;
+        std::vector<osmium::object_id_type> ids;
+
+        void node(const osmium::Node& node) {
+            ++nodes;
+            ids.push_back(node.id());
+        }
+
+        void way(const osmium::Way& way) {
+            ++ways;
+            ids.push_back(way.id());
+        }
+
+    }; // struct CountHandler
+
+    struct ThrowHandler : public osmium::handler::Handler {
+
+        void way(const osmium::Way& /*way*/) {
+            throw std::runtime_error{"way"};
+        }
+
+    }; // struct ThrowHandler
+
+    // Counts how many nodes handler copies started and finished
+    // handling and throws on ways.
+    struct SlowThrowHandler : public osmium::handler::Handler {
+
+        std::atomic<int>* started;
+        std::atomic<int>* finished;
+
+        SlowThrowHandler(std::atomic<int>* s, std::atomic<int>* f) :
+            started(s),
+            finished(f) {
+        }
+
+        void node(const osmium::Node& /*node*/) {
+            ++*started;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            ++*finished;
+        }
+
+        void way(const osmium::Way& /*way*/) {
+            throw std::runtime_error{"way"};
+        }
+
+    }; // struct SlowThrowHandler
+
+    // Reduce function object which can only be called as lvalue.
+    struct Summer {
+
+        int* sum;
+
+        explicit Summer(int* s) :
+            sum(s) {
+        }
+
+        void operator()(CountHandler&& handler) & {
+            *sum += handler.nodes + handler.ways;
+        }
+
+    }; // struct Summer
+
+} // anonymous namespace
+
+TEST_CASE("Parallel apply with ordered reduce") {
+    osmium::thread::Pool pool{3};
+    BufferSource source{100};
+
+    CountHandler total;
+    osmium::parallel_apply(source, CountHandler{}, [&total](CountHandler&& handler) {
+        total.nodes += handler.nodes;
+        total.ways += handler.ways;
+        total.ids.insert(total.ids.end(), handler.ids.begin(), handler.ids.end());
+    }, pool);
+
+    REQUIRE(total.nodes == 67);
+    REQUIRE(total.ways == 33);
+    REQUIRE(total.ids.size() == 100);
+
+    // reduce is called in order of the buffers
+    bool in_order = true;
+    for (std::size_t i = 0; i < total.ids.size(); ++i) {
+        if (total.ids[i] != static_cast<osmium::object_id_type>(i + 1)) {
+            in_order = false;
+        }
+    }
+    REQUIRE(in_order);
+}
+
+TEST_CASE("Parallel apply with small number of buffers in flight") {
+    osmium::thread::Pool pool{2};
+    BufferSource source{50};
+
+    int count = 0;
+    osmium::parallel_apply(source, CountHandler{}, [&count](CountHandler&& handler) {
+        count += handler.nodes + handler.ways;
+    }, pool, 1);
+
+    REQUIRE(count == 50);
+}
+
+TEST_CASE("Parallel apply without reduce") {
+    BufferSource source{30};
+    std::atomic<int> count{0};
+
+    struct SideEffectHandler : public osmium::handler::Handler {
+        std::atomic<int>* counter;
+
+        explicit SideEffectHandler(std::atomic<int>* c) :
+            counter(c) {
+        }
+
+        void node(const osmium::Node& /*node*/) {
+            ++*counter;
+        }
+    };
+
+    osmium::parallel_apply(source, SideEffectHandler{&count});
+
+    REQUIRE(count == 20);
+}
+
+TEST_CASE("Parallel apply passes on exceptions from handler") {
+    osmium::thread::Pool pool{2};
+    BufferSource source{10};
+
+    REQUIRE_THROWS_AS(osmium::parallel_apply(source, ThrowHandler{}, pool), const std::runtime_error&);
+}
+
+TEST_CASE("Parallel apply waits for running tasks before passing on exceptions") {
+    osmium::thread::Pool pool{2};
+    BufferSource source{20};
+    std::atomic<int> started{0};
+    std::atomic<int> finished{0};
+
+    REQUIRE_THROWS_AS(osmium::parallel_apply(source, SlowThrowHandler{&started, &finished}, [](SlowThrowHandler&& /*handler*/) {}, pool, 8), const std::runtime_error&);
+    REQUIRE(started == finished);
+}
+
+TEST_CASE("Parallel apply with temporary reduce function object") {
+    osmium::thread::Pool pool{2};
+    BufferSource source{30};
+
+    int sum = 0;
+    osmium::parallel_apply(source, CountHandler{}, Summer{&sum}, pool, 2);
+
+    REQUIRE(sum == 30);
+}
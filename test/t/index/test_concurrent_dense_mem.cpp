@@ -0,0 +1,81 @@
+#include "catch.hpp"
+
+#include <osmium/index/map/concurrent_dense_mem.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/types.hpp>
+#include <osmium/thread/pool.hpp>
+
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+using index_type = osmium::index::map::ConcurrentDenseMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+static osmium::Location location(osmium::unsigned_object_id_type id) {
+    return osmium::Location{static_cast<int32_t>(id % 1800), static_cast<int32_t>(id % 900)};
+}
+
+TEST_CASE("ConcurrentDenseMem: set and get") {
+    index_type index{1000000};
+
+    REQUIRE(index.max_id() >= 1000000);
+    REQUIRE(index.size() == 0);
+    REQUIRE_THROWS_AS(index.get(12), const osmium::not_found&);
+
+    index.set(12, location(12));
+    index.set(300000, location(300000));
+
+    REQUIRE(index.get(12) == location(12));
+    REQUIRE(index.get(300000) == location(300000));
+    REQUIRE(index.get_noexcept(13) == osmium::Location{});
+    REQUIRE(index.get_noexcept(200000) == osmium::Location{});
+    REQUIRE(index.get_noexcept(index.max_id() + 1) == osmium::Location{});
+    REQUIRE(index.size() > 300000);
+
+    REQUIRE_THROWS_AS(index.set(index.max_id() + 1, location(1)), const std::out_of_range&);
+
+    index.clear();
+    REQUIRE(index.size() == 0);
+    REQUIRE(index.get_noexcept(12) == osmium::Location{});
+}
+
+TEST_CASE("ConcurrentDenseMem: set from several threads") {
+    const osmium::unsigned_object_id_type max_id = 1000000;
+    const osmium::unsigned_object_id_type ids_per_task = 10000;
+
+    index_type index{max_id};
+    osmium::thread::Pool pool{4};
+
+    // Tasks use interleaved ID ranges, so several of them write into the
+    // same block.
+    std::vector<std::future<bool>> results;
+    for (osmium::unsigned_object_id_type first = 1; first < max_id; first += ids_per_task) {
+        results.push_back(pool.submit([&index, first, ids_per_task]() {
+            for (osmium::unsigned_object_id_type id = first; id < first + ids_per_task; id += 2) {
+                index.set(id, location(id));
+            }
+            return true;
+        }));
+    }
+    for (auto& result : results) {
+        REQUIRE(result.get());
+    }
+
+    for (osmium::unsigned_object_id_type id = 0; id < max_id; ++id) {
+        if (id % 2 == 1) {
+            REQUIRE(index.get(id) == location(id));
+        } else {
+            REQUIRE(index.get_noexcept(id) == osmium::Location{});
+        }
+    }
+
+    std::vector<osmium::unsigned_object_id_type> ids;
+    for (osmium::unsigned_object_id_type id = 0; id < max_id; id += 7) {
+        ids.push_back(id);
+    }
+    std::vector<osmium::Location> locations(ids.size());
+    index.get_many_noexcept(ids.data(), locations.data(), ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        REQUIRE(locations[i] == (ids[i] % 2 == 1 ? location(ids[i]) : osmium::Location{}));
+    }
+}
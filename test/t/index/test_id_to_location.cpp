@@ -1,5 +1,6 @@
 #include "catch.hpp"
 
+#include <osmium/index/map/dense_compressed_mem.hpp>
 #include <osmium/index/map/dense_file_array.hpp>
 #include <osmium/index/map/dense_mem_array.hpp>
 #include <osmium/index/map/dense_mmap_array.hpp>
@@ -65,6 +66,15 @@ void test_func_real(TIndex& index) {
     REQUIRE(loc1 == index.get_noexcept(id1));
     REQUIRE(loc2 == index.get_noexcept(id2));
 
+    const osmium::unsigned_object_id_type ids[] = {0, id2, 5, id1, 100};
+    osmium::Location locations[5];
+    index.get_many_noexcept(ids, locations, 5);
+    REQUIRE(locations[0] == osmium::Location{});
+    REQUIRE(locations[1] == loc2);
+    REQUIRE(locations[2] == osmium::Location{});
+    REQUIRE(locations[3] == loc1);
+    REQUIRE(locations[4] == osmium::Location{});
+
     REQUIRE_THROWS_AS(index.get(0), const osmium::not_found&);
     REQUIRE_THROWS_AS(index.get(1), const osmium::not_found&);
     REQUIRE_THROWS_AS(index.get(5), const osmium::not_found&);
@@ -249,6 +259,72 @@ TEST_CASE("Map Id to location: FlexMem switch") {
     REQUIRE(index.get_noexcept(2000000000) == osmium::Location{});
 }
 
+TEST_CASE("Map Id to location: DenseCompressedMem") {
+    using index_type = osmium::index::map::DenseCompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    index_type index1;
+    test_func_all<index_type>(index1);
+
+    index_type index2;
+    test_func_real<index_type>(index2);
+}
+
+TEST_CASE("Map Id to location: DenseCompressedMem with many blocks") {
+    using index_type = osmium::index::map::DenseCompressedMem<osmium::unsigned_object_id_type, osmium::Location>;
+
+    const auto location = [](osmium::unsigned_object_id_type id) {
+        if (id % 1000 == 0) {
+            // some locations far away from the others
+            return osmium::Location{-1800000000, 900000000};
+        }
+        return osmium::Location{static_cast<int32_t>(id * 3), static_cast<int32_t>(id % 7) - 3};
+    };
+
+    const osmium::unsigned_object_id_type max_id = 100000;
+    std::vector<bool> has_location(max_id + 1000);
+
+    index_type index;
+    for (osmium::unsigned_object_id_type id = 1; id < max_id; id += (id % 5) + 1) {
+        index.set(id, location(id));
+        has_location[id] = true;
+    }
+
+    // write to blocks that have already been compressed
+    index.set(500, location(500));
+    has_location[500] = true;
+    index.set(7, osmium::Location{});
+    has_location[7] = false;
+
+    REQUIRE(index.size() >= max_id);
+
+    const auto check = [&]() {
+        for (osmium::unsigned_object_id_type id = 0; id < has_location.size(); ++id) {
+            if (has_location[id]) {
+                REQUIRE(index.get(id) == location(id));
+            } else {
+                REQUIRE(index.get_noexcept(id) == osmium::Location{});
+            }
+        }
+    };
+
+    check();
+
+    std::vector<osmium::unsigned_object_id_type> ids;
+    for (osmium::unsigned_object_id_type id = 0; id < has_location.size(); id += 3) {
+        ids.push_back(id);
+    }
+    std::vector<osmium::Location> locations(ids.size());
+    index.get_many_noexcept(ids.data(), locations.data(), ids.size());
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        REQUIRE(locations[i] == (has_location[ids[i]] ? location(ids[i]) : osmium::Location{}));
+    }
+
+    index.sort();
+    check();
+
+    REQUIRE(index.used_memory() < max_id * sizeof(osmium::Location) / 2);
+}
+
 TEST_CASE("Map Id to location: Dynamic map choice") {
     using map_type = osmium::index::map::Map<osmium::unsigned_object_id_type, osmium::Location>;
     const auto& map_factory = osmium::index::MapFactory<osmium::unsigned_object_id_type, osmium::Location>::instance();
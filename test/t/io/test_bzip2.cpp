@@ -4,9 +4,93 @@
 
 #include <osmium/io/bzip2_compression.hpp>
 #include <osmium/io/detail/read_write.hpp>
+#include <osmium/thread/pool.hpp>
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 
+namespace {
+
+    std::string test_data(int lines) {
+        std::string data;
+        for (int i = 0; i < lines; ++i) {
+            data += "n" + std::to_string(i) + " v" + std::to_string(i % 7) + " x" + std::to_string(i * 31 % 1000) + " y" + std::to_string(i * 17 % 997) + "\n";
+        }
+        return data;
+    }
+
+    std::string bzip2_compress(std::string data, int block_size) {
+        std::string output(data.size() + data.size() / 100 + 600, '\0');
+        auto size = static_cast<unsigned int>(output.size());
+        REQUIRE(BZ2_bzBuffToBuffCompress(&*output.begin(), &size, &*data.begin(), static_cast<unsigned int>(data.size()), block_size, 0, 0) == BZ_OK);
+        output.resize(size);
+        return output;
+    }
+
+    // Create data which only contains bytes from 0x40 to 0x6f chosen so
+    // that the table of used bytes in the header of each bzip2 block
+    // contains the given (48 bit) magic number.
+    std::string data_with_magic_in_block_header(uint64_t magic, std::size_t size) {
+        std::string bytes;
+        for (unsigned int range = 0; range < 3; ++range) {
+            const auto bits = static_cast<unsigned int>(magic >> (32u - range * 16u)) & 0xffffu;
+            for (unsigned int i = 0; i < 16; ++i) {
+                if (bits & (0x8000u >> i)) {
+                    bytes += static_cast<char>(0x40u + range * 16u + i);
+                }
+            }
+        }
+
+        std::string data;
+        uint32_t random = 1;
+        std::size_t index = 0;
+        while (data.size() < size) {
+            random = random * 1103515245u + 12345u;
+            const auto next = (random >> 16u) % bytes.size();
+            // avoid runs which would be encoded with other bytes
+            index = (next == index) ? (next + 1) % bytes.size() : next;
+            data += bytes[index];
+        }
+        return data;
+    }
+
+    int count_magic(const std::string& compressed, uint64_t magic) {
+        int count = 0;
+        for (uint64_t pos = 0; pos + 48 <= compressed.size() * 8; ++pos) {
+            if (osmium::io::detail::bzip2_get_bits(compressed.data(), pos, 24) == (magic >> 24u) &&
+                osmium::io::detail::bzip2_get_bits(compressed.data(), pos + 24, 24) == (magic & 0xffffffu)) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    void write_streams(const std::string& filename, const std::string& compressed, int count) {
+        const int fd = osmium::io::detail::open_for_writing(filename, osmium::io::overwrite::allow);
+        REQUIRE(fd > 0);
+        for (int i = 0; i < count; ++i) {
+            osmium::io::detail::reliable_write(fd, compressed.data(), compressed.size());
+        }
+        osmium::io::detail::reliable_close(fd);
+    }
+
+    std::string read_parallel(const std::string& filename, osmium::thread::Pool& pool) {
+        const int fd = osmium::io::detail::open_for_reading(filename);
+        REQUIRE(fd > 0);
+
+        std::string all;
+        osmium::io::ParallelBzip2Decompressor decomp{fd, pool};
+        for (std::string data = decomp.read(); !data.empty(); data = decomp.read()) {
+            all += data;
+        }
+        decomp.close();
+        return all;
+    }
+
+} // anonymous namespace
+
 TEST_CASE("Invalid file descriptor of bzip2-compressed file") {
     REQUIRE_THROWS_AS(osmium::io::Bzip2Decompressor{-1}, const std::system_error&);
 }
@@ -134,3 +218,119 @@ TEST_CASE("Write bzip2-compressed file with implicit close") {
     REQUIRE(osmium::file_size(output_file) > 10);
 }
 
+
+TEST_CASE("Parallel decompression: Invalid file descriptor of bzip2-compressed file") {
+    REQUIRE_THROWS_AS(osmium::io::ParallelBzip2Decompressor{-1}, const std::system_error&);
+}
+
+TEST_CASE("Parallel decompression: Empty bzip2-compressed file") {
+    const int count = count_fds();
+
+    const int fd = osmium::io::detail::open_for_reading(with_data_dir("t/io/empty_file"));
+    REQUIRE(fd > 0);
+
+    osmium::io::ParallelBzip2Decompressor decomp{fd};
+    REQUIRE_THROWS_AS(decomp.read(), const osmium::bzip2_error&);
+    decomp.close();
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Parallel decompression: Read bzip2-compressed file") {
+    const int count = count_fds();
+
+    osmium::thread::Pool pool{2};
+    const std::string all = read_parallel(with_data_dir("t/io/data_bzip2.txt.bz2"), pool);
+
+    REQUIRE(all.size() >= 9);
+    REQUIRE(all.substr(0, 8) == "TESTDATA");
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Parallel decompression: Corrupted bzip2-compressed file") {
+    const int fd = osmium::io::detail::open_for_reading(with_data_dir("t/io/corrupt_data_bzip2.txt.bz2"));
+    REQUIRE(fd > 0);
+
+    osmium::io::ParallelBzip2Decompressor decomp{fd};
+    REQUIRE_THROWS_AS(decomp.read(), const osmium::bzip2_error&);
+}
+
+TEST_CASE("Parallel decompression: Read bzip2-compressed file with many blocks and streams") {
+    const std::string data = test_data(100000);
+    const std::string compressed = bzip2_compress(data, 1);
+
+    const std::string output_file = "test_bzip2_parallel.txt.bz2";
+    {
+        const int fd = osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow);
+        REQUIRE(fd > 0);
+        // two streams in one file
+        osmium::io::detail::reliable_write(fd, compressed.data(), compressed.size());
+        osmium::io::detail::reliable_write(fd, compressed.data(), compressed.size());
+        osmium::io::detail::reliable_close(fd);
+    }
+
+    osmium::thread::Pool pool{3};
+    REQUIRE(read_parallel(output_file, pool) == data + data);
+}
+
+TEST_CASE("Parallel decompression: Wrongly split bzip2 blocks are merged") {
+    const std::string data = test_data(1000);
+    const auto compressed = std::make_shared<const std::string>(bzip2_compress(data, 9));
+
+    // find end of the only block in the stream
+    uint64_t eos = 0;
+    for (uint64_t pos = 32; pos + 48 <= compressed->size() * 8; ++pos) {
+        if (osmium::io::detail::bzip2_get_bits(compressed->data(), pos, 24) == (osmium::io::detail::bzip2_eos_magic >> 24u) &&
+            osmium::io::detail::bzip2_get_bits(compressed->data(), pos + 24, 24) == (osmium::io::detail::bzip2_eos_magic & 0xffffffu)) {
+            eos = pos;
+            break;
+        }
+    }
+    REQUIRE(eos > 0);
+
+    osmium::io::detail::bzip2_block block;
+    block.data = compressed;
+    block.start = 32;
+    block.end = eos;
+    block.next = eos;
+    REQUIRE(osmium::io::detail::bzip2_decompress_block(block) == data);
+
+    const uint64_t split = 32 + (eos - 32) / 2 + 3;
+    osmium::io::detail::bzip2_block first{block};
+    first.end = split;
+    first.next = split;
+    osmium::io::detail::bzip2_block second{block};
+    second.start = split;
+
+    REQUIRE_THROWS_AS(osmium::io::detail::bzip2_decompress_block(first), const osmium::bzip2_error&);
+    REQUIRE(osmium::io::detail::bzip2_decompress_block(osmium::io::detail::bzip2_merge_blocks(first, second)) == data);
+}
+
+TEST_CASE("Parallel decompression: Block magic inside compressed data") {
+    const std::string data = data_with_magic_in_block_header(osmium::io::detail::bzip2_block_magic, 250000);
+    const std::string compressed = bzip2_compress(data, 1);
+
+    // three real blocks, each with a fake block magic in it
+    REQUIRE(count_magic(compressed, osmium::io::detail::bzip2_block_magic) == 6);
+
+    const std::string output_file = "test_bzip2_block_magic.txt.bz2";
+    write_streams(output_file, compressed, 2);
+
+    osmium::thread::Pool pool{2};
+    REQUIRE(read_parallel(output_file, pool) == data + data);
+}
+
+TEST_CASE("Parallel decompression: End of stream magic inside compressed data") {
+    const std::string data = data_with_magic_in_block_header(osmium::io::detail::bzip2_eos_magic, 250000);
+    const std::string compressed = bzip2_compress(data, 1);
+
+    // three fake end of stream magics in the blocks and the real one
+    REQUIRE(count_magic(compressed, osmium::io::detail::bzip2_eos_magic) == 4);
+
+    const std::string output_file = "test_bzip2_eos_magic.txt.bz2";
+    write_streams(output_file, compressed, 2);
+
+    osmium::thread::Pool pool{2};
+    REQUIRE(read_parallel(output_file, pool) == data + data);
+}
@@ -1,12 +1,19 @@
 #include "catch.hpp"
 
 #include <osmium/io/compression.hpp>
+#include <osmium/thread/pool.hpp>
 
 TEST_CASE("Create compressor using factory") {
     const auto& factory = osmium::io::CompressionFactory::instance();
     REQUIRE(factory.create_compressor(osmium::io::file_compression::none, -1, osmium::io::fsync::no));
 }
 
+TEST_CASE("Create compressor with thread pool using factory") {
+    const auto& factory = osmium::io::CompressionFactory::instance();
+    osmium::thread::Pool pool{1};
+    REQUIRE(factory.create_compressor(osmium::io::file_compression::none, -1, osmium::io::fsync::no, pool));
+}
+
 TEST_CASE("Create decompressor using factory") {
     const auto& factory = osmium::io::CompressionFactory::instance();
     REQUIRE(factory.create_decompressor(osmium::io::file_compression::none, nullptr, 0));
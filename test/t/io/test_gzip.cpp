@@ -4,9 +4,42 @@
 
 #include <osmium/io/detail/read_write.hpp>
 #include <osmium/io/gzip_compression.hpp>
+#include <osmium/thread/pool.hpp>
 
+#include <algorithm>
 #include <string>
 
+namespace {
+
+    std::string test_data(int lines) {
+        std::string data;
+        for (int i = 0; i < lines; ++i) {
+            data += "n" + std::to_string(i) + " v" + std::to_string(i % 7) + " x" + std::to_string(i * 31 % 1000) + " y" + std::to_string(i * 17 % 997) + "\n";
+        }
+        return data;
+    }
+
+    std::string write_bgzf_file(const std::string& data) {
+        const std::string filename{"test_gzip_bgzf.txt.gz"};
+        const int fd = osmium::io::detail::open_for_writing(filename, osmium::io::overwrite::allow);
+        REQUIRE(fd > 0);
+
+        for (std::size_t pos = 0; pos < data.size(); pos += osmium::io::detail::bgzf_max_input_size) {
+            const auto size = std::min(data.size() - pos, static_cast<std::size_t>(osmium::io::detail::bgzf_max_input_size));
+            const std::string block{osmium::io::detail::bgzf_compress_block(data.data() + pos, size)};
+            osmium::io::detail::reliable_write(fd, block.data(), block.size());
+        }
+
+        // BGZF files end with an empty block
+        const std::string block{osmium::io::detail::bgzf_compress_block(nullptr, 0)};
+        osmium::io::detail::reliable_write(fd, block.data(), block.size());
+        osmium::io::detail::reliable_close(fd);
+
+        return filename;
+    }
+
+} // anonymous namespace
+
 TEST_CASE("Invalid file descriptor of gzip-compressed file") {
     REQUIRE_THROWS_AS(osmium::io::GzipDecompressor{-1}, const osmium::gzip_error&);
 }
@@ -135,3 +168,121 @@ TEST_CASE("Write gzip-compressed file with implicit close") {
     REQUIRE(osmium::file_size(output_file) > 10);
 }
 
+TEST_CASE("Recognize BGZF files") {
+    const int fd1 = osmium::io::detail::open_for_reading(with_data_dir("t/io/data_gzip.txt.gz"));
+    REQUIRE_FALSE(osmium::io::detail::is_bgzf_file(fd1));
+    osmium::io::detail::reliable_close(fd1);
+
+    const int fd2 = osmium::io::detail::open_for_reading(write_bgzf_file("foo"));
+    REQUIRE(osmium::io::detail::is_bgzf_file(fd2));
+    osmium::io::detail::reliable_close(fd2);
+}
+
+TEST_CASE("Read BGZF file with normal gzip decompressor") {
+    const std::string data = test_data(100000);
+    const int fd = osmium::io::detail::open_for_reading(write_bgzf_file(data));
+
+    std::string all;
+    osmium::io::GzipDecompressor decomp{fd};
+    for (std::string chunk = decomp.read(); !chunk.empty(); chunk = decomp.read()) {
+        all += chunk;
+    }
+    decomp.close();
+
+    REQUIRE(all == data);
+}
+
+TEST_CASE("Read BGZF file with parallel gzip decompressor") {
+    const int count = count_fds();
+
+    const std::string data = test_data(100000);
+    const int fd = osmium::io::detail::open_for_reading(write_bgzf_file(data));
+
+    osmium::thread::Pool pool{3};
+    std::string all;
+    osmium::io::ParallelGzipDecompressor decomp{fd, pool};
+    for (std::string chunk = decomp.read(); !chunk.empty(); chunk = decomp.read()) {
+        all += chunk;
+    }
+    decomp.close();
+
+    REQUIRE(all == data);
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Parallel gzip decompressor fails on non-BGZF file") {
+    const int fd = osmium::io::detail::open_for_reading(with_data_dir("t/io/data_gzip.txt.gz"));
+
+    osmium::io::ParallelGzipDecompressor decomp{fd};
+    REQUIRE_THROWS_AS(decomp.read(), const osmium::gzip_error&);
+}
+
+TEST_CASE("Parallel gzip decompressor fails on corrupted BGZF block") {
+    std::string block{osmium::io::detail::bgzf_compress_block("foobarbaz", 9)};
+    REQUIRE(osmium::io::detail::bgzf_decompress_block(block) == "foobarbaz");
+
+    block[block.size() - 6] ^= 0x01; // change CRC
+    REQUIRE_THROWS_AS(osmium::io::detail::bgzf_decompress_block(block), const osmium::gzip_error&);
+}
+
+TEST_CASE("Parallel gzip decompressor fails on BGZF block with huge size") {
+    std::string block{osmium::io::detail::bgzf_compress_block("foobarbaz", 9)};
+    block[block.size() - 1] = static_cast<char>(0xff); // change ISIZE
+    REQUIRE_THROWS_AS(osmium::io::detail::bgzf_decompress_block(block), const osmium::gzip_error&);
+}
+
+TEST_CASE("Parallel compressor: Invalid file descriptor for gzip-compressed file") {
+    REQUIRE_THROWS_AS(osmium::io::ParallelGzipCompressor(-1, osmium::io::fsync::no), const std::system_error&);
+}
+
+TEST_CASE("Write gzip-compressed file with parallel compressor") {
+    const int count = count_fds();
+
+    const std::string data = test_data(200000);
+    const std::string output_file = "test_gzip_parallel_out.txt.gz";
+    {
+        const int fd = osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow);
+        REQUIRE(fd > 0);
+
+        osmium::thread::Pool pool{3};
+        osmium::io::ParallelGzipCompressor comp{fd, osmium::io::fsync::no, Z_DEFAULT_COMPRESSION, pool};
+        // write in pieces of different sizes
+        for (std::size_t pos = 0; pos < data.size(); pos += 100000) {
+            comp.write(data.substr(pos, 100000));
+        }
+        comp.close();
+    }
+    REQUIRE(count == count_fds());
+
+    const int fd = osmium::io::detail::open_for_reading(output_file);
+    REQUIRE(osmium::io::detail::is_bgzf_file(fd));
+
+    std::string all;
+    {
+        osmium::io::GzipDecompressor decomp{fd};
+        for (std::string chunk = decomp.read(); !chunk.empty(); chunk = decomp.read()) {
+            all += chunk;
+        }
+    }
+    REQUIRE(all == data);
+
+    all.clear();
+    {
+        osmium::io::ParallelGzipDecompressor decomp{osmium::io::detail::open_for_reading(output_file)};
+        for (std::string chunk = decomp.read(); !chunk.empty(); chunk = decomp.read()) {
+            all += chunk;
+        }
+    }
+    REQUIRE(all == data);
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Write empty gzip-compressed file with parallel compressor") {
+    const std::string output_file = "test_gzip_parallel_empty.txt.gz";
+    {
+        osmium::io::ParallelGzipCompressor comp{osmium::io::detail::open_for_writing(output_file, osmium::io::overwrite::allow), osmium::io::fsync::yes};
+    }
+
+    osmium::io::GzipDecompressor decomp{osmium::io::detail::open_for_reading(output_file)};
+    REQUIRE(decomp.read().empty());
+}
@@ -0,0 +1,45 @@
+#include "catch.hpp"
+
+#include "utils.hpp"
+
+#define OSMIUM_USE_LOCKFREE_QUEUES
+#include <osmium/io/pbf_input.hpp>
+#include <osmium/io/xml_input.hpp>
+#include <osmium/io/xml_output.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/node.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <utility>
+
+TEST_CASE("Reading and writing files with lock-free queues") {
+    osmium::memory::Buffer buffer = osmium::io::read_file(with_data_dir("t/io/data.osm"));
+    REQUIRE(buffer.committed() > 0);
+
+    const std::string filename{"test-lockfree-queues-out.osm"};
+    osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+    writer(std::move(buffer));
+    writer.close();
+
+    osmium::io::Reader reader{filename};
+    int count = 0;
+    while (const osmium::memory::Buffer read_buffer = reader.read()) {
+        count += static_cast<int>(std::distance(read_buffer.select<osmium::Node>().cbegin(), read_buffer.select<osmium::Node>().cend()));
+    }
+    reader.close();
+
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("Reading PBF file with lock-free queues") {
+    osmium::io::Reader reader{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+    int count = 0;
+    while (const osmium::memory::Buffer buffer = reader.read()) {
+        count += static_cast<int>(std::distance(buffer.select<osmium::Node>().cbegin(), buffer.select<osmium::Node>().cend()));
+    }
+    reader.close();
+
+    REQUIRE(count > 0);
+}
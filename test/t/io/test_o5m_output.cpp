@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/opl_output_format.hpp>
+#include <osmium/io/o5m_input.hpp>
+#include <osmium/io/o5m_output.hpp>
+#include <osmium/io/opl_input.hpp>
+#include <osmium/memory/buffer.hpp>
+#include <osmium/osm/node.hpp>
+
+#include <string>
+#include <utility>
+
+static void write_o5m(const std::string& filename, const std::string& opl, const osmium::io::Header& header = osmium::io::Header{}) {
+    osmium::io::File input_file{opl.data(), opl.size(), "opl"};
+    osmium::io::Reader reader{input_file};
+    osmium::io::Writer writer{filename, header, osmium::io::overwrite::allow};
+    while (auto buffer = reader.read()) {
+        writer(std::move(buffer));
+    }
+    writer.close();
+    reader.close();
+}
+
+static std::string read_as_opl(const std::string& filename, bool diff = false) {
+    osmium::io::Reader reader{filename};
+    osmium::io::detail::opl_output_options options;
+    options.add_metadata = osmium::metadata_options{"all"};
+    options.format_as_diff = diff;
+
+    std::string result;
+    while (auto buffer = reader.read()) {
+        result += osmium::io::detail::OPLOutputBlock{std::move(buffer), options}();
+    }
+    reader.close();
+    return result;
+}
+
+static const std::string data_opl =
+    "n1 v1 dV c10 t2015-01-01T01:00:00Z i1 ufoo T x1 y2\n"
+    "n2 v2 dV c10 t2015-01-01T02:00:00Z i1 ufoo Tamenity=pub,name=The%20%Pub x-1.5 y2.25\n"
+    "n3 v1 dV c12 t2015-01-01T03:00:00Z i2 ubar Tamenity=pub x179.9999999 y-89.9999999\n"
+    "n10 v1 dV c0 t i0 u T x1 y2\n"
+    "w20 v3 dV c13 t2015-01-02T00:00:00Z i0 u Thighway=primary,name=Main%20%Street Nn1,n2,n3,n1\n"
+    "w21 v1 dV c13 t2015-01-02T00:00:00Z i2 ubar T Nn3,n10\n"
+    "r30 v1 dV c14 t2015-01-03T00:00:00Z i1 ufoo Ttype=route Mn1@stop,w20@,w21@,r30@stop,n2@\n";
+
+TEST_CASE("Write and read back o5m file") {
+    write_o5m("test-o5m-output.o5m", data_opl);
+    REQUIRE(read_as_opl("test-o5m-output.o5m") == data_opl);
+}
+
+TEST_CASE("Write o5m file with header") {
+    osmium::io::Header header;
+    header.set("timestamp", "2019-07-01T12:34:56Z");
+    header.add_box(osmium::Box{1.5, -2.0, 3.25, 4.0});
+    write_o5m("test-o5m-output-header.o5m", data_opl, header);
+
+    osmium::io::Reader reader{"test-o5m-output-header.o5m"};
+    const auto& read_header = reader.header();
+    REQUIRE(read_header.get("timestamp") == "2019-07-01T12:34:56Z");
+    REQUIRE(read_header.box() == osmium::Box(1.5, -2.0, 3.25, 4.0));
+    REQUIRE_FALSE(read_header.has_multiple_object_versions());
+    reader.close();
+}
+
+TEST_CASE("Write o5c file with deleted objects") {
+    const std::string change_opl =
+        "n1 v2 dD c20 t2015-02-01T00:00:00Z i1 ufoo T x y\n"
+        "n2 v3 dV c20 t2015-02-01T00:00:00Z i1 ufoo Tamenity=bar x1 y1\n"
+        "w20 v4 dD c20 t2015-02-01T00:00:00Z i1 ufoo T N\n"
+        "r30 v2 dD c20 t2015-02-01T00:00:00Z i1 ufoo T M\n";
+
+    write_o5m("test-o5m-output.o5c", change_opl);
+
+    osmium::io::Reader reader{"test-o5m-output.o5c"};
+    REQUIRE(reader.header().has_multiple_object_versions());
+    reader.close();
+
+    REQUIRE(read_as_opl("test-o5m-output.o5c") == change_opl);
+}
+
+TEST_CASE("Write o5m file without metadata") {
+    osmium::io::File file{"test-o5m-output-nometa.o5m"};
+    file.set("add_metadata", "false");
+
+    const std::string opl = "n1 v1 dV c10 t2015-01-01T01:00:00Z i1 ufoo Tamenity=pub x1 y2\n";
+    osmium::io::File input_file{opl.data(), opl.size(), "opl"};
+    osmium::io::Reader reader{input_file};
+    osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+    writer(reader.read());
+    writer.close();
+    reader.close();
+
+    REQUIRE(read_as_opl("test-o5m-output-nometa.o5m") ==
+            "n1 v0 dV c0 t i0 u Tamenity=pub x1 y2\n");
+}
+
+static std::string write_and_read_with_metadata(const char* add_metadata) {
+    osmium::io::File file{"test-o5m-output-partialmeta.o5m"};
+    file.set("add_metadata", add_metadata);
+
+    const std::string opl = "n1 v3 dV c10 t2015-01-01T01:00:00Z i1 ufoo Tamenity=pub x1 y2\n";
+    osmium::io::File input_file{opl.data(), opl.size(), "opl"};
+    osmium::io::Reader reader{input_file};
+    osmium::io::Writer writer{file, osmium::io::overwrite::allow};
+    writer(reader.read());
+    writer.close();
+    reader.close();
+
+    return read_as_opl("test-o5m-output-partialmeta.o5m");
+}
+
+TEST_CASE("Write o5m file with some metadata") {
+    SECTION("version and timestamp") {
+        REQUIRE(write_and_read_with_metadata("version+timestamp") ==
+                "n1 v3 dV c0 t2015-01-01T01:00:00Z i0 u Tamenity=pub x1 y2\n");
+    }
+
+    SECTION("version, timestamp, and changeset") {
+        REQUIRE(write_and_read_with_metadata("version+timestamp+changeset") ==
+                "n1 v3 dV c10 t2015-01-01T01:00:00Z i0 u Tamenity=pub x1 y2\n");
+    }
+
+    SECTION("version, timestamp, and uid") {
+        REQUIRE(write_and_read_with_metadata("version+timestamp+uid") ==
+                "n1 v3 dV c0 t2015-01-01T01:00:00Z i1 u Tamenity=pub x1 y2\n");
+    }
+
+    SECTION("version only") {
+        REQUIRE(write_and_read_with_metadata("version") ==
+                "n1 v3 dV c0 t i0 u Tamenity=pub x1 y2\n");
+    }
+
+    SECTION("without version there is no place for the other fields") {
+        REQUIRE(write_and_read_with_metadata("timestamp+changeset+uid+user") ==
+                "n1 v0 dV c0 t i0 u Tamenity=pub x1 y2\n");
+    }
+}
+
+TEST_CASE("Write o5m file with more strings than fit into the string table") {
+    std::string opl;
+    for (int i = 1; i <= 40000; ++i) {
+        const auto n = std::to_string(i % 20000);
+        opl += "n" + std::to_string(i) + " v1 dV c1 t2015-01-01T00:00:00Z i" + std::to_string(i % 17000 + 1) +
+               " uuser" + std::to_string(i % 17000) + " Tkey=value" + n + " x1 y1\n";
+    }
+
+    write_o5m("test-o5m-output-strings.o5m", opl);
+    REQUIRE(read_as_opl("test-o5m-output-strings.o5m") == opl);
+}
@@ -0,0 +1,136 @@
+#include "catch.hpp"
+
+#include <osmium/io/o5m_input.hpp>
+#include <osmium/io/reader.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/way.hpp>
+
+#include <protozero/varint.hpp>
+
+#include <iterator>
+#include <string>
+
+static const char o5m_header[] = "\xff\xe0\x04o5m2";
+
+static void add_zvarint(std::string& out, int64_t value) {
+    protozero::write_varint(std::back_inserter(out), protozero::encode_zigzag64(value));
+}
+
+static void add_dataset(std::string& out, char type, const std::string& data) {
+    out += type;
+    protozero::write_varint(std::back_inserter(out), data.size());
+    out += data;
+}
+
+// Add count nodes with consecutive ids starting at first_id. The first node
+// has an inline tag, all others reference it in the string table.
+static void add_nodes(std::string& out, int64_t first_id, int count) {
+    for (int i = 0; i < count; ++i) {
+        std::string node;
+        add_zvarint(node, i == 0 ? first_id : 1);
+        node += '\0'; // no info section
+        add_zvarint(node, i == 0 ? 10 : 0); // lon
+        add_zvarint(node, i == 0 ? 20 : 0); // lat
+        if (i == 0) {
+            node += '\0';
+            node += "highway";
+            node += '\0';
+            node += "primary";
+            node += '\0';
+        } else {
+            node += '\x01';
+        }
+        add_dataset(out, '\x10', node);
+    }
+}
+
+static void check_nodes(const std::string& data, int64_t count) {
+    osmium::io::File file{data.data(), data.size(), "o5m"};
+    osmium::io::Reader reader{file};
+
+    int64_t id = 0;
+    while (const auto buffer = reader.read()) {
+        for (const auto& node : buffer.select<osmium::Node>()) {
+            REQUIRE(node.id() == ++id);
+            REQUIRE(node.location().x() == 10);
+            REQUIRE(node.location().y() == 20);
+            REQUIRE(std::string{node.tags()["highway"]} == "primary");
+        }
+    }
+    reader.close();
+    REQUIRE(id == count);
+}
+
+TEST_CASE("Parse o5m file with many reset points") {
+    std::string data{o5m_header, sizeof(o5m_header) - 1};
+    const int segments = 600;
+    const int nodes_per_segment = 1000;
+    for (int i = 0; i < segments; ++i) {
+        data += '\xff';
+        add_nodes(data, i * nodes_per_segment + 1, nodes_per_segment);
+    }
+    REQUIRE(data.size() > 3 * 1024 * 1024);
+
+    check_nodes(data, segments * nodes_per_segment);
+}
+
+TEST_CASE("Parse o5m file with long segment without reset") {
+    std::string data{o5m_header, sizeof(o5m_header) - 1};
+    data += '\xff';
+    add_nodes(data, 1, 1000);
+    data += '\xff';
+    add_nodes(data, 1001, 1250000);
+    data += '\xff';
+    add_nodes(data, 1251001, 1000);
+    REQUIRE(data.size() > 8 * 1024 * 1024);
+
+    check_nodes(data, 1252000);
+}
+
+TEST_CASE("Parse o5m file reading only some entity types") {
+    std::string data{o5m_header, sizeof(o5m_header) - 1};
+    data += '\xff';
+    add_nodes(data, 1, 10);
+    data += '\xff';
+
+    std::string way;
+    add_zvarint(way, 17);
+    way += '\0'; // no info section
+    std::string refs;
+    add_zvarint(refs, 1);
+    add_zvarint(refs, 1);
+    protozero::write_varint(std::back_inserter(way), refs.size());
+    way += refs;
+    add_dataset(data, '\x11', way);
+
+    osmium::io::File file{data.data(), data.size(), "o5m"};
+    osmium::io::Reader reader{file, osmium::osm_entity_bits::way};
+
+    int count = 0;
+    while (const auto buffer = reader.read()) {
+        REQUIRE(buffer.select<osmium::Node>().size() == 0);
+        for (const auto& w : buffer.select<osmium::Way>()) {
+            REQUIRE(w.id() == 17);
+            REQUIRE(w.nodes().size() == 2);
+            REQUIRE(w.nodes()[1].ref() == 2);
+            ++count;
+        }
+    }
+    reader.close();
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("Parse truncated o5m file") {
+    std::string data{o5m_header, sizeof(o5m_header) - 1};
+    data += '\xff';
+    add_nodes(data, 1, 10);
+    data.resize(data.size() - 2);
+
+    osmium::io::File file{data.data(), data.size(), "o5m"};
+    osmium::io::Reader reader{file};
+
+    REQUIRE_THROWS_AS([&]() {
+        while (reader.read()) {
+        }
+    }(), const osmium::o5m_error&);
+}
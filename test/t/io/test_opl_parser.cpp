@@ -1230,3 +1230,146 @@ TEST_CASE("line_by_line for OPL parser 28") {
     check_lbl({"foo\nb", "ar"}, {"foo", "bar"});
 }
 
+
+class cbl_tester {
+
+    std::vector<std::string> m_inputs;
+    std::vector<std::string> m_outputs;
+
+public:
+
+    cbl_tester(const std::initializer_list<std::string>& inputs,
+               const std::initializer_list<std::string>& outputs) :
+        m_inputs(inputs),
+        m_outputs(outputs) {
+    }
+
+    bool input_done() {
+        return m_inputs.empty();
+    }
+
+    std::string get_input() {
+        REQUIRE_FALSE(m_inputs.empty());
+        std::string data = std::move(m_inputs.front());
+        m_inputs.erase(m_inputs.begin());
+        return data;
+    }
+
+    void parse_chunk(std::string&& data) {
+        REQUIRE_FALSE(m_outputs.empty());
+        REQUIRE(m_outputs.front() == data);
+        m_outputs.erase(m_outputs.begin());
+    }
+
+    void check() {
+        REQUIRE(m_inputs.empty());
+        REQUIRE(m_outputs.empty());
+    }
+
+}; // class cbl_tester
+
+void check_cbl(const std::initializer_list<std::string>& in,
+               const std::initializer_list<std::string>& out) {
+    cbl_tester tester{in, out};
+    osmium::io::detail::chunk_by_lines(tester, 4);
+    tester.check();
+}
+
+TEST_CASE("chunk_by_lines for OPL parser: no input") {
+    check_cbl({}, {});
+}
+
+TEST_CASE("chunk_by_lines for OPL parser: small chunks are merged") {
+    check_cbl({"a\n", "b\n", "c\n"}, {"a\nb\n", "c\n"});
+}
+
+TEST_CASE("chunk_by_lines for OPL parser: chunks end at line boundary") {
+    check_cbl({"foo\nba", "r\nbaz"}, {"foo\n", "bar\n", "baz"});
+}
+
+TEST_CASE("chunk_by_lines for OPL parser: long lines are kept together") {
+    check_cbl({"foo", "bar", "baz\nx"}, {"foobarbaz\n", "x"});
+}
+
+TEST_CASE("chunk_by_lines for OPL parser: CRLF line endings") {
+    check_cbl({"foo\r", "\nbar\r\n"}, {"foo\r", "\nbar\r\n"});
+}
+
+TEST_CASE("Parse OPL chunk") {
+    std::string data{"n1\r\nn2\n\n# comment\nw3\nr4"};
+    oid::OPLChunkParser parser{std::move(data), 0, osmium::osm_entity_bits::all};
+
+    const auto buffer = parser();
+    std::vector<osmium::object_id_type> ids;
+    for (const auto& object : buffer.select<osmium::OSMObject>()) {
+        ids.push_back(object.id());
+    }
+    const std::vector<osmium::object_id_type> expected = {1, 2, 3, 4};
+    REQUIRE(ids == expected);
+}
+
+TEST_CASE("Parse OPL chunk with read_types") {
+    std::string data{"n1\nw2\nn3\n"};
+    oid::OPLChunkParser parser{std::move(data), 0, osmium::osm_entity_bits::way};
+
+    const auto buffer = parser();
+    REQUIRE(std::distance(buffer.begin(), buffer.end()) == 1);
+    REQUIRE(buffer.get<osmium::Way>(0).id() == 2);
+}
+
+TEST_CASE("Parse OPL chunk with error reports line number") {
+    std::string data{"n1\n\nn2\nx3\n"};
+    oid::OPLChunkParser parser{std::move(data), 10, osmium::osm_entity_bits::all};
+
+    try {
+        parser();
+        REQUIRE(false);
+    } catch (const osmium::opl_error& e) {
+        REQUIRE(e.line == 13);
+        REQUIRE(e.column == 0);
+    }
+}
+
+TEST_CASE("Parse OPL with many chunks using Reader") {
+    const int count = 100000;
+    std::string data;
+    for (int i = 1; i <= count; ++i) {
+        data += "n";
+        data += std::to_string(i);
+        data += " v1 dV c1 t2019-01-01T00:00:00Z i1 ufoo T x1.0 y2.0\n";
+    }
+    REQUIRE(data.size() > 4 * 1024 * 1024);
+
+    osmium::io::File file{data.data(), data.size(), "opl"};
+    osmium::io::Reader reader{file};
+
+    osmium::object_id_type id = 0;
+    while (const auto buffer = reader.read()) {
+        for (const auto& node : buffer.select<osmium::Node>()) {
+            REQUIRE(node.id() == ++id);
+        }
+    }
+    reader.close();
+    REQUIRE(id == count);
+}
+
+TEST_CASE("Parse OPL with error in later chunk using Reader") {
+    std::string data;
+    for (int i = 1; i <= 100000; ++i) {
+        data += "n";
+        data += std::to_string(i);
+        data += " v1 dV c1 t2019-01-01T00:00:00Z i1 ufoo T x1.0 y2.0\n";
+    }
+    data += "x1\n";
+
+    osmium::io::File file{data.data(), data.size(), "opl"};
+    osmium::io::Reader reader{file};
+
+    try {
+        while (reader.read()) {
+        }
+        REQUIRE(false);
+    } catch (const osmium::opl_error& e) {
+        REQUIRE(e.line == 100000);
+    }
+}
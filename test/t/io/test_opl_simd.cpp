@@ -0,0 +1,137 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/opl_parser_functions.hpp>
+#include <osmium/io/detail/opl_simd.hpp>
+#include <osmium/osm/location.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace oid = osmium::io::detail;
+
+namespace {
+
+    // Run the function with all SIMD levels supported by the CPU and
+    // restore the original level afterwards.
+    template <typename TFunc>
+    void with_all_levels(TFunc&& func) {
+        const auto original = oid::get_opl_simd_level();
+        for (const auto level : {oid::opl_simd_level::none, oid::opl_simd_level::sse42}) {
+            if (oid::set_opl_simd_level(level) == level) {
+                func();
+            }
+        }
+        oid::set_opl_simd_level(original);
+    }
+
+} // anonymous namespace
+
+TEST_CASE("SIMD level is capped at supported level") {
+    const auto original = oid::get_opl_simd_level();
+    REQUIRE(oid::set_opl_simd_level(oid::opl_simd_level::none) == oid::opl_simd_level::none);
+    REQUIRE(oid::get_opl_simd_level() == oid::opl_simd_level::none);
+    REQUIRE(oid::set_opl_simd_level(oid::opl_simd_level::sse42) == oid::opl_simd_level_supported());
+    oid::set_opl_simd_level(original);
+}
+
+TEST_CASE("Find end of string and section at all alignments") {
+    with_all_levels([]() {
+        for (std::size_t offset = 0; offset < 40; ++offset) {
+            for (std::size_t len = 0; len < 80; ++len) {
+                for (const char special : {'\0', ' ', '\t', ',', '=', '%'}) {
+                    std::string str(offset, 'x');
+                    str.append(len, 'a');
+                    str += special;
+                    str += "bc";
+
+                    const char* start = str.data() + offset;
+                    REQUIRE(oid::opl_simd()->find_string_end(start) == start + len);
+                    const bool section_end = special == '\0' || special == ' ' || special == '\t';
+                    REQUIRE(oid::opl_simd()->find_section_end(start) == start + (section_end ? len : len + 3));
+                }
+            }
+        }
+    });
+}
+
+TEST_CASE("Parse digits at all alignments") {
+    with_all_levels([]() {
+        for (std::size_t offset = 0; offset < 20; ++offset) {
+            std::string digits;
+            uint64_t expected = 0;
+            for (int n = 0; n <= 20; ++n) {
+                const std::string str = std::string(offset, '9') + "-" + digits + "x";
+                uint64_t value = 0;
+                const int len = oid::opl_simd()->parse_digits(str.data() + offset + 1, &value);
+                if (n < 16) {
+                    REQUIRE(len == n);
+                    REQUIRE(value == expected);
+                } else {
+                    REQUIRE(len == 16);
+                }
+                const char digit = static_cast<char>('0' + (n * 7 + 3) % 10);
+                digits += digit;
+                expected = expected * 10 + static_cast<uint64_t>(digit - '0');
+            }
+        }
+    });
+}
+
+TEST_CASE("Parse integers with all SIMD levels") {
+    with_all_levels([]() {
+        const char* s = "123456789012345 x";
+        REQUIRE(oid::opl_parse_int<int64_t>(&s) == 123456789012345);
+        REQUIRE(*s == ' ');
+
+        s = "-17,";
+        REQUIRE(oid::opl_parse_int<int32_t>(&s) == -17);
+        REQUIRE(*s == ',');
+
+        s = "1234567890123456";
+        REQUIRE_THROWS_WITH(oid::opl_parse_int<int64_t>(&s), "OPL error: integer too long");
+
+        s = "x";
+        REQUIRE_THROWS_WITH(oid::opl_parse_int<int64_t>(&s), "OPL error: expected integer");
+    });
+}
+
+TEST_CASE("Parse coordinates with all SIMD levels") {
+    const std::vector<std::string> inputs = {
+        "0", "1", "-1", "1.", "1.5", "-1.5", ".5", "180", "-180", "179.9999999",
+        "-179.9999999", "12.3456789", "12.34567891", "12.34567895", "0.0000001",
+        "214.7483647", "214.7483648", "-214.7483648", "1e1", "1.5E-1", "1234",
+        "0001.5", "89.9999999y", "-0.000001 ",
+    };
+
+    with_all_levels([&inputs]() {
+        for (const auto& input : inputs) {
+            const char* expected_end = input.c_str();
+            int32_t expected = 0;
+            bool expected_error = false;
+            try {
+                expected = osmium::detail::string_to_location_coordinate(&expected_end);
+            } catch (const osmium::invalid_location&) {
+                expected_error = true;
+            }
+
+            const char* end = input.c_str();
+            if (expected_error) {
+                REQUIRE_THROWS_AS(oid::opl_parse_coordinate(&end), const osmium::invalid_location&);
+            } else {
+                REQUIRE(oid::opl_parse_coordinate(&end) == expected);
+                REQUIRE(end == expected_end);
+            }
+        }
+    });
+}
+
+TEST_CASE("Parse strings with escapes with all SIMD levels") {
+    with_all_levels([]() {
+        const char* s = "a_rather_long_string_spanning_more_than_one_block%20%with%2c%escapes=";
+        std::string result;
+        oid::opl_parse_string(&s, result);
+        REQUIRE(result == "a_rather_long_string_spanning_more_than_one_block with,escapes");
+        REQUIRE(*s == '=');
+    });
+}
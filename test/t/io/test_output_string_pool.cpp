@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include <osmium/io/detail/output_string_pool.hpp>
+
+#include <string>
+
+TEST_CASE("Get string from empty pool") {
+    osmium::io::detail::OutputStringPool pool;
+    REQUIRE(pool.size() == 0);
+
+    const std::string str = pool.get(10000);
+    REQUIRE(str.empty());
+    REQUIRE(str.capacity() >= 10000);
+}
+
+TEST_CASE("Strings given back to the pool are reused") {
+    osmium::io::detail::OutputStringPool pool;
+
+    std::string str = pool.get(10000);
+    str.append(5000, 'x');
+    const char* data = str.data();
+    pool.put(std::move(str));
+    REQUIRE(pool.size() == 1);
+
+    const std::string reused = pool.get(100);
+    REQUIRE(reused.empty());
+    REQUIRE(reused.data() == data);
+    REQUIRE(reused.capacity() >= 10000);
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Small strings are not kept in the pool") {
+    osmium::io::detail::OutputStringPool pool;
+
+    pool.put(std::string{"foo"});
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Pool keeps strings large enough for the output of a full buffer") {
+    osmium::io::detail::OutputStringPool pool;
+
+    pool.put(std::string(30 * 1024 * 1024, 'x'));
+    REQUIRE(pool.size() == 1);
+
+    pool.put(std::string(osmium::io::detail::OutputStringPool::max_string_capacity + 1, 'y'));
+    REQUIRE(pool.size() == 1);
+}
+
+TEST_CASE("Pool keeps a limited total capacity") {
+    osmium::io::detail::OutputStringPool pool;
+
+    for (int i = 0; i < 100; ++i) {
+        pool.put(std::string(4 * 1024 * 1024, 'x'));
+    }
+    REQUIRE(pool.size() > 0);
+    REQUIRE(pool.size() < 100);
+    REQUIRE(pool.capacity() <= osmium::io::detail::OutputStringPool::max_capacity);
+
+    pool.put(std::string(16 * 1024 * 1024, 'y'));
+    REQUIRE(pool.capacity() <= osmium::io::detail::OutputStringPool::max_capacity);
+
+    while (pool.size() > 0) {
+        pool.get();
+    }
+    REQUIRE(pool.capacity() == 0);
+}
+
+TEST_CASE("Clearing the pool removes all strings") {
+    osmium::io::detail::OutputStringPool pool;
+
+    pool.put(std::string(10000, 'x'));
+    pool.put(std::string(10000, 'y'));
+    REQUIRE(pool.size() == 2);
+
+    pool.clear();
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.capacity() == 0);
+}
+
+TEST_CASE("Pool keeps a limited number of strings") {
+    osmium::io::detail::OutputStringPool pool;
+
+    for (int i = 0; i < 1000; ++i) {
+        pool.put(pool.get(10000) + std::string(10000, 'x'));
+        pool.put(std::string(10000, 'y'));
+    }
+    REQUIRE(pool.size() > 0);
+    REQUIRE(pool.size() < 1000);
+}
@@ -1,8 +1,12 @@
 #include "catch.hpp"
 
 #include <osmium/io/detail/string_util.hpp>
+#include <osmium/osm/location.hpp>
+#include <osmium/osm/timestamp.hpp>
 
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <locale>
 #include <stdexcept>
 #include <string>
@@ -94,6 +98,12 @@ TEST_CASE("html encoding encodes special XML characters") {
     REQUIRE(out == "&amp; &quot; &apos; &lt; &gt; &#xA; &#xD; &#x9;");
 }
 
+TEST_CASE("xml encoding of string with special characters at start and end") {
+    std::string out{"x"};
+    osmium::io::detail::append_xml_encoded_string(out, "<abc def>");
+    REQUIRE(out == "x&lt;abc def&gt;");
+}
+
 TEST_CASE("debug encoding does not encode normal characters") {
     const char* s = "abc123,.-";
     std::string out;
@@ -210,3 +220,36 @@ TEST_CASE("incomplete Unicode codepoint") {
     }
 }
 
+
+TEST_CASE("append integers") {
+    for (const int64_t value : {int64_t(0), int64_t(1), int64_t(-1), int64_t(9), int64_t(10), int64_t(99),
+                                int64_t(100), int64_t(-12345), int64_t(1234567890123),
+                                std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min()}) {
+        std::string out{"x"};
+        osmium::io::detail::append_int(out, value);
+        REQUIRE(out == "x" + std::to_string(value));
+    }
+}
+
+TEST_CASE("append location coordinates") {
+    for (const int32_t value : {0, 1, -1, 10000000, -1800000000, 1800000000, 123456789, -10,
+                                std::numeric_limits<int32_t>::max(), std::numeric_limits<int32_t>::min()}) {
+        std::string expected;
+        osmium::detail::append_location_coordinate_to_string(std::back_inserter(expected), value);
+        std::string out;
+        osmium::io::detail::append_location_coordinate(out, value);
+        REQUIRE(out == expected);
+    }
+}
+
+TEST_CASE("append ISO timestamps") {
+    for (uint32_t seconds = 0; seconds < 4200000000u; seconds += 86399u * 7u + 1234u) {
+        std::string out;
+        osmium::io::detail::append_iso_timestamp(out, seconds);
+        REQUIRE(out == osmium::Timestamp{seconds}.to_iso_all());
+    }
+
+    std::string out;
+    osmium::io::detail::append_iso_timestamp(out, 951782400); // 2000-02-29
+    REQUIRE(out == "2000-02-29T00:00:00Z");
+}
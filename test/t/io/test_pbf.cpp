@@ -2,10 +2,22 @@
 
 #include "utils.hpp"
 
+#include <osmium/io/detail/read_write.hpp>
+#include <osmium/io/opl_input.hpp>
 #include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_output.hpp>
 #include <osmium/io/reader.hpp>
+#include <osmium/io/writer.hpp>
 #include <osmium/osm/object.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
 /**
  * Osmosis writes PBF with changeset=-1 if its input file did not contain the changeset field.
  * The default value of the version field is -1 in the OSM.PBF format.
@@ -43,3 +55,363 @@ TEST_CASE("Read PBF file with version=-1 and changeset=-1 and DenseNodes (writte
     REQUIRE(object.version() == 0);
     REQUIRE(object.changeset() == 0);
 }
+
+TEST_CASE("Reading PBF file through memory mapping gives same result as normal read") {
+    const int count = count_fds();
+
+    const std::string filename{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+
+    const osmium::memory::Buffer buffer = osmium::io::read_file(filename);
+    const osmium::memory::Buffer mapped_buffer = osmium::io::read_file(filename, osmium::io::read_mmap::yes);
+
+    REQUIRE(buffer.committed() > 0);
+    REQUIRE(buffer.committed() == mapped_buffer.committed());
+    REQUIRE(std::equal(buffer.data(), buffer.data() + buffer.committed(), mapped_buffer.data()));
+
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Reading PBF file with work stealing pool gives same result as normal read") {
+    const std::string filename{with_data_dir("t/io/deleted_nodes.osh.pbf")};
+
+    osmium::thread::Pool pool{2, 0, osmium::thread::pool_scheduling::work_stealing};
+    osmium::io::Reader reader{filename, pool};
+    osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+    while (const osmium::memory::Buffer read_buffer = reader.read()) {
+        buffer.add_buffer(read_buffer);
+        buffer.commit();
+    }
+    reader.close();
+
+    const osmium::memory::Buffer expected = osmium::io::read_file(filename);
+    REQUIRE(buffer.committed() == expected.committed());
+}
+
+TEST_CASE("Reader with memory mapping reports offset and file size") {
+    osmium::io::Reader reader{with_data_dir("t/io/deleted_nodes.osh.pbf"), osmium::io::read_mmap::yes};
+    REQUIRE(reader.file_size() > 0);
+
+    while (reader.read()) {
+    }
+
+    REQUIRE(reader.eof());
+    REQUIRE(reader.offset() == reader.file_size());
+    reader.close();
+}
+
+TEST_CASE("Reader with memory mapping can be closed before reading all data") {
+    osmium::io::Reader reader{with_data_dir("t/io/deleted_nodes.osh.pbf"), osmium::io::read_mmap::yes};
+    const auto header = reader.header();
+    REQUIRE(header.has_multiple_object_versions());
+    reader.close();
+    REQUIRE(reader.eof());
+}
+
+namespace {
+
+    // Write a PBF file with one block each for nodes, ways, and relations.
+    std::string write_pbf_with_three_blocks() {
+        const std::string filename{"test-pbf-block-index.osm.pbf"};
+        const std::string data{"n1 v1 x1 y1\nn2 v1 x2 y2\nw10 v1 Nn1,n2\nr20 v1 Mw10@\nr21 v1 Mr20@\n"};
+
+        osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}};
+        osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+
+        return filename;
+    }
+
+    osmium::memory::Buffer read_pbf(const std::string& filename, osmium::osm_entity_bits::type entities, const osmium::io::PBFBlockIndex* index = nullptr, const osmium::io::read_id_range& range = osmium::io::read_id_range{}) {
+        osmium::memory::Buffer buffer{1024, osmium::memory::Buffer::auto_grow::yes};
+        std::unique_ptr<osmium::io::Reader> reader;
+        if (index) {
+            reader.reset(new osmium::io::Reader{filename, entities, *index, range});
+        } else {
+            reader.reset(new osmium::io::Reader{filename, entities});
+        }
+        while (const osmium::memory::Buffer read_buffer = reader->read()) {
+            buffer.add_buffer(read_buffer);
+            buffer.commit();
+        }
+        reader->close();
+        return buffer;
+    }
+
+    // Compare objects in two buffers. Buffers can't be compared bytewise
+    // because padding inside the objects is not initialized.
+    bool same_data(const osmium::memory::Buffer& a, const osmium::memory::Buffer& b) {
+        auto it_b = b.cbegin<osmium::OSMObject>();
+        for (const auto& object : a.select<osmium::OSMObject>()) {
+            if (it_b == b.cend<osmium::OSMObject>() ||
+                object.type() != it_b->type() ||
+                object.id() != it_b->id() ||
+                object.version() != it_b->version() ||
+                object.byte_size() != it_b->byte_size()) {
+                return false;
+            }
+            ++it_b;
+        }
+        return it_b == b.cend<osmium::OSMObject>();
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Build PBF block index") {
+    const auto filename = write_pbf_with_three_blocks();
+    const auto index = osmium::io::build_pbf_block_index(filename);
+
+    REQUIRE(index.size() == 3);
+    REQUIRE(index[0].offset > 0);
+    REQUIRE(index[0].types == osmium::osm_entity_bits::node);
+    REQUIRE(index[0].min_id == 1);
+    REQUIRE(index[0].max_id == 2);
+    REQUIRE(index[1].offset > index[0].offset);
+    REQUIRE(index[1].types == osmium::osm_entity_bits::way);
+    REQUIRE(index[1].min_id == 10);
+    REQUIRE(index[1].max_id == 10);
+    REQUIRE(index[2].offset > index[1].offset);
+    REQUIRE(index[2].types == osmium::osm_entity_bits::relation);
+    REQUIRE(index[2].min_id == 20);
+    REQUIRE(index[2].max_id == 21);
+}
+
+TEST_CASE("Reading PBF file with block index gives same result as full read") {
+    const auto filename = write_pbf_with_three_blocks();
+    const auto index = osmium::io::build_pbf_block_index(filename);
+
+    for (const auto entities : {osmium::osm_entity_bits::node,
+                                osmium::osm_entity_bits::way,
+                                osmium::osm_entity_bits::relation,
+                                osmium::osm_entity_bits::node | osmium::osm_entity_bits::relation,
+                                osmium::osm_entity_bits::nwr}) {
+        const auto buffer = read_pbf(filename, entities);
+        REQUIRE(buffer.committed() > 0);
+        REQUIRE(same_data(buffer, read_pbf(filename, entities, &index)));
+    }
+}
+
+TEST_CASE("Reading PBF file with block index and ID range") {
+    const auto filename = write_pbf_with_three_blocks();
+    const auto index = osmium::io::build_pbf_block_index(filename);
+
+    const auto buffer = read_pbf(filename, osmium::osm_entity_bits::nwr, &index, osmium::io::read_id_range{5, 15});
+    REQUIRE(std::distance(buffer.cbegin<osmium::OSMObject>(), buffer.cend<osmium::OSMObject>()) == 1);
+    REQUIRE(buffer.cbegin<osmium::OSMObject>()->id() == 10);
+
+    const auto empty_buffer = read_pbf(filename, osmium::osm_entity_bits::nwr, &index, osmium::io::read_id_range{100, 200});
+    REQUIRE(empty_buffer.committed() == 0);
+}
+
+TEST_CASE("Reading PBF file with block index that doesn't match the file throws") {
+    const auto filename = write_pbf_with_three_blocks();
+    osmium::io::PBFBlockIndex index;
+    osmium::io::PBFBlockIndex::block_info info;
+    info.offset = 1;
+    index.add(info);
+
+    osmium::io::Reader reader{filename, index};
+    REQUIRE_THROWS_AS(reader.read(), const osmium::pbf_error&);
+    reader.close();
+}
+
+TEST_CASE("Dump and load PBF block index") {
+    const auto filename = write_pbf_with_three_blocks();
+    const auto index = osmium::io::build_pbf_block_index(filename);
+
+    const std::string index_filename{"test-pbf-block-index.idx"};
+    const int fd_out = osmium::io::detail::open_for_writing(index_filename, osmium::io::overwrite::allow);
+    index.dump(fd_out);
+    osmium::io::detail::reliable_close(fd_out);
+
+    const int fd_in = osmium::io::detail::open_for_reading(index_filename);
+    const osmium::io::PBFBlockIndex loaded_index{fd_in};
+    osmium::io::detail::reliable_close(fd_in);
+
+    REQUIRE(loaded_index.size() == index.size());
+    for (std::size_t i = 0; i < index.size(); ++i) {
+        REQUIRE(loaded_index[i].offset == index[i].offset);
+        REQUIRE(loaded_index[i].types == index[i].types);
+        REQUIRE(loaded_index[i].min_id == index[i].min_id);
+        REQUIRE(loaded_index[i].max_id == index[i].max_id);
+    }
+}
+
+TEST_CASE("Building PBF block index for non-existent file throws") {
+    REQUIRE_THROWS(osmium::io::build_pbf_block_index("does-not-exist.osm.pbf"));
+}
+
+namespace {
+
+    // Write a PBF file with several blocks of nodes followed by ways and
+    // relations. If sorted is set, the header will have the
+    // Sort.Type_then_ID flag set.
+    std::string write_pbf_with_many_nodes(bool sorted) {
+        const std::string filename{sorted ? "test-pbf-sorted.osm.pbf" : "test-pbf-unsorted.osm.pbf"};
+
+        std::string data;
+        for (int i = 1; i <= 20000; ++i) {
+            data += "n" + std::to_string(i) + " v1 x1 y1\n";
+        }
+        for (int i = 1; i <= 10; ++i) {
+            data += "w" + std::to_string(i) + " v1 Nn" + std::to_string(i) + ",n" + std::to_string(i + 1) + "\n";
+        }
+        for (int i = 1; i <= 5; ++i) {
+            data += "r" + std::to_string(i) + " v1 Mw" + std::to_string(i) + "@\n";
+        }
+
+        osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}};
+        osmium::io::Header header;
+        if (sorted) {
+            header.set("sorting", "Type_then_ID");
+        }
+        osmium::io::Writer writer{filename, header, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+
+        return filename;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Sort.Type_then_ID flag is written and read") {
+    osmium::io::Reader reader{write_pbf_with_many_nodes(true), osmium::osm_entity_bits::nothing};
+    REQUIRE(reader.header().get("sorting") == "Type_then_ID");
+    reader.close();
+
+    osmium::io::Reader reader_unsorted{write_pbf_with_many_nodes(false), osmium::osm_entity_bits::nothing};
+    REQUIRE(reader_unsorted.header().get("sorting").empty());
+    reader_unsorted.close();
+}
+
+TEST_CASE("Reading sorted PBF file skips blobs of unwanted types with same result") {
+    const auto sorted = write_pbf_with_many_nodes(true);
+    const auto unsorted = write_pbf_with_many_nodes(false);
+
+    for (const auto entities : {osmium::osm_entity_bits::node,
+                                osmium::osm_entity_bits::way,
+                                osmium::osm_entity_bits::relation,
+                                osmium::osm_entity_bits::node | osmium::osm_entity_bits::relation,
+                                osmium::osm_entity_bits::way | osmium::osm_entity_bits::relation,
+                                osmium::osm_entity_bits::nwr}) {
+        const auto buffer = read_pbf(unsorted, entities);
+        REQUIRE(buffer.committed() > 0);
+        REQUIRE(same_data(buffer, read_pbf(sorted, entities)));
+    }
+
+    REQUIRE(read_pbf(sorted, osmium::osm_entity_bits::changeset).committed() == 0);
+}
+
+TEST_CASE("Reading sorted PBF file doesn't decompress blobs of unwanted types") {
+    const auto sorted = write_pbf_with_many_nodes(true);
+    const auto ways = read_pbf(sorted, osmium::osm_entity_bits::way);
+    const auto relations = read_pbf(sorted, osmium::osm_entity_bits::relation);
+
+    // Corrupt the end of the zlib data (the checksum) of the first node
+    // blob. Peeking at its type still works, decompressing all of it
+    // doesn't.
+    const auto index = osmium::io::build_pbf_block_index(sorted);
+    REQUIRE(index.size() > 3);
+    REQUIRE(index[0].types == osmium::osm_entity_bits::node);
+    REQUIRE(index[1].types == osmium::osm_entity_bits::node);
+    {
+        std::fstream file{sorted, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekg(static_cast<std::streamoff>(index[1].offset - 1));
+        const char c = static_cast<char>(file.get());
+        file.seekp(static_cast<std::streamoff>(index[1].offset - 1));
+        file.put(static_cast<char>(c ^ 0x01));
+    }
+
+    REQUIRE_THROWS(read_pbf(sorted, osmium::osm_entity_bits::node));
+    REQUIRE(same_data(ways, read_pbf(sorted, osmium::osm_entity_bits::way)));
+    REQUIRE(same_data(relations, read_pbf(sorted, osmium::osm_entity_bits::relation)));
+}
+
+namespace {
+
+    std::string write_pbf_with_compression(const std::string& name, const std::string& options) {
+        const std::string filename{"test-pbf-compression-" + name + ".osm.pbf"};
+
+        std::string data;
+        for (int i = 1; i <= 10000; ++i) {
+            data += "n" + std::to_string(i) + " v1 x1 y1 Tname=node" + std::to_string(i % 10) + "\n";
+        }
+        for (int i = 1; i <= 10; ++i) {
+            data += "w" + std::to_string(i) + " v1 Nn" + std::to_string(i) + ",n" + std::to_string(i + 1) + "\n";
+        }
+
+        osmium::io::Reader reader{osmium::io::File{data.data(), data.size(), "opl"}};
+        osmium::io::Writer writer{osmium::io::File{filename, "pbf," + options}, osmium::io::overwrite::allow};
+        while (osmium::memory::Buffer buffer = reader.read()) {
+            writer(std::move(buffer));
+        }
+        writer.close();
+        reader.close();
+
+        return filename;
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Write and read PBF file with different zlib compression levels") {
+    const auto uncompressed = read_pbf(write_pbf_with_compression("none", "pbf_compression=none"), osmium::osm_entity_bits::nwr);
+    REQUIRE(uncompressed.committed() > 0);
+
+    for (const char* level : {"0", "1", "9"}) {
+        const auto filename = write_pbf_with_compression(std::string{"zlib"} + level, std::string{"pbf_compression=zlib,pbf_compression_level="} + level);
+        REQUIRE(same_data(uncompressed, read_pbf(filename, osmium::osm_entity_bits::nwr)));
+    }
+}
+
+TEST_CASE("Writing PBF file with boolean pbf_compression values") {
+    const auto zlib = read_pbf(write_pbf_with_compression("zlib", "pbf_compression=zlib"), osmium::osm_entity_bits::nwr);
+
+    for (const char* value : {"true", "yes", "on", "false", "no"}) {
+        const auto filename = write_pbf_with_compression(value, std::string{"pbf_compression="} + value);
+        REQUIRE(same_data(zlib, read_pbf(filename, osmium::osm_entity_bits::nwr)));
+    }
+}
+
+TEST_CASE("Writing PBF file with unknown compression or invalid level throws") {
+    REQUIRE_THROWS_AS(write_pbf_with_compression("foo", "pbf_compression=foo"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(write_pbf_with_compression("invalid", "pbf_compression=zlib,pbf_compression_level=10"), const std::invalid_argument&);
+    REQUIRE_THROWS_AS(write_pbf_with_compression("invalid", "pbf_compression_level=x"), const std::invalid_argument&);
+}
+
+#ifdef OSMIUM_WITH_ZSTD
+TEST_CASE("Write and read PBF file with zstd compression") {
+    const auto uncompressed = read_pbf(write_pbf_with_compression("none", "pbf_compression=none"), osmium::osm_entity_bits::nwr);
+
+    for (const char* level : {"1", "3", "19"}) {
+        const auto filename = write_pbf_with_compression(std::string{"zstd"} + level, std::string{"pbf_compression=zstd,pbf_compression_level="} + level);
+        REQUIRE(same_data(uncompressed, read_pbf(filename, osmium::osm_entity_bits::nwr)));
+    }
+
+    REQUIRE_THROWS_AS(write_pbf_with_compression("invalid", "pbf_compression=zstd,pbf_compression_level=0"), const std::invalid_argument&);
+}
+#else
+TEST_CASE("Writing PBF file with zstd compression throws if not compiled in") {
+    REQUIRE_THROWS_AS(write_pbf_with_compression("invalid", "pbf_compression=zstd"), const std::invalid_argument&);
+}
+#endif
+
+#ifdef OSMIUM_WITH_LZ4
+TEST_CASE("Write and read PBF file with lz4 compression") {
+    const auto uncompressed = read_pbf(write_pbf_with_compression("none", "pbf_compression=none"), osmium::osm_entity_bits::nwr);
+
+    for (const char* level : {"0", "9"}) {
+        const auto filename = write_pbf_with_compression(std::string{"lz4"} + level, std::string{"pbf_compression=lz4,pbf_compression_level="} + level);
+        REQUIRE(same_data(uncompressed, read_pbf(filename, osmium::osm_entity_bits::nwr)));
+    }
+}
+#else
+TEST_CASE("Writing PBF file with lz4 compression throws if not compiled in") {
+    REQUIRE_THROWS_AS(write_pbf_with_compression("invalid", "pbf_compression=lz4"), const std::invalid_argument&);
+}
+#endif
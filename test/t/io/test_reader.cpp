@@ -2,14 +2,26 @@
 
 #include "utils.hpp"
 
+#include <osmium/builder/attr.hpp>
 #include <osmium/handler.hpp>
+#include <osmium/handler/store_node_locations.hpp>
+#include <osmium/index/map/concurrent_dense_mem.hpp>
 #include <osmium/io/any_compression.hpp>
+#include <osmium/io/o5m_input.hpp>
+#include <osmium/io/o5m_output.hpp>
+#include <osmium/io/opl_input.hpp>
+#include <osmium/io/opl_output.hpp>
 #include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_output.hpp>
+#include <osmium/io/writer.hpp>
 #include <osmium/io/xml_input.hpp>
+#include <osmium/io/xml_output.hpp>
 #include <osmium/memory/buffer.hpp>
 #include <osmium/visitor.hpp>
 
+#include <atomic>
 #include <stdexcept>
+#include <string>
 
 struct CountHandler : public osmium::handler::Handler {
 
@@ -231,6 +243,126 @@ TEST_CASE("Reader should decode zero node positions in history (PBF)") {
     REQUIRE(count == count_fds());
 }
 
+TEST_CASE("Reader should ignore memory mapping setting for non-PBF files") {
+    const int count = count_fds();
+
+    osmium::io::Reader reader{with_data_dir("t/io/data.osm"), osmium::io::read_mmap::yes};
+    CountHandler handler;
+
+    osmium::apply(reader, handler);
+    REQUIRE(handler.count == 1);
+
+    reader.close();
+    REQUIRE(count == count_fds());
+}
+
+TEST_CASE("Reader should call decode callback on all buffers") {
+    std::atomic<int> count{0};
+    const osmium::io::decode_callback callback{[&count](osmium::memory::Buffer& buffer) {
+        count += static_cast<int>(buffer.select<osmium::Node>().size());
+    }};
+
+    osmium::io::Reader reader{with_data_dir("t/io/data.osm"), callback};
+    CountHandler handler;
+
+    osmium::apply(reader, handler);
+    reader.close();
+
+    REQUIRE(handler.count == 1);
+    REQUIRE(count == 1);
+}
+
+TEST_CASE("Reader can store node locations while decoding (XML)") {
+    osmium::index::map::ConcurrentDenseMem<osmium::unsigned_object_id_type, osmium::Location> index;
+
+    osmium::io::Reader reader{with_data_dir("t/io/data.osm"), osmium::handler::store_node_locations(index)};
+    while (reader.read()) {
+    }
+    reader.close();
+
+    REQUIRE(index.get(1) == osmium::Location(1.02, 1.02));
+    REQUIRE(index.get_noexcept(2) == osmium::Location{});
+}
+
+TEST_CASE("Reader can store node locations while decoding (PBF)") {
+    osmium::index::map::ConcurrentDenseMem<osmium::unsigned_object_id_type, osmium::Location> index;
+
+    osmium::io::Reader reader{with_data_dir("t/io/data_pbf_version-1-densenodes.osm.pbf"), osmium::handler::store_node_locations(index)};
+    while (reader.read()) {
+    }
+    reader.close();
+
+    REQUIRE(index.get(2) == osmium::Location(10.01, 50.0));
+}
+
+namespace {
+
+    osmium::Location test_location(const osmium::object_id_type id) {
+        return osmium::Location{static_cast<double>(id % 1000) / 10.0, static_cast<double>(id / 1000) / 10.0};
+    }
+
+    // Write enough nodes that the parsers need more than one buffer for
+    // every chunk of input and check that the decode callback sees all.
+    void check_decode_callback_with_many_nodes(const std::string& format) {
+        const osmium::object_id_type num_nodes = 200000;
+
+        const std::string filename{"test-reader-decode-callback." + format};
+        {
+            osmium::memory::Buffer buffer{1024 * 1024, osmium::memory::Buffer::auto_grow::yes};
+            for (osmium::object_id_type id = 1; id <= num_nodes; ++id) {
+                osmium::builder::add_node(buffer,
+                    osmium::builder::attr::_id(id),
+                    osmium::builder::attr::_version(1),
+                    osmium::builder::attr::_location(test_location(id))
+                );
+            }
+            osmium::io::Writer writer{filename, osmium::io::overwrite::allow};
+            writer(std::move(buffer));
+            writer.close();
+        }
+
+        osmium::index::map::ConcurrentDenseMem<osmium::unsigned_object_id_type, osmium::Location> index;
+        const auto store = osmium::handler::store_node_locations(index);
+        std::atomic<osmium::object_id_type> count{0};
+        const osmium::io::decode_callback callback{[&](osmium::memory::Buffer& buffer) {
+            count += static_cast<osmium::object_id_type>(buffer.select<osmium::Node>().size());
+            store.function(buffer);
+        }};
+
+        osmium::io::Reader reader{filename, callback};
+        CountHandler handler;
+        osmium::apply(reader, handler);
+        reader.close();
+
+        REQUIRE(handler.count == num_nodes);
+        REQUIRE(count == num_nodes);
+
+        osmium::object_id_type found = 0;
+        for (osmium::object_id_type id = 1; id <= num_nodes; ++id) {
+            if (index.get_noexcept(static_cast<osmium::unsigned_object_id_type>(id)) == test_location(id)) {
+                ++found;
+            }
+        }
+        REQUIRE(found == num_nodes);
+    }
+
+} // anonymous namespace
+
+TEST_CASE("Reader calls decode callback on all nested buffers") {
+    SECTION("PBF") {
+        check_decode_callback_with_many_nodes("osm.pbf");
+    }
+    SECTION("OPL") {
+        check_decode_callback_with_many_nodes("osm.opl");
+    }
+    SECTION("XML") {
+        check_decode_callback_with_many_nodes("osm");
+    }
+    SECTION("O5M") {
+        check_decode_callback_with_many_nodes("o5m");
+    }
+}
+
 TEST_CASE("Reader should fail with nonexistent file") {
     const int count = count_fds();
 
@@ -255,6 +387,14 @@ TEST_CASE("Reader should fail with nonexistent file (pbf)") {
     REQUIRE(count == count_fds());
 }
 
+TEST_CASE("Reader should fail with nonexistent file (pbf with memory mapping)") {
+    const int count = count_fds();
+
+    REQUIRE_THROWS((osmium::io::Reader{with_data_dir("t/io/nonexistent-file.osm.pbf"), osmium::io::read_mmap::yes}));
+
+    REQUIRE(count == count_fds());
+}
+
 TEST_CASE("Reader should work when there is an exception in main thread before getting header") {
     const int count = count_fds();
 
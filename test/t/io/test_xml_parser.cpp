@@ -0,0 +1,278 @@
+#include "catch.hpp"
+
+#include <osmium/io/xml_input.hpp>
+#include <osmium/osm/changeset.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/osm/way.hpp>
+
+#include <cstring>
+#include <string>
+
+static osmium::memory::Buffer parse_subset(const std::string& data, bool* ok, osmium::osm_entity_bits::type read_types = osmium::osm_entity_bits::all) {
+    osmium::io::detail::XMLSubsetParser parser{read_types};
+    *ok = parser.parse(data);
+    if (!*ok) {
+        return osmium::memory::Buffer{};
+    }
+    return parser.release_buffer();
+}
+
+static osmium::memory::Buffer parse_expat(const std::string& data, osmium::osm_entity_bits::type read_types = osmium::osm_entity_bits::all) {
+    osmium::io::detail::XMLElementParser element_parser{read_types};
+    osmium::io::detail::XMLElementParser::ExpatXMLParser parser{&element_parser};
+    parser("<osm version=\"0.6\">", false);
+    parser(data, false);
+    parser("</osm>", true);
+    return element_parser.release_buffer();
+}
+
+static bool same_buffers(const osmium::memory::Buffer& a, const osmium::memory::Buffer& b) {
+    return a.committed() == b.committed() &&
+           !std::memcmp(a.data(), b.data(), a.committed());
+}
+
+static bool subset_parser_fails(const std::string& data) {
+    bool ok = true;
+    parse_subset(data, &ok);
+    return !ok;
+}
+
+TEST_CASE("Check XML characters and UTF-8 encoding") {
+    const auto valid = [](const std::string& s) {
+        return osmium::io::detail::xml_is_valid_utf8(s.data(), s.data() + s.size());
+    };
+
+    REQUIRE(valid(""));
+    REQUIRE(valid("abc"));
+    REQUIRE(valid("<node id=\"1\"/>\n\t<node id=\"2\"/>\r\n"));
+    REQUIRE(valid("\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80 and more ASCII text"));
+    REQUIRE_FALSE(valid("abc\x01"));
+    REQUIRE_FALSE(valid("long ASCII text with a control character\x1f"));
+    REQUIRE_FALSE(valid("\xc0\xaf"));         // overlong
+    REQUIRE_FALSE(valid("\xe0\x80\xaf"));     // overlong
+    REQUIRE_FALSE(valid("\xed\xa0\x80"));     // surrogate
+    REQUIRE_FALSE(valid("\xf4\x90\x80\x80")); // too large
+    REQUIRE_FALSE(valid("\xef\xbf\xbe"));     // U+FFFE
+    REQUIRE_FALSE(valid("\xe2\x82"));         // truncated
+    REQUIRE_FALSE(valid("\xe2\x28\xa1"));     // missing continuation byte
+}
+
+TEST_CASE("Find tags for splitting XML data") {
+    using osmium::io::detail::xml_tag;
+    using osmium::io::detail::xml_find_tag;
+
+    const std::string data{
+        "<?xml version='1.0'?>\n"
+        "<osm version=\"0.6\">\n"
+        "  <!-- <node id=\"1\"/> -->\n"
+        "  <![CDATA[<way>]]>\n"
+        "  <bounds minlat=\"1\"/>\n"
+        "  <node id=\"2\"><tag k=\"a\" v=\"b\"/></node>\n"
+        "  <nodes/>\n"
+        "  <way id=\"3\"/>\n"
+        "</osm>\n"
+    };
+
+    std::string::size_type pos = 0;
+    REQUIRE(xml_find_tag(data, pos, true) == xml_tag::object);
+    REQUIRE(data.substr(pos, 8) == "<node id");
+    ++pos;
+    REQUIRE(xml_find_tag(data, pos, true) == xml_tag::object);
+    REQUIRE(data.substr(pos, 7) == "<way id");
+    ++pos;
+    REQUIRE(xml_find_tag(data, pos, true) == xml_tag::root_end);
+    REQUIRE(data.substr(pos) == "</osm>\n");
+
+    SECTION("need more data") {
+        pos = 0;
+        const std::string part{data, 0, data.find("-->")};
+        REQUIRE(xml_find_tag(part, pos, false) == xml_tag::none);
+        REQUIRE(pos == part.find("<!--"));
+
+        const std::string end{"</osm>"};
+        pos = 0;
+        REQUIRE(xml_find_tag(end, pos, false) == xml_tag::none);
+        REQUIRE(pos == 0);
+        REQUIRE(xml_find_tag(end, pos, true) == xml_tag::root_end);
+    }
+
+    SECTION("declaration") {
+        const std::string doctype{"<?xml version='1.0'?><!DOCTYPE osm [<!ENTITY a 'b'>]><osm>"};
+        pos = 0;
+        REQUIRE(xml_find_tag(doctype, pos, true) == xml_tag::declaration);
+        REQUIRE(pos == doctype.find("<!DOCTYPE"));
+    }
+}
+
+TEST_CASE("XML subset parser creates the same objects as expat") {
+    const std::string data{
+        "<node id=\"1\" version=\"2\" timestamp=\"2019-01-01T00:00:00Z\" uid=\"3\" user=\"a &amp; b\" changeset=\"4\" lat=\"1.5\" lon=\"-2.25\">\n"
+        "    <tag k=\"name\" v=\"&quot;&lt;x&gt;&apos; &#10;&#x263A;&#229;\"/>\n"
+        "    <tag k = 'single' v = 'quote \"in\" value'/>\n"
+        "  </node>\n"
+        "  <node id=\"2\" visible=\"false\"/>\r\n"
+        "  <way id=\"3\" version=\"1\">\n"
+        "    <nd ref=\"1\"/>\n"
+        "    <nd ref=\"2\" lat=\"1\" lon=\"2\"/>\n"
+        "    <tag k=\"highway\" v=\"primary\"/>\n"
+        "  </way>\n"
+        "  <relation id=\"4\" version=\"1\">\n"
+        "    <member type=\"node\" ref=\"1\" role=\"\"/>\n"
+        "    <member type=\"way\" ref=\"3\" role=\"outer\"/>\n"
+        "    <tag k=\"type\" v=\"multipolygon\"/>\n"
+        "  </relation>\n"
+        "  <changeset id=\"5\" min_lat=\"1\" min_lon=\"2\" max_lat=\"3\" max_lon=\"4\" open=\"false\">\n"
+        "    <tag k=\"comment\" v=\"foo\"/>\n"
+        "  </changeset>\n"
+    };
+
+    bool ok = false;
+    const auto subset_buffer = parse_subset(data, &ok);
+    REQUIRE(ok);
+    REQUIRE(same_buffers(subset_buffer, parse_expat(data)));
+
+    const auto& node = subset_buffer.get<osmium::Node>(0);
+    REQUIRE(node.id() == 1);
+    REQUIRE(std::string{node.user()} == "a & b");
+    REQUIRE(std::string{node.tags()["name"]} == "\"<x>' \n\xe2\x98\xba\xc3\xa5");
+    REQUIRE(std::string{node.tags()["single"]} == "quote \"in\" value");
+
+    SECTION("with only some entity types") {
+        const auto ways_buffer = parse_subset(data, &ok, osmium::osm_entity_bits::way);
+        REQUIRE(ok);
+        REQUIRE(same_buffers(ways_buffer, parse_expat(data, osmium::osm_entity_bits::way)));
+        REQUIRE(ways_buffer.select<osmium::Way>().size() == 1);
+        REQUIRE(ways_buffer.select<osmium::Node>().size() == 0);
+    }
+}
+
+TEST_CASE("XML subset parser fails on anything unusual") {
+    REQUIRE_FALSE(subset_parser_fails("<node id=\"1\"/>"));
+    REQUIRE(subset_parser_fails("<!-- comment --><node id=\"1\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\"><![CDATA[x]]></node>"));
+    REQUIRE(subset_parser_fails("<?pi?><node id=\"1\"/>"));
+    REQUIRE(subset_parser_fails("text<node id=\"1\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" user=\"a\nb\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" user=\"&foo;\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" user=\"&#0;\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" user=\"a<b\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\"version=\"1\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" id=\"2\"/>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\"></way>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\">"));
+    REQUIRE(subset_parser_fails("<node id=\"1\"/></osm>"));
+    REQUIRE(subset_parser_fails("<node id=\"1\" user=\"\xff\"/>"));
+}
+
+TEST_CASE("XML chunk parser falls back to expat") {
+    const std::string data{
+        "<node id=\"1\" user=\"line\nfeed\"/>\n"
+        "<!-- comment -->\n"
+        "<changeset id=\"2\">\n"
+        "  <discussion>\n"
+        "    <comment uid=\"1\" user=\"foo\" date=\"2019-01-01T00:00:00Z\">\n"
+        "      <text>Some text</text>\n"
+        "    </comment>\n"
+        "  </discussion>\n"
+        "</changeset>\n"
+    };
+
+    REQUIRE(subset_parser_fails(data));
+
+    osmium::io::detail::XMLChunkParser parser{std::string{data}, 0, 0, osmium::osm_entity_bits::all};
+    const auto buffer = parser();
+    REQUIRE(same_buffers(buffer, parse_expat(data)));
+
+    const auto& node = buffer.get<osmium::Node>(0);
+    REQUIRE(std::string{node.user()} == "line feed");
+
+    const auto changesets = buffer.select<osmium::Changeset>();
+    REQUIRE(changesets.size() == 1);
+    const auto& comment = *changesets.begin()->discussion().begin();
+    REQUIRE(std::string{comment.text()} == "Some text");
+}
+
+TEST_CASE("XML chunk parser reports errors at the position in the file") {
+    const std::string data{"<node id=\"1\"/>\n  <node id=\"2\"></way>\n"};
+
+    osmium::io::detail::XMLChunkParser parser{std::string{data}, 10, 2, osmium::osm_entity_bits::all};
+    try {
+        parser();
+        REQUIRE(false);
+    } catch (const osmium::xml_error& e) {
+        REQUIRE(e.line == 12);
+        REQUIRE(e.column == 17);
+        REQUIRE(e.error_code == XML_ERROR_TAG_MISMATCH);
+    }
+}
+
+static std::string make_xml(int count, const char* extra = "") {
+    std::string data{"<?xml version='1.0' encoding='UTF-8'?>\n<osm version=\"0.6\" generator=\"test\">\n"};
+    for (int i = 1; i <= count; ++i) {
+        data += "  <node id=\"";
+        data += std::to_string(i);
+        data += "\" version=\"1\" lat=\"1.5\" lon=\"2.5\">\n    <tag k=\"name\" v=\"n&amp;";
+        data += std::to_string(i);
+        data += "\"/>\n  </node>\n";
+        if (i == count / 2) {
+            data += extra;
+        }
+    }
+    data += "</osm>\n";
+    return data;
+}
+
+TEST_CASE("Parse XML with many chunks using Reader") {
+    const int count = 50000;
+    const std::string data = make_xml(count, "  <!-- <node id=\"0\"/> -->\n");
+    REQUIRE(data.size() > 4 * 1024 * 1024);
+
+    osmium::io::File file{data.data(), data.size(), "osm"};
+    osmium::io::Reader reader{file};
+    REQUIRE(reader.header().get("generator") == "test");
+
+    osmium::object_id_type id = 0;
+    while (const auto buffer = reader.read()) {
+        for (const auto& node : buffer.select<osmium::Node>()) {
+            REQUIRE(node.id() == ++id);
+            REQUIRE(node.tags()["name"] == "n&" + std::to_string(id));
+        }
+    }
+    reader.close();
+    REQUIRE(id == count);
+}
+
+TEST_CASE("Parse XML with error in later chunk using Reader") {
+    const int count = 50000;
+    const std::string data = make_xml(count, "  <node id=\"0\">\n</way>\n");
+
+    osmium::io::File file{data.data(), data.size(), "osm"};
+    osmium::io::Reader reader{file};
+
+    try {
+        while (reader.read()) {
+        }
+        REQUIRE(false);
+    } catch (const osmium::xml_error& e) {
+        REQUIRE(e.line == 2 + count / 2 * 3 + 2);
+        REQUIRE(e.column == 2);
+    }
+}
+
+TEST_CASE("Parse truncated XML with many chunks using Reader") {
+    std::string data = make_xml(50000);
+    data.resize(data.size() - 7);
+
+    osmium::io::File file{data.data(), data.size(), "osm"};
+    osmium::io::Reader reader{file};
+
+    try {
+        while (reader.read()) {
+        }
+        REQUIRE(false);
+    } catch (const osmium::xml_error& e) {
+        REQUIRE(e.line == 2 + 50000 * 3 + 1);
+        REQUIRE(e.error_code == XML_ERROR_NO_ELEMENTS);
+    }
+}
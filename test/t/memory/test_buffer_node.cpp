@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <iterator>
 #include <string>
+#include <vector>
 
 void check_node_1(const osmium::Node& node) {
     REQUIRE(1 == node.id());
@@ -189,3 +190,30 @@ TEST_CASE("Node in Buffer") {
     }
 }
 
+TEST_CASE("Iterate over nested buffers") {
+    osmium::memory::Buffer buffer{128, osmium::memory::Buffer::auto_grow::internal};
+
+    for (osmium::object_id_type id = 1; id <= 20; ++id) {
+        {
+            osmium::builder::NodeBuilder node_builder{buffer};
+            node_builder.set_id(id);
+            node_builder.set_user("testuser");
+        }
+        buffer.commit();
+    }
+
+    REQUIRE(buffer.has_nested_buffers());
+
+    std::vector<osmium::object_id_type> ids;
+    const auto collect_ids = [&ids](osmium::memory::Buffer& b) {
+        for (const auto& node : b.select<osmium::Node>()) {
+            ids.push_back(node.id());
+        }
+    };
+    buffer.for_each_nested_buffer(collect_ids);
+    collect_ids(buffer);
+
+    REQUIRE(ids.size() == 20);
+    REQUIRE(std::is_sorted(ids.cbegin(), ids.cend()));
+    REQUIRE(buffer.has_nested_buffers());
+}
@@ -2,6 +2,8 @@
 
 #include "utils.hpp"
 
+#include <osmium/index/detail/tmpfile.hpp>
+#include <osmium/io/detail/read_write.hpp>
 #include <osmium/io/xml_input.hpp>
 #include <osmium/osm/relation.hpp>
 #include <osmium/relations/relations_manager.hpp>
@@ -175,6 +177,49 @@ TEST_CASE("Relations manager derived class") {
     REQUIRE(n == 1);
 }
 
+TEST_CASE("Relations manager storing objects in file") {
+    osmium::io::File file{with_data_dir("t/relations/data.osm")};
+    const int fd = osmium::detail::create_tmp_file();
+
+    {
+        TestRM manager;
+        manager.store_objects_in_file(fd);
+
+        osmium::relations::read_relations(file, manager);
+
+        REQUIRE(manager.member_nodes_database().size()     == 2);
+        REQUIRE(manager.member_ways_database().size()      == 2);
+        REQUIRE(manager.member_relations_database().size() == 1);
+
+        osmium::io::Reader reader{file};
+        osmium::apply(reader, manager.handler());
+        reader.close();
+
+        REQUIRE(manager.count_new_rels      ==  3);
+        REQUIRE(manager.count_new_members   ==  5);
+        REQUIRE(manager.count_complete_rels ==  2);
+        REQUIRE(manager.count_not_in_any    ==  6);
+
+        int n = 0;
+        manager.for_each_incomplete_relation([&](const osmium::relations::RelationHandle& handle){
+            ++n;
+            REQUIRE(handle->id() == 31);
+            for (const auto& member : handle->members()) {
+                const auto* obj = manager.get_member_object(member);
+                if (member.ref() == 22) {
+                    REQUIRE_FALSE(obj);
+                } else {
+                    REQUIRE(obj);
+                    REQUIRE(obj->id() == member.ref());
+                }
+            }
+        });
+        REQUIRE(n == 1);
+    }
+
+    osmium::io::detail::reliable_close(fd);
+}
+
 TEST_CASE("Relations manager with callback") {
     osmium::io::File file{with_data_dir("t/relations/data.osm")};
 
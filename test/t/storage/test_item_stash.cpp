@@ -1,6 +1,8 @@
 #include "catch.hpp"
 
 #include <osmium/builder/attr.hpp>
+#include <osmium/index/detail/tmpfile.hpp>
+#include <osmium/io/detail/read_write.hpp>
 #include <osmium/storage/item_stash.hpp>
 
 #include <sstream>
@@ -166,3 +168,67 @@ TEST_CASE("Fill item stash until it garbage collects") {
     REQUIRE(stash.count_removed() == 0);
 }
 
+TEST_CASE("Item stash stored in file") {
+    const auto buffer = generate_test_data();
+    const int fd = osmium::detail::create_tmp_file();
+
+    {
+        osmium::ItemStash stash;
+        REQUIRE_FALSE(stash.stored_in_file());
+
+        std::vector<osmium::ItemStash::handle_type> handles;
+        for (const auto& item : buffer) {
+            handles.push_back(stash.add_item(item));
+        }
+
+        stash.store_in_file(fd);
+        REQUIRE(stash.stored_in_file());
+        REQUIRE(stash.size() == 180);
+        REQUIRE(stash.used_memory() < 1024 * 1024);
+
+        // add enough items so that the file has to grow several times
+        const auto& node = buffer.get<osmium::Node>(0);
+        const std::size_t num_items = 200 * 1000;
+        for (std::size_t i = 0; i < num_items; ++i) {
+            handles.push_back(stash.add_item(node));
+        }
+        REQUIRE(stash.size() == 180 + num_items);
+        REQUIRE(osmium::file_size(fd) > 4 * 1024 * 1024);
+
+        osmium::object_id_type id = 1;
+        for (std::size_t i = 0; i < 180; ++i) {
+            const auto& obj = stash.get<osmium::OSMObject>(handles[i]);
+            REQUIRE(obj.id() == id);
+            if (id % 3 == 0) {
+                stash.remove_item(handles[i]);
+                handles[i] = osmium::ItemStash::handle_type{};
+            }
+            ++id;
+        }
+        for (std::size_t i = 180; i < handles.size(); ++i) {
+            if (i % 10 != 0) {
+                stash.remove_item(handles[i]);
+                handles[i] = osmium::ItemStash::handle_type{};
+            }
+        }
+
+        stash.garbage_collect();
+        REQUIRE(stash.size() == 120 + num_items / 10);
+        REQUIRE(stash.count_removed() == 0);
+
+        id = 1;
+        for (std::size_t i = 0; i < handles.size(); ++i) {
+            if (handles[i].valid()) {
+                const auto& obj = stash.get<osmium::OSMObject>(handles[i]);
+                REQUIRE(obj.id() == (i < 180 ? id : 1));
+            }
+            ++id;
+        }
+
+        stash.clear();
+        REQUIRE(stash.size() == 0);
+        REQUIRE(stash.stored_in_file());
+    }
+
+    osmium::io::detail::reliable_close(fd);
+}
@@ -0,0 +1,111 @@
+#include "catch.hpp"
+
+#include <osmium/thread/lockfree_queue.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Basic use of lock-free queue") {
+    osmium::thread::LockFreeQueue<int> queue{4, "lock-free queue"};
+    REQUIRE(queue.empty());
+    REQUIRE(queue.capacity() == 4);
+    REQUIRE(queue.name() == "lock-free queue");
+    queue.push(22);
+    REQUIRE_FALSE(queue.empty());
+    REQUIRE(queue.size() == 1);
+    int value = 0;
+    queue.wait_and_pop(value);
+    REQUIRE(value == 22);
+    REQUIRE(queue.empty());
+    REQUIRE_FALSE(queue.try_pop(value));
+}
+
+TEST_CASE("Lock-free queue size is rounded up to power of two") {
+    REQUIRE(osmium::thread::LockFreeQueue<int>{1}.capacity() == 2);
+    REQUIRE(osmium::thread::LockFreeQueue<int>{3}.capacity() == 4);
+    REQUIRE(osmium::thread::LockFreeQueue<int>{20}.capacity() == 32);
+}
+
+TEST_CASE("Lock-free queue needs a maximum size") {
+    REQUIRE_THROWS_AS(osmium::thread::LockFreeQueue<int>{0}, const std::invalid_argument&);
+}
+
+TEST_CASE("Lock-free queue keeps order when wrapping around") {
+    osmium::thread::LockFreeQueue<std::string> queue{4};
+    std::string value;
+    for (int i = 0; i < 10; ++i) {
+        queue.push(std::to_string(i));
+        queue.push(std::to_string(i + 100));
+        queue.wait_and_pop(value);
+        REQUIRE(value == std::to_string(i));
+        REQUIRE(queue.try_pop(value));
+        REQUIRE(value == std::to_string(i + 100));
+    }
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Lock-free queue with single producer and consumer thread") {
+    constexpr const int num = 100000;
+    osmium::thread::LockFreeQueue<int> queue{8};
+
+    std::thread producer{[&queue]() {
+        for (int i = 1; i <= num; ++i) {
+            queue.push(i);
+        }
+    }};
+
+    bool in_order = true;
+    int value = 0;
+    for (int i = 1; i <= num; ++i) {
+        queue.wait_and_pop(value);
+        if (value != i) {
+            in_order = false;
+        }
+    }
+    producer.join();
+
+    REQUIRE(in_order);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Lock-free queue with multiple producer threads") {
+    constexpr const int num_producers = 4;
+    constexpr const int num = 20000;
+    osmium::thread::LockFreeQueue<int, true> queue{8};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < num; ++i) {
+                queue.push(p * num + i);
+            }
+        });
+    }
+
+    // Each producer's elements must arrive in the order they were pushed.
+    std::vector<int> last(num_producers, -1);
+    bool in_order = true;
+    int64_t sum = 0;
+    int value = 0;
+    for (int i = 0; i < num_producers * num; ++i) {
+        queue.wait_and_pop(value);
+        const int p = value / num;
+        if (value <= last[p]) {
+            in_order = false;
+        }
+        last[p] = value;
+        sum += value;
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    const int64_t n = num_producers * num;
+    REQUIRE(in_order);
+    REQUIRE(sum == n * (n - 1) / 2);
+    REQUIRE(queue.empty());
+}
@@ -3,7 +3,11 @@
 #include <osmium/thread/pool.hpp>
 #include <osmium/util/compatibility.hpp>
 
+#include <atomic>
+#include <future>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 struct test_job_with_result {
     int operator()() const {
@@ -105,3 +109,111 @@ TEST_CASE("can throw from job in user provided thread pool") {
     REQUIRE_THROWS_AS(future.get(), const std::runtime_error&);
 }
 
+
+TEST_CASE("can choose scheduling of thread pool") {
+    osmium::thread::Pool shared_pool{2, 0, osmium::thread::pool_scheduling::shared_queue};
+    REQUIRE_FALSE(shared_pool.work_stealing());
+
+    osmium::thread::Pool stealing_pool{2, 0, osmium::thread::pool_scheduling::work_stealing};
+    REQUIRE(stealing_pool.work_stealing());
+    REQUIRE(stealing_pool.queue_empty());
+}
+
+TEST_CASE("can send job to work stealing thread pool") {
+    osmium::thread::Pool pool{3, 0, osmium::thread::pool_scheduling::work_stealing};
+    auto future = pool.submit(test_job_with_result{});
+    REQUIRE(future.get() == 42);
+}
+
+TEST_CASE("can throw from job in work stealing thread pool") {
+    osmium::thread::Pool pool{3, 0, osmium::thread::pool_scheduling::work_stealing};
+    auto future = pool.submit(test_job_throw{});
+    REQUIRE_THROWS_AS(future.get(), const std::runtime_error&);
+}
+
+TEST_CASE("work stealing thread pool runs all jobs") {
+    std::atomic<int> count{0};
+    std::vector<std::future<int>> results;
+    {
+        osmium::thread::Pool pool{4, 4, osmium::thread::pool_scheduling::work_stealing};
+        for (int i = 0; i < 1000; ++i) {
+            results.push_back(pool.submit([&count, i]() {
+                ++count;
+                return i;
+            }));
+        }
+        for (int i = 0; i < 1000; ++i) {
+            REQUIRE(results[i].get() == i);
+        }
+    }
+    REQUIRE(count == 1000);
+}
+
+TEST_CASE("work stealing thread pool runs jobs submitted from jobs") {
+    osmium::thread::Pool pool{2, 0, osmium::thread::pool_scheduling::work_stealing};
+    auto future = pool.submit([&pool]() {
+        auto inner = pool.submit(test_job_with_result{});
+        return inner.get() + 1;
+    });
+    REQUIRE(future.get() == 43);
+}
+
+TEST_CASE("destructing work stealing pool finishes queued jobs") {
+    std::atomic<int> count{0};
+    {
+        osmium::thread::Pool pool{2, 100, osmium::thread::pool_scheduling::work_stealing};
+        for (int i = 0; i < 50; ++i) {
+            pool.submit([&count]() {
+                ++count;
+                return 0;
+            });
+        }
+    }
+    REQUIRE(count == 50);
+}
+
+TEST_CASE("can get task handle from thread pool") {
+    for (const auto scheduling : {osmium::thread::pool_scheduling::shared_queue,
+                                  osmium::thread::pool_scheduling::work_stealing}) {
+        osmium::thread::Pool pool{2, 0, scheduling};
+
+        auto handle = pool.submit_task(test_job_with_result{});
+        REQUIRE(handle.valid());
+        handle.wait();
+        REQUIRE(handle.ready());
+        REQUIRE(handle.get() == 42);
+        REQUIRE_FALSE(handle.valid());
+
+        auto handle_throw = pool.submit_task([]() -> int {
+            throw std::runtime_error{"exception in pool thread"};
+        });
+        REQUIRE_THROWS_AS(handle_throw.get(), const std::runtime_error&);
+    }
+}
+
+TEST_CASE("task handles return results in order") {
+    osmium::thread::Pool pool{4, 0, osmium::thread::pool_scheduling::work_stealing};
+    std::vector<osmium::thread::task_handle<int>> handles;
+    for (int i = 0; i < 200; ++i) {
+        handles.push_back(pool.submit_task([i]() {
+            return i * 2;
+        }));
+    }
+    bool all_ok = true;
+    for (int i = 0; i < 200; ++i) {
+        if (handles[i].get() != i * 2) {
+            all_ok = false;
+        }
+    }
+    REQUIRE(all_ok);
+}
+
+TEST_CASE("task handle of task destroyed without running reports broken promise") {
+    auto state = std::make_shared<osmium::thread::detail::task_state<int>>();
+    osmium::thread::task_handle<int> handle{state};
+    {
+        osmium::thread::function_wrapper task{osmium::thread::detail::task_runner<test_job_with_result, int>{test_job_with_result{}, state}};
+    }
+    REQUIRE(handle.ready());
+    REQUIRE_THROWS_AS(handle.get(), const std::future_error&);
+}
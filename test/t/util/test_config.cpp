@@ -66,6 +66,162 @@ TEST_CASE("use_pool_threads_for_pbf_parsing") {
     REQUIRE(osmium::config::use_pool_threads_for_pbf_parsing());
 }
 
+TEST_CASE("use_pool_threads_for_opl_parsing") {
+    osmium::detail::env = nullptr;
+    REQUIRE(osmium::config::use_pool_threads_for_opl_parsing());
+    REQUIRE(osmium::detail::name == "OSMIUM_USE_POOL_THREADS_FOR_OPL_PARSING");
+    osmium::detail::env = "";
+    REQUIRE(osmium::config::use_pool_threads_for_opl_parsing());
+
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_opl_parsing());
+    osmium::detail::env = "false";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_opl_parsing());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_opl_parsing());
+    osmium::detail::env = "0";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_opl_parsing());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_pool_threads_for_opl_parsing());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_pool_threads_for_opl_parsing());
+}
+
+TEST_CASE("use_pool_threads_for_xml_parsing") {
+    osmium::detail::env = nullptr;
+    REQUIRE(osmium::config::use_pool_threads_for_xml_parsing());
+    REQUIRE(osmium::detail::name == "OSMIUM_USE_POOL_THREADS_FOR_XML_PARSING");
+    osmium::detail::env = "";
+    REQUIRE(osmium::config::use_pool_threads_for_xml_parsing());
+
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_xml_parsing());
+    osmium::detail::env = "false";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_xml_parsing());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_xml_parsing());
+    osmium::detail::env = "0";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_xml_parsing());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_pool_threads_for_xml_parsing());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_pool_threads_for_xml_parsing());
+}
+
+TEST_CASE("use_pool_threads_for_o5m_parsing") {
+    osmium::detail::env = nullptr;
+    REQUIRE(osmium::config::use_pool_threads_for_o5m_parsing());
+    REQUIRE(osmium::detail::name == "OSMIUM_USE_POOL_THREADS_FOR_O5M_PARSING");
+    osmium::detail::env = "";
+    REQUIRE(osmium::config::use_pool_threads_for_o5m_parsing());
+
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_o5m_parsing());
+    osmium::detail::env = "false";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_o5m_parsing());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_o5m_parsing());
+    osmium::detail::env = "0";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_o5m_parsing());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_pool_threads_for_o5m_parsing());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_pool_threads_for_o5m_parsing());
+}
+
+TEST_CASE("use_pool_threads_for_compression") {
+    osmium::detail::env = nullptr;
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+    REQUIRE(osmium::detail::name == "OSMIUM_USE_POOL_THREADS_FOR_COMPRESSION");
+    osmium::detail::env = "";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+    osmium::detail::env = "false";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+    osmium::detail::env = "0";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_compression());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_pool_threads_for_compression());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_pool_threads_for_compression());
+}
+
+TEST_CASE("use_pool_threads_for_decompression") {
+    osmium::detail::env = nullptr;
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+    REQUIRE(osmium::detail::name == "OSMIUM_USE_POOL_THREADS_FOR_DECOMPRESSION");
+    osmium::detail::env = "";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+    osmium::detail::env = "false";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+    osmium::detail::env = "0";
+    REQUIRE_FALSE(osmium::config::use_pool_threads_for_decompression());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_pool_threads_for_decompression());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_pool_threads_for_decompression());
+}
+
+TEST_CASE("get_bool_env") {
+    osmium::detail::env = nullptr;
+    REQUIRE(osmium::detail::get_bool_env("NAME", true));
+    REQUIRE(osmium::detail::name == "NAME");
+    REQUIRE_FALSE(osmium::detail::get_bool_env("NAME", false));
+
+    for (const char* value : {"", "foo", "2"}) {
+        osmium::detail::env = value;
+        REQUIRE(osmium::detail::get_bool_env("NAME", true));
+        REQUIRE_FALSE(osmium::detail::get_bool_env("NAME", false));
+    }
+
+    for (const char* value : {"on", "ON", "true", "True", "yes", "Yes", "1"}) {
+        osmium::detail::env = value;
+        REQUIRE(osmium::detail::get_bool_env("NAME", true));
+        REQUIRE(osmium::detail::get_bool_env("NAME", false));
+    }
+
+    for (const char* value : {"off", "OFF", "false", "False", "no", "No", "0"}) {
+        osmium::detail::env = value;
+        REQUIRE_FALSE(osmium::detail::get_bool_env("NAME", true));
+        REQUIRE_FALSE(osmium::detail::get_bool_env("NAME", false));
+    }
+}
+
+TEST_CASE("use_work_stealing_pool") {
+    osmium::detail::env = nullptr;
+    REQUIRE_FALSE(osmium::config::use_work_stealing_pool());
+    REQUIRE(osmium::detail::name == "OSMIUM_POOL_WORK_STEALING");
+    osmium::detail::env = "";
+    REQUIRE_FALSE(osmium::config::use_work_stealing_pool());
+    osmium::detail::env = "off";
+    REQUIRE_FALSE(osmium::config::use_work_stealing_pool());
+    osmium::detail::env = "no";
+    REQUIRE_FALSE(osmium::config::use_work_stealing_pool());
+
+    osmium::detail::env = "on";
+    REQUIRE(osmium::config::use_work_stealing_pool());
+    osmium::detail::env = "True";
+    REQUIRE(osmium::config::use_work_stealing_pool());
+    osmium::detail::env = "yes";
+    REQUIRE(osmium::config::use_work_stealing_pool());
+    osmium::detail::env = "1";
+    REQUIRE(osmium::config::use_work_stealing_pool());
+}
+
 TEST_CASE("get_max_queue_size") {
     osmium::detail::env = nullptr;
     REQUIRE(osmium::config::get_max_queue_size("NAME", 0) == 2);